@@ -0,0 +1,140 @@
+// Compares the interpreter (VM::run, with and without tier-up) against the same programs
+// compiled ahead of time to C (AOTCompiler) and loaded as shared objects.
+// Usage: aot_benchmark [repetitions]
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "AOTCompiler.h"
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "VM.h"
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"global loop sum",
+     "var total = 0;\n"
+     "for (var i = 0; i < 5000000; i = i + 1) { total = total + i * 2 - 1; }\n"
+     "print(total);\n"},
+    {"recursive fib(27)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(27));\n"},
+    {"nested loops",
+     "var hits = 0;\n"
+     "for (var i = 0; i < 2000; i = i + 1) {\n"
+     "    for (var j = 0; j < 2000; j = j + 1) { if (i > j) { hits = hits + 1; } }\n"
+     "}\n"
+     "print(hits);\n"},
+};
+
+// Runs body with stdout sent to a file, and returns everything it printed
+template <typename Body>
+static std::string captureStdout(const std::string& path, Body body) {
+    std::cout.flush();
+    std::fflush(stdout);
+    int saved = dup(1);
+    int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    dup2(file, 1);
+    close(file);
+    body();
+    std::cout.flush();
+    std::fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// Fastest of several runs, in milliseconds, plus what the first run printed
+template <typename Body>
+static double fastestMilliseconds(int repetitions, const std::string& capturePath, std::string& output, Body body) {
+    double best = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        std::string printed = captureStdout(capturePath, body);
+        auto end = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+        if (i == 0) output = printed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    std::string prefix = "/tmp/cocom_aot_benchmark_" + std::to_string(getpid());
+    std::string capturePath = prefix + ".out";
+
+    std::printf("Fastest of %d runs; milliseconds\n", repetitions);
+    std::printf("%-20s %10s %10s %10s %12s %8s\n", "workload", "VM", "VM tiered", "AOT", "AOT vs VM", "output");
+
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        std::string source = workload.source; // The lexer keeps a reference to its input
+        Lexer lexer(source);
+        std::vector<Token> tokens = lexer.tokenize();
+        Parser parser(tokens);
+        ASTNode* ast = parser.parse();
+        Compiler compiler;
+        std::vector<Bytecode> bytecode = compiler.compile(ast);
+        delete ast;
+        if (bytecode.empty()) {
+            std::fprintf(stderr, "%s: compilation failed\n", workload.name);
+            ++failures;
+            continue;
+        }
+        const std::vector<std::string>& strings = compiler.getStringLiterals();
+
+        std::string interpreted, tiered, native;
+        double vmTime = fastestMilliseconds(repetitions, capturePath, interpreted, [&] {
+            VM vm;
+            vm.setTrace(false);
+            vm.setTierUpThreshold(0);
+            vm.run(bytecode, strings);
+        });
+        double tieredTime = fastestMilliseconds(repetitions, capturePath, tiered, [&] {
+            VM vm;
+            vm.setTrace(false);
+            vm.run(bytecode, strings);
+        });
+
+        std::string library = prefix + ".so";
+        AOTCompiler aot;
+        if (!aot.build(bytecode, strings, library, true)) {
+            ++failures;
+            continue;
+        }
+        void* handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+        unlink(library.c_str());
+        auto run = handle ? reinterpret_cast<double (*)()>(dlsym(handle, "cocom_run")) : nullptr;
+        if (run == nullptr) {
+            std::fprintf(stderr, "%s: could not load the compiled program: %s\n", workload.name, dlerror());
+            ++failures;
+            continue;
+        }
+        double aotTime = fastestMilliseconds(repetitions, capturePath, native, [&] { run(); });
+        dlclose(handle);
+
+        bool same = interpreted == native && tiered == native;
+        if (!same) ++failures;
+        std::printf("%-20s %10.1f %10.1f %10.1f %11.1fx %8s\n", workload.name, vmTime, tieredTime, aotTime,
+                    vmTime / aotTime, same ? "same" : "DIFFERS");
+    }
+    unlink(capturePath.c_str());
+    return failures == 0 ? 0 : 1;
+}
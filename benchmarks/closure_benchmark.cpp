@@ -0,0 +1,132 @@
+// Compares the switch interpreter (VM::run) against the closure-compiled tier and, where it
+// is supported, the baseline JIT, on the same programs. Tier-up is off, so each column runs
+// one execution mode from start to end.
+// Usage: closure_benchmark [repetitions]
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "Compiler.h"
+#include "JIT.h"
+#include "Lexer.h"
+#include "Parser.h"
+#include "VM.h"
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"global loop sum",
+     "var total = 0;\n"
+     "for (var i = 0; i < 5000000; i = i + 1) { total = total + i * 2 - 1; }\n"
+     "print(total);\n"},
+    {"recursive fib(27)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(27));\n"},
+    {"nested loops",
+     "var hits = 0;\n"
+     "for (var i = 0; i < 2000; i = i + 1) {\n"
+     "    for (var j = 0; j < 2000; j = j + 1) { if (i > j) { hits = hits + 1; } }\n"
+     "}\n"
+     "print(hits);\n"},
+    {"locals in a function",
+     "fn collatz(limit) {\n"
+     "    var steps = 0;\n"
+     "    for (var n = 1; n < limit; n = n + 1) {\n"
+     "        var x = n;\n"
+     "        while (x > 1) { var half = x / 2; if (half * 2 == x) { x = half; } else { x = 3 * x + 1; } steps = steps + 1; }\n"
+     "    }\n"
+     "    return steps;\n"
+     "}\n"
+     "print(collatz(30000));\n"},
+};
+
+// Runs body with stdout sent to a file, and returns everything it printed
+template <typename Body>
+static std::string captureStdout(const std::string& path, Body body) {
+    std::cout.flush();
+    std::fflush(stdout);
+    int saved = dup(1);
+    int file = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    dup2(file, 1);
+    close(file);
+    body();
+    std::cout.flush();
+    std::fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+    std::ifstream in(path);
+    std::stringstream text;
+    text << in.rdbuf();
+    return text.str();
+}
+
+// Fastest of several runs of the program in one mode, in milliseconds, plus what the first run printed
+static double fastestMilliseconds(int repetitions, const std::string& capturePath, const std::vector<Bytecode>& bytecode,
+                                  const std::vector<std::string>& strings, bool closures, bool jit, std::string& output) {
+    double best = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        VM vm;
+        vm.setTrace(false);
+        vm.setTierUpThreshold(0);
+        vm.setClosures(closures);
+        vm.setJit(jit);
+        auto start = std::chrono::steady_clock::now();
+        std::string printed = captureStdout(capturePath, [&] { vm.run(bytecode, strings); });
+        auto end = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        if (i == 0 || elapsed < best) best = elapsed;
+        if (i == 0) output = printed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    int repetitions = argc > 1 ? std::max(1, std::atoi(argv[1])) : 3;
+    std::string capturePath = "/tmp/cocom_closure_benchmark_" + std::to_string(getpid()) + ".out";
+    bool jitSupported = JIT::isSupported();
+
+    std::printf("Fastest of %d runs; milliseconds\n", repetitions);
+    std::printf("%-22s %10s %10s %10s %14s %8s\n", "workload", "VM", "closures", "JIT", "closures vs VM", "output");
+
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        std::string source = workload.source; // The lexer keeps a reference to its input
+        Lexer lexer(source);
+        std::vector<Token> tokens = lexer.tokenize();
+        Parser parser(tokens);
+        ASTNode* ast = parser.parse();
+        Compiler compiler;
+        std::vector<Bytecode> bytecode = compiler.compile(ast);
+        delete ast;
+        if (bytecode.empty()) {
+            std::fprintf(stderr, "%s: compilation failed\n", workload.name);
+            ++failures;
+            continue;
+        }
+        const std::vector<std::string>& strings = compiler.getStringLiterals();
+
+        std::string interpreted, closures, jitted;
+        double vmTime = fastestMilliseconds(repetitions, capturePath, bytecode, strings, false, false, interpreted);
+        double closureTime = fastestMilliseconds(repetitions, capturePath, bytecode, strings, true, false, closures);
+        double jitTime = jitSupported ? fastestMilliseconds(repetitions, capturePath, bytecode, strings, false, true, jitted) : 0;
+
+        bool same = interpreted == closures && (!jitSupported || interpreted == jitted);
+        if (!same) ++failures;
+        char jitColumn[32] = "n/a";
+        if (jitSupported) std::snprintf(jitColumn, sizeof(jitColumn), "%.1f", jitTime);
+        std::printf("%-22s %10.1f %10.1f %10s %13.2fx %8s\n", workload.name, vmTime, closureTime, jitColumn,
+                    vmTime / closureTime, same ? "same" : "DIFFERS");
+    }
+    unlink(capturePath.c_str());
+    return failures == 0 ? 0 : 1;
+}
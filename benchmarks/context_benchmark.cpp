@@ -0,0 +1,85 @@
+// Measures how runs of one shared Program scale with threads: each thread owns an
+// ExecutionContext and runs the same compiled program repeatedly, from 1 thread up to N
+// (doubling). Prints runs per second and the speedup over 1 thread; every run's result and
+// output must match the first run's.
+// Usage: context_benchmark [runs per thread] [max threads]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CoCompiler.h"
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"short script",
+     "var greeting = \"hello\";\n"
+     "fn square(n) { return n * n; }\n"
+     "var total = 0;\n"
+     "for (var i = 0; i < 10; i = i + 1) { total = total + square(i); }\n"
+     "print(greeting + \" world\");\n"
+     "print(total);\n"},
+    {"recursive fib(18)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(18));\n"},
+    {"loop 100000",
+     "var total = 0;\n"
+     "for (var i = 0; i < 100000; i = i + 1) { total = total + i * 2; }\n"
+     "print(total);\n"},
+};
+
+int main(int argc, char* argv[]) {
+    int runsPerThread = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+    int maxThreads = argc > 2 ? std::max(1, std::atoi(argv[2])) : std::max(8, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<int> threadCounts;
+    for (int count = 1; count < maxThreads; count *= 2) threadCounts.push_back(count);
+    threadCounts.push_back(maxThreads);
+
+    std::printf("%d runs per thread, %u hardware threads; runs per second (speedup over 1 thread)\n", runsPerThread,
+                std::thread::hardware_concurrency());
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        cocompiler::Program program = cocompiler::compile(workload.source);
+        if (!program.ok()) {
+            std::fprintf(stderr, "%s: %s", workload.name, program.errors().c_str());
+            ++failures;
+            continue;
+        }
+        cocompiler::Result expected = cocompiler::run(program);
+
+        std::printf("%s\n", workload.name);
+        std::atomic<int> mismatches(0);
+        double single = 0;
+        for (int threadCount : threadCounts) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threadCount; ++t) {
+                threads.emplace_back([&] {
+                    cocompiler::ExecutionContext context; // The thread's own state; the program is shared
+                    for (int i = 0; i < runsPerThread; ++i) {
+                        cocompiler::Result result = context.run(program);
+                        if (result.ok != expected.ok || result.value != expected.value || result.output != expected.output) {
+                            mismatches++;
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double rate = threadCount * runsPerThread / seconds;
+            if (threadCount == 1) single = rate;
+            std::printf("  %3d threads %12.0f (%.2fx)\n", threadCount, rate, rate / single);
+        }
+        bool same = expected.ok && mismatches.load() == 0;
+        if (!same) ++failures;
+        std::printf("  output: %s\n", same ? "same" : "DIFFERS");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// Measures request latency through a Daemon on a Unix domain socket: each workload is sent
+// as source many times over one connection (the first request compiles it, the rest hit the
+// program cache), against compiling and running it in-process for every request. Prints the
+// p50 and p99 latency of each; every reply's output must match the in-process run's.
+// Usage: daemon_benchmark [requests]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "CoCompiler.h"
+#include "Daemon.h"
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"expression", "(3 + 4) * 5 - 6 / 2;"},
+    {"short script",
+     "var greeting = \"hello\";\n"
+     "fn square(n) { return n * n; }\n"
+     "var total = 0;\n"
+     "for (var i = 0; i < 10; i = i + 1) { total = total + square(i); }\n"
+     "print(greeting + \" world\");\n"
+     "print(total);\n"},
+    {"recursive fib(12)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(12));\n"},
+};
+
+static double percentile(std::vector<double>& latencies, double fraction) {
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[std::min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()))];
+}
+
+int main(int argc, char* argv[]) {
+    int requests = argc > 1 ? std::max(1, std::atoi(argv[1])) : 20000;
+    std::string path = "/tmp/cocompiler-benchmark-" + std::to_string(getpid()) + ".sock";
+
+    Daemon daemon(1);
+    DaemonClient client;
+    if (!daemon.start(path) || !client.connect(path)) return 1;
+
+    std::printf("%d requests per workload; latency in microseconds\n", requests);
+    std::printf("%-20s %12s %12s %12s %12s %8s\n", "workload", "cold p50", "cold p99", "daemon p50", "daemon p99", "output");
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        std::vector<double> cold, warm;
+        std::string expected;
+        for (int i = 0; i < requests; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            cocompiler::Result result = cocompiler::run(cocompiler::compile(workload.source));
+            cold.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            expected = result.output;
+        }
+
+        bool same = true;
+        std::string source = workload.source, output, errors;
+        daemon_protocol::Reply reply;
+        for (int i = 0; i < requests; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            bool sent = client.runSource(source, reply, output, errors);
+            warm.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            same = same && sent && reply.status == daemon_protocol::Status::OK && output == expected;
+        }
+
+        if (!same) ++failures;
+        std::printf("%-20s %12.1f %12.1f %12.1f %12.1f %8s\n", workload.name, percentile(cold, 0.5), percentile(cold, 0.99),
+                    percentile(warm, 0.5), percentile(warm, 0.99), same ? "same" : "DIFFERS");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+// Compares the startup cost of a script compiled at run time (Lexer, Parser, Compiler) with the
+// same script compiled into this binary by cocom::compile (copying its image into the vectors
+// VM::run takes), and checks that both produce the same bytecode.
+// Usage: embed_benchmark [iterations]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "Compiler.h"
+#include "ConstexprCompiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+#define GLOBAL_LOOP_SUM                                                   \
+    "var total = 0;\n"                                                    \
+    "for (var i = 0; i < 5000000; i = i + 1) { total = total + i * 2 - 1; }\n" \
+    "print(total);\n"
+#define RECURSIVE_FIB                                                                \
+    "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n" \
+    "print(fib(27));\n"
+#define NESTED_LOOPS                                                                    \
+    "var hits = 0;\n"                                                                   \
+    "for (var i = 0; i < 2000; i = i + 1) {\n"                                          \
+    "    for (var j = 0; j < 2000; j = j + 1) { if (i > j) { hits = hits + 1; } }\n" \
+    "}\n"                                                                               \
+    "print(hits);\n"
+#define LOCALS_IN_A_FUNCTION                                                                                                    \
+    "fn collatz(limit) {\n"                                                                                                     \
+    "    var steps = 0;\n"                                                                                                      \
+    "    for (var n = 1; n < limit; n = n + 1) {\n"                                                                             \
+    "        var x = n;\n"                                                                                                      \
+    "        while (x > 1) { var half = x / 2; if (half * 2 == x) { x = half; } else { x = 3 * x + 1; } steps = steps + 1; }\n" \
+    "    }\n"                                                                                                                   \
+    "    return steps;\n"                                                                                                       \
+    "}\n"                                                                                                                       \
+    "print(collatz(30000));\n"
+#define STRINGS_AND_BRANCHES                                                           \
+    "var greeting = \"hello\";\n"                                                      \
+    "var name = \"world\";\n"                                                          \
+    "fn classify(n) { if (n < 0) { return 0 - 1; } else if (n == 0) { return 0; } return 1; }\n" \
+    "for (var i = 0 - 2; i <= 2; i = i + 1) {\n"                                       \
+    "    var sign = classify(i);\n"                                                    \
+    "    if (sign < 0) { print(\"negative\"); } else if (sign == 0) { print(greeting + \", \" + name); }\n" \
+    "    else { print(\"positive\"); }\n"                                              \
+    "}\n"
+
+COCOM_EMBED(kGlobalLoopSum, GLOBAL_LOOP_SUM);
+COCOM_EMBED(kRecursiveFib, RECURSIVE_FIB);
+COCOM_EMBED(kNestedLoops, NESTED_LOOPS);
+COCOM_EMBED(kLocalsInAFunction, LOCALS_IN_A_FUNCTION);
+COCOM_EMBED(kStringsAndBranches, STRINGS_AND_BRANCHES);
+
+using Image = decltype(kGlobalLoopSum);
+
+struct Workload {
+    const char* name;
+    const char* source;
+    const Image* image;
+};
+
+static const Workload kWorkloads[] = {
+    {"global loop sum", GLOBAL_LOOP_SUM, &kGlobalLoopSum},
+    {"recursive fib", RECURSIVE_FIB, &kRecursiveFib},
+    {"nested loops", NESTED_LOOPS, &kNestedLoops},
+    {"locals in a function", LOCALS_IN_A_FUNCTION, &kLocalsInAFunction},
+    {"strings and branches", STRINGS_AND_BRANCHES, &kStringsAndBranches},
+};
+
+// Average time of one call of body over many, in microseconds
+template <typename Body>
+static double averageMicroseconds(int iterations, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+    std::printf("Average of %d startups; microseconds\n", iterations);
+    std::printf("%-22s %6s %12s %10s %10s %10s\n", "workload", "instrs", "run-time", "embedded", "speedup", "bytecode");
+
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        std::vector<Bytecode> compiled;
+        std::vector<std::string> compiledStrings;
+        double runtime = averageMicroseconds(iterations, [&] {
+            std::string source = workload.source; // The lexer keeps a reference to its input
+            Lexer lexer(source);
+            std::vector<Token> tokens = lexer.tokenize();
+            Parser parser(tokens);
+            ASTNode* ast = parser.parse();
+            Compiler compiler;
+            compiled = compiler.compile(ast);
+            compiledStrings = compiler.getStringLiterals();
+            delete ast;
+        });
+
+        std::vector<Bytecode> embedded;
+        std::vector<std::string> embeddedStrings;
+        double image = averageMicroseconds(iterations, [&] {
+            embedded = workload.image->bytecode();
+            embeddedStrings = workload.image->strings();
+        });
+
+        bool same = !compiled.empty() && compiled == embedded && compiledStrings == embeddedStrings;
+        if (!same) ++failures;
+        std::printf("%-22s %6zu %12.2f %10.2f %9.0fx %10s\n", workload.name, embedded.size(), runtime, image,
+                    runtime / image, same ? "same" : "DIFFERS");
+    }
+    return failures == 0 ? 0 : 1;
+}
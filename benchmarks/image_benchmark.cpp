@@ -0,0 +1,102 @@
+// Compares the cold-start cost of running a script from source (reading, lexing, parsing and
+// compiling it) with loading the same program from a bytecode image (mapping and checking a
+// .cocb file), for generated scripts of growing size, and checks that both give the VM the same
+// instructions and strings.
+// Usage: image_benchmark [iterations]
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BytecodeImage.h"
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+// A script of the given number of functions, each called from a loop, with globals and strings
+static std::string generateScript(int functions) {
+    std::ostringstream source;
+    source << "var total = 0;\n";
+    for (int f = 0; f < functions; ++f) {
+        source << "fn step" << f << "(n) {\n"
+               << "    var x = n * " << (f % 7 + 2) << ";\n"
+               << "    if (x > " << f << ") { x = x - " << f << "; } else { x = x + 1; }\n"
+               << "    while (x > 100) { x = x / 2; }\n"
+               << "    return x;\n"
+               << "}\n"
+               << "var label" << f << " = \"step " << f << "\";\n";
+    }
+    source << "for (var i = 0; i < 10; i = i + 1) {\n";
+    for (int f = 0; f < functions; ++f) source << "    total = total + step" << f << "(i);\n";
+    source << "}\nprint(total);\n";
+    return source.str();
+}
+
+// Average time of one call of body over many, in microseconds
+template <typename Body>
+static double averageMicroseconds(int iterations, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(end - start).count() / iterations;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+    std::string base = "/tmp/cocom_image_benchmark_" + std::to_string(getpid());
+    std::string sourcePath = base + ".cocom";
+    std::string imagePath = base + ".cocb";
+
+    std::printf("Average of %d cold starts; microseconds\n", iterations);
+    std::printf("%-10s %8s %12s %10s %10s %10s\n", "functions", "instrs", "source", "image", "speedup", "program");
+
+    int failures = 0;
+    for (int functions : {10, 100, 1000, 5000}) {
+        {
+            std::ofstream file(sourcePath);
+            file << generateScript(functions);
+        }
+
+        std::vector<Bytecode> compiled;
+        std::vector<std::string> compiledStrings;
+        int globals = 0;
+        double fromSource = averageMicroseconds(iterations, [&] {
+            std::ifstream file(sourcePath);
+            std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            Lexer lexer(source);
+            std::vector<Token> tokens = lexer.tokenize();
+            Parser parser(tokens);
+            ASTNode* ast = parser.parse();
+            Compiler compiler;
+            compiled = compiler.compile(ast);
+            compiledStrings = compiler.getStringLiterals();
+            globals = compiler.getGlobalCount();
+            delete ast;
+        });
+        if (compiled.empty() ||
+            !BytecodeImage::write(imagePath, compiled, compiledStrings, static_cast<uint32_t>(globals), 0)) {
+            std::fprintf(stderr, "%d functions: compilation failed\n", functions);
+            ++failures;
+            continue;
+        }
+
+        bool same = true;
+        double fromImage = averageMicroseconds(iterations, [&] {
+            BytecodeImage image;
+            same = image.load(imagePath) && image.size() == compiled.size() &&
+                   std::equal(compiled.begin(), compiled.end(), image.code()) && image.strings() == compiledStrings &&
+                   image.globalCount() == static_cast<uint32_t>(globals);
+        });
+
+        if (!same) ++failures;
+        std::printf("%-10d %8zu %12.1f %10.1f %9.0fx %10s\n", functions, compiled.size(), fromSource, fromImage,
+                    fromSource / fromImage, same ? "same" : "DIFFERS");
+    }
+    unlink(sourcePath.c_str());
+    unlink(imagePath.c_str());
+    return failures == 0 ? 0 : 1;
+}
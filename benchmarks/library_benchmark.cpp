@@ -0,0 +1,74 @@
+// Measures libcocompiler's compile-once, run-many use: each workload is compiled once with
+// cocompiler::compile, then run repeatedly with cocompiler::run from 1, 2, 4 and 8 threads at
+// once. Every run's result and printed output must match the first run's.
+// Usage: library_benchmark [runs per thread]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CoCompiler.h"
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"expression", "(3 + 4) * 5 - 6 / 2;"},
+    {"short script",
+     "var greeting = \"hello\";\n"
+     "fn square(n) { return n * n; }\n"
+     "var total = 0;\n"
+     "for (var i = 0; i < 10; i = i + 1) { total = total + square(i); }\n"
+     "print(greeting);\n"
+     "print(total);\n"},
+    {"recursive fib(18)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(18));\n"},
+};
+
+int main(int argc, char* argv[]) {
+    int runsPerThread = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+    std::printf("%d runs per thread; runs per second\n", runsPerThread);
+    std::printf("%-20s %12s %12s %12s %12s %8s\n", "workload", "1 thread", "2 threads", "4 threads", "8 threads", "output");
+
+    int failures = 0;
+    for (const Workload& workload : kWorkloads) {
+        cocompiler::Program program = cocompiler::compile(workload.source);
+        if (!program.ok()) {
+            std::fprintf(stderr, "%s: %s", workload.name, program.errors().c_str());
+            ++failures;
+            continue;
+        }
+        cocompiler::Result expected = cocompiler::run(program);
+
+        std::printf("%-20s", workload.name);
+        std::atomic<int> mismatches(0);
+        for (int threadCount : {1, 2, 4, 8}) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> threads;
+            for (int t = 0; t < threadCount; ++t) {
+                threads.emplace_back([&] {
+                    for (int i = 0; i < runsPerThread; ++i) {
+                        cocompiler::Result result = cocompiler::run(program);
+                        if (result.ok != expected.ok || result.value != expected.value || result.output != expected.output) {
+                            mismatches++;
+                        }
+                    }
+                });
+            }
+            for (std::thread& thread : threads) thread.join();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf(" %12.0f", threadCount * runsPerThread / seconds);
+        }
+        bool same = expected.ok && mismatches.load() == 0;
+        if (!same) ++failures;
+        std::printf(" %8s\n", same ? "same" : "DIFFERS");
+    }
+    return failures == 0 ? 0 : 1;
+}
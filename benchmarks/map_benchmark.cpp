@@ -0,0 +1,93 @@
+// Compares HashMap (the VM's map type) against std::unordered_map on the same workloads.
+// Usage: map_benchmark [key count]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "HashMap.h"
+
+// Pseudo-random keys (splitmix64), so neither table benefits from sequential keys
+static std::vector<int64_t> makeKeys(size_t count, uint64_t seed) {
+    std::vector<int64_t> keys(count);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t x = (seed += 0x9e3779b97f4a7c15ULL);
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+        keys[i] = static_cast<int64_t>(x ^ (x >> 31));
+    }
+    return keys;
+}
+
+template <typename Body>
+static double nanosecondsPerOp(size_t ops, Body body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(ops);
+}
+
+static void report(const char* workload, double hashMap, double unorderedMap, double checksum) {
+    std::printf("%-22s %10.1f %14.1f %8.2fx   (checksum %.0f)\n", workload, hashMap, unorderedMap, unorderedMap / hashMap, checksum);
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000;
+    std::vector<int64_t> keys = makeKeys(count, 1);
+    std::vector<int64_t> missing = makeKeys(count, 2);
+    // Lookups visit keys in a different order than they were inserted, so std::unordered_map's
+    // nodes (allocated in insertion order) do not get a sequential-access advantage
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i) order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+    std::vector<StringObject> stringKeys;
+    std::vector<std::string> plainStrings;
+    for (size_t i = 0; i < count; ++i) {
+        plainStrings.push_back("key_" + std::to_string(keys[i]));
+        stringKeys.emplace_back(plainStrings.back());
+    }
+
+    std::printf("%zu keys; nanoseconds per operation\n", count);
+    std::printf("%-22s %10s %14s %9s\n", "workload", "HashMap", "unordered_map", "speedup");
+
+    HashMap map;
+    std::unordered_map<int64_t, double> reference;
+    double sink = 0;
+
+    double a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) map.set(keys[i], static_cast<double>(i)); });
+    double b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) reference[keys[i]] = static_cast<double>(i); });
+    report("insert int", a, b, static_cast<double>(map.size()));
+
+    double hashMapSum = 0, referenceSum = 0;
+    a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) hashMapSum += *map.find(keys[order[i]]); });
+    b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) referenceSum += reference.find(keys[order[i]])->second; });
+    report("lookup int (hit)", a, b, hashMapSum - referenceSum);
+
+    size_t hashMapFound = 0, referenceFound = 0;
+    a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) hashMapFound += map.find(missing[i]) != nullptr; });
+    b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) referenceFound += reference.find(missing[i]) != reference.end(); });
+    report("lookup int (miss)", a, b, static_cast<double>(hashMapFound + referenceFound));
+
+    a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; i += 2) map.erase(keys[i]); for (size_t i = 0; i < count; i += 2) map.set(keys[i], 1.0); });
+    b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; i += 2) reference.erase(keys[i]); for (size_t i = 0; i < count; i += 2) reference[keys[i]] = 1.0; });
+    report("erase + reinsert int", a, b, static_cast<double>(map.size()) - static_cast<double>(reference.size()));
+
+    HashMap stringMap;
+    std::unordered_map<std::string, double> stringReference;
+    a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) stringMap.set(stringKeys[i], static_cast<double>(i)); });
+    b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) stringReference[plainStrings[i]] = static_cast<double>(i); });
+    report("insert string", a, b, static_cast<double>(stringMap.size()));
+
+    // The VM reuses the same StringObject for a literal key, so its hash is computed once
+    hashMapSum = referenceSum = 0;
+    a = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) hashMapSum += *stringMap.find(stringKeys[order[i]]); });
+    b = nanosecondsPerOp(count, [&] { for (size_t i = 0; i < count; ++i) referenceSum += stringReference.find(plainStrings[order[i]])->second; });
+    report("lookup string (hit)", a, b, hashMapSum - referenceSum);
+
+    sink += hashMapSum;
+    return sink < 0 ? 1 : 0;
+}
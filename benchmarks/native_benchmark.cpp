@@ -0,0 +1,69 @@
+// Measures calls to host functions bound through a NativeTable: a loop calling a bound C++
+// function against the same loop calling an equivalent script function and the same loop
+// computing the value inline, in the interpreter and in the closure tier. All three loops must
+// print the same total. Usage: native_benchmark [iterations]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include "CoCompiler.h"
+
+static double scale(double value, int factor) { return value * factor + 1; }
+
+struct Variant {
+    const char* name;
+    std::string source;
+};
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000000;
+    std::string count = std::to_string(iterations);
+
+    NativeTable natives;
+    natives.bind("scale", &scale);
+    cocompiler::Options options;
+    options.natives = &natives;
+
+    const Variant variants[] = {
+        {"inline", "var total = 0;\n"
+                   "for (var i = 0; i < " + count + "; i = i + 1) { total = total + (i * 3 + 1); }\n"
+                   "print(total);\n"},
+        {"script function", "fn script_scale(value, factor) { return value * factor + 1; }\n"
+                            "var total = 0;\n"
+                            "for (var i = 0; i < " + count + "; i = i + 1) { total = total + script_scale(i, 3); }\n"
+                            "print(total);\n"},
+        {"host function", "var total = 0;\n"
+                          "for (var i = 0; i < " + count + "; i = i + 1) { total = total + scale(i, 3); }\n"
+                          "print(total);\n"},
+    };
+
+    std::printf("%d iterations; ns per iteration\n", iterations);
+    std::printf("%-16s %12s %12s %8s\n", "loop body", "interpreter", "closures", "output");
+
+    int failures = 0;
+    std::string expected;
+    for (const Variant& variant : variants) {
+        cocompiler::Program program = cocompiler::compile(variant.source, options);
+        if (!program.ok()) {
+            std::fprintf(stderr, "%s: %s", variant.name, program.errors().c_str());
+            ++failures;
+            continue;
+        }
+        std::printf("%-16s", variant.name);
+        bool same = true;
+        for (bool closures : {false, true}) {
+            cocompiler::Inputs inputs;
+            inputs.closures = closures;
+            auto start = std::chrono::steady_clock::now();
+            cocompiler::Result result = cocompiler::run(program, inputs);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::printf(" %12.1f", seconds * 1e9 / iterations);
+            if (expected.empty()) expected = result.output;
+            same = same && result.ok && result.output == expected;
+        }
+        if (!same) ++failures;
+        std::printf(" %8s\n", same ? "same" : "DIFFERS");
+    }
+    return failures == 0 ? 0 : 1;
+}
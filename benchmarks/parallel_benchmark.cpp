@@ -0,0 +1,76 @@
+// Measures how the parallel array kernels scale from 1 to N threads, and checks that
+// floating-point results are identical for every thread count.
+// Usage: parallel_benchmark [element count] [max threads]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include "Array.h"
+#include "ThreadPool.h"
+
+template <typename Body>
+static double milliseconds(Body body) {
+    auto start = std::chrono::steady_clock::now();
+    body();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static uint64_t bitsOf(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : (1u << 24);
+    size_t maxThreads = argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)) : std::thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+
+    // Values with many significant bits, so any change in summation order would show
+    Array values(ElementType::FLOAT64, count);
+    uint64_t state = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        values.float64Data()[i] = static_cast<double>(state >> 11) / 9007199254740992.0 - 0.25;
+    }
+
+    std::printf("%zu elements; milliseconds (speedup over 1 thread)\n", count);
+    std::printf("%-8s %16s %16s %16s %16s %16s\n", "threads", "sum", "add", "scan", "filter", "sort");
+
+    double base[5] = {0};
+    uint64_t sumBits = 0;
+    uint64_t scanBits = 0;
+    bool deterministic = true;
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool::setSharedThreadCount(threads);
+        double sum = 0;
+        double times[5];
+        times[0] = milliseconds([&] { sum = ArrayKernels::sum(values); });
+        times[1] = milliseconds([&] { Array doubled = ArrayKernels::add(values, values); });
+        Array prefix(ElementType::FLOAT64, 0);
+        times[2] = milliseconds([&] { prefix = ArrayKernels::scan(values); });
+        times[3] = milliseconds([&] {
+            Array positive = ArrayKernels::filter(values, ArrayKernels::compare(values, 0.0, CompareOp::GREATER));
+        });
+        times[4] = milliseconds([&] { Array sorted = ArrayKernels::sort(values); });
+
+        if (threads == 1) {
+            for (int i = 0; i < 5; ++i) base[i] = times[i];
+            sumBits = bitsOf(sum);
+            scanBits = bitsOf(prefix.float64Data()[count - 1]);
+        } else if (bitsOf(sum) != sumBits || bitsOf(prefix.float64Data()[count - 1]) != scanBits) {
+            deterministic = false;
+        }
+        std::printf("%-8zu", threads);
+        for (int i = 0; i < 5; ++i) {
+            std::printf(" %9.2f (%4.2fx)", times[i], base[i] / times[i]);
+        }
+        std::printf("\n");
+        if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2; // Always end at maxThreads
+    }
+    std::printf("floating-point results identical across thread counts: %s\n", deterministic ? "yes" : "NO");
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+// Measures high rates of small runs: a fresh ExecutionContext per run (cocompiler::run) against
+// warmed contexts borrowed from a ContextPool, running into a reused Result. Every operator new
+// is counted; once the pool is warm, its runs must not allocate at all, and their output must
+// match the fresh runs'.
+// Usage: pool_benchmark [runs]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "CoCompiler.h"
+
+static std::atomic<size_t> allocations(0);
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    size_t align = static_cast<size_t>(alignment);
+    if (void* memory = std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { std::free(memory); }
+
+struct Workload {
+    const char* name;
+    const char* source;
+};
+
+static const Workload kWorkloads[] = {
+    {"expression", "(3 + 4) * 5 - 6 / 2;"},
+    {"short script",
+     "var greeting = \"hello\";\n"
+     "fn square(n) { return n * n; }\n"
+     "var total = 0;\n"
+     "for (var i = 0; i < 10; i = i + 1) { total = total + square(i); }\n"
+     "print(greeting + \", world of many words, longer than a short string\");\n"
+     "print(total);\n"},
+    {"recursive fib(12)",
+     "fn fib(n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+     "print(fib(12));\n"},
+};
+
+int main(int argc, char* argv[]) {
+    int runs = argc > 1 ? std::max(1, std::atoi(argv[1])) : 100000;
+
+    std::printf("%d runs; runs per second, and allocations per run\n", runs);
+    std::printf("%-20s %12s %10s %12s %10s %8s\n", "workload", "fresh", "allocs", "pooled", "allocs", "output");
+    int failures = 0;
+    cocompiler::ContextPool pool(1);
+    for (const Workload& workload : kWorkloads) {
+        cocompiler::Program program = cocompiler::compile(workload.source);
+        if (!program.ok()) {
+            std::fprintf(stderr, "%s: %s", workload.name, program.errors().c_str());
+            ++failures;
+            continue;
+        }
+        cocompiler::Result expected = cocompiler::run(program);
+
+        bool same = expected.ok;
+        size_t before = allocations.load();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i) {
+            cocompiler::Result result = cocompiler::run(program);
+            same = same && result.value == expected.value && result.output == expected.output;
+        }
+        double freshSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t freshAllocations = allocations.load() - before;
+
+        pool.warm(program);
+        cocompiler::Result result;
+        pool.run(program, cocompiler::Inputs(), result); // Grows result's buffers
+        before = allocations.load();
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; ++i) {
+            pool.run(program, cocompiler::Inputs(), result);
+            same = same && result.ok && result.value == expected.value && result.output == expected.output;
+        }
+        double pooledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t pooledAllocations = allocations.load() - before;
+
+        if (!same || pooledAllocations != 0) ++failures;
+        std::printf("%-20s %12.0f %10.1f %12.0f %10.1f %8s\n", workload.name, runs / freshSeconds,
+                    static_cast<double>(freshAllocations) / runs, runs / pooledSeconds,
+                    static_cast<double>(pooledAllocations) / runs, same ? "same" : "DIFFERS");
+    }
+    if (failures) std::printf("FAILED: pooled runs allocated or printed something else\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+// Measures cooperative M:N scheduling with ExecutionContext::step: many script runs share a few
+// threads, each thread cycling through its runs one slice of fuel at a time, against running
+// each script to completion in turn. A few of the scripts are long; the rest are short. Prints
+// the wall time, how long a thread stays inside one run() or step() call (which is what other
+// work on that thread waits for; the maximum includes any preemption by the OS), and when the
+// short scripts finished. Every run's output must match between the two schedules.
+// Usage: step_benchmark [scripts] [threads] [fuel]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CoCompiler.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const char* kShort =
+    "var total = 0;\n"
+    "for (var i = 0; i < 200; i = i + 1) { total = total + i; }\n"
+    "print(total);\n";
+static const char* kLong =
+    "var total = 0;\n"
+    "for (var i = 0; i < 5000000; i = i + 1) { total = total + i; }\n"
+    "print(total);\n";
+static const size_t kLongEvery = 1000; // One script in this many is long
+
+struct Schedule {
+    double seconds = 0;
+    std::vector<double> calls;            // Time inside each run() or step() call
+    std::vector<double> short_done;       // When each short script finished, from the start
+    std::vector<std::string> outputs;     // Per script
+};
+
+static double since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static double percentile(std::vector<double> values, double fraction) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()))];
+}
+
+// Runs script i's program on thread i % threads, with run() if fuel is 0, otherwise in slices
+static Schedule schedule(const cocompiler::Program& shortProgram, const cocompiler::Program& longProgram, size_t scripts,
+                         size_t threads, uint64_t fuel, const cocompiler::Inputs& inputs) {
+    Schedule result;
+    result.outputs.resize(scripts);
+    std::vector<double> done(scripts, 0);
+    std::vector<std::vector<double>> calls(threads);
+    Clock::time_point start = Clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<size_t> mine;
+            for (size_t i = t; i < scripts; i += threads) mine.push_back(i);
+            std::vector<std::unique_ptr<cocompiler::ExecutionContext>> contexts;
+            std::vector<cocompiler::Result> results(mine.size());
+            for (size_t k = 0; k < mine.size(); ++k) contexts.emplace_back(new cocompiler::ExecutionContext());
+            const cocompiler::Program* programs[] = {&shortProgram, &longProgram};
+
+            if (fuel == 0) {
+                for (size_t k = 0; k < mine.size(); ++k) {
+                    Clock::time_point call = Clock::now();
+                    contexts[k]->run(*programs[mine[k] % kLongEvery == 0], inputs, results[k]);
+                    calls[t].push_back(since(call));
+                    done[mine[k]] = since(start);
+                }
+            } else {
+                std::vector<size_t> active;
+                for (size_t k = 0; k < mine.size(); ++k) {
+                    if (contexts[k]->begin(*programs[mine[k] % kLongEvery == 0], inputs, results[k])) active.push_back(k);
+                }
+                while (!active.empty()) { // Round robin over the unfinished runs
+                    size_t kept = 0;
+                    for (size_t k : active) {
+                        Clock::time_point call = Clock::now();
+                        bool over = contexts[k]->step(fuel, results[k]);
+                        calls[t].push_back(since(call));
+                        if (over) done[mine[k]] = since(start);
+                        else active[kept++] = k;
+                    }
+                    active.resize(kept);
+                }
+            }
+            for (size_t k = 0; k < mine.size(); ++k) result.outputs[mine[k]] = results[k].output + results[k].errors;
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    result.seconds = since(start);
+    for (const std::vector<double>& thread : calls) result.calls.insert(result.calls.end(), thread.begin(), thread.end());
+    for (size_t i = 0; i < scripts; ++i) {
+        if (i % kLongEvery != 0) result.short_done.push_back(done[i]);
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    size_t scripts = argc > 1 ? std::max(2, std::atoi(argv[1])) : 10000;
+    size_t threads = argc > 2 ? std::max(1, std::atoi(argv[2])) : std::max(1u, std::thread::hardware_concurrency());
+    uint64_t fuel = argc > 3 ? std::max(1, std::atoi(argv[3])) : 10000;
+
+    cocompiler::Program shortProgram = cocompiler::compile(kShort);
+    cocompiler::Program longProgram = cocompiler::compile(kLong);
+    if (!shortProgram.ok() || !longProgram.ok()) return 1;
+    cocompiler::Inputs inputs;
+    inputs.max_frames = 64; // Thousands of paused runs are alive at once
+
+    std::printf("%zu scripts (1 in %zu long) on %zu threads; fuel %llu instructions per slice; times in ms\n", scripts,
+                kLongEvery, threads, static_cast<unsigned long long>(fuel));
+    std::printf("%-18s %10s %12s %12s %12s %12s\n", "schedule", "total", "call p99.9", "call max", "short p50", "short p99");
+    Schedule whole = schedule(shortProgram, longProgram, scripts, threads, 0, inputs);
+    Schedule stepped = schedule(shortProgram, longProgram, scripts, threads, fuel, inputs);
+    for (const Schedule* s : {&whole, &stepped}) {
+        std::printf("%-18s %10.1f %12.3f %12.3f %12.1f %12.1f\n", s == &whole ? "run to completion" : "stepped",
+                    s->seconds * 1e3, percentile(s->calls, 0.999) * 1e3, percentile(s->calls, 1.0) * 1e3,
+                    percentile(s->short_done, 0.5) * 1e3, percentile(s->short_done, 0.99) * 1e3);
+    }
+    bool same = whole.outputs == stepped.outputs;
+    std::printf("output: %s\n", same ? "same" : "DIFFERS");
+    return same ? 0 : 1;
+}
@@ -18,7 +18,16 @@ public:
         PRINT_STATEMENT,       // New: For print statements
         STRING_LITERAL,        // New: For string literals
         BOOLEAN_LITERAL,       // New: For boolean literals (true/false)
-        UNARY_EXPRESSION       // New: For unary expressions like !true, -5
+        UNARY_EXPRESSION,      // New: For unary expressions like !true, -5
+        WHILE_STATEMENT,       // For while loops
+        FOR_STATEMENT,         // For C-style for loops
+        PARALLEL_FOR_STATEMENT, // For parallel for loops
+        FUNCTION_DECLARATION,  // For declarations like fn add(a, b) { ... }
+        CALL_EXPRESSION,       // For calls like add(1, 2)
+        RETURN_STATEMENT,      // For return statements
+        NUMBER,                // Dynamically typed number (function parameters and call results)
+        ARRAY,                 // Handle to a numeric array (array literals and array-valued builtins)
+        MAP                    // Handle to a map from integer or string keys to numbers
     };
 
     virtual ~ASTNode() = default;
@@ -124,6 +133,118 @@ public:
     Type getType() const override { return value->getType(); }
 };
 
+// --- Call Expression Node ---
+class CallExpression : public Expression {
+private:
+    Token callee; // The token for the function name
+    std::vector<Expression*> arguments;
+
+public:
+    CallExpression(Token callee, const std::vector<Expression*>& arguments)
+        : callee(callee), arguments(arguments) {}
+
+    ~CallExpression() {
+        for (Expression* arg : arguments) {
+            delete arg;
+        }
+    }
+
+    Token getCallee() const { return callee; }
+    const std::vector<Expression*>& getArguments() const { return arguments; }
+
+    std::string toString() const override {
+        std::string s = "Call(" + callee.value;
+        for (size_t i = 0; i < arguments.size(); ++i) {
+            s += (i == 0 ? ": " : ", ") + arguments[i]->toString();
+        }
+        s += ")";
+        return s;
+    }
+    // Functions take and return numbers
+    Type getType() const override { return Type::NUMBER; }
+};
+
+// --- Array Literal Node ---
+class ArrayLiteral : public Expression {
+private:
+    Token bracket; // The '[' token, for error reporting
+    std::vector<Expression*> elements;
+
+public:
+    ArrayLiteral(Token bracket, const std::vector<Expression*>& elements)
+        : bracket(bracket), elements(elements) {}
+
+    ~ArrayLiteral() {
+        for (Expression* element : elements) {
+            delete element;
+        }
+    }
+
+    Token getBracket() const { return bracket; }
+    const std::vector<Expression*>& getElements() const { return elements; }
+
+    std::string toString() const override {
+        std::string s = "ArrayLiteral(";
+        for (size_t i = 0; i < elements.size(); ++i) {
+            s += (i == 0 ? "" : ", ") + elements[i]->toString();
+        }
+        s += ")";
+        return s;
+    }
+    Type getType() const override { return Type::ARRAY; }
+};
+
+// --- Index Expression Node ---
+class IndexExpression : public Expression {
+private:
+    Expression* array;
+    Token bracket; // The '[' token, for error reporting
+    Expression* index;
+
+public:
+    IndexExpression(Expression* array, Token bracket, Expression* index)
+        : array(array), bracket(bracket), index(index) {}
+
+    ~IndexExpression() {
+        delete array;
+        delete index;
+    }
+
+    Expression* getArray() const { return array; }
+    Token getBracket() const { return bracket; }
+    Expression* getIndex() const { return index; }
+
+    std::string toString() const override {
+        return "Index(" + array->toString() + "[" + index->toString() + "])";
+    }
+    // Element types are only known at runtime (INT64 arrays may be promoted to FLOAT64)
+    Type getType() const override { return Type::NUMBER; }
+};
+
+// --- Index Assignment Expression Node ---
+class IndexAssignmentExpression : public Expression {
+private:
+    IndexExpression* target; // The element being assigned to
+    Expression* value;
+
+public:
+    IndexAssignmentExpression(IndexExpression* target, Expression* value)
+        : target(target), value(value) {}
+
+    ~IndexAssignmentExpression() {
+        delete target;
+        delete value;
+    }
+
+    IndexExpression* getTarget() const { return target; }
+    Expression* getValue() const { return value; }
+
+    std::string toString() const override {
+        return "IndexAssignment(" + target->toString() + " = " + value->toString() + ")";
+    }
+    Type getType() const override { return Type::NUMBER; }
+};
+
 // --- Binary Expression Node ---
 class BinaryExpression : public Expression {
 private:
@@ -285,4 +406,152 @@ public:
     Type getType() const override { return Type::PRINT_STATEMENT; }
 };
 
+// --- While Statement Node ---
+class WhileStatement : public ASTNode {
+private:
+    Expression* condition;
+    ASTNode* body; // The loop body block
+
+public:
+    WhileStatement(Expression* condition, ASTNode* body) : condition(condition), body(body) {}
+
+    ~WhileStatement() {
+        delete condition;
+        delete body;
+    }
+
+    Expression* getCondition() const { return condition; }
+    ASTNode* getBody() const { return body; }
+
+    std::string toString() const override {
+        return "WhileStatement(Condition: " + condition->toString() + ", Body: " + body->toString() + ")";
+    }
+    Type getType() const override { return Type::WHILE_STATEMENT; }
+};
+
+// --- For Statement Node ---
+class ForStatement : public ASTNode {
+private:
+    ASTNode* initializer;  // Optional: a variable declaration or expression
+    Expression* condition; // Optional: loops forever when absent
+    Expression* increment; // Optional: evaluated after each iteration
+    ASTNode* body;         // The loop body block
+
+public:
+    ForStatement(ASTNode* initializer, Expression* condition, Expression* increment, ASTNode* body)
+        : initializer(initializer), condition(condition), increment(increment), body(body) {}
+
+    ~ForStatement() {
+        delete initializer;
+        delete condition;
+        delete increment;
+        delete body;
+    }
+
+    ASTNode* getInitializer() const { return initializer; }
+    Expression* getCondition() const { return condition; }
+    Expression* getIncrement() const { return increment; }
+    ASTNode* getBody() const { return body; }
+
+    std::string toString() const override {
+        std::string s = "ForStatement(";
+        s += "Init: " + (initializer ? initializer->toString() : std::string("none"));
+        s += ", Condition: " + (condition ? condition->toString() : std::string("none"));
+        s += ", Increment: " + (increment ? increment->toString() : std::string("none"));
+        s += ", Body: " + body->toString() + ")";
+        return s;
+    }
+    Type getType() const override { return Type::FOR_STATEMENT; }
+};
+
+// --- Parallel For Statement Node ---
+/**
+ * @brief A reduction clause entry of a parallel for, like `+: total`.
+ */
+struct ReductionClause {
+    Token op;       // PLUS, STAR, or the identifier min or max
+    Token variable; // The reduced variable
+};
+
+class ParallelForStatement : public ASTNode {
+private:
+    Token keyword;     // The 'parallel' token, for error reporting
+    ForStatement* loop; // The loop header and body
+    std::vector<ReductionClause> reductions; // From the optional reduce(...) clause
+
+public:
+    ParallelForStatement(Token keyword, ForStatement* loop, const std::vector<ReductionClause>& reductions)
+        : keyword(keyword), loop(loop), reductions(reductions) {}
+
+    ~ParallelForStatement() {
+        delete loop;
+    }
+
+    Token getKeyword() const { return keyword; }
+    ForStatement* getLoop() const { return loop; }
+    const std::vector<ReductionClause>& getReductions() const { return reductions; }
+
+    std::string toString() const override {
+        std::string s = "ParallelForStatement(";
+        for (const ReductionClause& reduction : reductions) {
+            s += "Reduce " + reduction.op.value + ": " + reduction.variable.value + ", ";
+        }
+        s += loop->toString() + ")";
+        return s;
+    }
+    Type getType() const override { return Type::PARALLEL_FOR_STATEMENT; }
+};
+
+// --- Function Declaration Node ---
+class FunctionDeclaration : public ASTNode {
+private:
+    Token name;
+    std::vector<Token> parameters;
+    ASTNode* body; // The function body block
+
+public:
+    FunctionDeclaration(Token name, const std::vector<Token>& parameters, ASTNode* body)
+        : name(name), parameters(parameters), body(body) {}
+
+    ~FunctionDeclaration() {
+        delete body;
+    }
+
+    Token getName() const { return name; }
+    const std::vector<Token>& getParameters() const { return parameters; }
+    ASTNode* getBody() const { return body; }
+
+    std::string toString() const override {
+        std::string s = "FunctionDeclaration(" + name.value + "(";
+        for (size_t i = 0; i < parameters.size(); ++i) {
+            s += (i == 0 ? "" : ", ") + parameters[i].value;
+        }
+        s += "), Body: " + body->toString() + ")";
+        return s;
+    }
+    Type getType() const override { return Type::FUNCTION_DECLARATION; }
+};
+
+// --- Return Statement Node ---
+class ReturnStatement : public ASTNode {
+private:
+    Token keyword;     // The 'return' token, for error reporting
+    Expression* value; // Optional: the returned expression
+
+public:
+    ReturnStatement(Token keyword, Expression* value = nullptr) : keyword(keyword), value(value) {}
+
+    ~ReturnStatement() {
+        delete value;
+    }
+
+    Token getKeyword() const { return keyword; }
+    Expression* getValue() const { return value; }
+
+    std::string toString() const override {
+        return "ReturnStatement(" + (value ? value->toString() : std::string("")) + ")";
+    }
+    Type getType() const override { return Type::RETURN_STATEMENT; }
+};
+
 #endif // AST_H
@@ -1,6 +1,8 @@
 #ifndef BYTECODE_H
 #define BYTECODE_H
 
+#include <cstddef>
+#include <vector>
 #include "Tokens.h"
 
 // --- VM Instructions ---
@@ -37,7 +39,74 @@ enum class Instruction {
     PUSH_STRING = 23,    // Push a string literal index onto the stack
     CONCAT_STRING = 24,   // Pop two string indices, concatenate strings, push new string index
     PRINT_VALUE = 25,     // Pop value from stack and print it (number or boolean)
-    PRINT_STRING = 26     // Pop string index from stack and print the string literal
+    PRINT_STRING = 26,    // Pop string index from stack and print the string literal
+
+    // Fused loop instructions
+    LOOP_INC_CMP_JUMP = 27, // Pop limit, add step (operand4) to memory[operand2], jump back to operand if it still compares (operand3) true
+
+    // Function instructions
+    LOAD_LOCAL = 28,  // Push the value of frame slot operand
+    STORE_LOCAL = 29, // Store the top of the stack into frame slot operand (the value stays on the stack unless operand2 is 1)
+    CALL = 30,        // Call the function at operand with operand2 arguments on the stack and a frame of operand3 slots
+    RET = 31,         // Pop the return value, discard the frame, push the value and resume at the return address
+    LOOP_INC_CMP_JUMP_LOCAL = 32, // LOOP_INC_CMP_JUMP with the counter in frame slot operand2
+    TAIL_CALL = 33,   // CALL that reuses the current frame: the operand2 arguments replace its slots and no frame is pushed
+
+    // Array instructions
+    NEW_ARRAY = 34,    // Pop operand elements, push a handle to a new array holding them
+    ARRAY_GET = 35,    // Pop index, pop array handle, push the element
+    ARRAY_SET = 36,    // Pop value, pop index, pop array handle, store the element and push the value
+    CALL_BUILTIN = 37, // Call builtin operand (a Builtin) with operand2 arguments; operand3 is 1 if the second argument is a scalar
+    PRINT_ARRAY = 38,  // Pop array handle and print the array's elements
+
+    // Map instructions (operand is 1 when the key is a string, 0 when it is an integer)
+    MAP_GET = 39,   // Pop key, pop map handle, push the key's value
+    MAP_SET = 40,   // Pop value, pop key, pop map handle, store the value and push it
+    MAP_HAS = 41,   // Pop key, pop map handle, push 1 if the key is present, else 0
+    MAP_DELETE = 42, // Pop key, pop map handle, remove the key and push 1 if it was present, else 0
+
+    // Parallel loop instructions
+    PARALLEL_FOR = 43,   // Pop limit, pop start; run the loop unit at operand (frame of operand2 slots) over the iterations on worker VMs.
+                         // operand3 is the comparison, operand4 the step. Pushes one combined partial per PARALLEL_REDUCE that follows.
+    PARALLEL_REDUCE = 44, // Pop a combined partial and fold it into global operand2 with Reduction operand (operand3 is the unit's frame slot)
+
+    // Specialized instructions (produced by the Optimizer for the optimized tier, never by the Compiler)
+    LOAD_GLOBAL = 45, // Push global operand (PUSH_INT operand; LOAD)
+    STORE_GLOBAL = 46, // Store the top of the stack into global operand (PUSH_INT operand; STORE); pops it if operand2 is 1
+
+    // Host functions
+    CALL_NATIVE = 47 // Pop operand2 arguments, call the host function at index operand of the VM's NativeTable, push its result
+};
+
+// --- Reduction operators (PARALLEL_REDUCE operand) ---
+enum class Reduction {
+    SUM = 0,     // +: identity 0
+    PRODUCT = 1, // *: identity 1
+    MIN = 2,     // min: identity +infinity
+    MAX = 3      // max: identity -infinity
+};
+
+// --- Builtin functions (CALL_BUILTIN operand) ---
+enum class Builtin {
+    ARRAY = 0, // array(n): new INT64 array of n zeros
+    RANGE = 1, // range(n): new INT64 array 0, 1, ..., n-1
+    LEN = 2,   // len(a): number of elements
+    SUM = 3,   // sum(a)
+    MIN = 4,   // min(a)
+    MAX = 5,   // max(a)
+    DOT = 6,   // dot(a, b)
+    ADD = 7,   // add(a, b): element-wise a + b (b may be a scalar)
+    MUL = 8,   // mul(a, b): element-wise a * b (b may be a scalar)
+    LT = 9,    // lt(a, b): element-wise a < b as 0/1 (b may be a scalar)
+    GT = 10,   // gt(a, b): element-wise a > b as 0/1 (b may be a scalar)
+    EQ = 11,   // eq(a, b): element-wise a == b as 0/1 (b may be a scalar)
+    MAP = 12,  // map(): new empty map
+    MAP_LEN = 13, // len(m) for a map: number of keys
+    HAS = 14,  // has(m, k): compiled to MAP_HAS
+    DELETE = 15, // delete(m, k): compiled to MAP_DELETE
+    SORT = 16,   // sort(a): sorted copy
+    SCAN = 17,   // scan(a): inclusive prefix sums
+    FILTER = 18  // filter(a, mask): elements of a whose mask element is non-zero
 };
 
 /**
@@ -74,24 +143,85 @@ inline std::string instruction_to_string(Instruction instr) {
         case Instruction::CONCAT_STRING: return "CONCAT_STRING";
         case Instruction::PRINT_VALUE: return "PRINT_VALUE";
         case Instruction::PRINT_STRING: return "PRINT_STRING";
+        case Instruction::LOOP_INC_CMP_JUMP: return "LOOP_INC_CMP_JUMP";
+        case Instruction::LOAD_LOCAL: return "LOAD_LOCAL";
+        case Instruction::STORE_LOCAL: return "STORE_LOCAL";
+        case Instruction::CALL: return "CALL";
+        case Instruction::RET: return "RET";
+        case Instruction::LOOP_INC_CMP_JUMP_LOCAL: return "LOOP_INC_CMP_JUMP_LOCAL";
+        case Instruction::TAIL_CALL: return "TAIL_CALL";
+        case Instruction::NEW_ARRAY: return "NEW_ARRAY";
+        case Instruction::ARRAY_GET: return "ARRAY_GET";
+        case Instruction::ARRAY_SET: return "ARRAY_SET";
+        case Instruction::CALL_BUILTIN: return "CALL_BUILTIN";
+        case Instruction::PRINT_ARRAY: return "PRINT_ARRAY";
+        case Instruction::MAP_GET: return "MAP_GET";
+        case Instruction::MAP_SET: return "MAP_SET";
+        case Instruction::MAP_HAS: return "MAP_HAS";
+        case Instruction::MAP_DELETE: return "MAP_DELETE";
+        case Instruction::PARALLEL_FOR: return "PARALLEL_FOR";
+        case Instruction::PARALLEL_REDUCE: return "PARALLEL_REDUCE";
+        case Instruction::LOAD_GLOBAL: return "LOAD_GLOBAL";
+        case Instruction::STORE_GLOBAL: return "STORE_GLOBAL";
+        case Instruction::CALL_NATIVE: return "CALL_NATIVE";
         default: return "UNKNOWN";
     }
 }
 
 struct Bytecode {
+    // Fields are ordered so the struct packs into 24 bytes.
     Instruction instruction;
+    int operand2;   // Secondary operands for multi-operand instructions (e.g., LOOP_INC_CMP_JUMP)
     double operand; // For jump targets, literal values, or memory addresses (now supports float directly)
+    int operand3;
+    int operand4;
+
+    // Default constructor (HALT), so fixed-size arrays of instructions can be built at compile time (see ConstexprCompiler.h)
+    constexpr Bytecode() : Bytecode(Instruction::HALT) {}
 
     // Constructor for instructions without an explicit operand (e.g., ADD, HALT)
-    Bytecode(Instruction instruction) : instruction(instruction), operand(0.0) {}
+    constexpr Bytecode(Instruction instruction) : instruction(instruction), operand2(0), operand(0.0), operand3(0), operand4(0) {}
 
     // Constructor for instructions with an integer operand (e.g., PUSH_INT, JUMP, JUMP_IF_FALSE, STORE, LOAD)
-    Bytecode(Instruction instruction, int intOperand) : instruction(instruction), operand(static_cast<double>(intOperand)) {}
+    constexpr Bytecode(Instruction instruction, int intOperand)
+        : instruction(instruction), operand2(0), operand(static_cast<double>(intOperand)), operand3(0), operand4(0) {}
 
     // Constructor for instructions with a float operand (e.g., PUSH_FLOAT)
-    Bytecode(Instruction instruction, float floatOperand) : instruction(instruction), operand(static_cast<double>(floatOperand)) {
+    constexpr Bytecode(Instruction instruction, float floatOperand)
+        : instruction(instruction), operand2(0), operand(static_cast<double>(floatOperand)), operand3(0), operand4(0) {
         // Now storing float directly as double operand, preserving precision.
     }
+
+    // Constructor for multi-operand instructions (e.g., LOOP_INC_CMP_JUMP target, address, comparison, step)
+    constexpr Bytecode(Instruction instruction, int intOperand, int operand2, int operand3 = 0, int operand4 = 0)
+        : instruction(instruction), operand2(operand2), operand(static_cast<double>(intOperand)),
+          operand3(operand3), operand4(operand4) {}
+
+    constexpr bool operator==(const Bytecode& other) const {
+        return instruction == other.instruction && operand2 == other.operand2 && operand == other.operand &&
+               operand3 == other.operand3 && operand4 == other.operand4;
+    }
+    constexpr bool operator!=(const Bytecode& other) const { return !(*this == other); }
+};
+
+// Instructions held elsewhere, read in place: a vector's, or a mapped bytecode image's (see BytecodeImage.h).
+// The instructions must outlive the view.
+class BytecodeView {
+public:
+    BytecodeView() : first(nullptr), count(0) {}
+    BytecodeView(const Bytecode* first, size_t count) : first(first), count(count) {}
+    BytecodeView(const std::vector<Bytecode>& code) : first(code.data()), count(code.size()) {}
+
+    const Bytecode& operator[](size_t index) const { return first[index]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const Bytecode* data() const { return first; }
+    const Bytecode* begin() const { return first; }
+    const Bytecode* end() const { return first + count; }
+
+private:
+    const Bytecode* first;
+    size_t count;
 };
 
 #endif // BYTECODE_H
@@ -0,0 +1,205 @@
+#ifndef COCOMPILER_H
+#define COCOMPILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Bytecode.h"
+#include "HostBindings.h"
+#include "NativeTable.h"
+#include "RunError.h"
+
+class Executable;
+class VM;
+
+/**
+ * @brief The embedding API of libcocompiler: compile a script once, then run it as often as
+ * needed, from any number of threads.
+ *
+ * compile() runs the lexer, parser and compiler without printing anything; errors end up in
+ * Program::errors(). run() executes a compiled program on a VM of its own, collecting what
+ * the program prints and any runtime error in the Result. Nothing is written to std::cout or
+ * std::cerr (unless Inputs::output says so).
+ *
+ * A Program does not change after compile() returns, and runs only read it, so any number of
+ * threads can run the same Program at once without locks: each through its own
+ * ExecutionContext, or through run(), which uses a fresh one per call. Parallel loops and
+ * array builtins in concurrent runs share the process's thread pool, which serializes their
+ * loops.
+ */
+namespace cocompiler {
+
+/**
+ * @brief How compile() compiles a script.
+ */
+struct Options {
+    bool optimize = false; // Apply the optimizer (see src/Optimizer.h) once here, so runs start in the optimized tier
+    const NativeTable* natives = nullptr; // Host functions the script may call; must outlive the Program and not change
+    const HostBindings* inputs = nullptr; // Host memory the script reads as variables; runs use it unless Inputs::bindings is set
+};
+
+/**
+ * @brief How run() executes a program.
+ */
+struct Inputs {
+    bool jit = false;                  // Run as x86-64 machine code where supported (see src/JIT.h)
+    bool closures = false;             // Run as pre-bound handlers where the JIT does not (see src/ClosureCompiler.h)
+    uint32_t tier_up_threshold = 1000; // Back-edges or calls that make a program hot (0 = never tier up)
+    size_t max_frames = 1024;          // Maximum call depth
+    uint64_t back_edge_budget = 0;     // Maximum backward jumps in the run (0 = unlimited)
+    uint64_t instruction_budget = 0;   // Maximum instructions, counted a loop iteration at a time; keeps the run interpreted (0 = unlimited)
+    uint32_t deadline_ms = 0;          // Wall-clock time the run may take, checked every few thousand back-edges (0 = unlimited)
+    uint64_t max_string_bytes = 0;     // Maximum bytes of strings the run's concatenations make (0 = unlimited)
+    std::ostream* output = nullptr;    // Where print statements write; null collects them in Result::output
+    const HostBindings* bindings = nullptr; // Memory for the program's inputs, bound in the same order and kinds; null uses Options::inputs
+};
+
+/**
+ * @brief What one run() of a program did.
+ */
+struct Result {
+    bool ok = false;    // False if the program reported a runtime error (or was not compiled)
+    double value = 0;   // The value on top of the stack at HALT, or -1 after an error
+    std::string output; // What the program printed, unless Inputs::output was set
+    std::string errors; // The runtime errors reported, one per line
+    RunError error = RunError::NONE; // Why the run failed: one of the limits above, or RUNTIME for anything else
+};
+
+/**
+ * @brief A compiled script: its bytecode, string literals and number of global variable slots.
+ * Copies share the compiled code, which is immutable.
+ */
+class Program {
+public:
+    Program();
+
+    bool ok() const { return executable != nullptr; } // False if compilation reported an error
+    const std::string& errors() const { return error_text; } // Lexer, parser and compiler errors, one per line
+    const std::vector<Bytecode>& bytecode() const;
+    const std::vector<std::string>& strings() const;
+    uint32_t globalCount() const;
+    bool isExpression() const { return expression; } // The script is a single expression, whose value is Result::value
+    const NativeTable* natives() const { return native_table; } // The host functions it was compiled against, or null
+    const HostBindings* inputs() const { return input_table; } // The host inputs it was compiled against, or null
+
+private:
+    std::shared_ptr<const Executable> executable; // Null if compilation failed
+    bool expression;
+    const NativeTable* native_table;
+    const HostBindings* input_table;
+    std::vector<HostValue> input_declarations; // Names and kinds of the inputs at compile time
+    std::string error_text;
+
+    friend Program compile(std::string_view source, const Options& options);
+    friend class ExecutionContext;
+};
+
+/**
+ * @brief One thread's state for running programs: a VM, with its stack, globals, frames,
+ * string arena and output buffers, kept from one run to the next.
+ * Runs read the Program in place, without copying its code or string literals, and each run
+ * rewinds what the last one left in O(1). Once warmed up, a run into a reused Result
+ * allocates nothing, unless the script makes arrays or maps or runs in a compiled tier
+ * (Inputs::jit, Inputs::closures). A context runs one program at a time; give each thread
+ * its own, or share a ContextPool.
+ */
+class ExecutionContext {
+public:
+    ExecutionContext();
+    ~ExecutionContext();
+    ExecutionContext(const ExecutionContext&) = delete;
+    ExecutionContext& operator=(const ExecutionContext&) = delete;
+
+    /**
+     * @brief Runs a compiled program from the start.
+     * @return What it printed and returned; Result::ok is false if the program was not
+     * compiled or reported a runtime error.
+     */
+    Result run(const Program& program, const Inputs& inputs = Inputs());
+
+    /**
+     * @brief Runs a compiled program from the start into an existing Result, whose strings
+     * trade buffers with the context's instead of being allocated again.
+     * @return Result::ok.
+     */
+    bool run(const Program& program, const Inputs& inputs, Result& result);
+
+    /**
+     * @brief Starts a run of a compiled program without executing anything; step() then runs
+     * it in slices of a given number of instructions. The paused run lives in the context, so
+     * a scheduler can interleave any number of contexts on a few threads (M:N), and a long
+     * script never holds a thread for more than one slice. Stepped runs stay in the
+     * interpreter: Inputs::jit and Inputs::closures are ignored.
+     * @return False, with the reason in result.errors, if the program cannot run (it was not
+     * compiled, or its inputs are not bound as they were at compile time).
+     */
+    bool begin(const Program& program, const Inputs& inputs, Result& result);
+
+    /**
+     * @brief Continues the run started by begin() for at most fuel instructions (0 = to the end).
+     * @return True once the run is over, with result filled in as by run(); false while it is
+     * paused. Output printed so far is held until the run is over, unless Inputs::output was set.
+     */
+    bool step(uint64_t fuel, Result& result);
+
+private:
+    struct State;
+    std::unique_ptr<State> state;
+
+    bool prepare(const Program& program, const Inputs& inputs, Result& result); // Configures the VM; false if the program cannot run
+    void finish(double value, Result& result); // Moves the run's output and errors into result
+};
+
+/**
+ * @brief Warmed execution contexts shared by any number of threads, for high rates of small runs.
+ * Each run() borrows an idle context for the duration of the run, creating another only when
+ * all are busy, so threads need not keep contexts of their own.
+ */
+class ContextPool {
+public:
+    explicit ContextPool(size_t size); // Creates size contexts up front
+    ~ContextPool();
+    ContextPool(const ContextPool&) = delete;
+    ContextPool& operator=(const ContextPool&) = delete;
+
+    /**
+     * @brief Runs a program once on every idle context, so that their buffers have grown to
+     * what it needs. Its effects (host functions, Inputs::output) happen once per context.
+     */
+    void warm(const Program& program, const Inputs& inputs = Inputs());
+
+    Result run(const Program& program, const Inputs& inputs = Inputs());
+    bool run(const Program& program, const Inputs& inputs, Result& result); // See ExecutionContext::run
+    size_t size(); // Contexts created so far
+
+private:
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ExecutionContext>> idle;
+    size_t created;
+
+    std::unique_ptr<ExecutionContext> acquire();
+    void release(std::unique_ptr<ExecutionContext> context);
+};
+
+/**
+ * @brief Compiles a script.
+ * @return The program; Program::ok() is false, with the reasons in Program::errors(), if any
+ * phase reported an error.
+ */
+Program compile(std::string_view source, const Options& options = Options());
+
+/**
+ * @brief Runs a compiled program from the start, in an ExecutionContext created for this call.
+ * @return What it printed and returned; Result::ok is false if the program was not compiled
+ * or reported a runtime error.
+ */
+Result run(const Program& program, const Inputs& inputs = Inputs());
+
+} // namespace cocompiler
+
+#endif // COCOMPILER_H
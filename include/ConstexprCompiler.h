@@ -0,0 +1,1322 @@
+#ifndef CONSTEXPR_COMPILER_H
+#define CONSTEXPR_COMPILER_H
+
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "AST.h" // For ASTNode::Type
+#include "Bytecode.h"
+
+/**
+ * Compiles .cocom source embedded in a C++ program while the C++ program itself is compiled,
+ * so an embedded script costs nothing to lex, parse or compile at startup:
+ *
+ *     COCOM_EMBED(kScript, R"(
+ *         var total = 0;
+ *         for (var i = 0; i < 10; i = i + 1) { total = total + i; }
+ *         print(total);
+ *     )");
+ *     ...
+ *     vm.run(kScript.bytecode(), kScript.strings());
+ *
+ * cocom::compile() is a constexpr lexer, parser and code generator in one pass (C++17 constant
+ * evaluation has no heap, so there is no token vector or AST). It accepts the language without
+ * arrays, maps, builtins and parallel loops, applies the runtime Compiler's type rules and
+ * emits the same bytecode, including fused counted loops and tail calls. Small functions are
+ * always called rather than inlined, so a program with calls the runtime Compiler would inline
+ * compiles to different, equivalent, bytecode.
+ *
+ * The result is a Program: the bytecode and string literals in fixed-size std::arrays, or an
+ * Error with its line and column. COCOM_EMBED turns an Error into a static_assert failure whose
+ * message names it, e.g. ScriptCheck<cocom::Error::UNDECLARED_VARIABLE, 3, 11>.
+ */
+namespace cocom {
+
+/**
+ * @brief Why a script did not compile (NONE if it did).
+ */
+enum class Error {
+    NONE,
+    // Lexer errors
+    UNEXPECTED_CHARACTER,
+    UNTERMINATED_STRING,
+    NUMBER_OUT_OF_RANGE,
+    // Parser errors
+    EXPECTED_EXPRESSION,
+    EXPECTED_IDENTIFIER,
+    EXPECTED_SEMICOLON,
+    EXPECTED_LEFT_PAREN,
+    EXPECTED_RIGHT_PAREN,
+    EXPECTED_LEFT_BRACE,
+    EXPECTED_RIGHT_BRACE,
+    INVALID_ASSIGNMENT_TARGET,
+    // Compiler errors (as reported by the runtime Compiler)
+    EMPTY_PROGRAM,
+    UNDECLARED_VARIABLE,
+    ALREADY_DECLARED,
+    TYPE_MISMATCH,
+    LOGICAL_OPERANDS,
+    ARITHMETIC_OPERANDS,
+    COMPARISON_OPERANDS,
+    NESTED_FUNCTION,
+    FUNCTION_ALREADY_DECLARED,
+    UNDEFINED_FUNCTION,
+    ARGUMENT_COUNT,
+    STRING_ARGUMENT,
+    STRING_RETURN,
+    RETURN_OUTSIDE_FUNCTION,
+    // Outside the subset compiled at C++ compile time
+    UNSUPPORTED_ARRAY,
+    UNSUPPORTED_BUILTIN,
+    UNSUPPORTED_PARALLEL,
+    // Capacity errors (raise the matching template argument of compile())
+    TOO_MANY_INSTRUCTIONS,
+    TOO_MANY_STRINGS,
+    STRINGS_TOO_LONG,
+    TOO_MANY_SYMBOLS,
+    TOO_MANY_FUNCTIONS,
+    TOO_MANY_CALLS
+};
+
+/**
+ * @brief Describes an Error.
+ */
+constexpr const char* errorMessage(Error error) {
+    switch (error) {
+        case Error::NONE: return "no error";
+        case Error::UNEXPECTED_CHARACTER: return "unexpected character";
+        case Error::UNTERMINATED_STRING: return "unterminated string literal";
+        case Error::NUMBER_OUT_OF_RANGE: return "number literal out of range";
+        case Error::EXPECTED_EXPRESSION: return "expected expression";
+        case Error::EXPECTED_IDENTIFIER: return "expected identifier";
+        case Error::EXPECTED_SEMICOLON: return "expected ';'";
+        case Error::EXPECTED_LEFT_PAREN: return "expected '('";
+        case Error::EXPECTED_RIGHT_PAREN: return "expected ')'";
+        case Error::EXPECTED_LEFT_BRACE: return "expected '{'";
+        case Error::EXPECTED_RIGHT_BRACE: return "expected '}'";
+        case Error::INVALID_ASSIGNMENT_TARGET: return "invalid assignment target";
+        case Error::EMPTY_PROGRAM: return "the program is empty";
+        case Error::UNDECLARED_VARIABLE: return "undeclared variable";
+        case Error::ALREADY_DECLARED: return "variable already declared in this scope";
+        case Error::TYPE_MISMATCH: return "type mismatch in assignment";
+        case Error::LOGICAL_OPERANDS: return "logical operators require boolean or integer operands";
+        case Error::ARITHMETIC_OPERANDS: return "arithmetic operators require numeric operands";
+        case Error::COMPARISON_OPERANDS: return "comparison operators require numeric operands";
+        case Error::NESTED_FUNCTION: return "functions must be declared at the top level";
+        case Error::FUNCTION_ALREADY_DECLARED: return "function already declared";
+        case Error::UNDEFINED_FUNCTION: return "call to undefined function";
+        case Error::ARGUMENT_COUNT: return "wrong number of arguments";
+        case Error::STRING_ARGUMENT: return "function arguments must be numeric";
+        case Error::STRING_RETURN: return "functions must return a numeric value";
+        case Error::RETURN_OUTSIDE_FUNCTION: return "'return' outside of a function";
+        case Error::UNSUPPORTED_ARRAY: return "arrays and maps are not supported in compile-time scripts";
+        case Error::UNSUPPORTED_BUILTIN: return "builtin functions are not supported in compile-time scripts";
+        case Error::UNSUPPORTED_PARALLEL: return "parallel loops are not supported in compile-time scripts";
+        case Error::TOO_MANY_INSTRUCTIONS: return "too many instructions";
+        case Error::TOO_MANY_STRINGS: return "too many string literals";
+        case Error::STRINGS_TOO_LONG: return "string literals too long";
+        case Error::TOO_MANY_SYMBOLS: return "too many variables";
+        case Error::TOO_MANY_FUNCTIONS: return "too many functions";
+        case Error::TOO_MANY_CALLS: return "too many calls";
+    }
+    return "unknown error";
+}
+
+namespace detail {
+template <typename Image> class ConstexprCompiler;
+}
+
+/**
+ * @brief A compiled script: bytecode and string literals held in std::arrays, so it can be a
+ * constexpr variable.
+ * @tparam MaxInstructions Capacity for bytecode, including the final HALT.
+ * @tparam MaxStrings Capacity for string literals.
+ * @tparam MaxStringBytes Capacity for the characters of all string literals.
+ */
+template <size_t MaxInstructions, size_t MaxStrings, size_t MaxStringBytes>
+class Program {
+public:
+    constexpr bool ok() const { return error_ == Error::NONE; }
+    constexpr Error error() const { return error_; }
+    constexpr int line() const { return error_line; }     /**< Line of the error, or 0. */
+    constexpr int column() const { return error_column; } /**< Column of the error, or 0. */
+
+    constexpr size_t size() const { return code_size; }
+    constexpr const Bytecode& operator[](size_t index) const { return code[index]; }
+    constexpr size_t stringCount() const { return string_count; }
+    constexpr std::string_view string(size_t index) const {
+        return std::string_view(characters.data() + string_spans[index].offset, string_spans[index].length);
+    }
+
+    /**
+     * @brief Copies the bytecode into the form VM::run takes.
+     */
+    std::vector<Bytecode> bytecode() const { return std::vector<Bytecode>(code.begin(), code.begin() + code_size); }
+
+    /**
+     * @brief Copies the string literals into the form VM::run takes.
+     */
+    std::vector<std::string> strings() const {
+        std::vector<std::string> result;
+        result.reserve(string_count);
+        for (size_t i = 0; i < string_count; ++i) result.emplace_back(string(i));
+        return result;
+    }
+
+private:
+    template <typename Image> friend class detail::ConstexprCompiler;
+
+    struct StringSpan {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    std::array<Bytecode, MaxInstructions> code{};
+    size_t code_size = 0;
+    std::array<StringSpan, MaxStrings> string_spans{};
+    size_t string_count = 0;
+    std::array<char, MaxStringBytes> characters{};
+    size_t character_count = 0;
+    Error error_ = Error::NONE;
+    int error_line = 0;
+    int error_column = 0;
+};
+
+namespace detail {
+
+/**
+ * @brief A token as a range of the source (there is no std::string at compile time).
+ */
+struct Lexeme {
+    TokenType type = TokenType::EOF_TOKEN;
+    size_t start = 0;
+    size_t length = 0;
+    int line = 1;
+    int column = 1;
+};
+
+/**
+ * @brief Where the parser is: enough to return to a point in the source and parse it again.
+ */
+struct Position {
+    size_t offset = 0; // Of the next character to lex
+    int line = 1;
+    int column = 1;
+    Lexeme current;
+    Lexeme previous;
+};
+
+/**
+ * @brief The AST node an expression would have been parsed into (parentheses add none).
+ */
+enum class Shape { NONE, LITERAL, BOOLEAN, IDENTIFIER, ASSIGNMENT, BINARY, UNARY, CALL };
+
+/**
+ * @brief The parts of an expression's AST node that code generation looks at.
+ */
+struct Node {
+    Shape shape = Shape::NONE;
+    TokenType op = TokenType::EOF_TOKEN; // Binary or unary operator
+    Lexeme token;                        // Literal, identifier or assignment target
+    Shape left = Shape::NONE;            // Binary operands
+    Lexeme left_token;
+    Shape right = Shape::NONE;
+    Lexeme right_token;
+    Position right_start;                // Where the right operand starts, to compile it again
+};
+
+/**
+ * @brief What compiling an expression tells its parent.
+ */
+struct Expr {
+    ASTNode::Type type = ASTNode::Type::UNKNOWN;     // As ASTNode::getType()
+    ASTNode::Type resolved = ASTNode::Type::UNKNOWN; // As Compiler::resolveExpressionType()
+    Node node;
+    Node value; // The value's node, for an assignment
+};
+
+struct Symbol {
+    Lexeme name;
+    ASTNode::Type type = ASTNode::Type::UNKNOWN;
+    int address = 0; // Memory address, or frame slot if local
+    bool local = false;
+    int depth = 0;   // Scope depth it was declared at
+};
+
+struct Function {
+    Lexeme name;
+    int entry = 0;
+    int arity = 0;
+    int frame_size = 0;
+};
+
+struct CallSite {
+    int index = 0; // Of the CALL or TAIL_CALL instruction
+    Lexeme callee;
+};
+
+constexpr const char* kBuiltinNames[] = {"array", "range", "len", "sum", "min", "max", "dot", "add", "mul",
+                                         "lt", "gt", "eq", "map", "has", "delete", "sort", "scan", "filter"};
+
+constexpr bool isNumericType(ASTNode::Type type) {
+    return type == ASTNode::Type::INTEGER || type == ASTNode::Type::FLOAT || type == ASTNode::Type::NUMBER;
+}
+
+constexpr bool isLogicalType(ASTNode::Type type) {
+    return type == ASTNode::Type::BOOLEAN_LITERAL || type == ASTNode::Type::INTEGER || type == ASTNode::Type::NUMBER;
+}
+
+/**
+ * @brief BinaryExpression::getType().
+ */
+constexpr ASTNode::Type binaryType(TokenType op, ASTNode::Type left, ASTNode::Type right) {
+    using Type = ASTNode::Type;
+    if (op == TokenType::PLUS) {
+        if (left == Type::STRING_LITERAL && right == Type::STRING_LITERAL) return Type::STRING_LITERAL;
+        if ((left == Type::STRING_LITERAL && (right == Type::INTEGER || right == Type::FLOAT)) ||
+            ((left == Type::INTEGER || left == Type::FLOAT) && right == Type::STRING_LITERAL)) {
+            return Type::UNKNOWN;
+        }
+    }
+    if (left == Type::UNKNOWN || right == Type::UNKNOWN) return Type::UNKNOWN;
+    if (left == Type::FLOAT || right == Type::FLOAT) return Type::FLOAT;
+    if (left == Type::INTEGER || right == Type::INTEGER) return Type::INTEGER;
+    if (left == Type::BOOLEAN_LITERAL || right == Type::BOOLEAN_LITERAL) return Type::BOOLEAN_LITERAL;
+    return Type::UNKNOWN;
+}
+
+/**
+ * @brief Compiler::resolveExpressionType() of a BinaryExpression.
+ */
+constexpr ASTNode::Type resolvedBinaryType(TokenType op, ASTNode::Type left, ASTNode::Type right) {
+    using Type = ASTNode::Type;
+    if (op == TokenType::PLUS && left == Type::STRING_LITERAL && right == Type::STRING_LITERAL) return Type::STRING_LITERAL;
+    if ((isNumericType(left) || left == Type::BOOLEAN_LITERAL) && (isNumericType(right) || right == Type::BOOLEAN_LITERAL)) {
+        if (left == Type::FLOAT || right == Type::FLOAT) return Type::FLOAT;
+        if (left == Type::NUMBER || right == Type::NUMBER) return Type::NUMBER;
+        return Type::INTEGER;
+    }
+    return Type::UNKNOWN;
+}
+
+/**
+ * @brief The one-pass compiler behind cocom::compile().
+ *
+ * The grammar functions mirror Parser's, and each compiles what it parses as Compiler would
+ * compile the node. Where Compiler looks at a node before compiling what precedes it (the type
+ * of a variable's initializer, the shape of a for loop's condition and increment), the
+ * expression is first parsed in a dry run, which reports its Expr without emitting code or
+ * reporting semantic errors, and then compiled from the saved Position.
+ */
+template <typename Image>
+class ConstexprCompiler {
+public:
+    constexpr ConstexprCompiler(std::string_view source, Image& image) : source(source), image(image) {}
+
+    constexpr void compile() {
+        advance();
+        bool first = true;
+        while (!check(TokenType::EOF_TOKEN)) {
+            bool leavesValue = statement();
+            if (failed) return;
+            // A program of one statement is compiled as that node, not as a block of statements
+            if (leavesValue && !(first && check(TokenType::EOF_TOKEN))) emit(Bytecode(Instruction::POP));
+            first = false;
+        }
+        if (failed) return;
+        if (image.code_size == 0) {
+            fail(Error::EMPTY_PROGRAM, position.current);
+            return;
+        }
+        patchCalls();
+        if (failed) return;
+        emit(Bytecode(Instruction::HALT));
+    }
+
+private:
+    static constexpr size_t kMaxSymbols = 256;
+    static constexpr size_t kMaxFunctions = 64;
+    static constexpr size_t kMaxCallSites = 256;
+
+    std::string_view source;
+    Image& image;
+    Position position;
+    bool failed = false;
+    bool dry = false; // Parsing only: no code, no symbol type changes, only syntax errors stop
+
+    std::array<Symbol, kMaxSymbols> symbols{};
+    size_t symbol_count = 0;
+    int depth = 0;
+    int function_depth = -1; // Scope depth of the current function's parameters, or -1
+    int next_address = 0;
+    int next_local = 0;
+    std::array<Function, kMaxFunctions> functions{};
+    size_t function_count = 0;
+    std::array<CallSite, kMaxCallSites> call_sites{};
+    size_t call_site_count = 0;
+
+    // --- Errors ---
+
+    /**
+     * @brief Records the first error and stops compilation. Dry runs ignore semantic errors.
+     */
+    constexpr void fail(Error error, const Lexeme& at, bool syntax = false) {
+        if (dry && !syntax) return;
+        failed = true;
+        if (!dry && image.error_ == Error::NONE) {
+            image.error_ = error;
+            image.error_line = at.line;
+            image.error_column = at.column;
+        }
+    }
+
+    // --- Lexer (as Lexer::tokenize) ---
+
+    constexpr char peekChar(size_t ahead = 0) const {
+        return position.offset + ahead < source.size() ? source[position.offset + ahead] : '\0';
+    }
+
+    constexpr char advanceChar() {
+        char c = peekChar();
+        ++position.offset;
+        ++position.column;
+        return c;
+    }
+
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static constexpr bool isAlpha(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+
+    constexpr bool lexemeIs(const Lexeme& lexeme, std::string_view text) const {
+        return source.substr(lexeme.start, lexeme.length) == text;
+    }
+
+    constexpr bool sameName(const Lexeme& a, const Lexeme& b) const {
+        return source.substr(a.start, a.length) == source.substr(b.start, b.length);
+    }
+
+    constexpr Lexeme scan() {
+        for (;;) {
+            while (position.offset < source.size()) {
+                char c = peekChar();
+                if (c == ' ' || c == '\t' || c == '\r') {
+                    advanceChar();
+                } else if (c == '\n') {
+                    advanceChar();
+                    ++position.line;
+                    position.column = 1;
+                } else {
+                    break;
+                }
+            }
+            if (peekChar() == '/' && peekChar(1) == '/') {
+                while (position.offset < source.size() && peekChar() != '\n') advanceChar();
+                continue;
+            }
+            break;
+        }
+
+        Lexeme lexeme;
+        lexeme.start = position.offset;
+        lexeme.line = position.line;
+        lexeme.column = position.column;
+        if (position.offset >= source.size()) return lexeme; // EOF_TOKEN
+
+        char c = advanceChar();
+        if (isDigit(c)) {
+            bool hasDecimal = false;
+            while (isDigit(peekChar()) || peekChar() == '.') {
+                if (peekChar() == '.') {
+                    if (hasDecimal) break; // Only one decimal point allowed
+                    hasDecimal = true;
+                }
+                advanceChar();
+            }
+            lexeme.type = hasDecimal ? TokenType::FLOAT_LITERAL : TokenType::INT_LITERAL;
+        } else if (isAlpha(c)) {
+            while (isAlpha(peekChar()) || isDigit(peekChar())) advanceChar();
+            lexeme.length = position.offset - lexeme.start;
+            lexeme.type = keyword(lexeme);
+            return lexeme;
+        } else if (c == '"') {
+            // The lexeme is the text between the quotes, escapes still in it (see addString)
+            lexeme.start = position.offset;
+            while (peekChar() != '"' && position.offset < source.size()) {
+                if (advanceChar() == '\\' && (peekChar() == '"' || peekChar() == '\\')) advanceChar();
+            }
+            if (position.offset >= source.size()) {
+                fail(Error::UNTERMINATED_STRING, lexeme, true);
+                return lexeme;
+            }
+            lexeme.length = position.offset - lexeme.start;
+            lexeme.type = TokenType::STRING_LITERAL;
+            advanceChar(); // The closing '"'
+            return lexeme;
+        } else {
+            bool equals = peekChar() == '=';
+            switch (c) {
+                case '+': lexeme.type = TokenType::PLUS; break;
+                case '-': lexeme.type = TokenType::MINUS; break;
+                case '*': lexeme.type = TokenType::STAR; break;
+                case '/': lexeme.type = TokenType::SLASH; break;
+                case '(': lexeme.type = TokenType::LPAREN; break;
+                case ')': lexeme.type = TokenType::RPAREN; break;
+                case '[': lexeme.type = TokenType::LBRACKET; break;
+                case ']': lexeme.type = TokenType::RBRACKET; break;
+                case '{': lexeme.type = TokenType::LBRACE; break;
+                case '}': lexeme.type = TokenType::RBRACE; break;
+                case ';': lexeme.type = TokenType::SEMICOLON; break;
+                case ',': lexeme.type = TokenType::COMMA; break;
+                case ':': lexeme.type = TokenType::COLON; break;
+                case '=': lexeme.type = equals ? TokenType::EQUAL_EQUAL : TokenType::ASSIGN; break;
+                case '>': lexeme.type = equals ? TokenType::GREATER_EQUAL : TokenType::GREATER; break;
+                case '<': lexeme.type = equals ? TokenType::LESS_EQUAL : TokenType::LESS; break;
+                case '!': lexeme.type = equals ? TokenType::BANG_EQUAL : TokenType::BANG; break;
+                case '&':
+                case '|':
+                    if (peekChar() != c) {
+                        fail(Error::UNEXPECTED_CHARACTER, lexeme, true);
+                        return lexeme;
+                    }
+                    advanceChar();
+                    lexeme.type = c == '&' ? TokenType::AND : TokenType::OR;
+                    break;
+                default:
+                    fail(Error::UNEXPECTED_CHARACTER, lexeme, true);
+                    return lexeme;
+            }
+            if (equals && (c == '=' || c == '>' || c == '<' || c == '!')) advanceChar();
+        }
+        lexeme.length = position.offset - lexeme.start;
+        return lexeme;
+    }
+
+    constexpr TokenType keyword(const Lexeme& lexeme) const {
+        if (lexemeIs(lexeme, "var")) return TokenType::VAR;
+        if (lexemeIs(lexeme, "if")) return TokenType::IF;
+        if (lexemeIs(lexeme, "else")) return TokenType::ELSE;
+        if (lexemeIs(lexeme, "while")) return TokenType::WHILE;
+        if (lexemeIs(lexeme, "for")) return TokenType::FOR;
+        if (lexemeIs(lexeme, "parallel")) return TokenType::PARALLEL;
+        if (lexemeIs(lexeme, "fn")) return TokenType::FN;
+        if (lexemeIs(lexeme, "return")) return TokenType::RETURN;
+        if (lexemeIs(lexeme, "print")) return TokenType::PRINT;
+        if (lexemeIs(lexeme, "true")) return TokenType::TRUE;
+        if (lexemeIs(lexeme, "false")) return TokenType::FALSE;
+        return TokenType::IDENTIFIER;
+    }
+
+    // --- Parser helpers (as Parser's) ---
+
+    constexpr void advance() {
+        position.previous = position.current;
+        if (!failed) position.current = scan();
+    }
+
+    constexpr bool check(TokenType type) const { return position.current.type == type; }
+
+    constexpr bool match(TokenType type) {
+        if (!check(type)) return false;
+        advance();
+        return true;
+    }
+
+    constexpr bool expect(TokenType type, Error error) {
+        if (match(type)) return true;
+        fail(error, position.current, true);
+        return false;
+    }
+
+    // --- Code generation ---
+
+    constexpr int here() const { return static_cast<int>(image.code_size); }
+
+    constexpr int emit(const Bytecode& instruction) {
+        if (dry || failed) return 0;
+        if (image.code_size == image.code.size()) {
+            fail(Error::TOO_MANY_INSTRUCTIONS, position.previous);
+            return 0;
+        }
+        image.code[image.code_size] = instruction;
+        return static_cast<int>(image.code_size++);
+    }
+
+    constexpr void patch(int index, int target) {
+        if (!dry && !failed) image.code[index].operand = target;
+    }
+
+    /**
+     * @brief Stores a string literal's text, with the escapes Lexer::string_literal handles.
+     * @return The string's index.
+     */
+    constexpr int addString(const Lexeme& literal) {
+        if (dry) return 0;
+        if (image.string_count == image.string_spans.size()) {
+            fail(Error::TOO_MANY_STRINGS, literal);
+            return 0;
+        }
+        size_t start = image.character_count;
+        for (size_t i = literal.start; i < literal.start + literal.length; ++i) {
+            char c = source[i];
+            if (c == '\\' && i + 1 < literal.start + literal.length && (source[i + 1] == '"' || source[i + 1] == '\\')) {
+                c = source[++i];
+            }
+            if (image.character_count == image.characters.size()) {
+                fail(Error::STRINGS_TOO_LONG, literal);
+                return 0;
+            }
+            image.characters[image.character_count++] = c;
+        }
+        image.string_spans[image.string_count].offset = start;
+        image.string_spans[image.string_count].length = image.character_count - start;
+        return static_cast<int>(image.string_count++);
+    }
+
+    /**
+     * @brief std::stoi of an integer literal.
+     */
+    constexpr bool integerValue(const Lexeme& literal, int& value) const {
+        long long result = 0;
+        for (size_t i = literal.start; i < literal.start + literal.length; ++i) {
+            result = result * 10 + (source[i] - '0');
+            if (result > std::numeric_limits<int>::max()) return false;
+        }
+        value = static_cast<int>(result);
+        return true;
+    }
+
+    /**
+     * @brief std::stof of a float literal: the digits as an integer, then one scaling by a power of ten.
+     */
+    constexpr bool floatValue(const Lexeme& literal, float& value) const {
+        unsigned long long digits = 0;
+        int exponent = 0;
+        bool fraction = false;
+        for (size_t i = literal.start; i < literal.start + literal.length; ++i) {
+            char c = source[i];
+            if (c == '.') {
+                fraction = true;
+            } else if (digits < 100000000000000000ULL) {
+                digits = digits * 10 + static_cast<unsigned long long>(c - '0');
+                if (fraction) --exponent;
+            } else if (!fraction) {
+                ++exponent; // Digits beyond the 18th only scale the value
+            }
+        }
+        double scale = 1;
+        for (int i = 0; i < (exponent < 0 ? -exponent : exponent); ++i) scale *= 10;
+        double result = exponent < 0 ? static_cast<double>(digits) / scale : static_cast<double>(digits) * scale;
+        if (result > std::numeric_limits<float>::max()) return false;
+        value = static_cast<float>(result);
+        return true;
+    }
+
+    // --- Symbols (as SymbolTable) ---
+
+    constexpr void enterScope() { ++depth; }
+
+    constexpr void exitScope() {
+        while (symbol_count > 0 && symbols[symbol_count - 1].depth == depth) --symbol_count;
+        --depth;
+    }
+
+    constexpr bool inFunction() const { return function_depth >= 0; }
+
+    constexpr int lookup(const Lexeme& name) const {
+        for (size_t i = symbol_count; i > 0; --i) {
+            if (sameName(symbols[i - 1].name, name)) return static_cast<int>(i - 1);
+        }
+        return -1;
+    }
+
+    constexpr int addSymbol(const Lexeme& name, ASTNode::Type type) {
+        for (size_t i = symbol_count; i > 0 && symbols[i - 1].depth == depth; --i) {
+            if (sameName(symbols[i - 1].name, name)) {
+                fail(Error::ALREADY_DECLARED, name);
+                return -1;
+            }
+        }
+        if (symbol_count == symbols.size()) {
+            fail(Error::TOO_MANY_SYMBOLS, name);
+            return -1;
+        }
+        Symbol& symbol = symbols[symbol_count];
+        symbol.name = name;
+        symbol.type = type;
+        symbol.local = inFunction();
+        symbol.address = symbol.local ? next_local++ : next_address++;
+        symbol.depth = depth;
+        return static_cast<int>(symbol_count++);
+    }
+
+    constexpr void emitLoad(const Symbol& symbol) {
+        if (symbol.local) {
+            emit(Bytecode(Instruction::LOAD_LOCAL, symbol.address));
+        } else {
+            emit(Bytecode(Instruction::PUSH_INT, symbol.address));
+            emit(Bytecode(Instruction::LOAD));
+        }
+    }
+
+    constexpr void emitStore(const Symbol& symbol) {
+        if (symbol.local) {
+            emit(Bytecode(Instruction::STORE_LOCAL, symbol.address));
+        } else {
+            emit(Bytecode(Instruction::PUSH_INT, symbol.address));
+            emit(Bytecode(Instruction::STORE));
+        }
+    }
+
+    /**
+     * @brief Parses an expression without compiling it, to see its Expr.
+     * @param ok Set to false on a syntax error (the caller compiles it again to report it).
+     */
+    constexpr Expr probe(bool& ok) {
+        bool wasDry = dry;
+        dry = true;
+        Expr expr = expression();
+        ok = !failed;
+        failed = false;
+        dry = wasDry;
+        return expr;
+    }
+
+    // --- Expressions ---
+
+    constexpr Expr expression() { return assignment(); }
+
+    constexpr Expr assignment() {
+        int start = here();
+        Expr target = logicalOr();
+        if (failed || !match(TokenType::ASSIGN)) return target;
+        Lexeme equals = position.previous;
+        if (target.node.shape != Shape::IDENTIFIER) {
+            fail(Error::INVALID_ASSIGNMENT_TARGET, equals, true);
+            return {};
+        }
+        if (!dry) image.code_size = static_cast<size_t>(start); // The target was compiled as a load
+
+        Expr value = assignment(); // Assignment is right-associative
+        if (failed) return {};
+        Expr result;
+        result.type = value.type;
+        result.resolved = value.type;
+        result.node.shape = Shape::ASSIGNMENT;
+        result.node.token = target.node.token;
+        result.value = value.node;
+
+        int index = lookup(target.node.token);
+        if (index < 0) {
+            fail(Error::UNDECLARED_VARIABLE, target.node.token);
+            return result;
+        }
+        Symbol& symbol = symbols[index];
+        ASTNode::Type assigned = value.resolved;
+        if (symbol.type != ASTNode::Type::UNKNOWN && assigned != ASTNode::Type::UNKNOWN &&
+            symbol.type != ASTNode::Type::NUMBER && assigned != ASTNode::Type::NUMBER && symbol.type != assigned) {
+            fail(Error::TYPE_MISMATCH, target.node.token);
+            return result;
+        }
+        if (symbol.type == ASTNode::Type::UNKNOWN && !dry) symbol.type = assigned;
+        emitStore(symbol);
+        return result;
+    }
+
+    constexpr Expr logicalOr() {
+        Expr expr = logicalAnd();
+        while (!failed && match(TokenType::OR)) {
+            Lexeme op = position.previous;
+            int jumpToTrue = emit(Bytecode(Instruction::JUMP_IF_TRUE, 0));
+            Position rightStart = position;
+            Expr right = logicalAnd();
+            if (failed) return {};
+            int jumpToEnd = emit(Bytecode(Instruction::JUMP, 0));
+            patch(jumpToTrue, here());
+            emit(Bytecode(Instruction::PUSH_INT, 1));
+            patch(jumpToEnd, here());
+            if (!(isLogicalType(expr.resolved) && isLogicalType(right.resolved))) fail(Error::LOGICAL_OPERANDS, op);
+            expr = binary(expr, op, right, rightStart);
+        }
+        return expr;
+    }
+
+    constexpr Expr logicalAnd() {
+        Expr expr = comparison();
+        while (!failed && match(TokenType::AND)) {
+            Lexeme op = position.previous;
+            int jumpToFalse = emit(Bytecode(Instruction::JUMP_IF_FALSE, 0));
+            Position rightStart = position;
+            Expr right = comparison();
+            if (failed) return {};
+            int jumpToEnd = emit(Bytecode(Instruction::JUMP, 0));
+            patch(jumpToFalse, here());
+            emit(Bytecode(Instruction::PUSH_INT, 0));
+            patch(jumpToEnd, here());
+            if (!(isLogicalType(expr.resolved) && isLogicalType(right.resolved))) fail(Error::LOGICAL_OPERANDS, op);
+            expr = binary(expr, op, right, rightStart);
+        }
+        return expr;
+    }
+
+    constexpr Expr comparison() {
+        Expr expr = term();
+        while (!failed && (check(TokenType::GREATER) || check(TokenType::LESS) || check(TokenType::GREATER_EQUAL) ||
+                           check(TokenType::LESS_EQUAL) || check(TokenType::EQUAL_EQUAL) || check(TokenType::BANG_EQUAL))) {
+            advance();
+            Lexeme op = position.previous;
+            Position rightStart = position;
+            Expr right = term();
+            if (failed) return {};
+            if (!(isNumericType(expr.resolved) && isNumericType(right.resolved))) fail(Error::COMPARISON_OPERANDS, op);
+            switch (op.type) {
+                case TokenType::GREATER: emit(Bytecode(Instruction::GREATER)); break;
+                case TokenType::LESS: emit(Bytecode(Instruction::LESS)); break;
+                case TokenType::GREATER_EQUAL: emit(Bytecode(Instruction::GREATER_EQUAL)); break;
+                case TokenType::LESS_EQUAL: emit(Bytecode(Instruction::LESS_EQUAL)); break;
+                case TokenType::EQUAL_EQUAL: emit(Bytecode(Instruction::EQUAL_EQUAL)); break;
+                default: emit(Bytecode(Instruction::BANG_EQUAL)); break;
+            }
+            expr = binary(expr, op, right, rightStart);
+        }
+        return expr;
+    }
+
+    constexpr Expr term() {
+        Expr expr = factor();
+        while (!failed && (check(TokenType::PLUS) || check(TokenType::MINUS))) {
+            advance();
+            Lexeme op = position.previous;
+            Position rightStart = position;
+            Expr right = factor();
+            if (failed) return {};
+            if (op.type == TokenType::PLUS && expr.resolved == ASTNode::Type::STRING_LITERAL &&
+                right.resolved == ASTNode::Type::STRING_LITERAL) {
+                emit(Bytecode(Instruction::CONCAT_STRING));
+            } else if (isNumericType(expr.resolved) && isNumericType(right.resolved)) {
+                emit(Bytecode(op.type == TokenType::PLUS ? Instruction::ADD : Instruction::SUB));
+            } else {
+                fail(Error::ARITHMETIC_OPERANDS, op);
+            }
+            expr = binary(expr, op, right, rightStart);
+        }
+        return expr;
+    }
+
+    constexpr Expr factor() {
+        Expr expr = unary();
+        while (!failed && (check(TokenType::STAR) || check(TokenType::SLASH))) {
+            advance();
+            Lexeme op = position.previous;
+            Position rightStart = position;
+            Expr right = unary();
+            if (failed) return {};
+            if (!(isNumericType(expr.resolved) && isNumericType(right.resolved))) fail(Error::ARITHMETIC_OPERANDS, op);
+            emit(Bytecode(op.type == TokenType::STAR ? Instruction::MUL : Instruction::DIV));
+            expr = binary(expr, op, right, rightStart);
+        }
+        return expr;
+    }
+
+    /**
+     * @brief The Expr of a binary expression whose code has been emitted.
+     */
+    constexpr Expr binary(const Expr& left, const Lexeme& op, const Expr& right, const Position& rightStart) const {
+        Expr result;
+        result.type = binaryType(op.type, left.type, right.type);
+        result.resolved = resolvedBinaryType(op.type, left.resolved, right.resolved);
+        result.node.shape = Shape::BINARY;
+        result.node.op = op.type;
+        result.node.left = left.node.shape;
+        result.node.left_token = left.node.token;
+        result.node.right = right.node.shape;
+        result.node.right_token = right.node.token;
+        result.node.right_start = rightStart;
+        return result;
+    }
+
+    constexpr Expr unary() {
+        if (check(TokenType::BANG) || check(TokenType::MINUS)) {
+            advance();
+            TokenType op = position.previous.type;
+            Expr right = unary(); // Unary operators are right-associative
+            if (failed) return {};
+            emit(Bytecode(op == TokenType::BANG ? Instruction::NOT : Instruction::NEGATE));
+            Expr result;
+            result.type = right.type;
+            result.resolved = right.type;
+            result.node.shape = Shape::UNARY;
+            result.node.op = op;
+            return result;
+        }
+        Expr expr = primary();
+        if (!failed && check(TokenType::LBRACKET)) fail(Error::UNSUPPORTED_ARRAY, position.current, true);
+        return expr;
+    }
+
+    constexpr Expr primary() {
+        Lexeme token = position.current;
+        Expr result;
+        result.node.token = token;
+        if (match(TokenType::INT_LITERAL)) {
+            int value = 0;
+            if (!integerValue(token, value)) fail(Error::NUMBER_OUT_OF_RANGE, token);
+            emit(Bytecode(Instruction::PUSH_INT, value));
+            result.type = result.resolved = ASTNode::Type::INTEGER;
+            result.node.shape = Shape::LITERAL;
+        } else if (match(TokenType::FLOAT_LITERAL)) {
+            float value = 0;
+            if (!floatValue(token, value)) fail(Error::NUMBER_OUT_OF_RANGE, token);
+            emit(Bytecode(Instruction::PUSH_FLOAT, value));
+            result.type = result.resolved = ASTNode::Type::FLOAT;
+            result.node.shape = Shape::LITERAL;
+        } else if (match(TokenType::STRING_LITERAL)) {
+            emit(Bytecode(Instruction::PUSH_STRING, addString(token)));
+            result.type = result.resolved = ASTNode::Type::STRING_LITERAL;
+            result.node.shape = Shape::LITERAL;
+        } else if (match(TokenType::TRUE) || match(TokenType::FALSE)) {
+            emit(Bytecode(Instruction::PUSH_INT, token.type == TokenType::TRUE ? 1 : 0));
+            result.type = result.resolved = ASTNode::Type::BOOLEAN_LITERAL;
+            result.node.shape = Shape::BOOLEAN;
+        } else if (match(TokenType::IDENTIFIER)) {
+            if (match(TokenType::LPAREN)) return call(token);
+            result.type = ASTNode::Type::IDENTIFIER_EXPRESSION;
+            result.node.shape = Shape::IDENTIFIER;
+            int index = lookup(token);
+            if (index < 0) {
+                fail(Error::UNDECLARED_VARIABLE, token);
+                return result;
+            }
+            result.resolved = symbols[index].type;
+            emitLoad(symbols[index]);
+        } else if (check(TokenType::LBRACKET)) {
+            fail(Error::UNSUPPORTED_ARRAY, token, true);
+        } else if (match(TokenType::LPAREN)) {
+            result = expression();
+            if (!failed) expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN);
+        } else {
+            fail(Error::EXPECTED_EXPRESSION, token, true);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Compiles a call after its '(' (as Compiler::compileCall, without inlining).
+     */
+    constexpr Expr call(const Lexeme& callee) {
+        for (const char* builtin : kBuiltinNames) {
+            if (lexemeIs(callee, builtin)) {
+                fail(Error::UNSUPPORTED_BUILTIN, callee, true);
+                return {};
+            }
+        }
+        int argumentCount = 0;
+        if (!check(TokenType::RPAREN)) {
+            do {
+                Expr argument = expression();
+                if (failed) return {};
+                if (argument.resolved == ASTNode::Type::STRING_LITERAL) fail(Error::STRING_ARGUMENT, callee);
+                ++argumentCount;
+            } while (match(TokenType::COMMA));
+        }
+        if (!expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN)) return {};
+
+        if (!dry) {
+            if (call_site_count == call_sites.size()) {
+                fail(Error::TOO_MANY_CALLS, callee);
+                return {};
+            }
+            call_sites[call_site_count].index = here();
+            call_sites[call_site_count].callee = callee;
+            ++call_site_count;
+        }
+        emit(Bytecode(Instruction::CALL, 0, argumentCount)); // Patched in patchCalls()
+        Expr result;
+        result.type = result.resolved = ASTNode::Type::NUMBER;
+        result.node.shape = Shape::CALL;
+        result.node.token = callee;
+        return result;
+    }
+
+    // --- Statements ---
+
+    /**
+     * @brief Compiles one statement.
+     * @return True if it leaves a value on the stack (see Compiler::compileStatement).
+     */
+    constexpr bool statement() {
+        switch (position.current.type) {
+            case TokenType::VAR: return variableDeclaration();
+            case TokenType::IF: ifStatement(); return false;
+            case TokenType::WHILE: whileStatement(); return false;
+            case TokenType::FOR: forStatement(); return false;
+            case TokenType::PARALLEL: fail(Error::UNSUPPORTED_PARALLEL, position.current, true); return false;
+            case TokenType::FN: functionDeclaration(); return false;
+            case TokenType::RETURN: returnStatement(); return false;
+            case TokenType::PRINT: printStatement(); return false;
+            default: break;
+        }
+        expression();
+        if (!failed) expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON);
+        return true;
+    }
+
+    constexpr void block() {
+        if (!expect(TokenType::LBRACE, Error::EXPECTED_LEFT_BRACE)) return;
+        enterScope();
+        while (!check(TokenType::RBRACE) && !check(TokenType::EOF_TOKEN)) {
+            if (statement()) emit(Bytecode(Instruction::POP));
+            if (failed) return;
+        }
+        expect(TokenType::RBRACE, Error::EXPECTED_RIGHT_BRACE);
+        exitScope();
+    }
+
+    /**
+     * @brief Compiles 'var name = initializer;'.
+     * @return True if there is an initializer (its value is left on the stack).
+     */
+    constexpr bool variableDeclaration() {
+        advance(); // 'var'
+        Lexeme name = position.current;
+        if (!expect(TokenType::IDENTIFIER, Error::EXPECTED_IDENTIFIER)) return false;
+        bool hasInitializer = match(TokenType::ASSIGN);
+
+        // The type comes from the initializer's node, before the variable is declared
+        ASTNode::Type type = ASTNode::Type::UNKNOWN;
+        Position initializerStart = position;
+        if (hasInitializer) {
+            bool parsed = true;
+            Expr initializer = probe(parsed);
+            position = initializerStart;
+            type = initializer.type;
+            if (initializer.node.shape == Shape::CALL) {
+                type = initializer.resolved;
+            } else if (type == ASTNode::Type::IDENTIFIER_EXPRESSION) {
+                int index = initializer.node.shape == Shape::IDENTIFIER ? lookup(initializer.node.token) : -1;
+                if (initializer.node.shape == Shape::IDENTIFIER && index < 0 && parsed) {
+                    fail(Error::UNDECLARED_VARIABLE, name);
+                    return false;
+                }
+                type = index >= 0 ? symbols[index].type : initializer.resolved;
+            }
+        }
+
+        int index = addSymbol(name, type);
+        if (failed) return false;
+        if (hasInitializer) {
+            expression();
+            if (failed) return false;
+            emitStore(symbols[index]);
+        }
+        expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON);
+        return hasInitializer;
+    }
+
+    constexpr void ifStatement() {
+        advance(); // 'if'
+        if (!expect(TokenType::LPAREN, Error::EXPECTED_LEFT_PAREN)) return;
+        expression();
+        if (failed || !expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN)) return;
+        int jumpIfFalse = emit(Bytecode(Instruction::JUMP_IF_FALSE, 0));
+        block();
+        if (failed) return;
+        if (match(TokenType::ELSE)) {
+            int jumpToEnd = emit(Bytecode(Instruction::JUMP, 0));
+            patch(jumpIfFalse, here());
+            if (check(TokenType::IF)) {
+                ifStatement(); // 'else if'
+            } else {
+                block();
+            }
+            patch(jumpToEnd, here());
+        } else {
+            patch(jumpIfFalse, here());
+        }
+    }
+
+    constexpr void whileStatement() {
+        advance(); // 'while'
+        int loopStart = here();
+        if (!expect(TokenType::LPAREN, Error::EXPECTED_LEFT_PAREN)) return;
+        expression();
+        if (failed || !expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN)) return;
+        int jumpIfFalse = emit(Bytecode(Instruction::JUMP_IF_FALSE, 0));
+        block();
+        emit(Bytecode(Instruction::JUMP, loopStart));
+        patch(jumpIfFalse, here());
+    }
+
+    /**
+     * @brief Compiles a for loop, in the fused form of Compiler::compileCountedLoop when it is
+     * counted. The condition and increment are probed first to choose the form, then the
+     * condition, body, and increment or limit are compiled in the order they are emitted.
+     */
+    constexpr void forStatement() {
+        advance(); // 'for'
+        if (!expect(TokenType::LPAREN, Error::EXPECTED_LEFT_PAREN)) return;
+        enterScope(); // The initializer's variable is scoped to the loop
+
+        if (match(TokenType::SEMICOLON)) {
+        } else if (check(TokenType::VAR)) {
+            if (variableDeclaration()) emit(Bytecode(Instruction::POP));
+        } else {
+            expression();
+            if (!failed && expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON)) emit(Bytecode(Instruction::POP));
+        }
+        if (failed) return;
+
+        bool parsed = true;
+        Position conditionStart = position;
+        bool hasCondition = !check(TokenType::SEMICOLON);
+        Expr condition;
+        if (hasCondition) condition = probe(parsed);
+        if (parsed) parsed = expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON);
+        Position incrementStart = position;
+        bool hasIncrement = parsed && !check(TokenType::RPAREN);
+        Expr increment;
+        if (hasIncrement) increment = probe(parsed);
+        if (parsed) parsed = expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN);
+        if (!parsed) {
+            // Compile the clauses for real to report the syntax error
+            position = conditionStart;
+            if (hasCondition) expression();
+            if (!failed) expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON);
+            if (!failed && !check(TokenType::RPAREN)) expression();
+            if (!failed) expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN);
+            if (!failed) fail(Error::EXPECTED_EXPRESSION, position.current, true);
+            return;
+        }
+        Position bodyStart = position;
+
+        // A counted loop: `counter <op> limit` and `counter = counter +/- <integer literal>`, where the
+        // limit is a literal or another variable (it is evaluated before the counter steps)
+        int counter = -1;
+        Instruction comparison = Instruction::LESS;
+        if (hasCondition && hasIncrement && condition.node.shape == Shape::BINARY && condition.node.left == Shape::IDENTIFIER &&
+            (condition.node.right == Shape::LITERAL ||
+             (condition.node.right == Shape::IDENTIFIER && !sameName(condition.node.right_token, condition.node.left_token))) &&
+            increment.node.shape == Shape::ASSIGNMENT && increment.value.shape == Shape::BINARY &&
+            (increment.value.op == TokenType::PLUS || increment.value.op == TokenType::MINUS) &&
+            increment.value.left == Shape::IDENTIFIER && increment.value.right == Shape::LITERAL &&
+            increment.value.right_token.type == TokenType::INT_LITERAL &&
+            sameName(increment.node.token, condition.node.left_token) &&
+            sameName(increment.value.left_token, condition.node.left_token)) {
+            bool comparable = true;
+            switch (condition.node.op) {
+                case TokenType::LESS: comparison = Instruction::LESS; break;
+                case TokenType::LESS_EQUAL: comparison = Instruction::LESS_EQUAL; break;
+                case TokenType::GREATER: comparison = Instruction::GREATER; break;
+                case TokenType::GREATER_EQUAL: comparison = Instruction::GREATER_EQUAL; break;
+                default: comparable = false; break;
+            }
+            counter = comparable ? lookup(condition.node.left_token) : -1;
+            if (counter >= 0 && !isNumericType(symbols[counter].type)) counter = -1;
+        }
+        int step = 0;
+        if (counter >= 0) {
+            if (!integerValue(increment.value.right_token, step)) {
+                fail(Error::NUMBER_OUT_OF_RANGE, increment.value.right_token);
+                return;
+            }
+            if (increment.value.op == TokenType::MINUS) step = -step;
+        }
+
+        // loop_start: condition; JUMP_IF_FALSE end
+        position = conditionStart;
+        int loopStart = here();
+        int jumpIfFalse = -1;
+        if (hasCondition) {
+            expression();
+            if (failed) return;
+            jumpIfFalse = emit(Bytecode(Instruction::JUMP_IF_FALSE, 0));
+        }
+
+        position = bodyStart;
+        int bodyStartAddress = here();
+        block();
+        if (failed) return;
+        Position end = position;
+
+        if (counter >= 0) {
+            // body_start: body; limit; LOOP_INC_CMP_JUMP body_start
+            position = condition.node.right_start;
+            term();
+            if (failed) return;
+            const Symbol& symbol = symbols[counter];
+            Instruction loop = symbol.local ? Instruction::LOOP_INC_CMP_JUMP_LOCAL : Instruction::LOOP_INC_CMP_JUMP;
+            emit(Bytecode(loop, bodyStartAddress, symbol.address, static_cast<int>(comparison), step));
+        } else {
+            // body; increment; POP; JUMP loop_start
+            if (hasIncrement) {
+                position = incrementStart;
+                expression();
+                if (failed) return;
+                emit(Bytecode(Instruction::POP));
+            }
+            emit(Bytecode(Instruction::JUMP, loopStart));
+        }
+        if (jumpIfFalse >= 0) patch(jumpIfFalse, here());
+        position = end;
+        exitScope();
+    }
+
+    constexpr void functionDeclaration() {
+        advance(); // 'fn'
+        Lexeme name = position.current;
+        if (!expect(TokenType::IDENTIFIER, Error::EXPECTED_IDENTIFIER)) return;
+        if (inFunction()) {
+            fail(Error::NESTED_FUNCTION, name);
+            return;
+        }
+        for (const char* builtin : kBuiltinNames) {
+            if (lexemeIs(name, builtin)) {
+                fail(Error::UNSUPPORTED_BUILTIN, name);
+                return;
+            }
+        }
+        for (size_t i = 0; i < function_count; ++i) {
+            if (sameName(functions[i].name, name)) {
+                fail(Error::FUNCTION_ALREADY_DECLARED, name);
+                return;
+            }
+        }
+        if (function_count == functions.size()) {
+            fail(Error::TOO_MANY_FUNCTIONS, name);
+            return;
+        }
+        if (!expect(TokenType::LPAREN, Error::EXPECTED_LEFT_PAREN)) return;
+
+        // The body is emitted in place, so straight-line execution jumps over it
+        int jumpOver = emit(Bytecode(Instruction::JUMP, 0));
+        Function& function = functions[function_count++];
+        function.name = name;
+        function.entry = here();
+
+        // Parameters occupy frame slots 0..arity-1, where the caller left the arguments
+        enterScope();
+        function_depth = depth;
+        next_local = 0;
+        if (!check(TokenType::RPAREN)) {
+            do {
+                Lexeme parameter = position.current;
+                if (!expect(TokenType::IDENTIFIER, Error::EXPECTED_IDENTIFIER)) return;
+                addSymbol(parameter, ASTNode::Type::NUMBER);
+                if (failed) return;
+                ++function.arity;
+            } while (match(TokenType::COMMA));
+        }
+        if (!expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN)) return;
+        block();
+        if (failed) return;
+        function.frame_size = next_local;
+        exitScope();
+        function_depth = -1;
+
+        // Falling off the end of the body returns 0
+        emit(Bytecode(Instruction::PUSH_INT, 0));
+        emit(Bytecode(Instruction::RET));
+        patch(jumpOver, here());
+    }
+
+    constexpr void returnStatement() {
+        Lexeme keyword = position.current;
+        advance(); // 'return'
+        if (!inFunction()) {
+            fail(Error::RETURN_OUTSIDE_FUNCTION, keyword);
+            return;
+        }
+        if (check(TokenType::SEMICOLON)) {
+            emit(Bytecode(Instruction::PUSH_INT, 0));
+            emit(Bytecode(Instruction::RET));
+        } else {
+            Expr value = expression();
+            if (failed) return;
+            if (value.resolved == ASTNode::Type::STRING_LITERAL) {
+                fail(Error::STRING_RETURN, keyword);
+                return;
+            }
+            if (value.node.shape == Shape::CALL) {
+                // A call in tail position reuses the current frame instead of returning through it
+                if (!dry) image.code[image.code_size - 1].instruction = Instruction::TAIL_CALL;
+            } else {
+                emit(Bytecode(Instruction::RET));
+            }
+        }
+        expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON);
+    }
+
+    constexpr void printStatement() {
+        advance(); // 'print'
+        if (!expect(TokenType::LPAREN, Error::EXPECTED_LEFT_PAREN)) return;
+        Expr value = expression();
+        if (failed || !expect(TokenType::RPAREN, Error::EXPECTED_RIGHT_PAREN)) return;
+        if (!expect(TokenType::SEMICOLON, Error::EXPECTED_SEMICOLON)) return;
+        emit(Bytecode(value.resolved == ASTNode::Type::STRING_LITERAL ? Instruction::PRINT_STRING : Instruction::PRINT_VALUE));
+    }
+
+    /**
+     * @brief Fills in the target and frame size of every call (as Compiler::patchCalls).
+     */
+    constexpr void patchCalls() {
+        for (size_t i = 0; i < call_site_count; ++i) {
+            const CallSite& site = call_sites[i];
+            const Function* function = nullptr;
+            for (size_t f = 0; f < function_count; ++f) {
+                if (sameName(functions[f].name, site.callee)) function = &functions[f];
+            }
+            if (function == nullptr) {
+                fail(Error::UNDEFINED_FUNCTION, site.callee);
+                return;
+            }
+            Bytecode& call = image.code[site.index];
+            if (call.operand2 != function->arity) {
+                fail(Error::ARGUMENT_COUNT, site.callee);
+                return;
+            }
+            call.operand = function->entry;
+            call.operand3 = function->frame_size;
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * @brief Compiles a script at C++ compile time when used in a constant expression.
+ * @tparam MaxInstructions, MaxStrings, MaxStringBytes The capacity of the returned Program.
+ * @param source The script.
+ * @return The Program, or one whose error() says why the script did not compile.
+ */
+template <size_t MaxInstructions = 1024, size_t MaxStrings = 64, size_t MaxStringBytes = 2048>
+constexpr Program<MaxInstructions, MaxStrings, MaxStringBytes> compile(std::string_view source) {
+    Program<MaxInstructions, MaxStrings, MaxStringBytes> program;
+    detail::ConstexprCompiler<Program<MaxInstructions, MaxStrings, MaxStringBytes>> compiler(source, program);
+    compiler.compile();
+    return program;
+}
+
+/**
+ * @brief Instantiated by COCOM_EMBED to fail the build, naming the Error, line and column, when
+ * a script does not compile.
+ */
+template <Error error, int line, int column>
+struct ScriptCheck {
+    static_assert(error == Error::NONE,
+                  "cocom: the embedded script does not compile (the error and its line and column are this template's arguments)");
+    static constexpr bool ok = true;
+};
+
+} // namespace cocom
+
+/**
+ * @brief Declares `name` as the compiled script `source`, a string literal, and fails the build
+ * if it does not compile.
+ */
+#define COCOM_EMBED(name, source)                                                                \
+    static constexpr auto name = ::cocom::compile(source);                                       \
+    static_assert(::cocom::ScriptCheck<name.error(), name.line(), name.column()>::ok, \
+                  "cocom: embedded script " #name " does not compile")
+
+#endif // CONSTEXPR_COMPILER_H
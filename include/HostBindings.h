@@ -0,0 +1,102 @@
+#ifndef HOST_BINDINGS_H
+#define HOST_BINDINGS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief Host memory bound to a script variable, as recorded by HostBindings.
+ */
+struct HostValue {
+    enum class Kind {
+        NUMBER,        /**< One double, read when a run starts. */
+        FLOAT64_ARRAY, /**< A read-only array of doubles. */
+        INT64_ARRAY,   /**< A read-only array of 64-bit integers. */
+        STRING         /**< A string. */
+    };
+
+    std::string name;
+    Kind kind;
+    const void* data; // The number, the first element or the first character
+    size_t length;    // Elements or characters (1 for a number)
+};
+
+/**
+ * @brief Script variables whose values live in memory the host owns.
+ *
+ * Each bound name becomes a global the script can read but not assign. Arrays are not
+ * copied: the script's array refers to the host's elements where they are, so their memory
+ * must stay valid (and unchanged) while a run uses it. A number is read through its pointer
+ * when each run starts, and a string is copied into the run's string table.
+ *
+ * The compiler declares the names, in binding order, as the program's first globals; the
+ * VM fills those slots from the table at the start of every run. Binding a name again
+ * replaces its memory in place, so one compiled program can run over many records by
+ * rebinding between runs. The kinds must stay as they were at compile time.
+ */
+class HostBindings {
+public:
+    /**
+     * @brief Binds a number. *value is read at the start of each run.
+     * @return The binding's index (its global slot).
+     */
+    int bind(const std::string& name, const double* value) {
+        return set(HostValue{name, HostValue::Kind::NUMBER, value, 1});
+    }
+
+    /**
+     * @brief Binds an array of doubles, which scripts read in place.
+     * @return The binding's index (its global slot).
+     */
+    int bind(const std::string& name, const double* data, size_t length) {
+        return set(HostValue{name, HostValue::Kind::FLOAT64_ARRAY, data, length});
+    }
+
+    /**
+     * @brief Binds an array of 64-bit integers, which scripts read in place.
+     * @return The binding's index (its global slot).
+     */
+    int bind(const std::string& name, const int64_t* data, size_t length) {
+        return set(HostValue{name, HostValue::Kind::INT64_ARRAY, data, length});
+    }
+
+    /**
+     * @brief Binds a string.
+     * @return The binding's index (its global slot).
+     */
+    int bind(const std::string& name, std::string_view text) {
+        return set(HostValue{name, HostValue::Kind::STRING, text.data(), text.size()});
+    }
+
+    /**
+     * @brief Looks up a binding by name.
+     * @return Its index, or -1 if nothing is bound to the name.
+     */
+    int find(const std::string& name) const {
+        for (size_t i = 0; i < values.size(); ++i) {
+            if (values[i].name == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    const HostValue& operator[](size_t index) const { return values[index]; }
+    size_t size() const { return values.size(); }
+
+private:
+    std::vector<HostValue> values;
+
+    int set(const HostValue& value) {
+        int index = find(value.name);
+        if (index >= 0) {
+            values[index] = value;
+            return index;
+        }
+        values.push_back(value);
+        return static_cast<int>(values.size() - 1);
+    }
+};
+
+#endif // HOST_BINDINGS_H
@@ -0,0 +1,105 @@
+#ifndef NATIVE_TABLE_H
+#define NATIVE_TABLE_H
+
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief A host C++ function callable from scripts, as bound to a NativeTable.
+ */
+struct NativeFunction {
+    using Erased = void (*)(); // The bound function with its type erased; only its own thunk casts it back
+    using Thunk = double (*)(Erased function, const double* args);
+
+    std::string name;
+    int arity;
+    Thunk thunk;     // Converts args (arity values, leftmost first) to the parameter types, calls and converts the result
+    Erased function;
+};
+
+namespace native_detail {
+
+// Script values are doubles; parameters and results may be any arithmetic type (bool is 0 or 1)
+template <typename T>
+struct Value {
+    static_assert(std::is_arithmetic<T>::value, "Host functions take and return arithmetic types (or return void)");
+    static T from(double value) { return static_cast<T>(value); }
+};
+
+template <>
+struct Value<bool> {
+    static bool from(double value) { return value != 0.0; }
+};
+
+template <typename R, typename... Args, size_t... I>
+double call(R (*function)(Args...), [[maybe_unused]] const double* args, std::index_sequence<I...>) {
+    if constexpr (std::is_void<R>::value) {
+        function(Value<std::decay_t<Args>>::from(args[I])...);
+        return 0.0;
+    } else {
+        static_assert(std::is_arithmetic<R>::value, "Host functions take and return arithmetic types (or return void)");
+        return static_cast<double>(function(Value<std::decay_t<Args>>::from(args[I])...));
+    }
+}
+
+// One instantiation per signature: the argument unpacking is generated at compile time
+template <typename R, typename... Args>
+double thunk(NativeFunction::Erased function, const double* args) {
+    return call(reinterpret_cast<R (*)(Args...)>(function), args, std::index_sequence_for<Args...>());
+}
+
+} // namespace native_detail
+
+/**
+ * @brief Host functions scripts can call by name.
+ *
+ * bind() records a plain function pointer together with a thunk generated from its
+ * signature. The compiler turns a call to a bound name into CALL_NATIVE with the function's
+ * index, and the VM calls the thunk on the arguments where they lie on its stack: no boxing,
+ * no std::function and no allocation per call. The table must outlive the compilers and VMs
+ * it is given to, and must not change while a VM that uses it is running.
+ */
+class NativeTable {
+public:
+    /**
+     * @brief Binds a host function to a name. Binding a name again replaces its function in
+     * place, so programs already compiled against the table call the new one.
+     * @param name The name scripts call it by.
+     * @param function A function taking and returning arithmetic types (or returning void).
+     * @return The function's index (CALL_NATIVE operand).
+     */
+    template <typename R, typename... Args>
+    int bind(const std::string& name, R (*function)(Args...)) {
+        NativeFunction native{name, static_cast<int>(sizeof...(Args)), &native_detail::thunk<R, Args...>,
+                              reinterpret_cast<NativeFunction::Erased>(function)};
+        int index = find(name);
+        if (index >= 0) {
+            functions[index] = native;
+            return index;
+        }
+        functions.push_back(native);
+        return static_cast<int>(functions.size() - 1);
+    }
+
+    /**
+     * @brief Looks up a function by name.
+     * @return Its index, or -1 if nothing is bound to the name.
+     */
+    int find(const std::string& name) const {
+        for (size_t i = 0; i < functions.size(); ++i) {
+            if (functions[i].name == name) return static_cast<int>(i);
+        }
+        return -1;
+    }
+
+    const NativeFunction& operator[](size_t index) const { return functions[index]; }
+    size_t size() const { return functions.size(); }
+
+private:
+    std::vector<NativeFunction> functions;
+};
+
+#endif // NATIVE_TABLE_H
@@ -0,0 +1,19 @@
+#ifndef RUN_ERROR_H
+#define RUN_ERROR_H
+
+#include <cstdint>
+
+/**
+ * @brief Why a run failed, so that hosts can tell a script stopped by one of its limits from
+ * one that is broken. The error text says more; this is the part meant for code.
+ */
+enum class RunError : uint8_t {
+    NONE = 0,               // The run halted normally
+    RUNTIME = 1,            // Any error other than a limit: a bad operand, a missing value, too deep a call stack, ...
+    BACK_EDGE_BUDGET = 2,   // More backward jumps than the back-edge budget allows
+    INSTRUCTION_BUDGET = 3, // More instructions than the instruction budget allows
+    DEADLINE = 4,           // The run was still going when its deadline passed
+    STRING_BYTES = 5,       // Its concatenations made more string bytes than the cap allows
+};
+
+#endif // RUN_ERROR_H
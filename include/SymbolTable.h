@@ -1,6 +1,7 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
+#include <ostream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -12,16 +13,18 @@
 struct Symbol {
     std::string name; /**< The name of the symbol. */
     ASTNode::Type type; /**< The type of the symbol. */
-    int address; /**< The memory address assigned to the symbol. */
+    int address; /**< The memory address assigned to the symbol, or its frame slot if it is a local. */
+    bool isLocal; /**< True if the symbol lives in a function's call frame rather than global memory. */
 
     /**
      * @brief Constructs a new Symbol object.
      * @param name The name of the symbol.
      * @param type The type of the symbol.
-     * @param address The memory address assigned to the symbol.
+     * @param address The memory address (or frame slot) assigned to the symbol.
+     * @param isLocal Whether the symbol is a function local.
      */
-    Symbol(const std::string& name, ASTNode::Type type, int address)
-        : name(name), type(type), address(address) {}
+    Symbol(const std::string& name, ASTNode::Type type, int address, bool isLocal = false)
+        : name(name), type(type), address(address), isLocal(isLocal) {}
 };
 
 /**
@@ -44,6 +47,49 @@ public:
      */
     void exitScope();
 
+    /**
+     * @brief Enters the outermost scope of a function body.
+     * Symbols added until the matching exitFunctionScope() are locals numbered from frame slot 0.
+     */
+    void enterFunctionScope();
+
+    /**
+     * @brief Exits the outermost scope of a function body.
+     */
+    void exitFunctionScope();
+
+    /**
+     * @brief Enters the outermost scope of a function body inlined at a call site.
+     * Lookups that pass this scope only see globals declared before the function
+     * (address below visibleAddressLimit), never the caller's locals or later globals,
+     * so the inlined body resolves names exactly as the out-of-line body did.
+     * @param visibleAddressLimit The next global address at the point the function was declared.
+     */
+    void enterInlineScope(int visibleAddressLimit);
+
+    /**
+     * @brief Exits the outermost scope of an inlined function body.
+     */
+    void exitInlineScope();
+
+    /**
+     * @brief Returns the next global address that will be assigned.
+     * @return The next available memory address.
+     */
+    int getNextAddress() const;
+
+    /**
+     * @brief Checks whether a function body is currently being compiled.
+     * @return True if inside a function scope.
+     */
+    bool inFunction() const;
+
+    /**
+     * @brief Returns the number of frame slots used by the current function so far.
+     * @return The number of locals (including parameters).
+     */
+    int getLocalCount() const;
+
     /**
      * @brief Adds a symbol to the current scope.
      * @param name The name of the symbol.
@@ -52,6 +98,13 @@ public:
      */
     bool addSymbol(const std::string& name, ASTNode::Type type);
 
+    /**
+     * @brief Reserves an unnamed frame slot in the current function.
+     * Used for compiler-managed values such as a parallel loop's chunk limit.
+     * @return The slot number.
+     */
+    int reserveLocal();
+
     /**
      * @brief Looks up a symbol in the current and enclosing scopes.
      * @param name The name of the symbol to look up.
@@ -59,9 +112,41 @@ public:
      */
     Symbol* lookupSymbol(const std::string& name);
 
+    /**
+     * @brief The scope depth and next global address at some point, to return to with restore().
+     */
+    struct Checkpoint {
+        size_t scopes;
+        int next_address;
+    };
+
+    /**
+     * @brief Records the current scope depth and next global address.
+     * @return The checkpoint.
+     */
+    Checkpoint checkpoint() const;
+
+    /**
+     * @brief Returns to a checkpoint, as if nothing had been compiled since: leaves the scopes
+     * entered after it (including any function or inlined body left open by an error) and
+     * forgets the globals declared after it. Used when one piece of a REPL session fails to compile.
+     * @param checkpoint A checkpoint taken at this scope depth or deeper.
+     */
+    void restore(const Checkpoint& checkpoint);
+
+    /**
+     * @brief Sets where scope errors are reported (std::cerr unless set).
+     * @param stream The stream to write to.
+     */
+    void setErrorStream(std::ostream& stream) { errors = &stream; }
+
 private:
     std::vector<std::unordered_map<std::string, Symbol>> scopes; /**< A stack of scopes, each mapping symbol names to Symbols. */
     int next_address; /**< The next available memory address for a new symbol. */
+    int function_scope_depth; /**< Index of the current function's outermost scope, or -1 outside functions. */
+    int next_local; /**< The next available frame slot in the current function. */
+    std::vector<std::pair<int, int>> inline_barriers; /**< (scope index, visible address limit) of each active inlined body. */
+    std::ostream* errors; /**< Where scope errors are reported. */
 };
 
 #endif // SYMBOL_TABLE_H
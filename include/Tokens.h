@@ -35,6 +35,8 @@ enum class TokenType {
     // Grouping
     LPAREN,     // (
     RPAREN,     // )
+    LBRACKET,   // [
+    RBRACKET,   // ]
 
     // Keywords
     VAR,        // var keyword for variable declaration
@@ -48,10 +50,17 @@ enum class TokenType {
 
     // Delimiters
     SEMICOLON,  // ;
+    COMMA,      // ,
+    COLON,      // :
 
     // Control flow
     IF,         // if keyword
     ELSE,       // else keyword
+    WHILE,      // while keyword
+    FOR,        // for keyword
+    PARALLEL,   // parallel keyword (parallel for)
+    FN,         // fn keyword for function declaration
+    RETURN,     // return keyword
     LBRACE,     // {
     RBRACE,     // }
 
@@ -94,13 +103,22 @@ struct Token {
             case TokenType::OR:           type_str = "OR"; break;
             case TokenType::LPAREN:       type_str = "LPAREN"; break;
             case TokenType::RPAREN:       type_str = "RPAREN"; break;
+            case TokenType::LBRACKET:     type_str = "LBRACKET"; break;
+            case TokenType::RBRACKET:     type_str = "RBRACKET"; break;
             case TokenType::VAR:          type_str = "VAR"; break;
             case TokenType::PRINT:        type_str = "PRINT"; break;
             case TokenType::IDENTIFIER:   type_str = "IDENTIFIER"; break;
             case TokenType::ASSIGN:       type_str = "ASSIGN"; break;
             case TokenType::SEMICOLON:    type_str = "SEMICOLON"; break;
+            case TokenType::COMMA:        type_str = "COMMA"; break;
+            case TokenType::COLON:        type_str = "COLON"; break;
             case TokenType::IF:           type_str = "IF"; break;
             case TokenType::ELSE:         type_str = "ELSE"; break;
+            case TokenType::WHILE:        type_str = "WHILE"; break;
+            case TokenType::FOR:          type_str = "FOR"; break;
+            case TokenType::PARALLEL:     type_str = "PARALLEL"; break;
+            case TokenType::FN:           type_str = "FN"; break;
+            case TokenType::RETURN:       type_str = "RETURN"; break;
             case TokenType::LBRACE:       type_str = "LBRACE"; break;
             case TokenType::RBRACE:       type_str = "RBRACE"; break;
             // Add more as you define them
@@ -2,6 +2,10 @@
 #include <string>
 #include <vector>
 #include <fstream> // For reading from file
+#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
 
 #include "Tokens.h"
 #include "src/Lexer.h"
@@ -9,9 +13,77 @@
 #include "include/AST.h"
 #include "src/Compiler.h"
 #include "src/VM.h"
+#include "src/AOTCompiler.h"
+#include "src/BytecodeImage.h"
+#include "src/CompilationCache.h"
+#include "src/ThreadPool.h"
+#include "src/BatchRunner.h"
+#include "src/Supervisor.h"
+#include "src/Daemon.h"
+#include "src/Session.h"
+
+// Command-line options that affect how programs are run
+struct RunOptions {
+    bool trace = true;        // Whether the VM prints a DEBUG line for every executed instruction
+    size_t max_frames = 1024; // Maximum call depth of the VM
+    bool jit = false;         // Run programs as x86-64 machine code (when not tracing)
+    bool closures = false;    // Run programs as pre-bound handlers where the JIT does not (when not tracing)
+    uint32_t tier_up_threshold = 1000; // Loop iterations or calls after which a program switches to its optimized tier (0 = never)
+    uint64_t instruction_budget = 0; // Maximum instructions a run may execute (0 = unlimited)
+    uint32_t deadline_ms = 0;        // Wall-clock time a run may take (0 = unlimited)
+    uint64_t max_string_bytes = 0;   // Maximum bytes of strings a run's concatenations may make (0 = unlimited)
+    std::string aot_output;   // Build a native executable (or shared object) here instead of running the program
+    bool aot_shared = false;  // With aot_output: build a shared object exporting cocom_run
+    std::string emit_c;       // Write the AOT backend's C translation here instead of running the program
+    std::string image_output; // With the compile command: write a bytecode image (.cocb) here instead of running the program
+    CompilationCache* cache = nullptr; // Reuse programs compiled by earlier runs (--cache-dir), or null
+};
+
+// Sets up a VM as the options ask
+static void configure_vm(VM& vm, const RunOptions& options) {
+    vm.setTrace(options.trace);
+    vm.setMaxFrames(options.max_frames);
+    vm.setJit(options.jit);
+    vm.setClosures(options.closures);
+    vm.setTierUpThreshold(options.tier_up_threshold);
+    vm.setInstructionBudget(options.instruction_budget);
+    vm.setDeadline(options.deadline_ms);
+    vm.setMaxStringBytes(options.max_string_bytes);
+}
+
+// Runs a loaded bytecode image and prints its result, as process_source_code does for a program it compiled
+static void run_image(const BytecodeImage& image, const RunOptions& options) {
+    VM vm;
+    configure_vm(vm, options);
+    double result = vm.run(image.code(), image.size(), image.strings(), image.globalCount());
+
+    std::cout << "\n--- Result ---" << std::endl;
+    if (image.flags() & BytecodeImage::kExpressionResult) {
+        std::cout << result << std::endl;
+    }
+    std::cout << "------------" << std::endl;
+}
 
 // Function to process a single source code string
-void process_source_code(const std::string& source_code) {
+void process_source_code(const std::string& source_code, const RunOptions& options = RunOptions()) {
+    // Compilation Cache: a program compiled by an earlier run skips every phase up to running it
+    std::string cache_key;
+    if (options.cache && options.image_output.empty() && options.aot_output.empty() && options.emit_c.empty()) {
+        cache_key = CompilationCache::key(source_code, ""); // No option changes the bytecode the compiler generates
+        BytecodeImage image;
+        if (options.cache->lookup(cache_key, image)) {
+            std::cout << "\n========================================" << std::endl;
+            std::cout << "Phase: Compilation Cache" << std::endl;
+            std::cout << "Explanation: This source was compiled before, so its cached bytecode runs without lexing, parsing or compiling." << std::endl;
+            std::cout << "Using: CompilationCache (src/CompilationCache.cpp, src/CompilationCache.h) to map a cached .cocb file." << std::endl;
+            std::cout << "========================================" << std::endl;
+            std::cout << "Cache hit " << cache_key << ": " << image.size() << " instructions" << std::endl;
+            std::cout << "----------------------" << std::endl;
+            run_image(image, options);
+            return;
+        }
+    }
+
     // Lexical Analysis (Scanning)
     std::cout << "\n========================================" << std::endl;
     std::cout << "Phase: Lexical Analysis (Scanning)" << std::endl;
@@ -92,6 +164,27 @@ void process_source_code(const std::string& source_code) {
                 case Instruction::PRINT_STRING: std::cout << "PRINT_STRING " << static_cast<int>(bytecode.operand) << " (\"" << compiler.getStringLiteral(static_cast<int>(bytecode.operand)) << "\")" << std::endl; break; // New: PRINT_STRING instruction
                 case Instruction::HALT: std::cout << "HALT" << std::endl; break;
                 case Instruction::POP: std::cout << "POP" << std::endl; break;
+                case Instruction::LOOP_INC_CMP_JUMP: std::cout << "LOOP_INC_CMP_JUMP " << static_cast<int>(bytecode.operand) << " (address " << bytecode.operand2 << ", " << instruction_to_string(static_cast<Instruction>(bytecode.operand3)) << ", step " << bytecode.operand4 << ")" << std::endl; break;
+                case Instruction::LOOP_INC_CMP_JUMP_LOCAL: std::cout << "LOOP_INC_CMP_JUMP_LOCAL " << static_cast<int>(bytecode.operand) << " (slot " << bytecode.operand2 << ", " << instruction_to_string(static_cast<Instruction>(bytecode.operand3)) << ", step " << bytecode.operand4 << ")" << std::endl; break;
+                case Instruction::LOAD_LOCAL: std::cout << "LOAD_LOCAL " << static_cast<int>(bytecode.operand) << std::endl; break;
+                case Instruction::STORE_LOCAL: std::cout << "STORE_LOCAL " << static_cast<int>(bytecode.operand) << std::endl; break;
+                case Instruction::CALL: std::cout << "CALL " << static_cast<int>(bytecode.operand) << " (args " << bytecode.operand2 << ", frame " << bytecode.operand3 << ")" << std::endl; break;
+                case Instruction::TAIL_CALL: std::cout << "TAIL_CALL " << static_cast<int>(bytecode.operand) << " (args " << bytecode.operand2 << ", frame " << bytecode.operand3 << ")" << std::endl; break;
+                case Instruction::RET: std::cout << "RET" << std::endl; break;
+                case Instruction::NEW_ARRAY: std::cout << "NEW_ARRAY " << static_cast<int>(bytecode.operand) << std::endl; break;
+                case Instruction::ARRAY_GET: std::cout << "ARRAY_GET" << std::endl; break;
+                case Instruction::ARRAY_SET: std::cout << "ARRAY_SET" << std::endl; break;
+                case Instruction::CALL_BUILTIN: std::cout << "CALL_BUILTIN " << static_cast<int>(bytecode.operand) << " (args " << bytecode.operand2 << (bytecode.operand3 ? ", scalar" : "") << ")" << std::endl; break;
+                case Instruction::PRINT_ARRAY: std::cout << "PRINT_ARRAY" << std::endl; break;
+                case Instruction::MAP_GET: std::cout << "MAP_GET" << (bytecode.operand ? " (string key)" : "") << std::endl; break;
+                case Instruction::MAP_SET: std::cout << "MAP_SET" << (bytecode.operand ? " (string key)" : "") << std::endl; break;
+                case Instruction::MAP_HAS: std::cout << "MAP_HAS" << (bytecode.operand ? " (string key)" : "") << std::endl; break;
+                case Instruction::MAP_DELETE: std::cout << "MAP_DELETE" << (bytecode.operand ? " (string key)" : "") << std::endl; break;
+                case Instruction::PARALLEL_FOR: std::cout << "PARALLEL_FOR " << static_cast<int>(bytecode.operand) << " (frame " << bytecode.operand2 << ", " << instruction_to_string(static_cast<Instruction>(bytecode.operand3)) << ", step " << bytecode.operand4 << ")" << std::endl; break;
+                case Instruction::PARALLEL_REDUCE: std::cout << "PARALLEL_REDUCE " << static_cast<int>(bytecode.operand) << " (address " << bytecode.operand2 << ", slot " << bytecode.operand3 << ")" << std::endl; break;
+                case Instruction::LOAD_GLOBAL: std::cout << "LOAD_GLOBAL " << static_cast<int>(bytecode.operand) << std::endl; break;
+                case Instruction::CALL_NATIVE: std::cout << "CALL_NATIVE " << static_cast<int>(bytecode.operand) << " (args " << bytecode.operand2 << ")" << std::endl; break;
+                case Instruction::STORE_GLOBAL: std::cout << "STORE_GLOBAL " << static_cast<int>(bytecode.operand) << (bytecode.operand2 ? " (pop)" : "") << std::endl; break;
                 default: std::cout << "UNKNOWN INSTRUCTION: " << static_cast<int>(bytecode.instruction) << std::endl; break;
             }
         }
@@ -100,7 +193,59 @@ void process_source_code(const std::string& source_code) {
         std::cout << "No instructions to execute (compilation failed)" << std::endl;
     }
 
+    if (!options.image_output.empty()) {
+        // Bytecode Image (instead of running the program)
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "Phase: Bytecode Image" << std::endl;
+        std::cout << "Explanation: Saves the bytecode, string literals and global slot count, so later runs skip every phase above." << std::endl;
+        std::cout << "Using: BytecodeImage (src/BytecodeImage.cpp, src/BytecodeImage.h) to write a .cocb file." << std::endl;
+        std::cout << "========================================" << std::endl;
+        bool expression = ast != nullptr && (dynamic_cast<Expression*>(ast) || dynamic_cast<AssignmentExpression*>(ast));
+        if (bytecode_instructions.empty()) {
+            std::cout << "Nothing to save (compilation failed)" << std::endl;
+        } else if (BytecodeImage::write(options.image_output, bytecode_instructions, compiler.getStringLiterals(),
+                                        static_cast<uint32_t>(compiler.getGlobalCount()),
+                                        expression ? BytecodeImage::kExpressionResult : 0)) {
+            std::cout << "Wrote bytecode image '" << options.image_output << "' (" << bytecode_instructions.size()
+                      << " instructions)" << std::endl;
+        }
+        delete ast;
+        return;
+    }
+
+    if (!options.aot_output.empty() || !options.emit_c.empty()) {
+        // Ahead-of-Time Compilation (instead of running the program)
+        std::cout << "\n========================================" << std::endl;
+        std::cout << "Phase: Ahead-of-Time Compilation" << std::endl;
+        std::cout << "Explanation: Translates the bytecode into C and builds it with the system C compiler." << std::endl;
+        std::cout << "Using: AOTCompiler (src/AOTCompiler.cpp, src/AOTCompiler.h) to generate C, then $CC (or cc)." << std::endl;
+        std::cout << "========================================" << std::endl;
+        AOTCompiler aot;
+        aot.setMaxFrames(options.max_frames);
+        if (bytecode_instructions.empty()) {
+            std::cout << "Nothing to compile (compilation failed)" << std::endl;
+        } else if (!options.emit_c.empty()) {
+            std::ofstream file(options.emit_c);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not write '" << options.emit_c << "'" << std::endl;
+            } else if (aot.translate(bytecode_instructions, compiler.getStringLiterals(), file)) {
+                std::cout << "Wrote C source to '" << options.emit_c << "'" << std::endl;
+            }
+        } else if (aot.build(bytecode_instructions, compiler.getStringLiterals(), options.aot_output, options.aot_shared)) {
+            std::cout << "Built " << (options.aot_shared ? "shared object" : "executable") << " '" << options.aot_output << "'" << std::endl;
+        }
+        delete ast;
+        return;
+    }
+
+    if (!cache_key.empty() && !bytecode_instructions.empty()) {
+        bool expression = ast != nullptr && (dynamic_cast<Expression*>(ast) || dynamic_cast<AssignmentExpression*>(ast));
+        options.cache->store(cache_key, bytecode_instructions, compiler.getStringLiterals(),
+                             static_cast<uint32_t>(compiler.getGlobalCount()), expression ? BytecodeImage::kExpressionResult : 0);
+    }
+
     VM vm;
+    configure_vm(vm, options);
     double result = 0;
     if (!bytecode_instructions.empty()) {
         result = vm.run(bytecode_instructions, compiler.getStringLiterals()); // Pass string literals to VM
@@ -126,6 +271,161 @@ void process_source_code(const std::string& source_code) {
     delete ast;
 }
 
+// Runs a bytecode image written by the compile command, skipping lexing, parsing and compiling
+void process_image(const std::string& path, const RunOptions& options) {
+    std::cout << "\n========================================" << std::endl;
+    std::cout << "Phase: Loading Bytecode Image" << std::endl;
+    std::cout << "Explanation: Maps a program compiled earlier; its instructions run where they lie in the file." << std::endl;
+    std::cout << "Using: BytecodeImage (src/BytecodeImage.cpp, src/BytecodeImage.h) to map and check a .cocb file." << std::endl;
+    std::cout << "========================================" << std::endl;
+
+    BytecodeImage image;
+    if (!image.load(path)) {
+        return;
+    }
+    std::cout << "Loaded " << image.size() << " instructions, " << image.strings().size() << " string literals and "
+              << image.globalCount() << " global slots" << std::endl;
+    std::cout << "----------------------" << std::endl;
+    run_image(image, options);
+}
+
+// Options of the batch command
+struct BatchOptions {
+    size_t jobs = 0;         // Threads running scripts (0 = one per hardware thread)
+    size_t processes = 0;    // Run scripts in this many worker processes instead of threads (0 = threads)
+    uint32_t timeout_ms = 0; // With processes: longest a script may run before its worker is killed (0 = no limit)
+};
+
+// Reads the inputs of the batch and client commands: .cocom files and quoted sources
+static bool read_scripts(const std::vector<std::string>& paths, std::vector<BatchScript>& scripts) {
+    for (const std::string& arg : paths) {
+        if (arg.length() > 6 && arg.substr(arg.length() - 6) == ".cocom") {
+            std::ifstream file(arg);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open file '" << arg << "'" << std::endl;
+                return false;
+            }
+            scripts.push_back(BatchScript{arg, std::string((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>())});
+        } else if (arg.length() > 2 && arg.front() == '"' && arg.back() == '"') {
+            scripts.push_back(BatchScript{arg, arg.substr(1, arg.length() - 2)});
+        } else {
+            std::cerr << "Error: Invalid input '" << arg << "'. Expected a .cocom file path or a quoted string." << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Prints each script's output in input order, then the totals; returns the exit status
+static int print_outcomes(const std::vector<BatchScript>& scripts, const std::vector<BatchOutcome>& outcomes,
+                          const BatchSummary& summary, const std::string& title, const std::string& runners) {
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        const cocompiler::Result& result = outcomes[i].result;
+        std::cout << "\n=== " << scripts[i].name << " ===" << std::endl;
+        std::cout << result.output << result.errors;
+        if (result.ok && outcomes[i].expression) {
+            std::cout << result.value << std::endl;
+        }
+    }
+
+    std::cout << "\n--- " << title << " ---" << std::endl;
+    std::cout << summary.scripts << " scripts (" << summary.programs << " distinct programs, " << summary.failures
+              << " failed) " << runners << " in " << summary.seconds * 1e3 << " ms: "
+              << summary.throughput() << " scripts/s" << std::endl;
+    std::cout << "Latency (us): p50 " << summary.p50 * 1e6 << ", p90 " << summary.p90 * 1e6 << ", p99 " << summary.p99 * 1e6
+              << ", max " << summary.max * 1e6 << std::endl;
+    std::cout << "-------------" << std::endl;
+    return summary.failures == 0 ? 0 : 1;
+}
+
+// How scripts run under the batch, serve and client commands
+static cocompiler::Inputs script_inputs(const RunOptions& options) {
+    cocompiler::Inputs inputs;
+    inputs.jit = options.jit;
+    inputs.closures = options.closures;
+    inputs.tier_up_threshold = options.tier_up_threshold;
+    inputs.max_frames = options.max_frames;
+    inputs.instruction_budget = options.instruction_budget;
+    inputs.deadline_ms = options.deadline_ms;
+    inputs.max_string_bytes = options.max_string_bytes;
+    return inputs;
+}
+
+// Runs every input of the batch command concurrently, then prints each one's output in input order and the totals
+static int run_batch(const std::vector<std::string>& paths, const BatchOptions& batch, const RunOptions& options) {
+    std::vector<BatchScript> scripts;
+    if (!read_scripts(paths, scripts)) return 1;
+
+    cocompiler::Inputs inputs = script_inputs(options);
+    std::vector<BatchOutcome> outcomes;
+    BatchSummary summary;
+    std::string runners;
+    if (batch.processes > 0) {
+        Supervisor supervisor(batch.processes, inputs, batch.timeout_ms);
+        outcomes = supervisor.run(scripts);
+        summary = supervisor.summary();
+        runners = "on " + std::to_string(supervisor.getWorkers()) + " worker processes (" +
+                  std::to_string(supervisor.getRespawns()) + " respawned)";
+    } else {
+        BatchRunner runner(batch.jobs, inputs);
+        outcomes = runner.run(scripts);
+        summary = runner.summary();
+        runners = "on " + std::to_string(runner.getJobs()) + " jobs";
+    }
+    return print_outcomes(scripts, outcomes, summary, "Batch", runners);
+}
+
+static Daemon* serving = nullptr; // The daemon SIGINT and SIGTERM stop
+
+static void stop_serving(int) {
+    if (serving) serving->stop();
+}
+
+// Serves compile and run requests on a Unix domain socket until interrupted
+static int run_daemon(const std::string& socket_path, size_t threads, const RunOptions& options) {
+    Daemon daemon(threads, script_inputs(options));
+    if (!daemon.start(socket_path)) return 1;
+    serving = &daemon;
+    std::signal(SIGINT, stop_serving);
+    std::signal(SIGTERM, stop_serving);
+    std::cout << "Serving on '" << socket_path << "' with " << daemon.getThreads() << " threads (Ctrl+C stops)" << std::endl;
+    daemon.wait();
+    serving = nullptr;
+    std::cout << "Served " << daemon.getRequests() << " requests, compiling " << daemon.getCompiles() << " programs" << std::endl;
+    return 0;
+}
+
+// Sends every input to a running daemon over one connection, then prints the outputs and totals as the batch command does
+static int run_client(const std::vector<std::string>& paths, const std::string& socket_path) {
+    std::vector<BatchScript> scripts;
+    if (!read_scripts(paths, scripts)) return 1;
+    DaemonClient client;
+    if (!client.connect(socket_path)) return 1;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchOutcome> outcomes(scripts.size());
+    std::vector<uint64_t> programs;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        auto sent = std::chrono::steady_clock::now();
+        daemon_protocol::Reply reply;
+        cocompiler::Result& result = outcomes[i].result;
+        if (!client.runSource(scripts[i].source, reply, result.output, result.errors)) {
+            std::cerr << "Daemon Error: The connection to '" << socket_path << "' failed." << std::endl;
+            return 1;
+        }
+        outcomes[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - sent).count();
+        outcomes[i].expression = reply.expression != 0;
+        result.ok = reply.status == daemon_protocol::Status::OK;
+        result.value = reply.value;
+        programs.push_back(reply.program);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::sort(programs.begin(), programs.end());
+    size_t distinct = static_cast<size_t>(std::unique(programs.begin(), programs.end()) - programs.begin());
+    return print_outcomes(scripts, outcomes, BatchSummary::of(outcomes, distinct, seconds), "Client",
+                          "via '" + socket_path + "'");
+}
+
 int main(int argc, char* argv[]) {
     // --- NEW IMPLEMENTATION (v1) ---
     // Redirect std::cerr to std::cout for easier debugging in this environment
@@ -133,42 +433,165 @@ int main(int argc, char* argv[]) {
     // --- END NEW IMPLEMENTATION (v1) ---
     std::cout << "Welcome to CoCompiler!" << std::endl;
 
-    if (argc > 1) {
-        // Process command-line arguments as source code files or direct strings
-        for (int i = 1; i < argc; ++i) {
-            std::string arg = argv[i];
-            // Check if argument is a file path with .cocom extension
-            if (arg.length() > 6 && arg.substr(arg.length() - 6) == ".cocom") {
+    // Options (arguments starting with "--") are recognised anywhere on the command line.
+    // "compile <input> -o <file.cocb>" saves a bytecode image instead of running the input.
+    // "batch [--jobs=N | --processes=N [--timeout=MS]] [--manifest=FILE] <inputs>" runs the inputs concurrently (see run_batch).
+    // "serve --socket=PATH [--jobs=N]" starts a daemon; "client --socket=PATH [--manifest=FILE] <inputs>" runs the inputs on it.
+    RunOptions options;
+    std::string cache_directory;
+    uint64_t cache_size = 64ull << 20;
+    bool compile_command = argc > 1 && std::string(argv[1]) == "compile";
+    bool batch_command = argc > 1 && std::string(argv[1]) == "batch";
+    bool serve_command = argc > 1 && std::string(argv[1]) == "serve";
+    bool client_command = argc > 1 && std::string(argv[1]) == "client";
+    BatchOptions batch_options;
+    std::string socket_path;
+    std::vector<std::string> inputs;
+    for (int i = compile_command || batch_command || serve_command || client_command ? 2 : 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-o") {
+            if (!compile_command || i + 1 == argc) {
+                std::cerr << "Usage: cocompiler compile <file.cocom | \"source\"> -o <file.cocb>" << std::endl;
+                return 1;
+            }
+            options.image_output = argv[++i];
+        } else if (arg == "--no-trace") {
+            options.trace = false; // Disable the per-instruction VM trace (e.g., for long-running loops)
+        } else if (arg == "--jit") {
+            options.jit = true; // Compile to machine code with the baseline JIT; falls back to the interpreter where unsupported
+        } else if (arg == "--closures") {
+            options.closures = true; // Run the closure-compiled tier: portable, without executable memory
+        } else if (arg.rfind("--aot=", 0) == 0) {
+            options.aot_output = arg.substr(6); // Compile to a native executable instead of running
+        } else if (arg.rfind("--aot-shared=", 0) == 0) {
+            options.aot_output = arg.substr(13); // Compile to a shared object exporting cocom_run
+            options.aot_shared = true;
+        } else if (arg.rfind("--emit-c=", 0) == 0) {
+            options.emit_c = arg.substr(9); // Write the C translation used by --aot
+        } else if (arg.rfind("--tier-threshold=", 0) == 0) {
+            options.tier_up_threshold = static_cast<uint32_t>(std::stoul(arg.substr(17))); // When hot loops and functions get optimized; 0 disables tier-up
+        } else if (arg.rfind("--max-frames=", 0) == 0) {
+            options.max_frames = std::stoul(arg.substr(13)); // Maximum recursion depth
+        } else if (arg.rfind("--instruction-budget=", 0) == 0) {
+            options.instruction_budget = std::stoull(arg.substr(21)); // Stop runs after this many instructions
+        } else if (arg.rfind("--deadline-ms=", 0) == 0) {
+            options.deadline_ms = static_cast<uint32_t>(std::stoul(arg.substr(14))); // Stop runs still going after this long
+        } else if (arg.rfind("--max-string-bytes=", 0) == 0) {
+            options.max_string_bytes = std::stoull(arg.substr(19)); // Stop runs whose strings grow past this
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            cache_directory = arg.substr(12); // Cache compiled programs here, keyed by their source
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            cache_size = std::stoull(arg.substr(13)); // Bytes of cached programs to keep (least recently used are evicted)
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            ThreadPool::setSharedThreadCount(std::stoul(arg.substr(10))); // Threads used by the parallel array builtins
+        } else if ((serve_command || client_command) && arg.rfind("--socket=", 0) == 0) {
+            socket_path = arg.substr(9); // The daemon's Unix domain socket
+        } else if ((batch_command || serve_command) && (arg == "--jobs" || arg.rfind("--jobs=", 0) == 0)) {
+            if (arg == "--jobs" && i + 1 == argc) {
+                std::cerr << "Usage: cocompiler batch [--jobs=N | --processes=N [--timeout=MS]] [--manifest=FILE] <file.cocom | \"source\">..." << std::endl;
+                return 1;
+            }
+            batch_options.jobs = std::stoul(arg == "--jobs" ? argv[++i] : arg.substr(7)); // Scripts run at the same time
+        } else if (batch_command && arg.rfind("--processes=", 0) == 0) {
+            batch_options.processes = std::stoul(arg.substr(12)); // Isolate scripts in forked worker processes
+        } else if (batch_command && arg.rfind("--timeout=", 0) == 0) {
+            batch_options.timeout_ms = static_cast<uint32_t>(std::stoul(arg.substr(10))); // Kill workers stuck in one script
+        } else if ((batch_command || client_command) && (arg == "--manifest" || arg.rfind("--manifest=", 0) == 0)) {
+            if (arg == "--manifest" && i + 1 == argc) {
+                std::cerr << "Usage: cocompiler batch [--jobs=N | --processes=N [--timeout=MS]] [--manifest=FILE] <file.cocom | \"source\">..." << std::endl;
+                return 1;
+            }
+            // One input per line; blank lines and lines starting with '#' are skipped
+            std::string manifest = arg == "--manifest" ? argv[++i] : arg.substr(11);
+            std::ifstream file(manifest);
+            if (!file.is_open()) {
+                std::cerr << "Error: Could not open manifest '" << manifest << "'" << std::endl;
+                return 1;
+            }
+            std::string line;
+            while (std::getline(file, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                if (!line.empty() && line[0] != '#') inputs.push_back(line);
+            }
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "Error: Unknown option '" << arg << "'" << std::endl;
+            return 1;
+        } else {
+            inputs.push_back(arg);
+        }
+    }
+    if (compile_command && (inputs.size() != 1 || options.image_output.empty())) {
+        std::cerr << "Usage: cocompiler compile <file.cocom | \"source\"> -o <file.cocb>" << std::endl;
+        return 1;
+    }
+    if (batch_command) {
+        if (inputs.empty()) {
+            std::cerr << "Usage: cocompiler batch [--jobs=N | --processes=N [--timeout=MS]] [--manifest=FILE] <file.cocom | \"source\">..." << std::endl;
+            return 1;
+        }
+        return run_batch(inputs, batch_options, options);
+    }
+    if (serve_command || client_command) {
+        if (socket_path.empty() || serve_command != inputs.empty()) {
+            std::cerr << "Usage: cocompiler serve --socket=PATH [--jobs=N]" << std::endl;
+            std::cerr << "       cocompiler client --socket=PATH [--manifest=FILE] <file.cocom | \"source\">..." << std::endl;
+            return 1;
+        }
+        return serve_command ? run_daemon(socket_path, batch_options.jobs, options) : run_client(inputs, socket_path);
+    }
+    std::unique_ptr<CompilationCache> cache;
+    if (!cache_directory.empty()) {
+        cache.reset(new CompilationCache(cache_directory, cache_size));
+        options.cache = cache.get();
+    }
+
+    if (!inputs.empty()) {
+        // Process command-line arguments as source code files, direct strings or bytecode images
+        for (const std::string& arg : inputs) {
+            // Check if argument is a file path with .cocb or .cocom extension
+            if (arg.length() > 5 && arg.substr(arg.length() - 5) == ".cocb" && !compile_command) {
+                process_image(arg, options);
+            } else if (arg.length() > 6 && arg.substr(arg.length() - 6) == ".cocom") {
                 std::ifstream file(arg);
                 if (file.is_open()) {
                     std::string file_content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-                    process_source_code(file_content);
+                    process_source_code(file_content, options);
                     file.close();
                 } else {
                     std::cerr << "Error: Could not open file '" << arg << "'" << std::endl;
                 }
             } else if (arg.length() > 2 && arg.front() == '"' && arg.back() == '"') {
                 // Treat as a direct source code string (remove quotes)
-                process_source_code(arg.substr(1, arg.length() - 2));
+                process_source_code(arg.substr(1, arg.length() - 2), options);
             } else {
-                std::cerr << "Error: Invalid argument. Expected a .cocom file path or a quoted string." << std::endl;
+                std::cerr << "Error: Invalid argument. Expected a .cocom file path, a .cocb image or a quoted string." << std::endl;
             }
         }
     } else {
-        // Interactive mode if no command-line arguments
+        // Interactive mode if no command-line arguments: one session, so each line sees the ones before it
         std::cout << "Enter source code (type 'exit' to quit):" << std::endl;
+        cocompiler::Inputs session_inputs = script_inputs(options);
+        session_inputs.output = &std::cout;
+        Session session(session_inputs);
         std::string line;
         while (true) {
             std::cout << "> ";
-            std::getline(std::cin, line);
-            if (line == "exit") {
+            if (!std::getline(std::cin, line) || line == "exit") {
                 break;
             }
             if (!line.empty()) {
-                process_source_code(line);
+                SessionOutcome outcome = session.evaluate(line);
+                std::cout << outcome.result.errors;
+                if (outcome.echoed) {
+                    std::cout << outcome.echo << std::endl;
+                }
             }
         }
     }
 
+    if (cache) {
+        std::cout << "Compilation cache: " << cache->getHits() << " hits, " << cache->getMisses() << " misses, "
+                  << cache->getStores() << " stores, " << cache->getEvictions() << " evictions" << std::endl;
+    }
     return 0;
 }
@@ -0,0 +1,448 @@
+#include "AOTCompiler.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include "Optimizer.h"
+#include "Verifier.h"
+
+// The runtime every generated file starts with: strings, globals and printing, as the VM does them
+static const char* kRuntime = R"(#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#pragma STDC FP_CONTRACT OFF
+
+typedef struct { char* data; size_t length; } cocom_string;
+typedef struct { int return_pc; ptrdiff_t base; } cocom_frame;
+
+static cocom_string* cocom_strings;
+static size_t cocom_string_count;
+static size_t cocom_string_capacity;
+static double* cocom_memory;
+static size_t cocom_memory_size;
+static size_t cocom_memory_capacity;
+static int cocom_halted;
+
+static void cocom_out_of_memory(void) {
+    fflush(stdout);
+    fputs("VM Error: Out of memory.\n", stderr);
+    exit(1);
+}
+
+static double cocom_from_bits(uint64_t bits) {
+    double value;
+    memcpy(&value, &bits, sizeof value);
+    return value;
+}
+
+/* Takes ownership of data (length bytes plus a terminator); returns the new string's index */
+static double cocom_take_string(char* data, size_t length) {
+    if (cocom_string_count == cocom_string_capacity) {
+        cocom_string_capacity = cocom_string_capacity ? cocom_string_capacity * 2 : 16;
+        cocom_strings = (cocom_string*)realloc(cocom_strings, cocom_string_capacity * sizeof *cocom_strings);
+        if (!cocom_strings) cocom_out_of_memory();
+    }
+    cocom_strings[cocom_string_count].data = data;
+    cocom_strings[cocom_string_count].length = length;
+    return (double)cocom_string_count++;
+}
+
+static double cocom_add_string(const char* data, size_t length) {
+    char* copy = (char*)malloc(length + 1);
+    if (!copy) cocom_out_of_memory();
+    memcpy(copy, data, length);
+    copy[length] = 0;
+    return cocom_take_string(copy, length);
+}
+
+static int cocom_is_string(int index) {
+    return index >= 0 && (size_t)index < cocom_string_count;
+}
+
+static double cocom_concat(int first, int second) {
+    size_t length = cocom_strings[first].length + cocom_strings[second].length;
+    char* data = (char*)malloc(length + 1);
+    if (!data) cocom_out_of_memory();
+    memcpy(data, cocom_strings[first].data, cocom_strings[first].length);
+    memcpy(data + cocom_strings[first].length, cocom_strings[second].data, cocom_strings[second].length);
+    data[length] = 0;
+    return cocom_take_string(data, length);
+}
+
+/* Grows the globals to size, zeroing the new ones (std::vector::resize) */
+static void cocom_resize_memory(size_t size) {
+    if (size > cocom_memory_capacity) {
+        size_t capacity = cocom_memory_capacity * 2 > size ? cocom_memory_capacity * 2 : size;
+        cocom_memory = (double*)realloc(cocom_memory, capacity * sizeof *cocom_memory);
+        if (!cocom_memory) cocom_out_of_memory();
+        cocom_memory_capacity = capacity;
+    }
+    memset(cocom_memory + cocom_memory_size, 0, (size - cocom_memory_size) * sizeof *cocom_memory);
+    cocom_memory_size = size;
+}
+
+/* PRINT_VALUE: 0 and 1 print as booleans; %g is what std::ostream prints for a double */
+static void cocom_print_value(double value) {
+    if (value == 0.0) {
+        puts("false");
+    } else if (value == 1.0) {
+        puts("true");
+    } else {
+        printf("%g\n", value);
+    }
+}
+
+static void cocom_print_string(int index) {
+    fwrite(cocom_strings[index].data, 1, cocom_strings[index].length, stdout);
+    putchar('\n');
+}
+)";
+
+// A C expression for value; hexadecimal floating-point literals are exact
+static std::string literal(double value) {
+    char buffer[64];
+    if (std::isfinite(value)) {
+        std::snprintf(buffer, sizeof buffer, "%a", value);
+    } else {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof bits);
+        std::snprintf(buffer, sizeof buffer, "cocom_from_bits(0x%llxULL)", static_cast<unsigned long long>(bits));
+    }
+    return buffer;
+}
+
+// A C string literal holding text byte for byte
+static std::string quote(const std::string& text) {
+    std::string quoted = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += static_cast<char>(c);
+        } else if (c >= 0x20 && c < 0x7F && c != '?') { // '?' would risk trigraphs
+            quoted += static_cast<char>(c);
+        } else {
+            char escape[8];
+            std::snprintf(escape, sizeof escape, "\\%03o", c);
+            quoted += escape;
+        }
+    }
+    return quoted + "\"";
+}
+
+static std::string slot(int index) {
+    return "f[" + std::to_string(index) + "]";
+}
+
+static bool hasAddressOperand(Instruction instruction) {
+    switch (instruction) {
+        case Instruction::JUMP: case Instruction::JUMP_IF_FALSE: case Instruction::JUMP_IF_TRUE:
+        case Instruction::LOOP_INC_CMP_JUMP: case Instruction::LOOP_INC_CMP_JUMP_LOCAL:
+        case Instruction::CALL: case Instruction::TAIL_CALL: case Instruction::PARALLEL_FOR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool isSupported(Instruction instruction) {
+    switch (instruction) {
+        case Instruction::NEW_ARRAY: case Instruction::ARRAY_GET: case Instruction::ARRAY_SET:
+        case Instruction::CALL_BUILTIN: case Instruction::PRINT_ARRAY: case Instruction::CALL_NATIVE:
+        case Instruction::MAP_GET: case Instruction::MAP_SET: case Instruction::MAP_HAS: case Instruction::MAP_DELETE:
+        case Instruction::PARALLEL_FOR: case Instruction::PARALLEL_REDUCE:
+            return false;
+        default:
+            return true;
+    }
+}
+
+static const char* comparisonOperator(Instruction comparison) {
+    switch (comparison) {
+        case Instruction::GREATER: return ">";
+        case Instruction::LESS: return "<";
+        case Instruction::GREATER_EQUAL: return ">=";
+        case Instruction::LESS_EQUAL: return "<=";
+        case Instruction::EQUAL_EQUAL: return "==";
+        case Instruction::BANG_EQUAL: return "!=";
+        default: return nullptr;
+    }
+}
+
+// Reports a fixed runtime error and leaves cocom_run
+static std::string fail(const std::string& message) {
+    return "{ fflush(stdout); fputs(" + quote(message + "\n") + ", stderr); goto fail; }";
+}
+
+AOTCompiler::AOTCompiler() : max_frames(1024) {}
+
+bool AOTCompiler::translate(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals, std::ostream& out) {
+    for (const Bytecode& instruction : bytecode) {
+        if (!isSupported(instruction.instruction)) {
+            std::cerr << "AOT Error: " << instruction_to_string(instruction.instruction)
+                      << " is not supported by the C backend (arrays, maps, builtins, host functions and parallel loops need the VM)." << std::endl;
+            return false;
+        }
+    }
+    OptimizedProgram optimized;
+    const std::vector<Bytecode>& program = Optimizer().optimize(bytecode, optimized) ? optimized.bytecode : bytecode;
+    std::vector<int> heights;
+    int maxHeight = 0;
+    if (!computeStackHeights(program, heights, maxHeight)) {
+        std::cerr << "AOT Error: Could not verify the program's stack use." << std::endl;
+        return false;
+    }
+
+    // Labels: jump targets, return addresses and the end of the program
+    int end = static_cast<int>(program.size());
+    std::set<int> labels = {end};
+    std::set<int> returnAddresses;
+    for (int pc = 0; pc < end; ++pc) {
+        const Bytecode& instruction = program[pc];
+        if (hasAddressOperand(instruction.instruction)) labels.insert(static_cast<int>(instruction.operand));
+        if (instruction.instruction == Instruction::CALL) {
+            labels.insert(pc + 1);
+            returnAddresses.insert(pc + 1);
+        }
+    }
+
+    out << "/* Generated by CoCompiler from " << bytecode.size() << " bytecode instructions. */\n";
+    out << kRuntime << "\n";
+    out << "#define COCOM_MAX_FRAMES " << max_frames << "\n";
+    // A frame's slots and temporaries never exceed maxHeight, and each frame starts within its caller's
+    out << "#define COCOM_STACK_SLOTS " << (max_frames + 1) * static_cast<size_t>(maxHeight + 1) << "\n";
+    out << "#define COCOM_LITERAL_COUNT " << string_literals.size() << "\n\n";
+    out << "static const char* const cocom_literal_data[] = {";
+    for (const std::string& text : string_literals) out << "\n    " << quote(text) << ",";
+    out << (string_literals.empty() ? " 0 };\n" : "\n};\n");
+    out << "static const size_t cocom_literal_lengths[] = {";
+    for (const std::string& text : string_literals) out << " " << text.size() << ",";
+    out << (string_literals.empty() ? " 0 };\n" : " };\n");
+    out << "static cocom_frame cocom_frames[COCOM_MAX_FRAMES > 0 ? COCOM_MAX_FRAMES : 1];\n";
+    out << "static double cocom_stack[COCOM_STACK_SLOTS];\n\n";
+
+    out << "double cocom_run(void) {\n";
+    out << "    double* const s = cocom_stack;\n";
+    out << "    double* f = s; /* Slot 0 of the current frame */\n";
+    out << "    int fc = 0;    /* Active frames */\n";
+    out << "    int ret = 0;   /* Return address being dispatched */\n";
+    out << "    double result = -1;\n";
+    out << "    size_t i;\n";
+    out << "    cocom_halted = 0;\n";
+    out << "    cocom_string_count = 0;\n";
+    out << "    cocom_memory_size = 0;\n";
+    out << "    for (i = 0; i < COCOM_LITERAL_COUNT; ++i) cocom_add_string(cocom_literal_data[i], cocom_literal_lengths[i]);\n";
+    out << "    (void)fc; (void)ret;\n";
+    for (int pc = 0; pc < end; ++pc) {
+        if (labels.count(pc)) out << "L" << pc << ":;\n";
+        if (heights[pc] < 0) continue; // Unreachable
+        emitInstruction(out, pc, program[pc], heights[pc]);
+    }
+    out << "L" << end << ":\n";
+    out << "    " << fail("VM Error: Program did not halt. Missing HALT instruction or infinite loop.") << "\n";
+    if (!returnAddresses.empty()) {
+        out << "cocom_return:\n";
+        out << "    switch (ret) {\n";
+        for (int address : returnAddresses) out << "        case " << address << ": goto L" << address << ";\n";
+        out << "    }\n";
+        out << "    goto fail;\n";
+    }
+    out << "fail:\n";
+    out << "    result = -1;\n";
+    out << "done:\n";
+    out << "    for (i = 0; i < cocom_string_count; ++i) free(cocom_strings[i].data);\n";
+    out << "    cocom_string_count = 0;\n";
+    out << "    fflush(stdout);\n";
+    out << "    return result;\n";
+    out << "}\n\n";
+    out << "#ifndef COCOM_SHARED\n";
+    out << "int main(void) {\n";
+    out << "    cocom_run();\n";
+    out << "    return cocom_halted ? 0 : 1;\n";
+    out << "}\n";
+    out << "#endif\n";
+    return true;
+}
+
+/**
+ * @brief Emits the C for one instruction. Stack slot k (counted from the frame) is f[k], so
+ * the top of the stack before the instruction is f[height - 1].
+ */
+void AOTCompiler::emitInstruction(std::ostream& out, int pc, const Bytecode& instruction, int height) {
+    std::string top = slot(height - 1);
+    std::string second = slot(height - 2);
+    std::string pushed = slot(height);
+    int target = static_cast<int>(instruction.operand);
+    std::string label = "L" + std::to_string(target);
+    out << "    /* " << pc << ": " << instruction_to_string(instruction.instruction) << " */ ";
+    switch (instruction.instruction) {
+        case Instruction::PUSH_INT:
+        case Instruction::PUSH_FLOAT:
+        case Instruction::PUSH_STRING:
+            out << pushed << " = " << literal(instruction.operand) << ";\n";
+            break;
+        case Instruction::ADD: out << second << " = " << second << " + " << top << ";\n"; break;
+        case Instruction::SUB: out << second << " = " << second << " - " << top << ";\n"; break;
+        case Instruction::MUL: out << second << " = " << second << " * " << top << ";\n"; break;
+        case Instruction::DIV:
+            out << "if (" << top << " == 0.0) " << fail("VM Error: Division by zero.") << "\n";
+            out << "    " << second << " = " << second << " / " << top << ";\n";
+            break;
+        case Instruction::NEGATE: out << top << " = -" << top << ";\n"; break;
+        case Instruction::NOT: out << top << " = " << top << " == 0.0 ? 1.0 : 0.0;\n"; break;
+        case Instruction::POP: out << "\n"; break;
+        case Instruction::GREATER: case Instruction::LESS: case Instruction::GREATER_EQUAL:
+        case Instruction::LESS_EQUAL: case Instruction::EQUAL_EQUAL: case Instruction::BANG_EQUAL:
+            out << second << " = " << second << " " << comparisonOperator(instruction.instruction) << " " << top << " ? 1.0 : 0.0;\n";
+            break;
+        case Instruction::STORE:
+            out << "{\n";
+            out << "        int address = (int)" << top << ";\n";
+            out << "        if (address < 0) { fflush(stdout); fprintf(stderr, \"VM Error: Invalid memory address for STORE: %d\\n\", address); goto fail; }\n";
+            out << "        if ((size_t)address >= cocom_memory_size) cocom_resize_memory((size_t)address + 1);\n";
+            out << "        cocom_memory[address] = " << second << ";\n";
+            out << "    }\n";
+            break;
+        case Instruction::LOAD:
+            out << "{\n";
+            out << "        int address = (int)" << top << ";\n";
+            out << "        if (address < 0 || (size_t)address >= cocom_memory_size) { fflush(stdout); fprintf(stderr, \"VM Error: Invalid memory address for LOAD: %d\\n\", address); goto fail; }\n";
+            out << "        " << top << " = cocom_memory[address];\n";
+            out << "    }\n";
+            break;
+        case Instruction::LOAD_GLOBAL:
+            out << "if (" << target << "u >= cocom_memory_size) " << fail("VM Error: Invalid memory address for LOAD: " + std::to_string(target)) << "\n";
+            out << "    " << pushed << " = cocom_memory[" << target << "];\n";
+            break;
+        case Instruction::STORE_GLOBAL:
+            out << "if (" << target << "u >= cocom_memory_size) cocom_resize_memory(" << target << "u + 1);\n";
+            out << "    cocom_memory[" << target << "] = " << top << ";\n";
+            break;
+        case Instruction::HALT:
+            out << "cocom_halted = 1; result = (f - s) + " << height << " > 0 ? f[" << height << " - 1] : 0.0; goto done;\n";
+            break;
+        case Instruction::JUMP: out << "goto " << label << ";\n"; break;
+        case Instruction::JUMP_IF_FALSE: out << "if (" << top << " == 0.0) goto " << label << ";\n"; break;
+        case Instruction::JUMP_IF_TRUE: out << "if (" << top << " != 0.0) goto " << label << ";\n"; break;
+        case Instruction::AND:
+        case Instruction::OR:
+            out << fail("VM Error: Encountered logical operator instruction (AND/OR) directly. This should be handled by jumps.") << "\n";
+            break;
+        case Instruction::CONCAT_STRING:
+            out << "{\n";
+            out << "        int first = (int)" << second << ", second = (int)" << top << ";\n";
+            out << "        if (!cocom_is_string(first) || !cocom_is_string(second)) " << fail("VM Error: Invalid string literal index for CONCAT_STRING.") << "\n";
+            out << "        " << second << " = cocom_concat(first, second);\n";
+            out << "    }\n";
+            break;
+        case Instruction::PRINT_VALUE: out << "cocom_print_value(" << top << ");\n"; break;
+        case Instruction::PRINT_STRING:
+            out << "if (!cocom_is_string((int)" << top << ")) " << fail("VM Error: Invalid string literal index for PRINT_STRING.") << "\n";
+            out << "    cocom_print_string((int)" << top << ");\n";
+            break;
+        case Instruction::LOOP_INC_CMP_JUMP:
+        case Instruction::LOOP_INC_CMP_JUMP_LOCAL: {
+            std::string name = instruction_to_string(instruction.instruction);
+            const char* comparison = comparisonOperator(static_cast<Instruction>(instruction.operand3));
+            if (!comparison || comparison[0] == '=' || comparison[0] == '!') {
+                out << fail("VM Error: Invalid comparison for " + name + ".") << "\n";
+                break;
+            }
+            std::string counter;
+            if (instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL) {
+                counter = slot(instruction.operand2);
+            } else {
+                int address = instruction.operand2;
+                out << "if (" << address << " < 0 || (size_t)" << address << " >= cocom_memory_size) "
+                    << fail("VM Error: Invalid memory address for LOOP_INC_CMP_JUMP: " + std::to_string(address)) << "\n    ";
+                counter = "cocom_memory[" + std::to_string(address) + "]";
+            }
+            out << counter << " = " << counter << " + " << literal(instruction.operand4) << "; ";
+            out << "if (" << counter << " " << comparison << " " << top << ") goto " << label << ";\n";
+            break;
+        }
+        case Instruction::LOAD_LOCAL: out << pushed << " = " << slot(target) << ";\n"; break;
+        case Instruction::STORE_LOCAL: out << slot(target) << " = " << top << ";\n"; break;
+        case Instruction::CALL: {
+            int argc = instruction.operand2;
+            out << "if (fc == COCOM_MAX_FRAMES) " << fail("VM Error: Call stack overflow (maximum depth " + std::to_string(max_frames) + ").") << "\n";
+            out << "    cocom_frames[fc].return_pc = " << pc + 1 << "; cocom_frames[fc].base = (f - s) + " << height - argc << "; fc++;\n";
+            out << "    f += " << height - argc << ";\n";
+            if (instruction.operand3 > argc) {
+                out << "    for (i = " << argc << "; i < " << instruction.operand3 << "; ++i) f[i] = 0.0;\n";
+            }
+            out << "    goto " << label << ";\n";
+            break;
+        }
+        case Instruction::TAIL_CALL: {
+            int argc = instruction.operand2;
+            out << "if (fc == 0) " << fail("VM Error: TAIL_CALL outside of a function.") << "\n";
+            out << "    memmove(f, f + " << height - argc << ", " << argc << " * sizeof(double));\n";
+            if (instruction.operand3 > argc) {
+                out << "    for (i = " << argc << "; i < " << instruction.operand3 << "; ++i) f[i] = 0.0;\n";
+            }
+            out << "    goto " << label << ";\n";
+            break;
+        }
+        case Instruction::RET:
+            out << "if (fc == 0) " << fail("VM Error: RET outside of a function.") << "\n";
+            out << "    fc--; s[cocom_frames[fc].base] = " << top << "; ret = cocom_frames[fc].return_pc;\n";
+            out << "    f = fc > 0 ? s + cocom_frames[fc - 1].base : s;\n";
+            out << "    goto cocom_return;\n";
+            break;
+        default:
+            out << fail("VM Error: Unknown instruction: " + std::to_string(static_cast<int>(instruction.instruction))) << "\n";
+            break;
+    }
+}
+
+// Quotes a path for the shell
+static std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') {
+            quoted += "'\\''";
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "'";
+}
+
+bool AOTCompiler::build(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals,
+                        const std::string& output, bool shared) {
+    std::string source = output + ".aot.c";
+    {
+        std::ofstream file(source);
+        if (!file.is_open()) {
+            std::cerr << "AOT Error: Could not write '" << source << "'" << std::endl;
+            return false;
+        }
+        if (!translate(bytecode, string_literals, file)) {
+            file.close();
+            std::remove(source.c_str());
+            return false;
+        }
+    }
+
+    const char* configured = std::getenv("CC");
+    std::string command = configured && *configured ? configured : "cc";
+    // No FMA contraction, so results round exactly as in the VM
+    command += " -O2 -ffp-contract=off";
+    if (shared) command += " -shared -fPIC -DCOCOM_SHARED";
+    command += " -o " + shellQuote(output) + " " + shellQuote(source);
+    int status = std::system(command.c_str());
+    std::remove(source.c_str());
+    if (status != 0) {
+        std::cerr << "AOT Error: The C compiler failed: " << command << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#ifndef AOT_COMPILER_H
+#define AOT_COMPILER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "../include/Bytecode.h"
+
+/**
+ * @brief The ahead-of-time backend: translates a program into a self-contained C file and
+ * builds it with the system C compiler.
+ *
+ * The bytecode is first optimized (see Optimizer.h), then each instruction becomes a few
+ * lines of C. The verified stack height of every instruction (see Verifier.h) gives each
+ * operand stack slot a fixed index relative to the frame, so the C compiler sees plain array
+ * accesses instead of pushes and pops. Jumps become gotos, and RET dispatches to the return
+ * address through a switch. A small runtime at the top of the file holds globals, strings
+ * and printing. Output and runtime error messages are those of VM::run; errors go to stderr.
+ *
+ * The C file defines double cocom_run(void), which runs the program and returns what
+ * VM::run would: the value on top of the stack at HALT, or -1 after an error. Unless
+ * COCOM_SHARED is defined it also defines main(), which exits with 1 after an error.
+ *
+ * Arrays, maps, builtins, host functions and parallel loops have no C runtime; programs using them are
+ * rejected.
+ */
+class AOTCompiler {
+public:
+    AOTCompiler();
+
+    void setMaxFrames(size_t count) { max_frames = count; } // Maximum call depth, as VM::setMaxFrames
+
+    /**
+     * @brief Translates a program to C.
+     * @param bytecode The program as compiled.
+     * @param string_literals The compiler's string literals.
+     * @param out Receives the C source.
+     * @return False (after reporting on std::cerr) if the program uses an unsupported instruction or cannot be verified.
+     */
+    bool translate(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals, std::ostream& out);
+
+    /**
+     * @brief Translates a program and compiles it with the C compiler named by the CC
+     * environment variable (cc if unset).
+     * @param output Path of the executable or shared object to create.
+     * @param shared Build a shared object exporting cocom_run instead of an executable.
+     * @return False (after reporting on std::cerr) if translation or the C compiler failed.
+     */
+    bool build(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals,
+               const std::string& output, bool shared);
+
+private:
+    size_t max_frames;
+
+    void emitInstruction(std::ostream& out, int pc, const Bytecode& instruction, int height);
+};
+
+#endif // AOT_COMPILER_H
@@ -0,0 +1,711 @@
+#include "Array.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "ThreadPool.h"
+
+// AVX2 kernels are compiled with a per-function target attribute and chosen at runtime,
+// so the binary still runs on CPUs without AVX2.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define COCOMPILER_AVX2_DISPATCH 1
+#include <immintrin.h>
+#define AVX2_TARGET __attribute__((target("avx2")))
+#endif
+
+// --- Array ---
+
+static void* allocateAligned(size_t bytes) {
+    void* data = ::operator new(std::max(bytes, Array::kAlignment), std::align_val_t(Array::kAlignment));
+    std::memset(data, 0, bytes);
+    return data;
+}
+
+static void freeAligned(void* data) {
+    ::operator delete(data, std::align_val_t(Array::kAlignment));
+}
+
+Array::Array(ElementType type, size_t length)
+    : type(type), length(length), data(allocateAligned(length * sizeof(double))), borrowed(false) {
+    // int64_t and double are both 8 bytes, so one allocation size serves either element type
+}
+
+Array::~Array() {
+    if (data && !borrowed) freeAligned(data);
+}
+
+Array Array::borrow(ElementType type, const void* data, size_t length) {
+    // Never written: the VM refuses to store into borrowed arrays
+    return Array(type, length, const_cast<void*>(data), true);
+}
+
+Array::Array(Array&& other) noexcept : type(other.type), length(other.length), data(other.data), borrowed(other.borrowed) {
+    other.data = nullptr;
+    other.length = 0;
+}
+
+Array& Array::operator=(Array&& other) noexcept {
+    if (this != &other) {
+        if (data && !borrowed) freeAligned(data);
+        type = other.type;
+        length = other.length;
+        data = other.data;
+        borrowed = other.borrowed;
+        other.data = nullptr;
+        other.length = 0;
+    }
+    return *this;
+}
+
+double Array::get(size_t index) const {
+    if (type == ElementType::INT64) {
+        return static_cast<double>(int64Data()[index]);
+    }
+    return float64Data()[index];
+}
+
+bool Array::fits(double value) const {
+    // Integral values that fit stay exact in an INT64 array; anything else needs FLOAT64
+    return type == ElementType::FLOAT64 || (value == std::floor(value) && value >= -9.2e18 && value <= 9.2e18);
+}
+
+void Array::set(size_t index, double value) {
+    if (type == ElementType::INT64) {
+        if (fits(value)) {
+            int64Data()[index] = static_cast<int64_t>(value);
+            return;
+        }
+        promoteToFloat64();
+    }
+    float64Data()[index] = value;
+}
+
+void Array::promoteToFloat64() {
+    if (type == ElementType::FLOAT64) return;
+    int64_t* ints = int64Data();
+    double* doubles = float64Data(); // Same storage, converted element by element in place
+    for (size_t i = 0; i < length; ++i) {
+        doubles[i] = static_cast<double>(ints[i]);
+    }
+    type = ElementType::FLOAT64;
+}
+
+Array Array::toFloat64() const {
+    Array copy(ElementType::FLOAT64, length);
+    for (size_t i = 0; i < length; ++i) {
+        copy.float64Data()[i] = get(i);
+    }
+    return copy;
+}
+
+std::string Array::toString() const {
+    std::ostringstream out;
+    out << "[";
+    for (size_t i = 0; i < length; ++i) {
+        if (i > 0) out << ", ";
+        if (type == ElementType::INT64) {
+            out << int64Data()[i];
+        } else {
+            out << float64Data()[i];
+        }
+    }
+    out << "]";
+    return out.str();
+}
+
+// --- Scalar kernels ---
+// Floating-point sums use 16 independent accumulators (lane j % 16 for element j),
+// combined in the same order as the AVX2 kernels' four 4-wide vectors.
+
+static double combineLanes(const double lanes[16]) {
+    double v[4];
+    for (int l = 0; l < 4; ++l) {
+        v[l] = (lanes[l] + lanes[4 + l]) + (lanes[8 + l] + lanes[12 + l]);
+    }
+    return (v[0] + v[2]) + (v[1] + v[3]);
+}
+
+static double sumF64Scalar(const double* p, size_t n) {
+    double lanes[16] = {0};
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int l = 0; l < 16; ++l) lanes[l] += p[i + l];
+    }
+    double result = combineLanes(lanes);
+    for (; i < n; ++i) result += p[i];
+    return result;
+}
+
+static double dotF64Scalar(const double* a, const double* b, size_t n) {
+    double lanes[16] = {0};
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        for (int l = 0; l < 16; ++l) lanes[l] += a[i + l] * b[i + l];
+    }
+    double result = combineLanes(lanes);
+    for (; i < n; ++i) result += a[i] * b[i];
+    return result;
+}
+
+static int64_t sumI64Scalar(const int64_t* p, size_t n) {
+    uint64_t result = 0; // Unsigned so overflow wraps instead of being undefined
+    for (size_t i = 0; i < n; ++i) result += static_cast<uint64_t>(p[i]);
+    return static_cast<int64_t>(result);
+}
+
+static int64_t dotI64Scalar(const int64_t* a, const int64_t* b, size_t n) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < n; ++i) result += static_cast<uint64_t>(a[i]) * static_cast<uint64_t>(b[i]);
+    return static_cast<int64_t>(result);
+}
+
+template <typename T>
+static T minScalar(const T* p, size_t n) {
+    T result = p[0];
+    for (size_t i = 1; i < n; ++i) result = p[i] < result ? p[i] : result;
+    return result;
+}
+
+template <typename T>
+static T maxScalar(const T* p, size_t n) {
+    T result = p[0];
+    for (size_t i = 1; i < n; ++i) result = p[i] > result ? p[i] : result;
+    return result;
+}
+
+enum class BinaryOp { ADD, MUL };
+
+// b is either an array of n elements or, if broadcast, a single scalar
+static void binaryF64Scalar(const double* a, const double* b, bool broadcast, double* out, size_t n, BinaryOp op) {
+    for (size_t i = 0; i < n; ++i) {
+        double rhs = b[broadcast ? 0 : i];
+        out[i] = op == BinaryOp::ADD ? a[i] + rhs : a[i] * rhs;
+    }
+}
+
+static void binaryI64Scalar(const int64_t* a, const int64_t* b, bool broadcast, int64_t* out, size_t n, BinaryOp op) {
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t lhs = static_cast<uint64_t>(a[i]);
+        uint64_t rhs = static_cast<uint64_t>(b[broadcast ? 0 : i]);
+        out[i] = static_cast<int64_t>(op == BinaryOp::ADD ? lhs + rhs : lhs * rhs);
+    }
+}
+
+template <typename T>
+static void compareScalar(const T* a, const T* b, bool broadcast, int64_t* out, size_t n, CompareOp op) {
+    for (size_t i = 0; i < n; ++i) {
+        T rhs = b[broadcast ? 0 : i];
+        bool result = op == CompareOp::LESS ? a[i] < rhs : (op == CompareOp::GREATER ? a[i] > rhs : a[i] == rhs);
+        out[i] = result ? 1 : 0;
+    }
+}
+
+// --- AVX2 kernels ---
+
+#ifdef COCOMPILER_AVX2_DISPATCH
+AVX2_TARGET static double horizontalSum(__m256d v) {
+    __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)); // (v0 + v2, v1 + v3)
+    return _mm_cvtsd_f64(s) + _mm_cvtsd_f64(_mm_unpackhi_pd(s, s));
+}
+
+AVX2_TARGET static double sumF64AVX2(const double* p, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(p + i));
+        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(p + i + 4));
+        acc2 = _mm256_add_pd(acc2, _mm256_loadu_pd(p + i + 8));
+        acc3 = _mm256_add_pd(acc3, _mm256_loadu_pd(p + i + 12));
+    }
+    double result = horizontalSum(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) result += p[i];
+    return result;
+}
+
+AVX2_TARGET static double dotF64AVX2(const double* a, const double* b, size_t n) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd();
+    __m256d acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        // Separate multiply and add (no FMA) to round exactly like the scalar kernel
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+        acc2 = _mm256_add_pd(acc2, _mm256_mul_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8)));
+        acc3 = _mm256_add_pd(acc3, _mm256_mul_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12)));
+    }
+    double result = horizontalSum(_mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3)));
+    for (; i < n; ++i) result += a[i] * b[i];
+    return result;
+}
+
+AVX2_TARGET static int64_t sumI64AVX2(const int64_t* p, size_t n) {
+    __m256i acc0 = _mm256_setzero_si256(), acc1 = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_add_epi64(acc0, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)));
+        acc1 = _mm256_add_epi64(acc1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 4)));
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(acc0, acc1));
+    uint64_t result = static_cast<uint64_t>(lanes[0]) + static_cast<uint64_t>(lanes[1]) +
+                      static_cast<uint64_t>(lanes[2]) + static_cast<uint64_t>(lanes[3]);
+    for (; i < n; ++i) result += static_cast<uint64_t>(p[i]);
+    return static_cast<int64_t>(result);
+}
+
+AVX2_TARGET static double minMaxF64AVX2(const double* p, size_t n, bool isMax) {
+    __m256d acc = _mm256_set1_pd(p[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256d v = _mm256_loadu_pd(p + i);
+        acc = isMax ? _mm256_max_pd(acc, v) : _mm256_min_pd(acc, v);
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, acc);
+    double result = lanes[0];
+    for (int l = 1; l < 4; ++l) result = isMax ? std::max(result, lanes[l]) : std::min(result, lanes[l]);
+    for (; i < n; ++i) result = isMax ? std::max(result, p[i]) : std::min(result, p[i]);
+    return result;
+}
+
+AVX2_TARGET static int64_t minMaxI64AVX2(const int64_t* p, size_t n, bool isMax) {
+    __m256i acc = _mm256_set1_epi64x(p[0]);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        // AVX2 has no 64-bit min/max; select with a signed comparison instead
+        __m256i takeV = isMax ? _mm256_cmpgt_epi64(v, acc) : _mm256_cmpgt_epi64(acc, v);
+        acc = _mm256_blendv_epi8(acc, v, takeV);
+    }
+    alignas(32) int64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), acc);
+    int64_t result = lanes[0];
+    for (int l = 1; l < 4; ++l) result = isMax ? std::max(result, lanes[l]) : std::min(result, lanes[l]);
+    for (; i < n; ++i) result = isMax ? std::max(result, p[i]) : std::min(result, p[i]);
+    return result;
+}
+
+AVX2_TARGET static void binaryF64AVX2(const double* a, const double* b, bool broadcast, double* out, size_t n, BinaryOp op) {
+    size_t i = 0;
+    __m256d scalar = _mm256_set1_pd(b[0]);
+    for (; i + 4 <= n; i += 4) {
+        __m256d lhs = _mm256_loadu_pd(a + i);
+        __m256d rhs = broadcast ? scalar : _mm256_loadu_pd(b + i);
+        _mm256_storeu_pd(out + i, op == BinaryOp::ADD ? _mm256_add_pd(lhs, rhs) : _mm256_mul_pd(lhs, rhs));
+    }
+    binaryF64Scalar(a + i, broadcast ? b : b + i, broadcast, out + i, n - i, op);
+}
+
+AVX2_TARGET static void addI64AVX2(const int64_t* a, const int64_t* b, bool broadcast, int64_t* out, size_t n) {
+    size_t i = 0;
+    __m256i scalar = _mm256_set1_epi64x(b[0]);
+    for (; i + 4 <= n; i += 4) {
+        __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i rhs = broadcast ? scalar : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi64(lhs, rhs));
+    }
+    binaryI64Scalar(a + i, broadcast ? b : b + i, broadcast, out + i, n - i, BinaryOp::ADD);
+}
+
+AVX2_TARGET static void compareF64AVX2(const double* a, const double* b, bool broadcast, int64_t* out, size_t n, CompareOp op) {
+    size_t i = 0;
+    __m256d scalar = _mm256_set1_pd(b[0]);
+    __m256i one = _mm256_set1_epi64x(1);
+    for (; i + 4 <= n; i += 4) {
+        __m256d lhs = _mm256_loadu_pd(a + i);
+        __m256d rhs = broadcast ? scalar : _mm256_loadu_pd(b + i);
+        __m256d mask = op == CompareOp::LESS ? _mm256_cmp_pd(lhs, rhs, _CMP_LT_OQ)
+                     : (op == CompareOp::GREATER ? _mm256_cmp_pd(lhs, rhs, _CMP_GT_OQ) : _mm256_cmp_pd(lhs, rhs, _CMP_EQ_OQ));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_and_si256(_mm256_castpd_si256(mask), one));
+    }
+    compareScalar(a + i, broadcast ? b : b + i, broadcast, out + i, n - i, op);
+}
+
+AVX2_TARGET static void compareI64AVX2(const int64_t* a, const int64_t* b, bool broadcast, int64_t* out, size_t n, CompareOp op) {
+    size_t i = 0;
+    __m256i scalar = _mm256_set1_epi64x(b[0]);
+    __m256i one = _mm256_set1_epi64x(1);
+    for (; i + 4 <= n; i += 4) {
+        __m256i lhs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i rhs = broadcast ? scalar : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i mask = op == CompareOp::LESS ? _mm256_cmpgt_epi64(rhs, lhs)
+                     : (op == CompareOp::GREATER ? _mm256_cmpgt_epi64(lhs, rhs) : _mm256_cmpeq_epi64(lhs, rhs));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_and_si256(mask, one));
+    }
+    compareScalar(a + i, broadcast ? b : b + i, broadcast, out + i, n - i, op);
+}
+#endif // COCOMPILER_AVX2_DISPATCH
+
+// --- Dispatch ---
+
+bool ArrayKernels::usingAVX2() {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    static const bool enabled = __builtin_cpu_supports("avx2") && std::getenv("COCOMPILER_NO_SIMD") == nullptr;
+    return enabled;
+#else
+    return false;
+#endif
+}
+
+static double sumF64(const double* p, size_t n) {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    if (ArrayKernels::usingAVX2()) return sumF64AVX2(p, n);
+#endif
+    return sumF64Scalar(p, n);
+}
+
+static int64_t sumI64(const int64_t* p, size_t n) {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    if (ArrayKernels::usingAVX2()) return sumI64AVX2(p, n);
+#endif
+    return sumI64Scalar(p, n);
+}
+
+static double dotF64(const double* a, const double* b, size_t n) {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    if (ArrayKernels::usingAVX2()) return dotF64AVX2(a, b, n);
+#endif
+    return dotF64Scalar(a, b, n);
+}
+
+static double minMaxF64(const double* p, size_t n, bool isMax) {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    if (ArrayKernels::usingAVX2()) return minMaxF64AVX2(p, n, isMax);
+#endif
+    return isMax ? maxScalar(p, n) : minScalar(p, n);
+}
+
+static int64_t minMaxI64(const int64_t* p, size_t n, bool isMax) {
+#ifdef COCOMPILER_AVX2_DISPATCH
+    if (ArrayKernels::usingAVX2()) return minMaxI64AVX2(p, n, isMax);
+#endif
+    return isMax ? maxScalar(p, n) : minScalar(p, n);
+}
+
+// --- Chunking ---
+// Every whole-array operation is split into the same fixed-size chunks whatever the array
+// size or thread count; chunks only run on the thread pool once the array is large enough
+// to pay for it. Per-chunk results are combined in chunk order, so floating-point results
+// are identical with 1 thread or many.
+
+static size_t chunkCount(size_t n) {
+    return (n + ArrayKernels::kChunkSize - 1) / ArrayKernels::kChunkSize;
+}
+
+static void forEachChunk(size_t n, const std::function<void(size_t chunk, size_t begin, size_t end)>& body) {
+    size_t chunks = chunkCount(n);
+    std::function<void(size_t)> task = [&](size_t chunk) {
+        size_t begin = chunk * ArrayKernels::kChunkSize;
+        body(chunk, begin, std::min(n, begin + ArrayKernels::kChunkSize));
+    };
+    if (n >= ArrayKernels::kParallelThreshold) {
+        ThreadPool::shared().parallelFor(chunks, task);
+    } else {
+        for (size_t chunk = 0; chunk < chunks; ++chunk) task(chunk);
+    }
+}
+
+double ArrayKernels::sum(const Array& array) {
+    size_t n = array.size();
+    if (array.getElementType() == ElementType::INT64) {
+        std::vector<int64_t> partials(chunkCount(n));
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            partials[chunk] = sumI64(array.int64Data() + begin, end - begin);
+        });
+        uint64_t total = 0;
+        for (int64_t partial : partials) total += static_cast<uint64_t>(partial);
+        return static_cast<double>(static_cast<int64_t>(total));
+    }
+    std::vector<double> partials(chunkCount(n));
+    forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+        partials[chunk] = sumF64(array.float64Data() + begin, end - begin);
+    });
+    double total = 0.0;
+    for (double partial : partials) total += partial;
+    return total;
+}
+
+static double minMax(const Array& array, bool isMax) {
+    size_t n = array.size();
+    std::vector<double> partials(chunkCount(n));
+    forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+        partials[chunk] = array.getElementType() == ElementType::INT64
+            ? static_cast<double>(minMaxI64(array.int64Data() + begin, end - begin, isMax))
+            : minMaxF64(array.float64Data() + begin, end - begin, isMax);
+    });
+    double result = partials[0];
+    for (double partial : partials) result = isMax ? std::max(result, partial) : std::min(result, partial);
+    return result;
+}
+
+double ArrayKernels::min(const Array& array) {
+    return minMax(array, false);
+}
+
+double ArrayKernels::max(const Array& array) {
+    return minMax(array, true);
+}
+
+double ArrayKernels::dot(const Array& left, const Array& right) {
+    size_t n = left.size();
+    if (left.getElementType() == ElementType::INT64 && right.getElementType() == ElementType::INT64) {
+        std::vector<int64_t> partials(chunkCount(n));
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            partials[chunk] = dotI64Scalar(left.int64Data() + begin, right.int64Data() + begin, end - begin);
+        });
+        uint64_t total = 0;
+        for (int64_t partial : partials) total += static_cast<uint64_t>(partial);
+        return static_cast<double>(static_cast<int64_t>(total));
+    }
+    // Mixed element types are computed in floating point
+    Array leftF = left.getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : left.toFloat64();
+    Array rightF = right.getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : right.toFloat64();
+    const double* a = left.getElementType() == ElementType::FLOAT64 ? left.float64Data() : leftF.float64Data();
+    const double* b = right.getElementType() == ElementType::FLOAT64 ? right.float64Data() : rightF.float64Data();
+    std::vector<double> partials(chunkCount(n));
+    forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+        partials[chunk] = dotF64(a + begin, b + begin, end - begin);
+    });
+    double total = 0.0;
+    for (double partial : partials) total += partial;
+    return total;
+}
+
+// Checks whether a scalar can take part in INT64 arithmetic exactly
+static bool isInt64Scalar(double value) {
+    return value == std::floor(value) && value >= -9.2e18 && value <= 9.2e18;
+}
+
+static Array binary(const Array& left, const Array* right, double scalar, BinaryOp op) {
+    size_t n = left.size();
+    bool broadcast = right == nullptr;
+    bool intResult = left.getElementType() == ElementType::INT64 &&
+                     (broadcast ? isInt64Scalar(scalar) : right->getElementType() == ElementType::INT64);
+    if (intResult) {
+        Array result(ElementType::INT64, n);
+        int64_t scalarInt = broadcast ? static_cast<int64_t>(scalar) : 0;
+        const int64_t* a = left.int64Data();
+        const int64_t* b = broadcast ? &scalarInt : right->int64Data();
+        int64_t* out = result.int64Data();
+        forEachChunk(n, [&](size_t, size_t begin, size_t end) {
+            const int64_t* rhs = broadcast ? b : b + begin;
+#ifdef COCOMPILER_AVX2_DISPATCH
+            // AVX2 has no 64-bit multiply, so only addition is vectorized
+            if (op == BinaryOp::ADD && ArrayKernels::usingAVX2()) {
+                addI64AVX2(a + begin, rhs, broadcast, out + begin, end - begin);
+                return;
+            }
+#endif
+            binaryI64Scalar(a + begin, rhs, broadcast, out + begin, end - begin, op);
+        });
+        return result;
+    }
+
+    Array leftF = left.getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : left.toFloat64();
+    Array rightF = broadcast || right->getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : right->toFloat64();
+    const double* a = left.getElementType() == ElementType::FLOAT64 ? left.float64Data() : leftF.float64Data();
+    const double* b = broadcast ? &scalar : (right->getElementType() == ElementType::FLOAT64 ? right->float64Data() : rightF.float64Data());
+    Array result(ElementType::FLOAT64, n);
+    double* out = result.float64Data();
+    forEachChunk(n, [&](size_t, size_t begin, size_t end) {
+        const double* rhs = broadcast ? b : b + begin;
+#ifdef COCOMPILER_AVX2_DISPATCH
+        if (ArrayKernels::usingAVX2()) {
+            binaryF64AVX2(a + begin, rhs, broadcast, out + begin, end - begin, op);
+            return;
+        }
+#endif
+        binaryF64Scalar(a + begin, rhs, broadcast, out + begin, end - begin, op);
+    });
+    return result;
+}
+
+Array ArrayKernels::add(const Array& left, const Array& right) {
+    return binary(left, &right, 0.0, BinaryOp::ADD);
+}
+
+Array ArrayKernels::add(const Array& left, double scalar) {
+    return binary(left, nullptr, scalar, BinaryOp::ADD);
+}
+
+Array ArrayKernels::mul(const Array& left, const Array& right) {
+    return binary(left, &right, 0.0, BinaryOp::MUL);
+}
+
+Array ArrayKernels::mul(const Array& left, double scalar) {
+    return binary(left, nullptr, scalar, BinaryOp::MUL);
+}
+
+static Array compareArrays(const Array& left, const Array* right, double scalar, CompareOp op) {
+    size_t n = left.size();
+    bool broadcast = right == nullptr;
+    Array result(ElementType::INT64, n);
+    int64_t* out = result.int64Data();
+    bool intCompare = left.getElementType() == ElementType::INT64 &&
+                      (broadcast ? isInt64Scalar(scalar) : right->getElementType() == ElementType::INT64);
+    if (intCompare) {
+        int64_t scalarInt = broadcast ? static_cast<int64_t>(scalar) : 0;
+        const int64_t* a = left.int64Data();
+        const int64_t* b = broadcast ? &scalarInt : right->int64Data();
+        forEachChunk(n, [&](size_t, size_t begin, size_t end) {
+            const int64_t* rhs = broadcast ? b : b + begin;
+#ifdef COCOMPILER_AVX2_DISPATCH
+            if (ArrayKernels::usingAVX2()) {
+                compareI64AVX2(a + begin, rhs, broadcast, out + begin, end - begin, op);
+                return;
+            }
+#endif
+            compareScalar(a + begin, rhs, broadcast, out + begin, end - begin, op);
+        });
+        return result;
+    }
+
+    Array leftF = left.getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : left.toFloat64();
+    Array rightF = broadcast || right->getElementType() == ElementType::FLOAT64 ? Array(ElementType::FLOAT64, 0) : right->toFloat64();
+    const double* a = left.getElementType() == ElementType::FLOAT64 ? left.float64Data() : leftF.float64Data();
+    const double* b = broadcast ? &scalar : (right->getElementType() == ElementType::FLOAT64 ? right->float64Data() : rightF.float64Data());
+    forEachChunk(n, [&](size_t, size_t begin, size_t end) {
+        const double* rhs = broadcast ? b : b + begin;
+#ifdef COCOMPILER_AVX2_DISPATCH
+        if (ArrayKernels::usingAVX2()) {
+            compareF64AVX2(a + begin, rhs, broadcast, out + begin, end - begin, op);
+            return;
+        }
+#endif
+        compareScalar(a + begin, rhs, broadcast, out + begin, end - begin, op);
+    });
+    return result;
+}
+
+Array ArrayKernels::compare(const Array& left, const Array& right, CompareOp op) {
+    return compareArrays(left, &right, 0.0, op);
+}
+
+Array ArrayKernels::compare(const Array& left, double scalar, CompareOp op) {
+    return compareArrays(left, nullptr, scalar, op);
+}
+
+// --- Sort, scan and filter ---
+
+// Orders NaN after every number (and equal to other NaNs), so sorting is well defined
+static bool lessF64(double a, double b) {
+    return a < b || (b != b && a == a);
+}
+
+template <typename T, typename Less>
+static void parallelSort(T* data, size_t n, Less less) {
+    if (n < ArrayKernels::kParallelThreshold) {
+        std::stable_sort(data, data + n, less);
+        return;
+    }
+    // Sort chunks independently, then merge neighbouring runs pairwise until one run remains.
+    // Stable sorts and merges give exactly the result of one stable sort.
+    size_t chunks = chunkCount(n);
+    ThreadPool& pool = ThreadPool::shared();
+    pool.parallelFor(chunks, [&](size_t chunk) {
+        size_t begin = chunk * ArrayKernels::kChunkSize;
+        std::stable_sort(data + begin, data + std::min(n, begin + ArrayKernels::kChunkSize), less);
+    });
+    std::vector<T> buffer(n);
+    T* from = data;
+    T* to = buffer.data();
+    for (size_t width = ArrayKernels::kChunkSize; width < n; width *= 2) {
+        size_t pairs = (n + 2 * width - 1) / (2 * width);
+        pool.parallelFor(pairs, [&](size_t pair) {
+            size_t begin = pair * 2 * width;
+            size_t middle = std::min(n, begin + width);
+            size_t end = std::min(n, begin + 2 * width);
+            std::merge(from + begin, from + middle, from + middle, from + end, to + begin, less);
+        });
+        std::swap(from, to);
+    }
+    if (from != data) {
+        std::copy(from, from + n, data);
+    }
+}
+
+Array ArrayKernels::sort(const Array& array) {
+    size_t n = array.size();
+    Array result(array.getElementType(), n);
+    if (array.getElementType() == ElementType::INT64) {
+        std::copy(array.int64Data(), array.int64Data() + n, result.int64Data());
+        parallelSort(result.int64Data(), n, [](int64_t a, int64_t b) { return a < b; });
+    } else {
+        std::copy(array.float64Data(), array.float64Data() + n, result.float64Data());
+        parallelSort(result.float64Data(), n, lessF64);
+    }
+    return result;
+}
+
+Array ArrayKernels::scan(const Array& array) {
+    size_t n = array.size();
+    Array result(array.getElementType(), n);
+    size_t chunks = chunkCount(n);
+    // Three passes: per-chunk totals, their running offsets (in chunk order), then each
+    // chunk's running sum starting from its offset
+    if (array.getElementType() == ElementType::INT64) {
+        const int64_t* in = array.int64Data();
+        int64_t* out = result.int64Data();
+        std::vector<uint64_t> offsets(chunks + 1, 0);
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            offsets[chunk + 1] = static_cast<uint64_t>(sumI64(in + begin, end - begin));
+        });
+        for (size_t chunk = 0; chunk < chunks; ++chunk) offsets[chunk + 1] += offsets[chunk];
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            uint64_t running = offsets[chunk];
+            for (size_t i = begin; i < end; ++i) {
+                running += static_cast<uint64_t>(in[i]);
+                out[i] = static_cast<int64_t>(running);
+            }
+        });
+    } else {
+        const double* in = array.float64Data();
+        double* out = result.float64Data();
+        std::vector<double> offsets(chunks + 1, 0.0);
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            offsets[chunk + 1] = sumF64(in + begin, end - begin);
+        });
+        for (size_t chunk = 0; chunk < chunks; ++chunk) offsets[chunk + 1] += offsets[chunk];
+        forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+            double running = offsets[chunk];
+            for (size_t i = begin; i < end; ++i) {
+                running += in[i];
+                out[i] = running;
+            }
+        });
+    }
+    return result;
+}
+
+Array ArrayKernels::filter(const Array& array, const Array& mask) {
+    size_t n = array.size();
+    size_t chunks = chunkCount(n);
+    // Count survivors per chunk, turn the counts into output offsets, then copy in parallel
+    std::vector<size_t> offsets(chunks + 1, 0);
+    forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+        size_t kept = 0;
+        for (size_t i = begin; i < end; ++i) kept += mask.get(i) != 0.0;
+        offsets[chunk + 1] = kept;
+    });
+    for (size_t chunk = 0; chunk < chunks; ++chunk) offsets[chunk + 1] += offsets[chunk];
+
+    Array result(array.getElementType(), offsets[chunks]);
+    bool isInt = array.getElementType() == ElementType::INT64;
+    forEachChunk(n, [&](size_t chunk, size_t begin, size_t end) {
+        size_t next = offsets[chunk];
+        for (size_t i = begin; i < end; ++i) {
+            if (mask.get(i) == 0.0) continue;
+            if (isInt) {
+                result.int64Data()[next++] = array.int64Data()[i];
+            } else {
+                result.float64Data()[next++] = array.float64Data()[i];
+            }
+        }
+    });
+    return result;
+}
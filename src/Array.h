@@ -0,0 +1,161 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief The element representation of an Array.
+ */
+enum class ElementType {
+    INT64,  /**< 64-bit signed integers (exact integer arithmetic). */
+    FLOAT64 /**< 64-bit floating-point numbers. */
+};
+
+/**
+ * @brief Element-wise comparison performed by ArrayKernels::compare.
+ */
+enum class CompareOp {
+    LESS,
+    GREATER,
+    EQUAL
+};
+
+/**
+ * @brief A contiguous, typed numeric array.
+ * Storage is 64-byte aligned (one cache line, and a multiple of the 32-byte AVX2 vector
+ * width), so kernels can stream over it with aligned vector loads.
+ */
+class Array {
+private:
+    ElementType type;
+    size_t length;
+    void* data; // 64-byte aligned, length elements of the current element type
+    bool borrowed; // data belongs to the host (see borrow()), is not freed and must not be written
+
+    Array(ElementType type, size_t length, void* data, bool borrowed)
+        : type(type), length(length), data(data), borrowed(borrowed) {}
+
+public:
+    static constexpr size_t kAlignment = 64;
+
+    /**
+     * @brief Constructs a zero-filled array.
+     * @param type The element type.
+     * @param length The number of elements.
+     */
+    Array(ElementType type, size_t length);
+    ~Array();
+
+    /**
+     * @brief Wraps elements owned by someone else, without copying them.
+     * The array must not be written, and the memory must outlive it. It need not be aligned.
+     * @param type The element type.
+     * @param data The first element.
+     * @param length The number of elements.
+     */
+    static Array borrow(ElementType type, const void* data, size_t length);
+
+    Array(Array&& other) noexcept;
+    Array& operator=(Array&& other) noexcept;
+    Array(const Array&) = delete;
+    Array& operator=(const Array&) = delete;
+
+    ElementType getElementType() const { return type; }
+    size_t size() const { return length; }
+    bool isBorrowed() const { return borrowed; }
+
+    int64_t* int64Data() { return static_cast<int64_t*>(data); }
+    const int64_t* int64Data() const { return static_cast<const int64_t*>(data); }
+    double* float64Data() { return static_cast<double*>(data); }
+    const double* float64Data() const { return static_cast<const double*>(data); }
+
+    /**
+     * @brief Reads an element as a double. The index must be in range.
+     */
+    double get(size_t index) const;
+
+    /**
+     * @brief Checks whether set() can store a value without changing the element type.
+     */
+    bool fits(double value) const;
+
+    /**
+     * @brief Writes an element. The index must be in range.
+     * Storing a non-integral value into an INT64 array first promotes it to FLOAT64.
+     */
+    void set(size_t index, double value);
+
+    /**
+     * @brief Converts the array's storage to FLOAT64 in place.
+     */
+    void promoteToFloat64();
+
+    /**
+     * @brief Returns a FLOAT64 copy of the array.
+     */
+    Array toFloat64() const;
+
+    /**
+     * @brief Formats the array as "[e0, e1, ...]".
+     */
+    std::string toString() const;
+};
+
+/**
+ * @brief Whole-array numeric kernels.
+ * Each kernel has an AVX2 implementation selected at runtime when the CPU supports it,
+ * and a portable scalar fallback. Floating-point reductions accumulate in the same
+ * 16-lane order on both paths, so results do not depend on the CPU.
+ * Work is split into fixed kChunkSize-element chunks, which run on ThreadPool::shared()
+ * for arrays of at least kParallelThreshold elements; per-chunk results are combined in
+ * chunk order, so results do not depend on the thread count either.
+ * Callers check sizes (element-wise operands must have equal lengths, min/max need at
+ * least one element).
+ */
+namespace ArrayKernels {
+    constexpr size_t kChunkSize = 1 << 15;         // Elements per chunk (256 KB of data)
+    constexpr size_t kParallelThreshold = 1 << 17; // Smaller arrays run their chunks on the calling thread
+
+    /**
+     * @brief Reports whether the AVX2 kernels are in use.
+     * They are used when the CPU supports AVX2, unless the COCOMPILER_NO_SIMD
+     * environment variable is set.
+     */
+    bool usingAVX2();
+
+    double sum(const Array& array);
+    double min(const Array& array);
+    double max(const Array& array);
+    double dot(const Array& left, const Array& right);
+
+    Array add(const Array& left, const Array& right);
+    Array add(const Array& left, double scalar);
+    Array mul(const Array& left, const Array& right);
+    Array mul(const Array& left, double scalar);
+
+    /**
+     * @brief Compares element-wise, producing an INT64 array of 0/1 flags.
+     */
+    Array compare(const Array& left, const Array& right, CompareOp op);
+    Array compare(const Array& left, double scalar, CompareOp op);
+
+    /**
+     * @brief Returns a sorted copy (ascending, NaN last), using a parallel merge sort.
+     */
+    Array sort(const Array& array);
+
+    /**
+     * @brief Returns the inclusive prefix sums (element i is the sum of elements 0..i).
+     */
+    Array scan(const Array& array);
+
+    /**
+     * @brief Returns the elements whose mask element is non-zero, in order.
+     * The mask must have the same length as the array.
+     */
+    Array filter(const Array& array, const Array& mask);
+}
+
+#endif // ARRAY_H
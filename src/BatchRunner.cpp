@@ -0,0 +1,69 @@
+#include "BatchRunner.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+BatchRunner::BatchRunner(size_t jobs, const cocompiler::Inputs& inputs)
+    : pool(jobs == 0 ? std::thread::hardware_concurrency() : jobs), inputs(inputs) {
+    this->inputs.output = nullptr;
+    for (size_t i = 0; i < pool.getThreadCount(); ++i) {
+        contexts.emplace_back(new cocompiler::ExecutionContext());
+    }
+}
+
+// The latency below which a fraction of the (sorted) latencies fall, by nearest rank
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+BatchSummary BatchSummary::of(const std::vector<BatchOutcome>& outcomes, size_t programs, double seconds) {
+    BatchSummary summary;
+    summary.scripts = outcomes.size();
+    summary.programs = programs;
+    summary.seconds = seconds;
+    std::vector<double> latencies;
+    latencies.reserve(outcomes.size());
+    for (const BatchOutcome& outcome : outcomes) {
+        if (!outcome.result.ok) summary.failures++;
+        latencies.push_back(outcome.seconds);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    summary.p50 = percentile(latencies, 0.50);
+    summary.p90 = percentile(latencies, 0.90);
+    summary.p99 = percentile(latencies, 0.99);
+    summary.max = latencies.empty() ? 0 : latencies.back();
+    return summary;
+}
+
+std::vector<BatchOutcome> BatchRunner::run(const std::vector<BatchScript>& scripts) {
+    auto batchStart = std::chrono::steady_clock::now();
+
+    // Scripts with the same source share a program slot
+    std::unordered_map<std::string_view, size_t> slots;
+    std::vector<size_t> slotOf(scripts.size());
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        slotOf[i] = slots.emplace(scripts[i].source, slots.size()).first->second;
+    }
+    std::vector<cocompiler::Program> programs(slots.size());
+    std::unique_ptr<std::once_flag[]> compiled(new std::once_flag[slots.size()]);
+
+    std::vector<BatchOutcome> outcomes(scripts.size());
+    pool.parallelForEach(scripts.size(), [&](size_t task, size_t participant) {
+        auto start = std::chrono::steady_clock::now();
+        size_t slot = slotOf[task];
+        std::call_once(compiled[slot], [&] { programs[slot] = cocompiler::compile(scripts[task].source); });
+        BatchOutcome& outcome = outcomes[task];
+        contexts[participant]->run(programs[slot], inputs, outcome.result);
+        outcome.expression = programs[slot].isExpression();
+        outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    });
+
+    totals = BatchSummary::of(outcomes, programs.size(),
+                              std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count());
+    return outcomes;
+}
@@ -0,0 +1,86 @@
+#ifndef BATCH_RUNNER_H
+#define BATCH_RUNNER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../include/CoCompiler.h"
+#include "ThreadPool.h"
+
+/**
+ * @brief One script of a batch: a name to report it by and its source.
+ */
+struct BatchScript {
+    std::string name;
+    std::string source;
+};
+
+/**
+ * @brief What running one script of a batch did.
+ */
+struct BatchOutcome {
+    cocompiler::Result result; // Compile errors end up in result.errors, with result.ok false
+    bool expression = false;   // The script is a single expression, whose value is result.value
+    double seconds = 0;        // Its latency: compiling it (unless another script did) and running it
+};
+
+/**
+ * @brief Totals of a batch, for throughput and latency reporting.
+ */
+struct BatchSummary {
+    size_t scripts = 0;
+    size_t programs = 0;  // Distinct sources, each compiled once
+    size_t failures = 0;  // Scripts that did not compile or reported a runtime error
+    double seconds = 0;   // Wall-clock time of the whole batch
+    double p50 = 0;       // Latency percentiles, in seconds (nearest rank)
+    double p90 = 0;
+    double p99 = 0;
+    double max = 0;
+
+    double throughput() const { return seconds > 0 ? scripts / seconds : 0; } // Scripts per second
+
+    /**
+     * @brief Counts the failures and computes the latency percentiles of a finished batch.
+     * @param programs Distinct sources among the scripts.
+     * @param seconds Wall-clock time of the batch.
+     */
+    static BatchSummary of(const std::vector<BatchOutcome>& outcomes, size_t programs, double seconds);
+};
+
+/**
+ * @brief Compiles and runs many scripts concurrently on a work-stealing ThreadPool.
+ *
+ * Scripts are tasks of one parallelForEach: each participant runs its tasks on an
+ * ExecutionContext of its own and steals from the others once its block is done, so long
+ * scripts do not hold up the rest. Scripts with the same source share one Program, compiled by
+ * whichever task reaches it first while the others wait for it. Every script's output and
+ * errors are kept in its own BatchOutcome, so callers can print them in input order however
+ * the scripts interleaved. Parallel loops inside scripts run inline on the batch's threads.
+ */
+class BatchRunner {
+public:
+    /**
+     * @param jobs Scripts run at the same time (including the calling thread); 0 uses the
+     * number of hardware threads.
+     * @param inputs How every script runs (Inputs::output is ignored: output is collected).
+     */
+    BatchRunner(size_t jobs, const cocompiler::Inputs& inputs = cocompiler::Inputs());
+
+    /**
+     * @brief Runs every script and waits for all of them.
+     * @return One outcome per script, in the order of scripts.
+     */
+    std::vector<BatchOutcome> run(const std::vector<BatchScript>& scripts);
+
+    const BatchSummary& summary() const { return totals; } // Of the last run()
+    size_t getJobs() const { return pool.getThreadCount(); }
+
+private:
+    ThreadPool pool;
+    std::vector<std::unique_ptr<cocompiler::ExecutionContext>> contexts; // One per participant
+    cocompiler::Inputs inputs;
+    BatchSummary totals;
+};
+
+#endif // BATCH_RUNNER_H
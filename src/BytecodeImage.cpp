@@ -0,0 +1,190 @@
+#include "BytecodeImage.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <type_traits>
+#include "Verifier.h"
+
+static_assert(std::is_trivially_copyable<Bytecode>::value, "Images store instructions as raw bytes");
+
+static const char kMagic[4] = {'C', 'O', 'C', 'B'};
+static const uint32_t kByteOrder = 0x01020304; // Reads back differently on a host of the other byte order
+static const size_t kCodeAlignment = 8;        // Bytecode holds a double
+
+struct BytecodeImage::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t byte_order;
+    uint32_t instruction_size; // sizeof(Bytecode) on the writing host
+    uint32_t flags;
+    uint32_t global_count;
+    uint64_t code_offset;
+    uint64_t code_count;
+    uint64_t string_table_offset; // string_count pairs of uint32_t: offset into the string bytes, length
+    uint64_t string_count;
+    uint64_t string_bytes_offset;
+    uint64_t string_bytes_size;
+};
+
+static size_t alignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+BytecodeImage::BytecodeImage()
+    : mapping(nullptr), mapping_size(0), code_begin(nullptr), code_count(0), global_count(0), image_flags(0) {}
+
+BytecodeImage::~BytecodeImage() {
+    unmap();
+}
+
+void BytecodeImage::unmap() {
+    if (mapping) munmap(mapping, mapping_size);
+    mapping = nullptr;
+    mapping_size = 0;
+    code_begin = nullptr;
+    code_count = 0;
+    string_literals.clear();
+    global_count = 0;
+    image_flags = 0;
+}
+
+bool BytecodeImage::write(const std::string& path, const std::vector<Bytecode>& bytecode,
+                          const std::vector<std::string>& string_literals, uint32_t global_count, uint32_t flags) {
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.instruction_size = sizeof(Bytecode);
+    header.flags = flags;
+    header.global_count = global_count;
+    header.code_offset = alignUp(sizeof(Header), kCodeAlignment);
+    header.code_count = bytecode.size();
+    header.string_table_offset = header.code_offset + bytecode.size() * sizeof(Bytecode);
+    header.string_count = string_literals.size();
+    header.string_bytes_offset = header.string_table_offset + string_literals.size() * 2 * sizeof(uint32_t);
+
+    std::vector<uint32_t> table;
+    std::string bytes;
+    for (const std::string& literal : string_literals) {
+        table.push_back(static_cast<uint32_t>(bytes.size()));
+        table.push_back(static_cast<uint32_t>(literal.size()));
+        bytes += literal;
+    }
+    header.string_bytes_size = bytes.size();
+
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Image Error: Could not write '" << temporary << "'" << std::endl;
+            return false;
+        }
+        static const char padding[kCodeAlignment] = {};
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(padding, header.code_offset - sizeof(header));
+        file.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size() * sizeof(Bytecode));
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(uint32_t));
+        file.write(bytes.data(), bytes.size());
+        file.close();
+        if (!file) {
+            std::cerr << "Image Error: Could not write '" << temporary << "'" << std::endl;
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::cerr << "Image Error: Could not replace '" << path << "'" << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool BytecodeImage::load(const std::string& path) {
+    unmap();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Image Error: Could not open '" << path << "'" << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        std::cerr << "Image Error: '" << path << "' is too short to be a bytecode image." << std::endl;
+        return false;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Image Error: Could not map '" << path << "'" << std::endl;
+        return false;
+    }
+    mapping = mapped;
+    mapping_size = size;
+
+    const char* base = static_cast<const char*>(mapped);
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    const char* problem = nullptr;
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        problem = "is not a bytecode image";
+    } else if (header.version != kVersion) {
+        problem = "was written for a different image version; recompile it";
+    } else if (header.byte_order != kByteOrder || header.instruction_size != sizeof(Bytecode)) {
+        problem = "was written on an incompatible host; recompile it";
+    } else if (header.code_offset % kCodeAlignment != 0 || header.code_offset < sizeof(Header) ||
+               header.code_offset > size || header.code_count > (size - header.code_offset) / sizeof(Bytecode) ||
+               header.string_table_offset != header.code_offset + header.code_count * sizeof(Bytecode) ||
+               header.string_count > (size - header.string_table_offset) / (2 * sizeof(uint32_t)) ||
+               header.string_bytes_offset != header.string_table_offset + header.string_count * 2 * sizeof(uint32_t) ||
+               header.string_bytes_size != size - header.string_bytes_offset) {
+        problem = "is truncated or corrupt";
+    }
+    if (!problem) {
+        const char* table = base + header.string_table_offset;
+        const char* bytes = base + header.string_bytes_offset;
+        string_literals.reserve(header.string_count);
+        for (uint64_t i = 0; i < header.string_count && !problem; ++i) {
+            uint32_t entry[2];
+            std::memcpy(entry, table + i * sizeof(entry), sizeof(entry));
+            if (entry[0] > header.string_bytes_size || entry[1] > header.string_bytes_size - entry[0]) {
+                problem = "is truncated or corrupt";
+            } else {
+                string_literals.emplace_back(bytes + entry[0], entry[1]);
+            }
+        }
+    }
+    if (!problem) {
+        // The VM indexes frames and global slots with these operands unchecked
+        const Bytecode* code = reinterpret_cast<const Bytecode*>(base + header.code_offset);
+        std::vector<int> heights;
+        int maxHeight;
+        if (!computeStackHeights(code, static_cast<size_t>(header.code_count), heights, maxHeight)) {
+            problem = "fails bytecode verification";
+        }
+        for (uint64_t i = 0; i < header.code_count && !problem; ++i) {
+            if ((code[i].instruction == Instruction::LOAD_GLOBAL || code[i].instruction == Instruction::STORE_GLOBAL) &&
+                (code[i].operand < 0 || code[i].operand >= header.global_count)) {
+                problem = "fails bytecode verification";
+            }
+        }
+    }
+    if (problem) {
+        unmap();
+        std::cerr << "Image Error: '" << path << "' " << problem << "." << std::endl;
+        return false;
+    }
+
+    code_begin = reinterpret_cast<const Bytecode*>(base + header.code_offset);
+    code_count = header.code_count;
+    global_count = header.global_count;
+    image_flags = header.flags;
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef BYTECODE_IMAGE_H
+#define BYTECODE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../include/Bytecode.h"
+
+/**
+ * @brief A compiled program saved to disk (a .cocb file), so that running it skips the
+ * lexer, parser and compiler.
+ *
+ * The file is a fixed header followed by three sections, each starting at an offset the
+ * header records:
+ *   - code: the Bytecode instructions exactly as they are laid out in memory, 8-byte aligned;
+ *   - string table: an offset and a length (two uint32_t) per string literal;
+ *   - string bytes: the characters of every literal, one after another.
+ * The header also holds the number of global variable slots the program uses and flags
+ * describing how the driver should report its result.
+ *
+ * load() maps the file read-only and checks the header and section bounds; the
+ * instructions are then used where they lie in the mapping, with no decoding. Because
+ * instructions are stored in the host's layout, the header records the byte order and
+ * sizeof(Bytecode), and an image written on a host that differs in either is rejected.
+ * load() also runs the stack verifier (see Verifier.h) over the instructions and checks
+ * their global slots against the header, so an image whose locals or stack could fall
+ * outside a frame is rejected rather than trusted; other operands are checked when they run.
+ */
+class BytecodeImage {
+public:
+    static const uint32_t kVersion = 1;          // Bumped whenever the layout or the meaning of an instruction changes
+    static const uint32_t kExpressionResult = 1; // Flag: the program is a single expression, whose value the driver prints
+
+    BytecodeImage();
+    ~BytecodeImage();
+
+    BytecodeImage(const BytecodeImage&) = delete;
+    BytecodeImage& operator=(const BytecodeImage&) = delete;
+
+    /**
+     * @brief Writes a program as an image. The file is written under a temporary name and
+     * renamed into place, so a reader never sees a partial image.
+     * @param path The file to create or replace.
+     * @param bytecode The program as compiled.
+     * @param string_literals The compiler's string literals.
+     * @param global_count The number of global variable slots the program uses.
+     * @param flags A combination of the flags above.
+     * @return False (after reporting on std::cerr) if the file could not be written.
+     */
+    static bool write(const std::string& path, const std::vector<Bytecode>& bytecode,
+                      const std::vector<std::string>& string_literals, uint32_t global_count, uint32_t flags);
+
+    /**
+     * @brief Maps an image and checks its header, sections and instructions. Any image loaded before is unmapped.
+     * @return False (after reporting on std::cerr) if the file cannot be read, is not a valid image
+     * or fails verification.
+     */
+    bool load(const std::string& path);
+
+    const Bytecode* code() const { return code_begin; } // The instructions, inside the mapping
+    size_t size() const { return code_count; }
+    const std::vector<std::string>& strings() const { return string_literals; }
+    uint32_t globalCount() const { return global_count; }
+    uint32_t flags() const { return image_flags; }
+
+private:
+    struct Header; // The on-disk header (see BytecodeImage.cpp)
+
+    void* mapping;
+    size_t mapping_size;
+    const Bytecode* code_begin;
+    size_t code_count;
+    std::vector<std::string> string_literals;
+    uint32_t global_count;
+    uint32_t image_flags;
+
+    void unmap();
+};
+
+#endif // BYTECODE_IMAGE_H
@@ -0,0 +1,558 @@
+#include "ClosureCompiler.h"
+#include <algorithm>
+#include <functional>
+#include "Verifier.h"
+#include "VM.h"
+
+/**
+ * @brief The state every handler reads and writes.
+ * The operand stack has no pointer of its own here: handlers address their operands as
+ * fixed slots of the current frame.
+ */
+struct ClosureCompiler::Context {
+    double* frame;              // Slot 0 of the current frame
+    double* values;             // The ValueStack's element 0
+    size_t capacity;            // The ValueStack's capacity
+    Frame* frames;              // The VM's call frames
+    int frame_count;            // Authoritative while handlers run, like back_edges_taken
+    int max_frames;             // The VM's maximum call depth
+    double* memory;             // Global variables
+    size_t memory_size;         // Number of globals
+    uint32_t* back_edge_counts; // The VM's hotness counters
+    uint64_t back_edges_taken;  // Authoritative while handlers run; copied to and from the VM around each step
+    uint64_t limit_check_after; // The VM's limit_check_at - 1: the back-edge after this many checks the VM's limits
+    uint64_t calls_taken;       // Authoritative while handlers run, like back_edges_taken
+    uint64_t call_check_after;  // The VM's call_check_at - 1: the call after this many checks the VM's limits
+    const Handler* handlers;    // ClosureCompiler::handlers
+    int end;                    // Program size
+    size_t max_height;          // ClosureCompiler::max_height
+    VM* vm;
+    bool halted;                // Set when HALT ran
+    double result;              // The value HALT returned
+};
+
+/**
+ * @brief One instruction (or a fused run of them) with its operands resolved.
+ */
+struct ClosureCompiler::Handler {
+    using Function = const Handler* (*)(const Handler* self, Context& context);
+    Function function;     // Runs the instruction and returns the handler to run next, or null to stop
+    const Handler* next;   // The handler of the instruction that follows
+    const Handler* target; // The handler of the jump, loop or call target
+    double constant;       // The pushed constant, constant right operand, or loop step
+    int slot;              // Local slot or global address
+    int argc;              // CALL and TAIL_CALL: arguments
+    int frame_size;        // CALL and TAIL_CALL: slots of the callee's frame
+    int pc;                // The (first) instruction, where an interpreter step starts
+    int target_pc;         // The instruction jumped to, whose back-edge counter is updated
+    int height;            // Stack height before the instruction, relative to the frame
+};
+
+/**
+ * @brief Builds the handler of each instruction. Handlers are captureless lambdas and
+ * function templates over the operation, so each compiles to a short straight-line function.
+ */
+class HandlerBuilder {
+public:
+    using Handler = ClosureCompiler::Handler;
+    using Context = ClosureCompiler::Context;
+
+    HandlerBuilder(BytecodeView program, const std::vector<int>& heights, std::vector<Handler>& handlers)
+        : program(program), heights(heights), handlers(handlers) {}
+
+    void build() {
+        findEntryPoints();
+        handlers.assign(program.size() + 1, Handler());
+        for (size_t pc = 0; pc <= program.size(); ++pc) {
+            Handler& handler = handlers[pc];
+            handler.pc = static_cast<int>(pc);
+            handler.height = pc < program.size() && heights[pc] > 0 ? heights[pc] : 0;
+            handler.function = &ClosureCompiler::step; // Running off the end, or unreachable as far as the verifier knows
+            handler.next = resolve(static_cast<int>(pc) + 1);
+            if (pc < program.size() && heights[pc] >= 0) buildInstruction(static_cast<int>(pc));
+        }
+    }
+
+private:
+    BytecodeView program;
+    const std::vector<int>& heights;
+    std::vector<Handler>& handlers;
+    std::vector<bool> entries; // Instructions reached other than from the one before
+
+    void findEntryPoints() {
+        entries.assign(program.size() + 1, false);
+        for (size_t pc = 0; pc < program.size(); ++pc) {
+            const Bytecode& instruction = program[pc];
+            switch (instruction.instruction) {
+                case Instruction::JUMP: case Instruction::JUMP_IF_FALSE: case Instruction::JUMP_IF_TRUE:
+                case Instruction::LOOP_INC_CMP_JUMP: case Instruction::LOOP_INC_CMP_JUMP_LOCAL:
+                case Instruction::CALL: case Instruction::TAIL_CALL: case Instruction::PARALLEL_FOR: {
+                    int target = static_cast<int>(instruction.operand);
+                    if (target >= 0 && target <= static_cast<int>(program.size())) entries[target] = true;
+                    if (instruction.instruction == Instruction::CALL) entries[pc + 1] = true;
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    // The handler that runs when execution reaches pc; POPs need none, since operands have fixed slots
+    const Handler* resolve(int pc) {
+        int end = static_cast<int>(program.size());
+        if (pc < 0 || pc > end) pc = end;
+        while (pc < end && program[pc].instruction == Instruction::POP && heights[pc] >= 1) ++pc;
+        return &handlers[pc];
+    }
+
+    // True if the instruction at pc can be folded into the handler of the one before
+    bool fusible(int pc) const {
+        return pc < static_cast<int>(program.size()) && !entries[pc] && heights[pc] >= 0;
+    }
+
+    static bool isConstant(const Bytecode& instruction) {
+        return instruction.instruction == Instruction::PUSH_INT || instruction.instruction == Instruction::PUSH_FLOAT;
+    }
+
+    static bool isBackEdge(int pc, int target) { return target >= 0 && target <= pc; }
+
+    // Counts a back-edge as VM::onBackEdge does; false (after reporting) if a limit is exceeded
+    static bool backEdge(const Handler* self, Context& context) {
+        context.back_edge_counts[self->target_pc]++;
+        if (++context.back_edges_taken <= context.limit_check_after) return true;
+        return checkLimits(self, context);
+    }
+
+    // Counts a call as VM CALL does; false (after reporting) if a limit is exceeded
+    static bool call(const Handler* self, Context& context) {
+        if (++context.calls_taken <= context.call_check_after) return true;
+        return checkLimits(self, context);
+    }
+
+    // Runs the VM's limit check that a back-edge or call to self's target made due
+    static bool checkLimits(const Handler* self, Context& context) {
+        VM& vm = *context.vm;
+        vm.back_edges_taken = context.back_edges_taken;
+        vm.calls_taken = context.calls_taken;
+        vm.frame_count = context.frame_count;
+        if (!vm.checkLimits(self->target_pc)) return false;
+        context.limit_check_after = vm.limit_check_at - 1;
+        context.call_check_after = vm.call_check_at - 1;
+        return true;
+    }
+
+    // TAIL_CALL: the arguments slide down over the current frame's slots, and the callee's locals start at zero
+    static void replaceFrame(const Handler* self, Context& context) {
+        double* arguments = context.frame + self->height - self->argc;
+        std::copy(arguments, arguments + self->argc, context.frame);
+        std::fill(context.frame + self->argc, context.frame + self->frame_size, 0.0);
+    }
+
+    template <typename Operation>
+    static const Handler* binary(const Handler* self, Context& context) {
+        double* operands = context.frame + self->height - 2;
+        operands[0] = Operation()(operands[0], operands[1]);
+        return self->next;
+    }
+
+    // PUSH of a constant followed by a binary instruction
+    template <typename Operation>
+    static const Handler* binaryConstant(const Handler* self, Context& context) {
+        double* operand = context.frame + self->height - 1;
+        *operand = Operation()(*operand, self->constant);
+        return self->next;
+    }
+
+    // A comparison followed by a conditional jump
+    template <typename Comparison, bool jumpIf, bool backward>
+    static const Handler* compareAndJump(const Handler* self, Context& context) {
+        const double* operands = context.frame + self->height - 2;
+        if (Comparison()(operands[0], operands[1]) != jumpIf) return self->next;
+        if (backward && !backEdge(self, context)) return nullptr;
+        return self->target;
+    }
+
+    // PUSH of a constant, a comparison and a conditional jump
+    template <typename Comparison, bool jumpIf, bool backward>
+    static const Handler* compareConstantAndJump(const Handler* self, Context& context) {
+        if (Comparison()(context.frame[self->height - 1], self->constant) != jumpIf) return self->next;
+        if (backward && !backEdge(self, context)) return nullptr;
+        return self->target;
+    }
+
+    template <bool jumpIf, bool backward>
+    static const Handler* conditionalJump(const Handler* self, Context& context) {
+        if ((context.frame[self->height - 1] != 0.0) != jumpIf) return self->next;
+        if (backward && !backEdge(self, context)) return nullptr;
+        return self->target;
+    }
+
+    template <typename Comparison, bool local>
+    static const Handler* loop(const Handler* self, Context& context) {
+        double* counter;
+        if (local) {
+            counter = context.frame + self->slot;
+        } else {
+            if (static_cast<size_t>(self->slot) >= context.memory_size) return ClosureCompiler::step(self, context);
+            counter = context.memory + self->slot;
+        }
+        *counter += self->constant;
+        if (!Comparison()(*counter, context.frame[self->height - 1])) return self->next;
+        if (!backEdge(self, context)) return nullptr;
+        return self->target;
+    }
+
+    // Picks the instantiation of a template for one of the ten binary instructions
+    template <template <typename> class Handlers>
+    static Handler::Function forOperation(Instruction instruction) {
+        switch (instruction) {
+            case Instruction::ADD: return Handlers<std::plus<double>>::function;
+            case Instruction::SUB: return Handlers<std::minus<double>>::function;
+            case Instruction::MUL: return Handlers<std::multiplies<double>>::function;
+            case Instruction::DIV: return Handlers<std::divides<double>>::function;
+            default: return forComparison<Handlers>(instruction);
+        }
+    }
+
+    template <template <typename> class Handlers>
+    static Handler::Function forComparison(Instruction instruction) {
+        switch (instruction) {
+            case Instruction::GREATER: return Handlers<std::greater<double>>::function;
+            case Instruction::LESS: return Handlers<std::less<double>>::function;
+            case Instruction::GREATER_EQUAL: return Handlers<std::greater_equal<double>>::function;
+            case Instruction::LESS_EQUAL: return Handlers<std::less_equal<double>>::function;
+            case Instruction::EQUAL_EQUAL: return Handlers<std::equal_to<double>>::function;
+            case Instruction::BANG_EQUAL: return Handlers<std::not_equal_to<double>>::function;
+            default: return nullptr;
+        }
+    }
+
+    template <typename Operation> struct Binary { static constexpr Handler::Function function = &binary<Operation>; };
+    template <typename Operation> struct BinaryConstant { static constexpr Handler::Function function = &binaryConstant<Operation>; };
+    template <typename Comparison> struct LoopGlobal { static constexpr Handler::Function function = &loop<Comparison, false>; };
+    template <typename Comparison> struct LoopLocal { static constexpr Handler::Function function = &loop<Comparison, true>; };
+
+    template <bool jumpIf, bool backward>
+    struct Branch {
+        template <typename Comparison> struct Compare { static constexpr Handler::Function function = &compareAndJump<Comparison, jumpIf, backward>; };
+        template <typename Comparison> struct CompareConstant { static constexpr Handler::Function function = &compareConstantAndJump<Comparison, jumpIf, backward>; };
+    };
+
+    template <bool constant>
+    static Handler::Function compareAndJumpFor(Instruction comparison, bool jumpIf, bool backward) {
+        if (constant) {
+            if (jumpIf) return backward ? forComparison<Branch<true, true>::CompareConstant>(comparison) : forComparison<Branch<true, false>::CompareConstant>(comparison);
+            return backward ? forComparison<Branch<false, true>::CompareConstant>(comparison) : forComparison<Branch<false, false>::CompareConstant>(comparison);
+        }
+        if (jumpIf) return backward ? forComparison<Branch<true, true>::Compare>(comparison) : forComparison<Branch<true, false>::Compare>(comparison);
+        return backward ? forComparison<Branch<false, true>::Compare>(comparison) : forComparison<Branch<false, false>::Compare>(comparison);
+    }
+
+    static bool isComparison(Instruction instruction) { return forComparison<Binary>(instruction) != nullptr; }
+    static bool isConditionalJump(Instruction instruction) {
+        return instruction == Instruction::JUMP_IF_FALSE || instruction == Instruction::JUMP_IF_TRUE;
+    }
+
+    // Points handler at the conditional jump at jumpPc
+    void setJump(Handler& handler, int jumpPc) {
+        const Bytecode& jump = program[jumpPc];
+        handler.target_pc = static_cast<int>(jump.operand);
+        handler.target = resolve(handler.target_pc);
+        handler.next = resolve(jumpPc + 1);
+    }
+
+    // Fuses the instructions after a constant push or comparison where possible; true if it did
+    bool buildFused(int pc) {
+        const Bytecode& instruction = program[pc];
+        Handler& handler = handlers[pc];
+        if (isConstant(instruction) && fusible(pc + 1)) {
+            Instruction operation = program[pc + 1].instruction;
+            if (isComparison(operation) && fusible(pc + 2) && isConditionalJump(program[pc + 2].instruction)) {
+                bool jumpIf = program[pc + 2].instruction == Instruction::JUMP_IF_TRUE;
+                handler.constant = instruction.operand;
+                setJump(handler, pc + 2);
+                handler.function = compareAndJumpFor<true>(operation, jumpIf, isBackEdge(pc + 2, handler.target_pc));
+                return true;
+            }
+            bool dividesByZero = operation == Instruction::DIV && instruction.operand == 0.0;
+            Handler::Function function = forOperation<BinaryConstant>(operation);
+            if (function && !dividesByZero) {
+                handler.constant = instruction.operand;
+                handler.next = resolve(pc + 2);
+                handler.function = function;
+                return true;
+            }
+        }
+        if (isComparison(instruction.instruction) && fusible(pc + 1) && isConditionalJump(program[pc + 1].instruction)) {
+            bool jumpIf = program[pc + 1].instruction == Instruction::JUMP_IF_TRUE;
+            setJump(handler, pc + 1);
+            handler.function = compareAndJumpFor<false>(instruction.instruction, jumpIf, isBackEdge(pc + 1, handler.target_pc));
+            return true;
+        }
+        return false;
+    }
+
+    void buildInstruction(int pc) {
+        const Bytecode& instruction = program[pc];
+        Handler& handler = handlers[pc];
+        if (buildFused(pc)) return;
+        handler.constant = instruction.operand;
+        handler.target_pc = static_cast<int>(instruction.operand);
+        handler.target = resolve(handler.target_pc);
+        handler.argc = instruction.operand2;
+        handler.frame_size = instruction.operand3;
+        switch (instruction.instruction) {
+            case Instruction::PUSH_INT:
+            case Instruction::PUSH_FLOAT:
+            case Instruction::PUSH_STRING:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    context.frame[self->height] = self->constant;
+                    return self->next;
+                };
+                break;
+            case Instruction::ADD: case Instruction::SUB: case Instruction::MUL:
+            case Instruction::GREATER: case Instruction::LESS: case Instruction::GREATER_EQUAL:
+            case Instruction::LESS_EQUAL: case Instruction::EQUAL_EQUAL: case Instruction::BANG_EQUAL:
+                handler.function = forOperation<Binary>(instruction.instruction);
+                break;
+            case Instruction::DIV:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    double* operands = context.frame + self->height - 2;
+                    if (operands[1] == 0.0) return ClosureCompiler::step(self, context); // Reports the error
+                    operands[0] /= operands[1];
+                    return self->next;
+                };
+                break;
+            case Instruction::NEGATE:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    double* operand = context.frame + self->height - 1;
+                    *operand = -*operand;
+                    return self->next;
+                };
+                break;
+            case Instruction::NOT:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    double* operand = context.frame + self->height - 1;
+                    *operand = *operand == 0.0 ? 1.0 : 0.0;
+                    return self->next;
+                };
+                break;
+            case Instruction::POP:
+                handler.function = [](const Handler* self, Context&) -> const Handler* { return self->next; };
+                break;
+            case Instruction::LOAD:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    double* operand = context.frame + self->height - 1;
+                    if (!(*operand >= 0.0 && *operand < static_cast<double>(context.memory_size))) return ClosureCompiler::step(self, context);
+                    *operand = context.memory[static_cast<int>(*operand)];
+                    return self->next;
+                };
+                break;
+            case Instruction::STORE:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    double* operands = context.frame + self->height - 2;
+                    if (!(operands[1] >= 0.0 && operands[1] < static_cast<double>(context.memory_size))) return ClosureCompiler::step(self, context);
+                    context.memory[static_cast<int>(operands[1])] = operands[0]; // The value stays, as the result
+                    return self->next;
+                };
+                break;
+            case Instruction::LOAD_GLOBAL:
+                handler.slot = static_cast<int>(instruction.operand);
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    if (static_cast<size_t>(self->slot) >= context.memory_size) return ClosureCompiler::step(self, context);
+                    context.frame[self->height] = context.memory[self->slot];
+                    return self->next;
+                };
+                break;
+            case Instruction::STORE_GLOBAL:
+                handler.slot = static_cast<int>(instruction.operand);
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    if (static_cast<size_t>(self->slot) >= context.memory_size) return ClosureCompiler::step(self, context); // Grows memory
+                    context.memory[self->slot] = context.frame[self->height - 1];
+                    return self->next;
+                };
+                break;
+            case Instruction::LOAD_LOCAL:
+                handler.slot = static_cast<int>(instruction.operand);
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    context.frame[self->height] = context.frame[self->slot];
+                    return self->next;
+                };
+                break;
+            case Instruction::STORE_LOCAL:
+                handler.slot = static_cast<int>(instruction.operand);
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    context.frame[self->slot] = context.frame[self->height - 1];
+                    return self->next;
+                };
+                break;
+            case Instruction::JUMP:
+                if (isBackEdge(pc, handler.target_pc)) {
+                    handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                        return backEdge(self, context) ? self->target : nullptr;
+                    };
+                } else {
+                    handler.function = [](const Handler* self, Context&) -> const Handler* { return self->target; };
+                }
+                break;
+            case Instruction::JUMP_IF_FALSE:
+            case Instruction::JUMP_IF_TRUE: {
+                bool jumpIf = instruction.instruction == Instruction::JUMP_IF_TRUE;
+                bool backward = isBackEdge(pc, handler.target_pc);
+                if (jumpIf) {
+                    handler.function = backward ? &conditionalJump<true, true> : &conditionalJump<true, false>;
+                } else {
+                    handler.function = backward ? &conditionalJump<false, true> : &conditionalJump<false, false>;
+                }
+                break;
+            }
+            case Instruction::LOOP_INC_CMP_JUMP:
+            case Instruction::LOOP_INC_CMP_JUMP_LOCAL: {
+                Instruction comparison = static_cast<Instruction>(instruction.operand3);
+                if (comparison != Instruction::LESS && comparison != Instruction::LESS_EQUAL &&
+                    comparison != Instruction::GREATER && comparison != Instruction::GREATER_EQUAL) {
+                    break; // The interpreter reports the invalid comparison
+                }
+                handler.slot = instruction.operand2;
+                handler.constant = instruction.operand4;
+                bool local = instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL;
+                handler.function = local ? forComparison<LoopLocal>(comparison) : forComparison<LoopGlobal>(comparison);
+                break;
+            }
+            case Instruction::CALL:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    size_t base = static_cast<size_t>(context.frame - context.values) + self->height - self->argc;
+                    if (context.frame_count == context.max_frames || base + context.max_height + 1 > context.capacity) {
+                        return ClosureCompiler::step(self, context); // Reports the overflow, or grows the stack
+                    }
+                    Frame& frame = context.frames[context.frame_count++];
+                    frame.return_pc = self->pc + 1;
+                    frame.base = static_cast<int>(base);
+                    context.frame = context.values + base;
+                    std::fill(context.frame + self->argc, context.frame + self->frame_size, 0.0); // The callee's locals
+                    return call(self, context) ? self->target : nullptr;
+                };
+                break;
+            case Instruction::TAIL_CALL:
+                if (isBackEdge(pc, handler.target_pc)) { // Self tail recursion is a loop
+                    handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                        if (context.frame_count == 0) return ClosureCompiler::step(self, context); // Reports TAIL_CALL outside of a function
+                        replaceFrame(self, context);
+                        return backEdge(self, context) ? self->target : nullptr;
+                    };
+                } else {
+                    handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                        if (context.frame_count == 0) return ClosureCompiler::step(self, context);
+                        replaceFrame(self, context);
+                        return self->target;
+                    };
+                }
+                break;
+            case Instruction::RET:
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    if (context.frame_count == 0) return ClosureCompiler::step(self, context); // Reports RET outside of a function
+                    double value = context.frame[self->height - 1];
+                    const Frame& frame = context.frames[--context.frame_count];
+                    context.values[frame.base] = value;
+                    context.frame = context.values + (context.frame_count > 0 ? context.frames[context.frame_count - 1].base : 0);
+                    return context.handlers + std::min(frame.return_pc, context.end);
+                };
+                break;
+            case Instruction::CALL_NATIVE:
+                handler.slot = static_cast<int>(instruction.operand);
+                handler.function = [](const Handler* self, Context& context) -> const Handler* {
+                    const NativeTable& natives = *context.vm->natives;
+                    if (static_cast<size_t>(self->slot) >= natives.size() || natives[self->slot].arity != self->argc) {
+                        return ClosureCompiler::step(self, context); // Reports the error
+                    }
+                    const NativeFunction& native = natives[self->slot];
+                    double* args = context.frame + self->height - self->argc;
+                    args[0] = native.thunk(native.function, args); // The result takes the first argument's slot
+                    return self->next;
+                };
+                break;
+            default:
+                break; // Strings, printing, arrays, maps, builtins, parallel loops and HALT run in the interpreter
+        }
+    }
+};
+
+ClosureCompiler::ClosureCompiler() : max_height(0) {}
+
+ClosureCompiler::~ClosureCompiler() {}
+
+bool ClosureCompiler::compile(BytecodeView program) {
+    std::vector<int> heights;
+    int maxHeight = 0;
+    if (!computeStackHeights(program, heights, maxHeight)) return false;
+    HandlerBuilder(program, heights, handlers).build();
+    max_height = static_cast<size_t>(maxHeight);
+    return true;
+}
+
+void ClosureCompiler::refresh(Context& context) {
+    VM& vm = *context.vm;
+    context.frame = vm.stack.values + vm.fp;
+    context.values = vm.stack.values;
+    context.capacity = vm.stack.capacity;
+    context.frames = vm.frames.data();
+    context.frame_count = vm.frame_count;
+    context.memory = vm.heap->memory.data();
+    context.memory_size = vm.heap->memory.size();
+}
+
+/**
+ * @brief Runs the handler's instruction as one step of the interpreter.
+ * @return The handler to continue at (the end handler if execution ran off the end), or
+ * null after HALT or a reported error.
+ */
+const ClosureCompiler::Handler* ClosureCompiler::step(const Handler* handler, Context& context) {
+    VM& vm = *context.vm;
+    vm.fp = static_cast<int>(context.frame - context.values);
+    vm.stack.count = static_cast<size_t>(vm.fp + handler->height);
+    vm.frame_count = context.frame_count;
+    vm.back_edges_taken = context.back_edges_taken;
+    vm.calls_taken = context.calls_taken;
+    vm.pc = handler->pc;
+    double result = vm.execute(1);
+    context.back_edges_taken = vm.back_edges_taken;
+    context.calls_taken = vm.calls_taken;
+    if (vm.halted) {
+        context.halted = true;
+        context.result = result;
+        return nullptr;
+    }
+    if (result == -1) return nullptr;
+    // Handlers never check capacity: within a frame the stack grows by at most max_height
+    vm.stack.reserve(vm.stack.count + context.max_height + 1);
+    refresh(context);
+    return context.handlers + (vm.pc >= 0 && vm.pc < context.end ? vm.pc : context.end);
+}
+
+double ClosureCompiler::run(VM& vm) {
+    if (handlers.empty()) return -1;
+    Context context;
+    context.vm = &vm;
+    context.max_frames = static_cast<int>(vm.max_frames);
+    context.back_edge_counts = vm.back_edge_counts.data();
+    context.back_edges_taken = vm.back_edges_taken;
+    context.limit_check_after = vm.limit_check_at - 1;
+    context.calls_taken = vm.calls_taken;
+    context.call_check_after = vm.call_check_at - 1;
+    context.handlers = handlers.data();
+    context.end = static_cast<int>(handlers.size()) - 1;
+    context.max_height = max_height;
+    context.halted = false;
+    context.result = -1;
+    vm.halted = false;
+    vm.stack.reserve(vm.stack.count + max_height + 1);
+    refresh(context);
+    const Handler* handler = context.handlers + (vm.pc >= 0 && vm.pc < context.end ? vm.pc : context.end);
+    while (handler) {
+        handler = handler->function(handler, context);
+    }
+    vm.back_edges_taken = context.back_edges_taken;
+    vm.calls_taken = context.calls_taken;
+    return context.halted ? context.result : -1;
+}
@@ -0,0 +1,64 @@
+#ifndef CLOSURE_COMPILER_H
+#define CLOSURE_COMPILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../include/Bytecode.h"
+
+class VM;
+
+/**
+ * @brief The closure-compiled tier: translates bytecode into an array of pre-bound handlers,
+ * in portable C++ and without executable memory.
+ *
+ * compile() turns each instruction into a Handler: a plain function (a captureless lambda)
+ * together with everything it needs resolved in advance. Stack operands become fixed slots
+ * relative to the frame, using the verified stack height of every instruction (see
+ * Verifier.h); constants are stored in the handler; jump targets and the next instruction
+ * are direct handler pointers. Running the program is then a loop of indirect calls, each
+ * returning the handler to run next, with no decoding, no per-instruction stack bounds
+ * checks and no stack pointer to maintain. Within a basic block a comparison followed by a
+ * conditional jump becomes one compare-and-branch handler, and an arithmetic instruction
+ * whose right operand is a constant takes it from the handler.
+ *
+ * Arithmetic, comparisons, jumps, loops, global and local variable access, calls, tail
+ * calls and returns have handlers. Every other instruction, and every rare case a handler
+ * does not cover (division by zero, a store that grows memory, call stack overflow), runs
+ * as one step of VM::execute, exactly as with the JIT, so output, error messages and
+ * back-edge counts are identical to the interpreter.
+ */
+class ClosureCompiler {
+public:
+    ClosureCompiler();
+    ~ClosureCompiler();
+
+    ClosureCompiler(const ClosureCompiler&) = delete;
+    ClosureCompiler& operator=(const ClosureCompiler&) = delete;
+
+    /**
+     * @brief Builds the handlers for a program.
+     * @param program The bytecode, which must outlive the handlers.
+     * @return False if the program's stack use cannot be verified (see JIT::compile).
+     */
+    bool compile(BytecodeView program);
+
+    /**
+     * @brief Runs the compiled program on a VM that VM::run has set up, starting at its pc.
+     * @return As VM::execute: the value on top of the stack at HALT, or -1 after an error was reported.
+     */
+    double run(VM& vm);
+
+private:
+    struct Context; // The run-time state handlers share (see ClosureCompiler.cpp)
+    struct Handler;
+    friend class HandlerBuilder;
+
+    std::vector<Handler> handlers; // One per instruction, plus one for running off the end
+    size_t max_height;             // Largest stack height of any instruction, relative to its frame
+
+    static const Handler* step(const Handler* handler, Context& context);
+    static void refresh(Context& context);
+};
+
+#endif // CLOSURE_COMPILER_H
@@ -0,0 +1,248 @@
+#include "../include/CoCompiler.h"
+#include <sstream>
+#include <stdexcept>
+#include "Compiler.h"
+#include "Lexer.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "VM.h"
+
+namespace cocompiler {
+
+Program::Program() : expression(false), native_table(nullptr), input_table(nullptr) {}
+
+const std::vector<Bytecode>& Program::bytecode() const {
+    static const std::vector<Bytecode> none;
+    return executable ? executable->getBytecode() : none;
+}
+
+const std::vector<std::string>& Program::strings() const {
+    static const std::vector<std::string> none;
+    return executable ? executable->getStringLiterals() : none;
+}
+
+uint32_t Program::globalCount() const {
+    return executable ? static_cast<uint32_t>(executable->getGlobalCount()) : 0;
+}
+
+Program compile(std::string_view source, const Options& options) {
+    Program program;
+    std::string text(source); // The lexer keeps a reference to its input
+    std::ostringstream errors;
+
+    ASTNode* ast = nullptr;
+    Compiler compiler;
+    std::vector<Bytecode> bytecode;
+    try {
+        Lexer lexer(text);
+        lexer.setErrorStream(errors);
+        std::vector<Token> tokens = lexer.tokenize();
+
+        Parser parser(tokens);
+        parser.setErrorStream(errors);
+        ast = parser.parse();
+
+        compiler.setErrorStream(errors);
+        compiler.setNatives(options.natives);
+        compiler.setInputs(options.inputs);
+        bytecode = compiler.compile(ast);
+    } catch (const std::exception& e) { // Errors reach the caller through Program::errors(), never as exceptions
+        errors << "Compiler Error: " << e.what() << std::endl;
+        bytecode.clear();
+    }
+
+    // Unlike the driver, which runs whatever the compiler produced, any reported error fails the script
+    program.error_text = errors.str();
+    if (!bytecode.empty() && program.error_text.empty()) {
+        OptimizedProgram optimized;
+        if (options.optimize && Optimizer().optimize(bytecode, optimized)) {
+            bytecode = std::move(optimized.bytecode);
+        }
+        program.executable = std::make_shared<const Executable>(std::move(bytecode), compiler.getStringLiterals(),
+                                                                 static_cast<size_t>(compiler.getGlobalCount()));
+        program.expression = dynamic_cast<Expression*>(ast) || dynamic_cast<AssignmentExpression*>(ast);
+        program.native_table = options.natives;
+        program.input_table = options.inputs;
+        if (options.inputs) {
+            for (size_t i = 0; i < options.inputs->size(); ++i) program.input_declarations.push_back((*options.inputs)[i]);
+        }
+    } else if (program.error_text.empty()) {
+        program.error_text = "Compiler Error: No instructions were generated.\n";
+    }
+    delete ast;
+    return program;
+}
+
+// Collects what a stream writes into a string whose buffer is kept from run to run
+class StringSink : public std::streambuf {
+public:
+    std::string text;
+
+protected:
+    int_type overflow(int_type c) override {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) text.push_back(traits_type::to_char_type(c));
+        return traits_type::not_eof(c);
+    }
+    std::streamsize xsputn(const char* data, std::streamsize count) override {
+        text.append(data, static_cast<size_t>(count));
+        return count;
+    }
+};
+
+struct ExecutionContext::State {
+    VM vm;
+    Program stepped; // The program begin() started, kept alive until its run is over
+    StringSink output_sink;
+    StringSink error_sink;
+    std::ostream output{&output_sink};
+    std::ostream errors{&error_sink};
+};
+
+ExecutionContext::ExecutionContext() : state(new State()) {}
+
+ExecutionContext::~ExecutionContext() = default;
+
+Result ExecutionContext::run(const Program& program, const Inputs& inputs) {
+    Result result;
+    run(program, inputs, result);
+    return result;
+}
+
+bool ExecutionContext::run(const Program& program, const Inputs& inputs, Result& result) {
+    if (!prepare(program, inputs, result)) return false;
+    finish(state->vm.run(*program.executable), result);
+    return result.ok;
+}
+
+bool ExecutionContext::begin(const Program& program, const Inputs& inputs, Result& result) {
+    if (!prepare(program, inputs, result)) return false;
+    state->stepped = program;
+    state->vm.begin(*program.executable);
+    return true;
+}
+
+bool ExecutionContext::step(uint64_t fuel, Result& result) {
+    if (!state->stepped.ok()) {
+        result.ok = false;
+        result.value = -1;
+        result.errors = "VM Error: No run was started with begin().\n";
+        return true;
+    }
+    double value;
+    if (state->vm.step(fuel, value) == StepStatus::PAUSED) return false;
+    finish(value, result);
+    state->stepped = Program();
+    return true;
+}
+
+bool ExecutionContext::prepare(const Program& program, const Inputs& inputs, Result& result) {
+    result.ok = false;
+    result.output.clear();
+    if (state->stepped.ok()) state->stepped = Program(); // A new run abandons one begin() started
+    if (!program.ok()) {
+        result.value = -1;
+        result.error = RunError::RUNTIME;
+        result.errors = program.errors();
+        return false;
+    }
+
+    // The bindings must give every input the kind it was compiled with
+    const HostBindings* bindings = inputs.bindings ? inputs.bindings : program.inputs();
+    for (size_t i = 0; i < program.input_declarations.size(); ++i) {
+        const HostValue& declared = program.input_declarations[i];
+        if (!bindings || i >= bindings->size() || (*bindings)[i].name != declared.name || (*bindings)[i].kind != declared.kind) {
+            result.value = -1;
+            result.error = RunError::RUNTIME;
+            result.errors = "VM Error: Host input '" + declared.name + "' is not bound as it was at compile time.\n";
+            return false;
+        }
+    }
+
+    VM& vm = state->vm;
+    vm.setTrace(false);
+    vm.setJit(inputs.jit);
+    vm.setClosures(inputs.closures);
+    vm.setTierUpThreshold(inputs.tier_up_threshold);
+    vm.setMaxFrames(inputs.max_frames);
+    vm.setBackEdgeBudget(inputs.back_edge_budget);
+    vm.setInstructionBudget(inputs.instruction_budget);
+    vm.setDeadline(inputs.deadline_ms);
+    vm.setMaxStringBytes(inputs.max_string_bytes);
+    vm.setOutputStream(inputs.output ? *inputs.output : state->output);
+    vm.setErrorStream(state->errors);
+    if (program.natives()) vm.setNatives(*program.natives());
+    vm.setInputs(bindings);
+    return true;
+}
+
+void ExecutionContext::finish(double value, Result& result) {
+    result.value = value;
+
+    // The result takes the text and leaves its old buffers for the next run, grown to match
+    result.output.swap(state->output_sink.text);
+    result.errors.swap(state->error_sink.text);
+    state->output_sink.text.clear();
+    state->output_sink.text.reserve(result.output.capacity());
+    state->error_sink.text.clear();
+    state->error_sink.text.reserve(result.errors.capacity());
+    result.ok = result.errors.empty();
+    result.error = result.ok ? RunError::NONE
+                 : state->vm.getRunError() != RunError::NONE ? state->vm.getRunError() : RunError::RUNTIME;
+}
+
+ContextPool::ContextPool(size_t size) : created(size) {
+    idle.reserve(size);
+    for (size_t i = 0; i < size; ++i) idle.emplace_back(new ExecutionContext());
+}
+
+ContextPool::~ContextPool() = default;
+
+void ContextPool::warm(const Program& program, const Inputs& inputs) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Result result;
+    for (const std::unique_ptr<ExecutionContext>& context : idle) context->run(program, inputs, result);
+}
+
+Result ContextPool::run(const Program& program, const Inputs& inputs) {
+    Result result;
+    run(program, inputs, result);
+    return result;
+}
+
+bool ContextPool::run(const Program& program, const Inputs& inputs, Result& result) {
+    std::unique_ptr<ExecutionContext> context = acquire();
+    bool ok = context->run(program, inputs, result);
+    release(std::move(context));
+    return ok;
+}
+
+size_t ContextPool::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return created;
+}
+
+std::unique_ptr<ExecutionContext> ContextPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!idle.empty()) {
+            std::unique_ptr<ExecutionContext> context = std::move(idle.back());
+            idle.pop_back();
+            return context;
+        }
+        created++;
+        idle.reserve(created); // So that release() never allocates
+    }
+    return std::unique_ptr<ExecutionContext>(new ExecutionContext()); // All busy: the pool grows
+}
+
+void ContextPool::release(std::unique_ptr<ExecutionContext> context) {
+    std::lock_guard<std::mutex> lock(mutex);
+    idle.push_back(std::move(context));
+}
+
+Result run(const Program& program, const Inputs& inputs) {
+    ExecutionContext context;
+    return context.run(program, inputs);
+}
+
+} // namespace cocompiler
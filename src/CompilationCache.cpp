@@ -0,0 +1,124 @@
+#include "CompilationCache.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include "Compiler.h"
+
+static const char* kEntrySuffix = ".cocb";
+
+// 128-bit FNV-1a, kept as two 64-bit halves so it needs no compiler-specific integer type
+struct Fnv128 {
+    uint64_t high = 0x6c62272e07bb0142ULL;
+    uint64_t low = 0x62b821756295c58dULL;
+
+    void add(const std::string& text) {
+        for (unsigned char c : text) {
+            low ^= c;
+            // Multiply by the FNV prime 2^88 + 0x13B, modulo 2^128
+            uint64_t lowLow = (low & 0xffffffffULL) * 0x13B;
+            uint64_t lowHigh = (low >> 32) * 0x13B;
+            uint64_t product = lowLow + (lowHigh << 32);
+            uint64_t carry = (lowHigh >> 32) + (product < lowLow ? 1 : 0);
+            high = high * 0x13B + carry + (low << 24);
+            low = product;
+        }
+    }
+
+    // Adds a field together with its length, so that consecutive fields cannot run into each other
+    void addField(const std::string& text) {
+        add(std::to_string(text.size()) + ":");
+        add(text);
+    }
+};
+
+// Creates a directory and any missing parents; true if it exists afterwards
+static bool makeDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string prefix = path.substr(0, slash);
+        if (!prefix.empty() && mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+        if (slash == std::string::npos) break;
+    }
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+CompilationCache::CompilationCache(const std::string& directory, uint64_t max_bytes)
+    : directory(directory), max_bytes(max_bytes), hits(0), misses(0), stores(0), evictions(0) {
+    if (!makeDirectories(directory)) {
+        std::cerr << "Cache Error: Could not create cache directory '" << directory << "'" << std::endl;
+    }
+}
+
+std::string CompilationCache::key(const std::string& source, const std::string& options) {
+    Fnv128 hash;
+    hash.addField(Compiler::kVersion);
+    hash.addField(std::to_string(BytecodeImage::kVersion));
+    hash.addField(options);
+    hash.addField(source);
+    static const char digits[] = "0123456789abcdef";
+    std::string text;
+    for (uint64_t half : {hash.high, hash.low}) {
+        for (int shift = 60; shift >= 0; shift -= 4) text += digits[(half >> shift) & 0xf];
+    }
+    return text;
+}
+
+std::string CompilationCache::pathOf(const std::string& key) const {
+    return directory + "/" + key + kEntrySuffix;
+}
+
+bool CompilationCache::lookup(const std::string& key, BytecodeImage& image) {
+    std::string path = pathOf(key);
+    if (access(path.c_str(), R_OK) != 0 || !image.load(path)) {
+        ++misses;
+        return false;
+    }
+    utimensat(AT_FDCWD, path.c_str(), nullptr, 0); // Now the most recently used entry
+    ++hits;
+    return true;
+}
+
+bool CompilationCache::store(const std::string& key, const std::vector<Bytecode>& bytecode,
+                             const std::vector<std::string>& string_literals, uint32_t global_count, uint32_t flags) {
+    if (!BytecodeImage::write(pathOf(key), bytecode, string_literals, global_count, flags)) return false;
+    ++stores;
+    evict();
+    return true;
+}
+
+void CompilationCache::evict() {
+    struct Entry {
+        std::string path;
+        uint64_t size;
+        struct timespec used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    DIR* listing = opendir(directory.c_str());
+    if (!listing) return;
+    size_t suffixLength = std::char_traits<char>::length(kEntrySuffix);
+    while (struct dirent* item = readdir(listing)) {
+        std::string name = item->d_name;
+        if (name.size() <= suffixLength || name.compare(name.size() - suffixLength, suffixLength, kEntrySuffix) != 0) continue;
+        std::string path = directory + "/" + name;
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+        entries.push_back({path, static_cast<uint64_t>(info.st_size), info.st_mtim});
+        total += static_cast<uint64_t>(info.st_size);
+    }
+    closedir(listing);
+    if (total <= max_bytes) return;
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec : a.used.tv_nsec < b.used.tv_nsec;
+    });
+    for (const Entry& entry : entries) {
+        if (total <= max_bytes) break;
+        if (unlink(entry.path.c_str()) == 0) ++evictions; // Another process may have evicted it already
+        total -= entry.size;
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef COMPILATION_CACHE_H
+#define COMPILATION_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../include/Bytecode.h"
+#include "BytecodeImage.h"
+
+/**
+ * @brief An on-disk cache of compiled programs, addressed by the content they were compiled from.
+ *
+ * Each entry is a bytecode image (see BytecodeImage.h) named after a 128-bit FNV-1a hash of
+ * the source, the compiler and image versions, and the options that affect compilation, so a
+ * change to any of them is a different entry and entries never need invalidating. Entries are
+ * written under a temporary name and renamed into place, so concurrent processes sharing a
+ * directory only ever see whole entries.
+ *
+ * The directory is bounded in size: after each store, the least recently used entries (by
+ * modification time, which a hit refreshes) are removed until the entries fit. Hits, misses,
+ * stores and evictions are counted per cache object.
+ */
+class CompilationCache {
+public:
+    /**
+     * @param directory Where entries live; created if missing.
+     * @param max_bytes The total size of entries to keep.
+     */
+    CompilationCache(const std::string& directory, uint64_t max_bytes);
+
+    /**
+     * @brief The key of a program.
+     * @param source The program's source code.
+     * @param options The options that affect how it compiles, in a fixed form.
+     */
+    static std::string key(const std::string& source, const std::string& options);
+
+    /**
+     * @brief Loads the entry for a key, if there is one, and marks it as recently used.
+     * @return True on a hit; false (counted as a miss) if there is no valid entry.
+     */
+    bool lookup(const std::string& key, BytecodeImage& image);
+
+    /**
+     * @brief Saves a compiled program under a key (as BytecodeImage::write), then evicts entries over the size bound.
+     * @return False (after reporting on std::cerr) if the entry could not be written.
+     */
+    bool store(const std::string& key, const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals,
+               uint32_t global_count, uint32_t flags);
+
+    uint64_t getHits() const { return hits; }
+    uint64_t getMisses() const { return misses; }
+    uint64_t getStores() const { return stores; }
+    uint64_t getEvictions() const { return evictions; }
+
+private:
+    std::string directory;
+    uint64_t max_bytes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+
+    std::string pathOf(const std::string& key) const;
+    void evict();
+};
+
+#endif // COMPILATION_CACHE_H
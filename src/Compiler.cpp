@@ -1,5 +1,7 @@
 #include "Compiler.h"
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
 #include "../include/Tokens.h"
 #include "../include/Bytecode.h"
 #include "../include/AST.h"
@@ -9,7 +11,7 @@
  * @brief Constructs a new Compiler object.
  * Initializes the symbol table with a global scope.
  */
-Compiler::Compiler() : symbolTable() {
+Compiler::Compiler() : symbolTable(), inline_depth(0), parallel_loop(nullptr), errors(&std::cerr), natives(nullptr), inputs(nullptr), session_scope(false) {
     // The symbolTable is initialized in the member initializer list,
     // which automatically calls its constructor and enters the global scope.
 }
@@ -23,10 +25,29 @@ Compiler::Compiler() : symbolTable() {
  */
 std::vector<Bytecode> Compiler::compile(ASTNode* ast) {
     bytecode.clear();
+    functions.clear();
+    call_sites.clear();
+    declarations.clear();
+    inline_depth = 0;
+    current_function.clear();
+    parallel_loop = nullptr;
+    parallel_calls.clear();
+
+    // The inliner needs the whole call graph, including functions declared after a call
+    collectDeclarations(ast);
 
     // Enter the global scope for compilation
     symbolTable.enterScope();
 
+    // Host inputs come first, so input i is global i (see HostBindings.h)
+    for (size_t i = 0; inputs && i < inputs->size(); ++i) {
+        const HostValue& input = (*inputs)[i];
+        ASTNode::Type type = input.kind == HostValue::Kind::NUMBER ? ASTNode::Type::NUMBER
+                             : input.kind == HostValue::Kind::STRING ? ASTNode::Type::STRING_LITERAL
+                             : ASTNode::Type::ARRAY;
+        symbolTable.addSymbol(input.name, type);
+    }
+
     compileNode(ast);
 
     // Exit the global scope after compilation
@@ -36,10 +57,171 @@ std::vector<Bytecode> Compiler::compile(ASTNode* ast) {
         return {}; // Return empty vector if compilation failed or no bytecode was generated
     }
 
+    // Calls may precede their function's declaration (or be recursive), so targets are filled in last
+    if (!patchCalls() || !checkParallelCalls()) {
+        return {};
+    }
+
     bytecode.push_back(Bytecode(Instruction::HALT));
     return bytecode;
 }
 
+std::vector<Bytecode> Compiler::compileIncremental(const std::vector<ASTNode*>& statements, int base) {
+    bytecode.clear();
+    call_sites.clear();
+    new_declarations.clear();
+    inline_depth = 0;
+    current_function.clear();
+    parallel_loop = nullptr;
+    parallel_calls.clear();
+
+    if (!session_scope) {
+        symbolTable.enterScope(); // The global scope every piece declares into
+        session_scope = true;
+    }
+    SymbolTable::Checkpoint checkpoint = symbolTable.checkpoint();
+    size_t literalCount = string_literals.size();
+
+    for (ASTNode* statement : statements) {
+        collectDeclarations(statement);
+    }
+    if (statements.size() == 1) {
+        compileNode(statements[0]); // A lone expression's value is the piece's result, as in compile()
+    } else {
+        for (ASTNode* statement : statements) {
+            compileStatement(statement);
+            if (bytecode.empty()) break;
+        }
+    }
+
+    bool compiled = !bytecode.empty();
+    if (compiled) {
+        // Move the piece to its place after the program; calls are patched with final entries below
+        for (Bytecode& instruction : bytecode) {
+            switch (instruction.instruction) {
+                case Instruction::JUMP: case Instruction::JUMP_IF_FALSE: case Instruction::JUMP_IF_TRUE:
+                case Instruction::LOOP_INC_CMP_JUMP: case Instruction::LOOP_INC_CMP_JUMP_LOCAL:
+                case Instruction::PARALLEL_FOR:
+                    instruction.operand += base;
+                    break;
+                default:
+                    break;
+            }
+        }
+        for (const std::string& name : new_declarations) {
+            auto function = functions.find(name);
+            if (function != functions.end()) function->second.entry += base;
+        }
+        compiled = patchCalls() && checkParallelCalls();
+    }
+    if (!compiled) {
+        symbolTable.restore(checkpoint);
+        string_literals.resize(literalCount);
+        for (const std::string& name : new_declarations) {
+            functions.erase(name);
+            declarations.erase(name);
+        }
+        return {};
+    }
+
+    bytecode.push_back(Bytecode(Instruction::HALT));
+    return bytecode;
+}
+
+/**
+ * @brief Checks whether a type can be used as a number.
+ * NUMBER (function parameters and call results) is dynamically typed and accepted wherever
+ * an INTEGER or FLOAT is.
+ */
+static bool isNumericType(ASTNode::Type type) {
+    return type == ASTNode::Type::INTEGER || type == ASTNode::Type::FLOAT || type == ASTNode::Type::NUMBER;
+}
+
+/**
+ * @brief Checks whether a type can be used where an array is expected.
+ * NUMBER values may hold array handles (e.g. a function parameter), so they are checked at runtime.
+ */
+static bool isArrayType(ASTNode::Type type) {
+    return type == ASTNode::Type::ARRAY || type == ASTNode::Type::NUMBER;
+}
+
+/**
+ * @brief Returns a type's name for error messages.
+ */
+static const char* typeName(ASTNode::Type type) {
+    switch (type) {
+        case ASTNode::Type::INTEGER: return "INTEGER";
+        case ASTNode::Type::FLOAT: return "FLOAT";
+        case ASTNode::Type::STRING_LITERAL: return "STRING";
+        case ASTNode::Type::NUMBER: return "NUMBER";
+        case ASTNode::Type::ARRAY: return "ARRAY";
+        case ASTNode::Type::MAP: return "MAP";
+        default: return "BOOLEAN";
+    }
+}
+
+/**
+ * @brief What a builtin accepts in an argument position.
+ */
+enum class ArgKind {
+    LENGTH,          // A number (an array length)
+    ARRAY,           // An array
+    ARRAY_OR_SCALAR, // An array, or a number applied to every element
+    COLLECTION,      // An array or a map
+    MAP,             // A map
+    KEY              // A map key: a string or an integer
+};
+
+/**
+ * @brief Describes a builtin function callable like a user-defined one.
+ */
+struct BuiltinInfo {
+    const char* name;
+    Builtin id;
+    int arity;
+    ASTNode::Type result; // ARRAY, MAP or NUMBER
+    ArgKind args[2];
+};
+
+static const BuiltinInfo kBuiltins[] = {
+    {"array", Builtin::ARRAY, 1, ASTNode::Type::ARRAY, {ArgKind::LENGTH}},
+    {"range", Builtin::RANGE, 1, ASTNode::Type::ARRAY, {ArgKind::LENGTH}},
+    {"len", Builtin::LEN, 1, ASTNode::Type::NUMBER, {ArgKind::COLLECTION}},
+    {"sum", Builtin::SUM, 1, ASTNode::Type::NUMBER, {ArgKind::ARRAY}},
+    {"min", Builtin::MIN, 1, ASTNode::Type::NUMBER, {ArgKind::ARRAY}},
+    {"max", Builtin::MAX, 1, ASTNode::Type::NUMBER, {ArgKind::ARRAY}},
+    {"dot", Builtin::DOT, 2, ASTNode::Type::NUMBER, {ArgKind::ARRAY, ArgKind::ARRAY}},
+    {"add", Builtin::ADD, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY_OR_SCALAR}},
+    {"mul", Builtin::MUL, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY_OR_SCALAR}},
+    {"lt", Builtin::LT, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY_OR_SCALAR}},
+    {"gt", Builtin::GT, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY_OR_SCALAR}},
+    {"eq", Builtin::EQ, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY_OR_SCALAR}},
+    {"map", Builtin::MAP, 0, ASTNode::Type::MAP, {}},
+    {"has", Builtin::HAS, 2, ASTNode::Type::NUMBER, {ArgKind::MAP, ArgKind::KEY}},
+    {"delete", Builtin::DELETE, 2, ASTNode::Type::NUMBER, {ArgKind::MAP, ArgKind::KEY}},
+    {"sort", Builtin::SORT, 1, ASTNode::Type::ARRAY, {ArgKind::ARRAY}},
+    {"scan", Builtin::SCAN, 1, ASTNode::Type::ARRAY, {ArgKind::ARRAY}},
+    {"filter", Builtin::FILTER, 2, ASTNode::Type::ARRAY, {ArgKind::ARRAY, ArgKind::ARRAY}},
+};
+
+/**
+ * @brief Looks up a builtin function by name.
+ * @return The builtin, or nullptr if the name is not a builtin.
+ */
+static const BuiltinInfo* findBuiltin(const std::string& name) {
+    for (const BuiltinInfo& builtin : kBuiltins) {
+        if (name == builtin.name) return &builtin;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Checks whether a type can be used as an operand of '&&' or '||'.
+ */
+static bool isLogicalType(ASTNode::Type type) {
+    return type == ASTNode::Type::BOOLEAN_LITERAL || type == ASTNode::Type::INTEGER || type == ASTNode::Type::NUMBER;
+}
+
 /**
  * @brief Helper function to determine the type of a literal.
  *
@@ -75,10 +257,18 @@ void Compiler::compileNode(ASTNode* node) {
     if (Literal* literal = dynamic_cast<Literal*>(node)) {
         Token token = literal->getToken();
         if (token.type == TokenType::INT_LITERAL) {
-            int value = std::stoi(token.value);
+            int value;
+            if (!literalValue(token, value)) {
+                bytecode.clear();
+                return;
+            }
             bytecode.push_back(Bytecode(Instruction::PUSH_INT, value));
         } else if (token.type == TokenType::FLOAT_LITERAL) {
-            float value = std::stof(token.value);
+            float value;
+            if (!literalValue(token, value)) {
+                bytecode.clear();
+                return;
+            }
             // Pass float value directly to Bytecode constructor, which now handles double operand
             bytecode.push_back(Bytecode(Instruction::PUSH_FLOAT, value));
         } else if (token.type == TokenType::STRING_LITERAL) {
@@ -106,25 +296,24 @@ void Compiler::compileNode(ASTNode* node) {
         Token identifier_token = identExpr->getIdentifier();
         Symbol* symbol = symbolTable.lookupSymbol(identifier_token.value);
         if (!symbol) {
-            std::cerr << "Compiler Error: Undeclared variable '" << identifier_token.value
-                      << "' at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
+            *errors << "Compiler Error: Undeclared variable '" << identifier_token.value
+                    << "' at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
             bytecode.clear(); // Indicate compilation failure
             return;
         }
-        // Push the address of the variable onto the stack, then load its value
-        bytecode.push_back(Bytecode(Instruction::PUSH_INT, symbol->address));
-        bytecode.push_back(Bytecode(Instruction::LOAD));
+        emitLoad(symbol);
     }
     // Compile AssignmentExpression node (variable assignment)
     else if (AssignmentExpression* assignExpr = dynamic_cast<AssignmentExpression*>(node)) {
         Token identifier_token = assignExpr->getIdentifier();
         Symbol* symbol = symbolTable.lookupSymbol(identifier_token.value);
         if (!symbol) {
-            std::cerr << "Compiler Error: Assignment to undeclared variable '" << identifier_token.value
-                      << "' at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
+            *errors << "Compiler Error: Assignment to undeclared variable '" << identifier_token.value
+                    << "' at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
             bytecode.clear(); // Indicate compilation failure
             return;
         }
+        if (!checkVariableWrite(symbol, identifier_token)) return;
 
         // Compile the right-hand side expression
         compileNode(assignExpr->getValue());
@@ -133,15 +322,11 @@ void Compiler::compileNode(ASTNode* node) {
         // Type checking for assignment (basic)
         // Resolve the actual type of the right-hand side expression
         ASTNode::Type assignedType = resolveExpressionType(assignExpr->getValue());
-        if (symbol->type != ASTNode::Type::UNKNOWN && assignedType != ASTNode::Type::UNKNOWN && symbol->type != assignedType) {
-            std::cerr << "Compiler Error: Type mismatch in assignment for variable '" << identifier_token.value
-                      << "'. Expected " << (symbol->type == ASTNode::Type::INTEGER ? "INTEGER" :
-                                            (symbol->type == ASTNode::Type::FLOAT ? "FLOAT" :
-                                             (symbol->type == ASTNode::Type::STRING_LITERAL ? "STRING" : "BOOLEAN")))
-                      << ", got " << (assignedType == ASTNode::Type::INTEGER ? "INTEGER" :
-                                      (assignedType == ASTNode::Type::FLOAT ? "FLOAT" :
-                                       (assignedType == ASTNode::Type::STRING_LITERAL ? "STRING" : "BOOLEAN")))
-                      << " at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
+        if (symbol->type != ASTNode::Type::UNKNOWN && assignedType != ASTNode::Type::UNKNOWN &&
+            symbol->type != ASTNode::Type::NUMBER && assignedType != ASTNode::Type::NUMBER && symbol->type != assignedType) {
+            *errors << "Compiler Error: Type mismatch in assignment for variable '" << identifier_token.value
+                    << "'. Expected " << typeName(symbol->type) << ", got " << typeName(assignedType)
+                    << " at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
             bytecode.clear(); // Indicate compilation failure
             return;
         }
@@ -150,9 +335,79 @@ void Compiler::compileNode(ASTNode* node) {
             symbol->type = assignedType;
         }
 
-        // Push the address of the variable onto the stack, then store the value
-        bytecode.push_back(Bytecode(Instruction::PUSH_INT, symbol->address));
-        bytecode.push_back(Bytecode(Instruction::STORE));
+        emitStore(symbol);
+    }
+    // Compile ArrayLiteral node
+    else if (ArrayLiteral* arrayLiteral = dynamic_cast<ArrayLiteral*>(node)) {
+        if (!noteSharedEffect("create arrays or maps", arrayLiteral->getBracket())) return;
+        for (Expression* element : arrayLiteral->getElements()) {
+            if (!isNumericType(resolveExpressionType(element))) {
+                Token bracket = arrayLiteral->getBracket();
+                *errors << "Compiler Error: Array elements must be numeric at L" << bracket.line << ":C" << bracket.column << std::endl;
+                bytecode.clear();
+                return;
+            }
+            compileNode(element);
+            if (bytecode.empty()) return; // Propagate error
+        }
+        bytecode.push_back(Bytecode(Instruction::NEW_ARRAY, static_cast<int>(arrayLiteral->getElements().size())));
+    }
+    // Compile IndexExpression node (array element read)
+    else if (IndexExpression* indexExpr = dynamic_cast<IndexExpression*>(node)) {
+        Token bracket = indexExpr->getBracket();
+        if (resolveExpressionType(indexExpr->getArray()) == ASTNode::Type::MAP) {
+            compileMapAccess(indexExpr, nullptr);
+            return;
+        }
+        if (!isArrayType(resolveExpressionType(indexExpr->getArray())) || !isNumericType(resolveExpressionType(indexExpr->getIndex()))) {
+            *errors << "Compiler Error: Indexing requires an array and a numeric index at L" << bracket.line << ":C" << bracket.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        compileNode(indexExpr->getArray());
+        if (bytecode.empty()) return; // Propagate error
+        compileNode(indexExpr->getIndex());
+        if (bytecode.empty()) return; // Propagate error
+        bytecode.push_back(Bytecode(Instruction::ARRAY_GET));
+    }
+    // Compile IndexAssignmentExpression node (array element write)
+    else if (IndexAssignmentExpression* indexAssign = dynamic_cast<IndexAssignmentExpression*>(node)) {
+        IndexExpression* target = indexAssign->getTarget();
+        Token bracket = target->getBracket();
+        if (resolveExpressionType(target->getArray()) == ASTNode::Type::MAP) {
+            compileMapAccess(target, indexAssign->getValue());
+            return;
+        }
+        if (!isArrayType(resolveExpressionType(target->getArray())) || !isNumericType(resolveExpressionType(target->getIndex()))) {
+            *errors << "Compiler Error: Indexing requires an array and a numeric index at L" << bracket.line << ":C" << bracket.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (IdentifierExpression* arrayName = dynamic_cast<IdentifierExpression*>(target->getArray())) {
+            if (isHostInput(symbolTable.lookupSymbol(arrayName->getIdentifier().value))) {
+                *errors << "Compiler Error: Cannot store into host array '" << arrayName->getIdentifier().value
+                        << "' at L" << bracket.line << ":C" << bracket.column << std::endl;
+                bytecode.clear();
+                return;
+            }
+        }
+        if (!isNumericType(resolveExpressionType(indexAssign->getValue()))) {
+            *errors << "Compiler Error: Array elements must be numeric at L" << bracket.line << ":C" << bracket.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        // Each iteration of a parallel for owns element i, so a[i] with the loop variable is race-free
+        if (!(parallel_loop && isLoopVariable(target->getIndex())) &&
+            !noteSharedEffect("write array elements other than a[i] for the loop variable i", bracket)) {
+            return;
+        }
+        compileNode(target->getArray());
+        if (bytecode.empty()) return; // Propagate error
+        compileNode(target->getIndex());
+        if (bytecode.empty()) return; // Propagate error
+        compileNode(indexAssign->getValue());
+        if (bytecode.empty()) return; // Propagate error
+        bytecode.push_back(Bytecode(Instruction::ARRAY_SET));
     }
     // Compile BinaryExpression node
     else if (BinaryExpression* binaryExpr = dynamic_cast<BinaryExpression*>(node)) {
@@ -177,9 +432,8 @@ void Compiler::compileNode(ASTNode* node) {
 
         // Handle logical operators (AND, OR)
         if (op.type == TokenType::AND) {
-            if (!((leftType == ASTNode::Type::BOOLEAN_LITERAL || leftType == ASTNode::Type::INTEGER) &&
-                  (rightType == ASTNode::Type::BOOLEAN_LITERAL || rightType == ASTNode::Type::INTEGER))) {
-                std::cerr << "Compiler Error: Logical operator '&&' requires boolean or integer operands." << std::endl;
+            if (!(isLogicalType(leftType) && isLogicalType(rightType))) {
+                *errors << "Compiler Error: Logical operator '&&' requires boolean or integer operands." << std::endl;
                 bytecode.clear();
                 return;
             }
@@ -211,9 +465,8 @@ void Compiler::compileNode(ASTNode* node) {
             bytecode[jumpToEnd_idx].operand = static_cast<int>(bytecode.size());
 
         } else if (op.type == TokenType::OR) {
-            if (!((leftType == ASTNode::Type::BOOLEAN_LITERAL || leftType == ASTNode::Type::INTEGER) &&
-                  (rightType == ASTNode::Type::BOOLEAN_LITERAL || rightType == ASTNode::Type::INTEGER))) {
-                std::cerr << "Compiler Error: Logical operator '||' requires boolean or integer operands." << std::endl;
+            if (!(isLogicalType(leftType) && isLogicalType(rightType))) {
+                *errors << "Compiler Error: Logical operator '||' requires boolean or integer operands." << std::endl;
                 bytecode.clear();
                 return;
             }
@@ -248,6 +501,7 @@ void Compiler::compileNode(ASTNode* node) {
             // --- NEW IMPLEMENTATION (v2) ---
             // Handle string concatenation using resolved types
             if (leftType == ASTNode::Type::STRING_LITERAL && rightType == ASTNode::Type::STRING_LITERAL) {
+                if (!noteSharedEffect("concatenate strings", op)) return;
                 compileNode(left);
                 if (bytecode.empty()) return;
                 compileNode(right);
@@ -256,23 +510,21 @@ void Compiler::compileNode(ASTNode* node) {
             }
             // --- END NEW IMPLEMENTATION (v2) ---
             // Handle numeric addition
-            else if ((leftType == ASTNode::Type::INTEGER || leftType == ASTNode::Type::FLOAT) &&
-                     (rightType == ASTNode::Type::INTEGER || rightType == ASTNode::Type::FLOAT)) {
+            else if (isNumericType(leftType) && isNumericType(rightType)) {
                 compileNode(left);
                 if (bytecode.empty()) return;
                 compileNode(right);
                 if (bytecode.empty()) return;
                 bytecode.push_back(Bytecode(Instruction::ADD));
             } else {
-                std::cerr << "Compiler Error: Operator '+' requires two numeric operands or two string operands for concatenation." << std::endl;
+                *errors << "Compiler Error: Operator '+' requires two numeric operands or two string operands for concatenation." << std::endl;
                 bytecode.clear();
                 return;
             }
         } else if (op.type == TokenType::MINUS || op.type == TokenType::STAR || op.type == TokenType::SLASH) {
             // Handle numeric arithmetic operators
-            if (!((leftType == ASTNode::Type::INTEGER || leftType == ASTNode::Type::FLOAT) &&
-                  (rightType == ASTNode::Type::INTEGER || rightType == ASTNode::Type::FLOAT))) {
-                std::cerr << "Compiler Error: Arithmetic operator '" << op.value << "' requires numeric operands." << std::endl;
+            if (!(isNumericType(leftType) && isNumericType(rightType))) {
+                *errors << "Compiler Error: Arithmetic operator '" << op.value << "' requires numeric operands." << std::endl;
                 bytecode.clear();
                 return;
             }
@@ -292,9 +544,8 @@ void Compiler::compileNode(ASTNode* node) {
                    op.type == TokenType::GREATER_EQUAL || op.type == TokenType::LESS_EQUAL ||
                    op.type == TokenType::EQUAL_EQUAL || op.type == TokenType::BANG_EQUAL) {
             // Handle comparison operators
-            if (!((leftType == ASTNode::Type::INTEGER || leftType == ASTNode::Type::FLOAT) &&
-                  (rightType == ASTNode::Type::INTEGER || rightType == ASTNode::Type::FLOAT))) {
-                std::cerr << "Compiler Error: Comparison operator '" << op.value << "' requires numeric operands." << std::endl;
+            if (!(isNumericType(leftType) && isNumericType(rightType))) {
+                *errors << "Compiler Error: Comparison operator '" << op.value << "' requires numeric operands." << std::endl;
                 bytecode.clear();
                 return;
             }
@@ -317,7 +568,7 @@ void Compiler::compileNode(ASTNode* node) {
                 bytecode.push_back(Bytecode(Instruction::BANG_EQUAL));
             }
         } else {
-            std::cerr << "Compiler Error: Unknown binary operator '" << op.value << "'." << std::endl;
+            *errors << "Compiler Error: Unknown binary operator '" << op.value << "'." << std::endl;
             bytecode.clear();
             return;
         }
@@ -333,7 +584,7 @@ void Compiler::compileNode(ASTNode* node) {
         } else if (op.type == TokenType::MINUS) {
             bytecode.push_back(Bytecode(Instruction::NEGATE)); // Emit NEGATE instruction
         } else {
-            std::cerr << "Compiler Error: Unknown unary operator." << std::endl;
+            *errors << "Compiler Error: Unknown unary operator." << std::endl;
             bytecode.clear(); // Indicate compilation failure
             return;
         }
@@ -347,14 +598,18 @@ void Compiler::compileNode(ASTNode* node) {
         ASTNode::Type varType = ASTNode::Type::UNKNOWN;
         if (initializer) {
             varType = initializer->getType();
-            if (varType == ASTNode::Type::IDENTIFIER_EXPRESSION) {
+            if (varType != ASTNode::Type::IDENTIFIER_EXPRESSION) {
+                // Operands are looked up in the symbol table, so `a * b` of NUMBER parameters is NUMBER,
+                // and builtins have static result types (e.g. ARRAY)
+                varType = resolveExpressionType(initializer);
+            } else {
                 // If initializer is an identifier, look up its type
                 Symbol* initSymbol = symbolTable.lookupSymbol(dynamic_cast<IdentifierExpression*>(initializer)->getIdentifier().value);
                 if (initSymbol) {
                     varType = initSymbol->type;
                 } else {
-                    std::cerr << "Compiler Error: Initializer for variable '" << identifier_token.value
-                              << "' is an undeclared variable at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
+                    *errors << "Compiler Error: Initializer for variable '" << identifier_token.value
+                            << "' is an undeclared variable at L" << identifier_token.line << ":C" << identifier_token.column << std::endl;
                     bytecode.clear(); // Indicate compilation failure
                     return;
                 }
@@ -379,12 +634,11 @@ void Compiler::compileNode(ASTNode* node) {
             // Get the address of the newly added symbol
             Symbol* symbol = symbolTable.lookupSymbol(identifier_token.value);
             if (!symbol) { // Should not happen if addSymbol was successful
-                std::cerr << "Internal Compiler Error: Symbol not found after adding it." << std::endl;
+                *errors << "Internal Compiler Error: Symbol not found after adding it." << std::endl;
                 bytecode.clear();
                 return;
             }
-            bytecode.push_back(Bytecode(Instruction::PUSH_INT, symbol->address));
-            bytecode.push_back(Bytecode(Instruction::STORE));
+            emitStore(symbol);
         }
     }
     // Compile BlockStatement node
@@ -392,7 +646,7 @@ void Compiler::compileNode(ASTNode* node) {
         // Enter a new scope for the block
         symbolTable.enterScope();
         for (ASTNode* stmt : blockStmt->getStatements()) {
-            compileNode(stmt);
+            compileStatement(stmt);
             if (bytecode.empty()) return; // Propagate error
         }
         // Exit the scope after compiling the block
@@ -431,9 +685,169 @@ void Compiler::compileNode(ASTNode* node) {
             bytecode[jumpToEndAddress].operand = static_cast<int>(bytecode.size());
         }
     }
+    // Compile WhileStatement node
+    else if (WhileStatement* whileStmt = dynamic_cast<WhileStatement*>(node)) {
+        // loop_start: condition; JUMP_IF_FALSE end; body; JUMP loop_start; end:
+        int loopStartAddress = static_cast<int>(bytecode.size());
+        compileNode(whileStmt->getCondition());
+        if (bytecode.empty()) return; // Propagate error
+
+        int jumpIfFalseAddress = static_cast<int>(bytecode.size());
+        bytecode.push_back(Bytecode(Instruction::JUMP_IF_FALSE, 0)); // Placeholder address
+
+        compileNode(whileStmt->getBody());
+        if (bytecode.empty()) return; // Propagate error
+
+        // Backward jump: the VM treats it as a loop back-edge
+        bytecode.push_back(Bytecode(Instruction::JUMP, loopStartAddress));
+        bytecode[jumpIfFalseAddress].operand = static_cast<int>(bytecode.size());
+    }
+    // Compile ForStatement node
+    else if (ForStatement* forStmt = dynamic_cast<ForStatement*>(node)) {
+        // The initializer's variable is scoped to the loop
+        symbolTable.enterScope();
+
+        if (forStmt->getInitializer()) {
+            compileStatement(forStmt->getInitializer());
+            if (bytecode.empty()) return; // Propagate error
+        }
+
+        if (!compileCountedLoop(forStmt)) {
+            if (bytecode.empty()) return; // Propagate error
+
+            // loop_start: condition; JUMP_IF_FALSE end; body; increment; POP; JUMP loop_start; end:
+            int loopStartAddress = static_cast<int>(bytecode.size());
+            int jumpIfFalseAddress = -1;
+            if (forStmt->getCondition()) {
+                compileNode(forStmt->getCondition());
+                if (bytecode.empty()) return; // Propagate error
+                jumpIfFalseAddress = static_cast<int>(bytecode.size());
+                bytecode.push_back(Bytecode(Instruction::JUMP_IF_FALSE, 0)); // Placeholder address
+            }
+
+            compileNode(forStmt->getBody());
+            if (bytecode.empty()) return; // Propagate error
+
+            if (forStmt->getIncrement()) {
+                compileStatement(forStmt->getIncrement());
+                if (bytecode.empty()) return; // Propagate error
+            }
+
+            // Backward jump: the VM treats it as a loop back-edge
+            bytecode.push_back(Bytecode(Instruction::JUMP, loopStartAddress));
+            if (jumpIfFalseAddress >= 0) {
+                bytecode[jumpIfFalseAddress].operand = static_cast<int>(bytecode.size());
+            }
+        }
+
+        symbolTable.exitScope();
+    }
+    // Compile ParallelForStatement node
+    else if (ParallelForStatement* parallelFor = dynamic_cast<ParallelForStatement*>(node)) {
+        compileParallelFor(parallelFor);
+    }
+    // Compile FunctionDeclaration node
+    else if (FunctionDeclaration* funcDecl = dynamic_cast<FunctionDeclaration*>(node)) {
+        Token name = funcDecl->getName();
+        if (symbolTable.inFunction()) {
+            *errors << "Compiler Error: Function '" << name.value << "' must be declared at the top level"
+                    << " at L" << name.line << ":C" << name.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (findBuiltin(name.value)) {
+            *errors << "Compiler Error: Function '" << name.value << "' conflicts with a builtin function"
+                    << " at L" << name.line << ":C" << name.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (natives && natives->find(name.value) >= 0) {
+            *errors << "Compiler Error: Function '" << name.value << "' conflicts with a host function"
+                    << " at L" << name.line << ":C" << name.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (functions.count(name.value)) {
+            *errors << "Compiler Error: Function '" << name.value << "' is already declared"
+                    << " at L" << name.line << ":C" << name.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+
+        // The body is emitted in place, so straight-line execution jumps over it
+        int jumpOverAddress = static_cast<int>(bytecode.size());
+        bytecode.push_back(Bytecode(Instruction::JUMP, 0)); // Placeholder address
+
+        const std::vector<Token>& parameters = funcDecl->getParameters();
+        FunctionInfo& info = functions[name.value];
+        info.entry = static_cast<int>(bytecode.size());
+        info.arity = static_cast<int>(parameters.size());
+        info.frameSize = info.arity;
+        info.visibleAddressLimit = symbolTable.getNextAddress();
+        info.declaration = funcDecl;
+        info.sharedEffect.clear();
+        current_function = name.value;
+
+        // Parameters occupy frame slots 0..arity-1, where the caller left the arguments
+        symbolTable.enterFunctionScope();
+        for (const Token& parameter : parameters) {
+            if (!symbolTable.addSymbol(parameter.value, ASTNode::Type::NUMBER)) {
+                bytecode.clear();
+                return;
+            }
+        }
+        compileNode(funcDecl->getBody());
+        if (bytecode.empty()) return; // Propagate error
+        info.frameSize = symbolTable.getLocalCount();
+        symbolTable.exitFunctionScope();
+        current_function.clear();
+
+        // Falling off the end of the body returns 0
+        bytecode.push_back(Bytecode(Instruction::PUSH_INT, 0));
+        bytecode.push_back(Bytecode(Instruction::RET));
+        bytecode[jumpOverAddress].operand = static_cast<int>(bytecode.size());
+    }
+    // Compile CallExpression node
+    else if (CallExpression* callExpr = dynamic_cast<CallExpression*>(node)) {
+        compileCall(callExpr, false);
+    }
+    // Compile ReturnStatement node
+    else if (ReturnStatement* returnStmt = dynamic_cast<ReturnStatement*>(node)) {
+        Token keyword = returnStmt->getKeyword();
+        if (!symbolTable.inFunction()) {
+            *errors << "Compiler Error: 'return' outside of a function at L" << keyword.line << ":C" << keyword.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (parallel_loop) {
+            *errors << "Compiler Error: 'return' inside a parallel for body at L" << keyword.line << ":C" << keyword.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        if (returnStmt->getValue()) {
+            if (resolveExpressionType(returnStmt->getValue()) == ASTNode::Type::STRING_LITERAL) {
+                *errors << "Compiler Error: Functions must return a numeric value at L" << keyword.line << ":C" << keyword.column << std::endl;
+                bytecode.clear();
+                return;
+            }
+            if (CallExpression* tailCall = dynamic_cast<CallExpression*>(returnStmt->getValue())) {
+                // A call in tail position reuses the current frame instead of returning through it
+                compileCall(tailCall, true);
+                if (bytecode.empty() || bytecode.back().instruction == Instruction::TAIL_CALL) return;
+            } else {
+                compileNode(returnStmt->getValue());
+                if (bytecode.empty()) return; // Propagate error
+            }
+        } else {
+            bytecode.push_back(Bytecode(Instruction::PUSH_INT, 0));
+        }
+        bytecode.push_back(Bytecode(Instruction::RET));
+    }
     // Compile PrintStatement node
     else if (PrintStatement* printStmt = dynamic_cast<PrintStatement*>(node)) {
         Expression* expr = printStmt->getExpression();
+        // Iterations run in no particular order, so a parallel body cannot print (reported at the loop)
+        if (!noteSharedEffect("print", parallel_loop ? parallel_loop->getKeyword() : Token(TokenType::PRINT, "print", 0, 0))) return;
         compileNode(expr);
         if (bytecode.empty()) return; // Propagate error
 
@@ -441,17 +855,833 @@ void Compiler::compileNode(ASTNode* node) {
         ASTNode::Type exprType = resolveExpressionType(expr);
         if (exprType == ASTNode::Type::STRING_LITERAL) {
             bytecode.push_back(Bytecode(Instruction::PRINT_STRING));
+        } else if (exprType == ASTNode::Type::ARRAY) {
+            bytecode.push_back(Bytecode(Instruction::PRINT_ARRAY));
+        } else if (exprType == ASTNode::Type::MAP) {
+            *errors << "Compiler Error: Maps cannot be printed; print their values instead." << std::endl;
+            bytecode.clear();
+            return;
         } else {
             bytecode.push_back(Bytecode(Instruction::PRINT_VALUE));
         }
     }
     else {
-        std::cerr << "Compiler Error: Unknown AST node type encountered." << std::endl;
+        *errors << "Compiler Error: Unknown AST node type encountered." << std::endl;
         bytecode.clear(); // Indicate compilation failure
         return;
     }
 }
 
+/**
+ * @brief Compiles a node in statement position.
+ * Expressions and initialized variable declarations leave their value on the stack
+ * (STORE pushes the stored value back), so it is popped here to keep the stack
+ * balanced across loop iterations.
+ *
+ * @param node A pointer to the AST node to compile.
+ */
+void Compiler::compileStatement(ASTNode* node) {
+    compileNode(node);
+    if (bytecode.empty()) return; // Propagate error
+
+    bool leavesValue = dynamic_cast<Expression*>(node) != nullptr;
+    if (VariableDeclaration* varDecl = dynamic_cast<VariableDeclaration*>(node)) {
+        leavesValue = varDecl->getInitializer() != nullptr;
+    }
+    if (leavesValue) {
+        bytecode.push_back(Bytecode(Instruction::POP));
+    }
+}
+
+/**
+ * @brief Compiles a counted for loop into the fused LOOP_INC_CMP_JUMP form.
+ * A loop is counted when its condition compares the loop variable against a limit
+ * (`i < n`, `i <= n`, `i > n`, `i >= n`) and its increment adds or subtracts an
+ * integer literal (`i = i + 1`, `i = i - 2`). The limit must be a literal or another
+ * variable: LOOP_INC_CMP_JUMP steps the counter after the limit is evaluated, so a
+ * limit that reads the counter (`i < 10 - i`) would see the old value. The emitted layout is:
+ *
+ *     condition; JUMP_IF_FALSE end
+ *   body_start:
+ *     body; limit; LOOP_INC_CMP_JUMP body_start
+ *   end:
+ *
+ * so each iteration costs one dispatch for the increment, comparison and back-edge.
+ * The initializer must already have been compiled.
+ *
+ * @param forStmt The ForStatement AST node.
+ * @return True if the loop was emitted, false if it is not a counted loop (nothing is emitted).
+ */
+bool Compiler::compileCountedLoop(ForStatement* forStmt) {
+    BinaryExpression* condition = dynamic_cast<BinaryExpression*>(forStmt->getCondition());
+    AssignmentExpression* increment = dynamic_cast<AssignmentExpression*>(forStmt->getIncrement());
+    if (!condition || !increment) return false;
+
+    IdentifierExpression* counter = dynamic_cast<IdentifierExpression*>(condition->getLeft());
+    if (!counter) return false;
+    const std::string& counterName = counter->getIdentifier().value;
+
+    Instruction comparison;
+    switch (condition->getOp().type) {
+        case TokenType::LESS: comparison = Instruction::LESS; break;
+        case TokenType::LESS_EQUAL: comparison = Instruction::LESS_EQUAL; break;
+        case TokenType::GREATER: comparison = Instruction::GREATER; break;
+        case TokenType::GREATER_EQUAL: comparison = Instruction::GREATER_EQUAL; break;
+        default: return false;
+    }
+    Expression* limit = condition->getRight();
+    IdentifierExpression* limitVariable = dynamic_cast<IdentifierExpression*>(limit);
+    if (!dynamic_cast<Literal*>(limit) && !(limitVariable && limitVariable->getIdentifier().value != counterName)) return false;
+
+    // The increment must be `counter = counter +/- <integer literal>`
+    if (increment->getIdentifier().value != counterName) return false;
+    BinaryExpression* step = dynamic_cast<BinaryExpression*>(increment->getValue());
+    if (!step || (step->getOp().type != TokenType::PLUS && step->getOp().type != TokenType::MINUS)) return false;
+    IdentifierExpression* stepBase = dynamic_cast<IdentifierExpression*>(step->getLeft());
+    Literal* stepAmount = dynamic_cast<Literal*>(step->getRight());
+    if (!stepBase || stepBase->getIdentifier().value != counterName) return false;
+    if (!stepAmount || stepAmount->getToken().type != TokenType::INT_LITERAL) return false;
+
+    Symbol* symbol = symbolTable.lookupSymbol(counterName);
+    if (!symbol || !isNumericType(symbol->type)) return false;
+    if (!checkVariableWrite(symbol, increment->getIdentifier())) return true; // Propagate error
+
+    int stepValue;
+    if (!literalValue(stepAmount->getToken(), stepValue)) {
+        bytecode.clear();
+        return true; // Propagate error
+    }
+    if (step->getOp().type == TokenType::MINUS) stepValue = -stepValue;
+
+    // Entry test (also type-checks the condition)
+    compileNode(condition);
+    if (bytecode.empty()) return true; // Propagate error
+    int jumpIfFalseAddress = static_cast<int>(bytecode.size());
+    bytecode.push_back(Bytecode(Instruction::JUMP_IF_FALSE, 0)); // Placeholder address
+
+    int bodyStartAddress = static_cast<int>(bytecode.size());
+    compileNode(forStmt->getBody());
+    if (bytecode.empty()) return true; // Propagate error
+
+    // The limit is re-evaluated every iteration, exactly like the unfused condition
+    compileNode(condition->getRight());
+    if (bytecode.empty()) return true; // Propagate error
+    Instruction loopInstruction = symbol->isLocal ? Instruction::LOOP_INC_CMP_JUMP_LOCAL : Instruction::LOOP_INC_CMP_JUMP;
+    bytecode.push_back(Bytecode(loopInstruction, bodyStartAddress, symbol->address,
+                                static_cast<int>(comparison), stepValue));
+
+    bytecode[jumpIfFalseAddress].operand = static_cast<int>(bytecode.size());
+    return true;
+}
+
+/**
+ * @brief Converts an integer literal as std::stoi does, reporting one that does not fit in an int
+ * instead of letting std::out_of_range escape the compiler.
+ */
+bool Compiler::literalValue(const Token& literal, int& value) {
+    try {
+        value = std::stoi(literal.value);
+        return true;
+    } catch (const std::out_of_range&) {
+        *errors << "Compiler Error: Number literal '" << literal.value << "' is out of range at L" << literal.line
+                << ":C" << literal.column << std::endl;
+        return false;
+    }
+}
+
+/**
+ * @brief Converts a float literal as std::stof does, reporting one that does not fit in a float.
+ */
+bool Compiler::literalValue(const Token& literal, float& value) {
+    try {
+        value = std::stof(literal.value);
+        return true;
+    } catch (const std::out_of_range&) {
+        *errors << "Compiler Error: Number literal '" << literal.value << "' is out of range at L" << literal.line
+                << ":C" << literal.column << std::endl;
+        return false;
+    }
+}
+
+/**
+ * @brief Emits the instructions that push a variable's value.
+ * Globals are addressed through memory, function locals through their frame slot.
+ * @param symbol The variable to load.
+ */
+void Compiler::emitLoad(const Symbol* symbol) {
+    if (symbol->isLocal) {
+        bytecode.push_back(Bytecode(Instruction::LOAD_LOCAL, symbol->address));
+    } else {
+        // Push the address of the variable onto the stack, then load its value
+        bytecode.push_back(Bytecode(Instruction::PUSH_INT, symbol->address));
+        bytecode.push_back(Bytecode(Instruction::LOAD));
+    }
+}
+
+/**
+ * @brief Emits the instructions that store the top of the stack into a variable.
+ * Like STORE, the stored value remains on the stack so assignments can be used as expressions.
+ * @param symbol The variable to store to.
+ */
+void Compiler::emitStore(const Symbol* symbol) {
+    if (symbol->isLocal) {
+        bytecode.push_back(Bytecode(Instruction::STORE_LOCAL, symbol->address));
+    } else {
+        // Push the address of the variable onto the stack, then store the value
+        bytecode.push_back(Bytecode(Instruction::PUSH_INT, symbol->address));
+        bytecode.push_back(Bytecode(Instruction::STORE));
+    }
+}
+
+/**
+ * @brief Fills in the target and frame size of every CALL instruction.
+ * Runs after the whole program is compiled so calls can reach functions declared later
+ * and recursive calls see their function's final frame size.
+ * @return True on success, false if a call names an undefined function or passes the wrong number of arguments.
+ */
+bool Compiler::patchCalls() {
+    for (const auto& site : call_sites) {
+        const Token& callee = site.second;
+        auto it = functions.find(callee.value);
+        if (it == functions.end()) {
+            *errors << "Compiler Error: Call to undefined function '" << callee.value
+                    << "' at L" << callee.line << ":C" << callee.column << std::endl;
+            return false;
+        }
+        Bytecode& call = bytecode[site.first];
+        if (call.operand2 != it->second.arity) {
+            *errors << "Compiler Error: Function '" << callee.value << "' expects " << it->second.arity
+                    << " argument(s) but got " << call.operand2 << " at L" << callee.line << ":C" << callee.column << std::endl;
+            return false;
+        }
+        call.operand = it->second.entry;
+        call.operand3 = it->second.frameSize;
+    }
+    return true;
+}
+
+// Inliner cost model: bodies up to this many AST nodes are substituted at call sites,
+// and inlined bodies may themselves inline calls up to this depth.
+static const int kInlineNodeBudget = 24;
+static const int kMaxInlineDepth = 4;
+
+/**
+ * @brief Collects the direct children of an AST node.
+ * @param node The node to inspect.
+ * @return The node's non-null children.
+ */
+static std::vector<ASTNode*> childrenOf(ASTNode* node) {
+    std::vector<ASTNode*> children;
+    if (UnaryExpression* unary = dynamic_cast<UnaryExpression*>(node)) {
+        children = {unary->getRight()};
+    } else if (AssignmentExpression* assign = dynamic_cast<AssignmentExpression*>(node)) {
+        children = {assign->getValue()};
+    } else if (BinaryExpression* binary = dynamic_cast<BinaryExpression*>(node)) {
+        children = {binary->getLeft(), binary->getRight()};
+    } else if (CallExpression* call = dynamic_cast<CallExpression*>(node)) {
+        children.assign(call->getArguments().begin(), call->getArguments().end());
+    } else if (ArrayLiteral* arrayLiteral = dynamic_cast<ArrayLiteral*>(node)) {
+        children.assign(arrayLiteral->getElements().begin(), arrayLiteral->getElements().end());
+    } else if (IndexExpression* index = dynamic_cast<IndexExpression*>(node)) {
+        children = {index->getArray(), index->getIndex()};
+    } else if (IndexAssignmentExpression* indexAssign = dynamic_cast<IndexAssignmentExpression*>(node)) {
+        children = {indexAssign->getTarget(), indexAssign->getValue()};
+    } else if (VariableDeclaration* varDecl = dynamic_cast<VariableDeclaration*>(node)) {
+        children = {varDecl->getInitializer()};
+    } else if (IfStatement* ifStmt = dynamic_cast<IfStatement*>(node)) {
+        children = {ifStmt->getCondition(), ifStmt->getThenBranch(), ifStmt->getElseBranch()};
+    } else if (BlockStatement* block = dynamic_cast<BlockStatement*>(node)) {
+        children = block->getStatements();
+    } else if (PrintStatement* print = dynamic_cast<PrintStatement*>(node)) {
+        children = {print->getExpression()};
+    } else if (WhileStatement* whileStmt = dynamic_cast<WhileStatement*>(node)) {
+        children = {whileStmt->getCondition(), whileStmt->getBody()};
+    } else if (ForStatement* forStmt = dynamic_cast<ForStatement*>(node)) {
+        children = {forStmt->getInitializer(), forStmt->getCondition(), forStmt->getIncrement(), forStmt->getBody()};
+    } else if (ParallelForStatement* parallelFor = dynamic_cast<ParallelForStatement*>(node)) {
+        children = {parallelFor->getLoop()};
+    } else if (FunctionDeclaration* funcDecl = dynamic_cast<FunctionDeclaration*>(node)) {
+        children = {funcDecl->getBody()};
+    } else if (ReturnStatement* returnStmt = dynamic_cast<ReturnStatement*>(node)) {
+        children = {returnStmt->getValue()};
+    }
+    children.erase(std::remove(children.begin(), children.end(), nullptr), children.end());
+    return children;
+}
+
+/**
+ * @brief Counts the nodes of an AST subtree (the inliner's size estimate).
+ */
+static int countNodes(ASTNode* node) {
+    int count = 1;
+    for (ASTNode* child : childrenOf(node)) {
+        count += countNodes(child);
+    }
+    return count;
+}
+
+/**
+ * @brief Counts the return statements in an AST subtree.
+ */
+static int countReturns(ASTNode* node) {
+    int count = dynamic_cast<ReturnStatement*>(node) ? 1 : 0;
+    for (ASTNode* child : childrenOf(node)) {
+        count += countReturns(child);
+    }
+    return count;
+}
+
+/**
+ * @brief Collects the names of the functions called in an AST subtree.
+ */
+static void collectCallees(ASTNode* node, std::vector<std::string>& callees) {
+    if (CallExpression* call = dynamic_cast<CallExpression*>(node)) {
+        callees.push_back(call->getCallee().value);
+    }
+    for (ASTNode* child : childrenOf(node)) {
+        collectCallees(child, callees);
+    }
+}
+
+/**
+ * @brief Records every function declaration in the program (functions are never nested).
+ * @param node The root of the subtree to search.
+ */
+void Compiler::collectDeclarations(ASTNode* node) {
+    if (!node) return;
+    if (FunctionDeclaration* funcDecl = dynamic_cast<FunctionDeclaration*>(node)) {
+        if (declarations.emplace(funcDecl->getName().value, funcDecl).second) { // Duplicates are reported when compiled
+            new_declarations.push_back(funcDecl->getName().value);
+        }
+        return;
+    }
+    for (ASTNode* child : childrenOf(node)) {
+        collectDeclarations(child);
+    }
+}
+
+/**
+ * @brief Checks whether a function is directly or mutually recursive.
+ * @param name The function's name.
+ * @return True if the function can reach itself through the call graph.
+ */
+bool Compiler::isRecursive(const std::string& name) {
+    std::vector<std::string> pending;
+    std::unordered_map<std::string, bool> visited;
+    auto start = declarations.find(name);
+    if (start == declarations.end()) return false;
+    collectCallees(start->second->getBody(), pending);
+    while (!pending.empty()) {
+        std::string callee = pending.back();
+        pending.pop_back();
+        if (callee == name) return true;
+        if (visited[callee]) continue;
+        visited[callee] = true;
+        auto decl = declarations.find(callee);
+        if (decl != declarations.end()) {
+            collectCallees(decl->second->getBody(), pending);
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Decides whether a call should be inlined.
+ * Small (by AST node count), non-recursive functions whose only return is their last
+ * statement are substituted at the call site; everything else is called.
+ * @param info The callee, which must already be declared.
+ * @param callExpr The call site.
+ * @return True if the call should be inlined.
+ */
+bool Compiler::shouldInline(const FunctionInfo& info, CallExpression* callExpr) {
+    if (inline_depth >= kMaxInlineDepth) return false;
+    if (static_cast<int>(callExpr->getArguments().size()) != info.arity) return false; // Reported by patchCalls()
+
+    BlockStatement* body = dynamic_cast<BlockStatement*>(info.declaration->getBody());
+    if (!body || countNodes(body) > kInlineNodeBudget) return false;
+
+    const std::vector<ASTNode*>& statements = body->getStatements();
+    bool endsWithReturn = !statements.empty() && dynamic_cast<ReturnStatement*>(statements.back());
+    if (countReturns(body) != (endsWithReturn ? 1 : 0)) return false;
+
+    return !isRecursive(info.declaration->getName().value);
+}
+
+/**
+ * @brief Compiles a call expression.
+ * Calls to small, already declared, non-recursive functions are inlined. Other calls emit
+ * CALL, or TAIL_CALL when the call is the value of a return statement.
+ * @param callExpr The CallExpression AST node.
+ * @param tailPosition True if the call's value is returned directly by the enclosing function.
+ */
+void Compiler::compileCall(CallExpression* callExpr, bool tailPosition) {
+    Token callee = callExpr->getCallee();
+    if (findBuiltin(callee.value)) {
+        compileBuiltinCall(callExpr);
+        return;
+    }
+    int native = natives ? natives->find(callee.value) : -1;
+    if (native >= 0) {
+        compileNativeCall(callExpr, native);
+        return;
+    }
+    for (Expression* arg : callExpr->getArguments()) {
+        if (resolveExpressionType(arg) == ASTNode::Type::STRING_LITERAL) {
+            *errors << "Compiler Error: Function arguments must be numeric in call to '" << callee.value
+                    << "' at L" << callee.line << ":C" << callee.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+    }
+
+    auto function = functions.find(callee.value);
+    if (function != functions.end() && shouldInline(function->second, callExpr)) {
+        compileInlinedCall(function->second, callExpr);
+        return;
+    }
+
+    // Arguments are pushed left to right and become the callee's first frame slots
+    for (Expression* arg : callExpr->getArguments()) {
+        compileNode(arg);
+        if (bytecode.empty()) return; // Propagate error
+    }
+    call_sites.push_back({static_cast<int>(bytecode.size()), callee});
+    if (parallel_loop) {
+        parallel_calls.push_back(callee); // The callee may not be compiled yet
+    }
+    Instruction instruction = tailPosition ? Instruction::TAIL_CALL : Instruction::CALL;
+    bytecode.push_back(Bytecode(instruction, 0, static_cast<int>(callExpr->getArguments().size()))); // Patched in patchCalls()
+}
+
+/**
+ * @brief Compiles a call to a builtin function as a single CALL_BUILTIN (or MAP_HAS/MAP_DELETE).
+ * Arguments are type-checked here; array handles held in NUMBER values are checked by the VM.
+ * @param callExpr The CallExpression AST node, whose callee must be a builtin.
+ */
+void Compiler::compileBuiltinCall(CallExpression* callExpr) {
+    Token callee = callExpr->getCallee();
+    const BuiltinInfo* builtin = findBuiltin(callee.value);
+    const std::vector<Expression*>& arguments = callExpr->getArguments();
+    if (static_cast<int>(arguments.size()) != builtin->arity) {
+        *errors << "Compiler Error: Function '" << callee.value << "' expects " << builtin->arity
+                << " argument(s) but got " << arguments.size() << " at L" << callee.line << ":C" << callee.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+
+    Builtin id = builtin->id;
+    bool scalarSecond = false; // ARRAY_OR_SCALAR arguments are arrays unless statically numeric
+    bool stringKey = false;
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        ASTNode::Type argType = resolveExpressionType(arguments[i]);
+        bool accepted = false;
+        const char* expected = "";
+        switch (builtin->args[i]) {
+            case ArgKind::LENGTH: accepted = isNumericType(argType); expected = "numeric"; break;
+            case ArgKind::ARRAY: accepted = isArrayType(argType); expected = "an array"; break;
+            case ArgKind::ARRAY_OR_SCALAR:
+                scalarSecond = argType != ASTNode::Type::ARRAY;
+                accepted = argType == ASTNode::Type::ARRAY || isNumericType(argType);
+                expected = "an array or numeric";
+                break;
+            case ArgKind::COLLECTION:
+                if (argType == ASTNode::Type::MAP) id = Builtin::MAP_LEN;
+                accepted = argType == ASTNode::Type::MAP || isArrayType(argType);
+                expected = "an array or map";
+                break;
+            case ArgKind::MAP: accepted = argType == ASTNode::Type::MAP; expected = "a map"; break;
+            case ArgKind::KEY:
+                stringKey = argType == ASTNode::Type::STRING_LITERAL;
+                accepted = stringKey || isNumericType(argType);
+                expected = "a string or integer key";
+                break;
+        }
+        if (!accepted) {
+            *errors << "Compiler Error: Argument " << (i + 1) << " of '" << callee.value << "' must be "
+                    << expected << ", got " << typeName(argType)
+                    << " at L" << callee.line << ":C" << callee.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        compileNode(arguments[i]);
+        if (bytecode.empty()) return; // Propagate error
+    }
+
+    if (id == Builtin::DELETE && !noteSharedEffect("modify a map", callee)) return;
+    if ((builtin->result == ASTNode::Type::ARRAY || builtin->result == ASTNode::Type::MAP) &&
+        !noteSharedEffect("create arrays or maps", callee)) {
+        return;
+    }
+
+    // has() and delete() have their own opcodes; everything else goes through CALL_BUILTIN
+    if (id == Builtin::HAS || id == Builtin::DELETE) {
+        Instruction instruction = id == Builtin::HAS ? Instruction::MAP_HAS : Instruction::MAP_DELETE;
+        bytecode.push_back(Bytecode(instruction, stringKey ? 1 : 0));
+        return;
+    }
+    bytecode.push_back(Bytecode(Instruction::CALL_BUILTIN, static_cast<int>(id),
+                                static_cast<int>(arguments.size()), scalarSecond ? 1 : 0));
+}
+
+/**
+ * @brief Compiles a call to a host function (see NativeTable.h) as a single CALL_NATIVE.
+ * Host functions take numbers, so strings, arrays and maps are rejected here.
+ * @param callExpr The CallExpression AST node, whose callee must be bound in natives.
+ * @param index The callee's index in natives.
+ */
+void Compiler::compileNativeCall(CallExpression* callExpr, int index) {
+    Token callee = callExpr->getCallee();
+    const NativeFunction& native = (*natives)[index];
+    const std::vector<Expression*>& arguments = callExpr->getArguments();
+    if (static_cast<int>(arguments.size()) != native.arity) {
+        *errors << "Compiler Error: Function '" << callee.value << "' expects " << native.arity
+                << " argument(s) but got " << arguments.size() << " at L" << callee.line << ":C" << callee.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        ASTNode::Type argType = resolveExpressionType(arguments[i]);
+        if (argType == ASTNode::Type::STRING_LITERAL || argType == ASTNode::Type::ARRAY || argType == ASTNode::Type::MAP) {
+            *errors << "Compiler Error: Argument " << (i + 1) << " of '" << callee.value << "' must be numeric, got "
+                    << typeName(argType) << " at L" << callee.line << ":C" << callee.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        compileNode(arguments[i]);
+        if (bytecode.empty()) return; // Propagate error
+    }
+    if (!noteSharedEffect("call host functions", callee)) return; // Host code may not be thread-safe
+    bytecode.push_back(Bytecode(Instruction::CALL_NATIVE, index, static_cast<int>(arguments.size())));
+}
+
+/**
+ * @brief Compiles a map element read (m[key]) or write (m[key] = value) to MAP_GET or MAP_SET.
+ * @param target The indexing expression; its base must be a map.
+ * @param value The assigned value, or nullptr for a read.
+ */
+void Compiler::compileMapAccess(IndexExpression* target, Expression* value) {
+    Token bracket = target->getBracket();
+    ASTNode::Type keyType = resolveExpressionType(target->getIndex());
+    bool stringKey = keyType == ASTNode::Type::STRING_LITERAL;
+    if (!stringKey && !isNumericType(keyType)) {
+        *errors << "Compiler Error: Map keys must be strings or integers at L" << bracket.line << ":C" << bracket.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+    if (value && !isNumericType(resolveExpressionType(value))) {
+        *errors << "Compiler Error: Map values must be numeric at L" << bracket.line << ":C" << bracket.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+    if (value && !noteSharedEffect("modify a map", bracket)) return;
+    compileNode(target->getArray());
+    if (bytecode.empty()) return; // Propagate error
+    compileNode(target->getIndex());
+    if (bytecode.empty()) return; // Propagate error
+    if (value) {
+        compileNode(value);
+        if (bytecode.empty()) return; // Propagate error
+    }
+    bytecode.push_back(Bytecode(value ? Instruction::MAP_SET : Instruction::MAP_GET, stringKey ? 1 : 0));
+}
+
+/**
+ * @brief Substitutes a function body at its call site.
+ * The arguments are evaluated in the caller's scope and stored into fresh variables that
+ * stand in for the parameters (frame slots inside a function, global addresses at the top
+ * level), then the body is compiled in place; its final return value is left on the stack.
+ * @param info The callee.
+ * @param callExpr The call site.
+ */
+void Compiler::compileInlinedCall(const FunctionInfo& info, CallExpression* callExpr) {
+    for (Expression* arg : callExpr->getArguments()) {
+        compileNode(arg);
+        if (bytecode.empty()) return; // Propagate error
+    }
+
+    symbolTable.enterInlineScope(info.visibleAddressLimit);
+    inline_depth++;
+
+    // Rename the parameters to fresh slots, then pop the arguments into them (last argument on top)
+    const std::vector<Token>& parameters = info.declaration->getParameters();
+    std::vector<Symbol*> slots;
+    for (const Token& parameter : parameters) {
+        if (!symbolTable.addSymbol(parameter.value, ASTNode::Type::NUMBER)) {
+            bytecode.clear();
+            return;
+        }
+        slots.push_back(symbolTable.lookupSymbol(parameter.value));
+    }
+    for (auto slot = slots.rbegin(); slot != slots.rend(); ++slot) {
+        emitStore(*slot);
+        bytecode.push_back(Bytecode(Instruction::POP));
+    }
+
+    symbolTable.enterScope(); // The body block's own scope
+    const std::vector<ASTNode*>& statements = static_cast<BlockStatement*>(info.declaration->getBody())->getStatements();
+    ReturnStatement* finalReturn = statements.empty() ? nullptr : dynamic_cast<ReturnStatement*>(statements.back());
+    size_t bodyCount = finalReturn ? statements.size() - 1 : statements.size();
+    for (size_t i = 0; i < bodyCount; ++i) {
+        compileStatement(statements[i]);
+        if (bytecode.empty()) return; // Propagate error
+    }
+    if (finalReturn && finalReturn->getValue()) {
+        if (resolveExpressionType(finalReturn->getValue()) == ASTNode::Type::STRING_LITERAL) {
+            Token keyword = finalReturn->getKeyword();
+            *errors << "Compiler Error: Functions must return a numeric value at L" << keyword.line << ":C" << keyword.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        compileNode(finalReturn->getValue());
+        if (bytecode.empty()) return; // Propagate error
+    } else {
+        bytecode.push_back(Bytecode(Instruction::PUSH_INT, 0)); // Falling off the end returns 0
+    }
+    symbolTable.exitScope();
+
+    inline_depth--;
+    symbolTable.exitInlineScope();
+}
+
+/**
+ * @brief Compiles a parallel for loop.
+ * The loop must be counted: `var i = start; i <cmp> limit; i = i +/- step` with an integer
+ * literal step moving i toward the limit. Start and limit are evaluated once. The body is
+ * compiled out of line into a loop unit with its own frame (slot 0 is i, slot 1 the chunk's
+ * limit, then one private copy of each reduction variable, then the body's locals):
+ *
+ *     JUMP over
+ *   entry:
+ *     body; LOAD_LOCAL 1; LOOP_INC_CMP_JUMP_LOCAL entry; HALT
+ *   over:
+ *     start; limit; PARALLEL_FOR entry; PARALLEL_REDUCE ...
+ *
+ * The VM runs the unit once per chunk of iterations on a worker VM, then the
+ * PARALLEL_REDUCEs fold the per-chunk results into the reduction variables.
+ * @param parallelFor The ParallelForStatement AST node.
+ */
+void Compiler::compileParallelFor(ParallelForStatement* parallelFor) {
+    Token keyword = parallelFor->getKeyword();
+    ForStatement* loop = parallelFor->getLoop();
+    if (symbolTable.inFunction()) {
+        *errors << "Compiler Error: parallel for must be at the top level, not inside a function or another parallel for"
+                << " at L" << keyword.line << ":C" << keyword.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+
+    // The iteration space must be known before the loop starts
+    VariableDeclaration* init = dynamic_cast<VariableDeclaration*>(loop->getInitializer());
+    BinaryExpression* condition = dynamic_cast<BinaryExpression*>(loop->getCondition());
+    AssignmentExpression* increment = dynamic_cast<AssignmentExpression*>(loop->getIncrement());
+    IdentifierExpression* counter = condition ? dynamic_cast<IdentifierExpression*>(condition->getLeft()) : nullptr;
+    BinaryExpression* step = increment ? dynamic_cast<BinaryExpression*>(increment->getValue()) : nullptr;
+    IdentifierExpression* stepBase = step ? dynamic_cast<IdentifierExpression*>(step->getLeft()) : nullptr;
+    Literal* stepAmount = step ? dynamic_cast<Literal*>(step->getRight()) : nullptr;
+    bool counted = init && init->getInitializer() && counter && increment && stepBase && stepAmount &&
+                   counter->getIdentifier().value == init->getIdentifier().value &&
+                   increment->getIdentifier().value == init->getIdentifier().value &&
+                   stepBase->getIdentifier().value == init->getIdentifier().value &&
+                   (step->getOp().type == TokenType::PLUS || step->getOp().type == TokenType::MINUS) &&
+                   stepAmount->getToken().type == TokenType::INT_LITERAL;
+    Instruction comparison = Instruction::LESS;
+    if (counted) {
+        switch (condition->getOp().type) {
+            case TokenType::LESS: comparison = Instruction::LESS; break;
+            case TokenType::LESS_EQUAL: comparison = Instruction::LESS_EQUAL; break;
+            case TokenType::GREATER: comparison = Instruction::GREATER; break;
+            case TokenType::GREATER_EQUAL: comparison = Instruction::GREATER_EQUAL; break;
+            default: counted = false; break;
+        }
+    }
+    if (!counted) {
+        *errors << "Compiler Error: parallel for needs the form 'parallel for (var i = start; i < limit; i = i + step)'"
+                << " with an integer step at L" << keyword.line << ":C" << keyword.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+    int stepValue;
+    if (!literalValue(stepAmount->getToken(), stepValue)) {
+        bytecode.clear();
+        return;
+    }
+    if (step->getOp().type == TokenType::MINUS) stepValue = -stepValue;
+    bool upward = comparison == Instruction::LESS || comparison == Instruction::LESS_EQUAL;
+    if (stepValue == 0 || (stepValue > 0) != upward) {
+        *errors << "Compiler Error: parallel for step must move '" << init->getIdentifier().value << "' toward its limit"
+                << " at L" << keyword.line << ":C" << keyword.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+    ASTNode::Type counterType = resolveExpressionType(init->getInitializer());
+    if (!isNumericType(counterType) || !isNumericType(resolveExpressionType(condition->getRight()))) {
+        *errors << "Compiler Error: parallel for start and limit must be numeric at L" << keyword.line << ":C" << keyword.column << std::endl;
+        bytecode.clear();
+        return;
+    }
+
+    // Reduction variables are globals; the body updates a private copy of each
+    std::vector<std::pair<Reduction, Symbol*>> reductions;
+    for (const ReductionClause& clause : parallelFor->getReductions()) {
+        Symbol* global = symbolTable.lookupSymbol(clause.variable.value);
+        if (!global || !isNumericType(global->type)) {
+            *errors << "Compiler Error: Reduction variable '" << clause.variable.value << "' must be a declared numeric variable"
+                    << " at L" << clause.variable.line << ":C" << clause.variable.column << std::endl;
+            bytecode.clear();
+            return;
+        }
+        Reduction op = Reduction::SUM;
+        if (clause.op.type == TokenType::STAR) op = Reduction::PRODUCT;
+        else if (clause.op.value == "min") op = Reduction::MIN;
+        else if (clause.op.value == "max") op = Reduction::MAX;
+        reductions.push_back({op, global});
+    }
+
+    // The loop unit, emitted in place and jumped over like a function body
+    int jumpOverAddress = static_cast<int>(bytecode.size());
+    bytecode.push_back(Bytecode(Instruction::JUMP, 0)); // Placeholder address
+    int entry = static_cast<int>(bytecode.size());
+
+    symbolTable.enterFunctionScope();
+    symbolTable.addSymbol(init->getIdentifier().value, counterType); // Slot 0
+    int limitSlot = symbolTable.reserveLocal();                      // Slot 1
+    std::vector<int> reductionSlots;
+    for (const auto& reduction : reductions) {
+        if (!symbolTable.addSymbol(reduction.second->name, reduction.second->type)) {
+            bytecode.clear();
+            return;
+        }
+        reductionSlots.push_back(symbolTable.lookupSymbol(reduction.second->name)->address);
+    }
+    parallel_loop = parallelFor;
+    compileNode(loop->getBody());
+    parallel_loop = nullptr;
+    if (bytecode.empty()) return; // Propagate error
+    int frameSize = symbolTable.getLocalCount();
+    symbolTable.exitFunctionScope();
+
+    // A chunk's limit is exact (integer start and step), so upward loops stop at < and downward at >
+    bytecode.push_back(Bytecode(Instruction::LOAD_LOCAL, limitSlot));
+    bytecode.push_back(Bytecode(Instruction::LOOP_INC_CMP_JUMP_LOCAL, entry, 0,
+                                static_cast<int>(upward ? Instruction::LESS : Instruction::GREATER), stepValue));
+    bytecode.push_back(Bytecode(Instruction::HALT)); // Ends the chunk; the worker reads its frame
+    bytecode[jumpOverAddress].operand = static_cast<int>(bytecode.size());
+
+    compileNode(init->getInitializer());
+    if (bytecode.empty()) return; // Propagate error
+    compileNode(condition->getRight());
+    if (bytecode.empty()) return; // Propagate error
+    bytecode.push_back(Bytecode(Instruction::PARALLEL_FOR, entry, frameSize, static_cast<int>(comparison), stepValue));
+    for (size_t i = 0; i < reductions.size(); ++i) {
+        bytecode.push_back(Bytecode(Instruction::PARALLEL_REDUCE, static_cast<int>(reductions[i].first),
+                                    reductions[i].second->address, reductionSlots[i]));
+    }
+}
+
+/**
+ * @brief Records an operation that is unsafe to run concurrently: writing shared state,
+ * allocating, or printing. In a parallel for body it is an error; in a function body it
+ * marks the function, so checkParallelCalls() can reject calls to it from parallel bodies.
+ * @param effect What the operation does, phrased to follow "cannot" (e.g. "print").
+ * @param where The token to report the error at.
+ * @return False (after reporting) if the operation is inside a parallel for body.
+ */
+bool Compiler::noteSharedEffect(const std::string& effect, const Token& where) {
+    if (parallel_loop) {
+        *errors << "Compiler Error: A parallel for body cannot " << effect << " at L" << where.line << ":C" << where.column << std::endl;
+        bytecode.clear();
+        return false;
+    }
+    if (!current_function.empty()) {
+        std::string& recorded = functions[current_function].sharedEffect;
+        if (recorded.empty()) recorded = effect;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks an assignment to a variable: host inputs are read-only, and a parallel for
+ * body cannot assign its loop variable or any shared (global) variable other than through
+ * its reduction copies.
+ * @param symbol The assigned variable.
+ * @param where The token to report an error at.
+ * @return False (after reporting) if the assignment is not allowed.
+ */
+bool Compiler::checkVariableWrite(const Symbol* symbol, const Token& where) {
+    if (isHostInput(symbol)) {
+        *errors << "Compiler Error: Cannot assign to host input '" << symbol->name
+                << "' at L" << where.line << ":C" << where.column << std::endl;
+        bytecode.clear();
+        return false;
+    }
+    if (parallel_loop && symbol->isLocal && symbol->address == 0) {
+        *errors << "Compiler Error: A parallel for body cannot assign to its loop variable '" << symbol->name
+                << "' at L" << where.line << ":C" << where.column << std::endl;
+        bytecode.clear();
+        return false;
+    }
+    if (parallel_loop && !symbol->isLocal) {
+        *errors << "Compiler Error: A parallel for body cannot assign to shared variable '" << symbol->name
+                << "'; declare it inside the loop or list it in reduce(...) at L" << where.line << ":C" << where.column << std::endl;
+        bytecode.clear();
+        return false;
+    }
+    if (!symbol->isLocal) {
+        return noteSharedEffect("assign to shared variable '" + symbol->name + "'", where);
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether a symbol is a global bound to host memory (see setInputs()).
+ * @param symbol The symbol to check, or null.
+ * @return True if the symbol is one of the first inputs->size() globals.
+ */
+bool Compiler::isHostInput(const Symbol* symbol) const {
+    return symbol && inputs && !symbol->isLocal && symbol->address < static_cast<int>(inputs->size());
+}
+
+/**
+ * @brief Checks whether an expression is the loop variable of the parallel for being compiled.
+ * @param expr The expression to check.
+ * @return True if expr names the loop variable (frame slot 0 of the loop unit).
+ */
+bool Compiler::isLoopVariable(Expression* expr) {
+    IdentifierExpression* identifier = dynamic_cast<IdentifierExpression*>(expr);
+    if (!identifier) return false;
+    Symbol* symbol = symbolTable.lookupSymbol(identifier->getIdentifier().value);
+    return symbol && symbol->isLocal && symbol->address == 0;
+}
+
+/**
+ * @brief Rejects calls from parallel for bodies to functions that (directly or through
+ * the functions they call) have a shared effect. Runs once every function is compiled.
+ * @return True if every such call is safe.
+ */
+bool Compiler::checkParallelCalls() {
+    for (const Token& callee : parallel_calls) {
+        std::vector<std::string> pending = {callee.value};
+        std::unordered_map<std::string, bool> visited;
+        while (!pending.empty()) {
+            std::string name = pending.back();
+            pending.pop_back();
+            if (visited[name]) continue;
+            visited[name] = true;
+            auto function = functions.find(name);
+            if (function == functions.end()) continue;
+            if (!function->second.sharedEffect.empty()) {
+                *errors << "Compiler Error: Function '" << callee.value << "' cannot be called in a parallel for body because "
+                        << (name == callee.value ? std::string("it") : "'" + name + "' (which it calls)")
+                        << " may " << function->second.sharedEffect
+                        << " at L" << callee.line << ":C" << callee.column << std::endl;
+                return false;
+            }
+            collectCallees(function->second.declaration->getBody(), pending);
+        }
+    }
+    return true;
+}
+
 /**
  * @brief Returns a string literal by its index.
  * @param index The index of the string literal.
@@ -463,7 +1693,7 @@ const std::string& Compiler::getStringLiteral(int index) const {
     }
     // Handle error: index out of bounds
     static const std::string error_str = "ERROR: String literal index out of bounds";
-    std::cerr << error_str << std::endl;
+    *errors << error_str << std::endl;
     return error_str;
 }
 
@@ -483,9 +1713,9 @@ ASTNode::Type Compiler::resolveExpressionType(Expression* expr) {
             // If symbol not found, it's an undeclared variable.
             // This error should ideally be caught earlier or handled more gracefully.
             // For now, return UNKNOWN and let subsequent checks handle it.
-            std::cerr << "Compiler Warning: Attempted to resolve type of undeclared variable '"
-                      << identifier_token.value << "' at L" << identifier_token.line
-                      << ":C" << identifier_token.column << std::endl;
+            *errors << "Compiler Warning: Attempted to resolve type of undeclared variable '"
+                    << identifier_token.value << "' at L" << identifier_token.line
+                    << ":C" << identifier_token.column << std::endl;
             return ASTNode::Type::UNKNOWN;
         }
     } else if (BinaryExpression* binExpr = dynamic_cast<BinaryExpression*>(expr)) {
@@ -502,17 +1732,23 @@ ASTNode::Type Compiler::resolveExpressionType(Expression* expr) {
         // This simplified logic assumes type compatibility is already checked during compilation of the binary expression itself.
         // For now, we'll return the type of the left operand if it's numeric/boolean, or UNKNOWN if not.
         // A more robust solution would involve a type inference system.
-        if ((leftType == ASTNode::Type::INTEGER || leftType == ASTNode::Type::FLOAT || leftType == ASTNode::Type::BOOLEAN_LITERAL) &&
-            (rightType == ASTNode::Type::INTEGER || rightType == ASTNode::Type::FLOAT || rightType == ASTNode::Type::BOOLEAN_LITERAL)) {
+        if ((isNumericType(leftType) || leftType == ASTNode::Type::BOOLEAN_LITERAL) &&
+            (isNumericType(rightType) || rightType == ASTNode::Type::BOOLEAN_LITERAL)) {
             // If either is float, result is float, otherwise int/bool
             if (leftType == ASTNode::Type::FLOAT || rightType == ASTNode::Type::FLOAT) {
                 return ASTNode::Type::FLOAT;
+            } else if (leftType == ASTNode::Type::NUMBER || rightType == ASTNode::Type::NUMBER) {
+                return ASTNode::Type::NUMBER; // Dynamically typed operand, result is only known at runtime
             } else {
                 return ASTNode::Type::INTEGER; // Covers INTEGER and BOOLEAN_LITERAL (which are 0/1 integers)
             }
         }
         return ASTNode::Type::UNKNOWN; // Fallback for unhandled binary expression types
     }
+    else if (CallExpression* callExpr = dynamic_cast<CallExpression*>(expr)) {
+        const BuiltinInfo* builtin = findBuiltin(callExpr->getCallee().value);
+        return builtin ? builtin->result : ASTNode::Type::NUMBER;
+    }
     else {
         // For other expression types, just return their inherent type
         return expr->getType();
@@ -526,3 +1762,20 @@ ASTNode::Type Compiler::resolveExpressionType(Expression* expr) {
 const std::vector<std::string>& Compiler::getStringLiterals() const {
     return string_literals;
 }
+
+/**
+ * @brief Returns the number of global variable slots the compiled program uses.
+ * @return One more than the highest global address assigned.
+ */
+int Compiler::getGlobalCount() const {
+    return symbolTable.getNextAddress();
+}
+
+/**
+ * @brief Sets where compile errors are reported.
+ * @param stream The stream to write to (std::cerr unless set).
+ */
+void Compiler::setErrorStream(std::ostream& stream) {
+    errors = &stream;
+    symbolTable.setErrorStream(stream);
+}
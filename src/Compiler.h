@@ -1,28 +1,102 @@
 #ifndef COMPILER_H
 #define COMPILER_H
 
+#include <ostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include "../include/AST.h"
 #include "../include/Tokens.h"
 #include "../include/Bytecode.h"
+#include "../include/HostBindings.h"
+#include "../include/NativeTable.h"
 #include "../include/SymbolTable.h" // Include for SymbolTable
 
+/**
+ * @brief Compile-time information about a user-defined function.
+ */
+struct FunctionInfo {
+    int entry;     /**< Address of the function's first instruction. */
+    int arity;     /**< Number of parameters. */
+    int frameSize; /**< Number of frame slots (parameters plus locals). */
+    int visibleAddressLimit; /**< Next global address when the function was declared (globals it can see are below it). */
+    FunctionDeclaration* declaration; /**< The declaration, used by the inliner. */
+    std::string sharedEffect; /**< The first thing the body does that a parallel for body may not (empty if none). */
+};
+
 class Compiler {
 private:
     std::vector<Bytecode> bytecode;
     SymbolTable symbolTable; // Member for managing symbols and scopes
     std::vector<std::string> string_literals; // New: To store string literals
+    std::unordered_map<std::string, FunctionInfo> functions; // User-defined functions by name
+    std::vector<std::pair<int, Token>> call_sites; // CALL instructions patched once every function is compiled
+    std::unordered_map<std::string, FunctionDeclaration*> declarations; // Every function in the program, for call-graph analysis
+    int inline_depth; // Nesting depth of inlined bodies currently being compiled
+    std::string current_function; // Function whose body is being compiled (empty at the top level)
+    ParallelForStatement* parallel_loop; // The parallel for whose body is being compiled, or nullptr
+    std::vector<Token> parallel_calls; // Functions called (not inlined) from parallel for bodies, checked once all are compiled
+    std::ostream* errors; // Where compile errors are reported: std::cerr unless set
+    const NativeTable* natives; // Host functions calls may resolve to, or null
+    const HostBindings* inputs; // Host memory declared as the program's first globals, or null
+    bool session_scope; // compileIncremental() has entered the global scope its pieces share (it is never left)
+    std::vector<std::string> new_declarations; // Functions collectDeclarations() saw for the first time
 
 private:
     void compileNode(ASTNode* node);
-    ASTNode::Type resolveExpressionType(Expression* expr); // New: Helper to resolve expression types
+    void compileStatement(ASTNode* node); // Compiles a statement and discards any value it leaves on the stack
+    bool compileCountedLoop(ForStatement* forStmt); // Emits the fused LOOP_INC_CMP_JUMP form if the loop is counted
+    void emitLoad(const Symbol* symbol); // Pushes a variable's value (global or frame slot)
+    void emitStore(const Symbol* symbol); // Stores the top of the stack into a variable, leaving it on the stack
+    bool patchCalls(); // Resolves call sites to function entries; false on undefined functions or arity mismatch
+
+    // Calls, inlining and tail calls
+    void compileCall(CallExpression* callExpr, bool tailPosition); // Emits an inlined body, CALL or TAIL_CALL
+    void compileBuiltinCall(CallExpression* callExpr); // Emits CALL_BUILTIN for builtins like sum(a), or a map opcode
+    void compileNativeCall(CallExpression* callExpr, int index); // Emits CALL_NATIVE for a host function
+    void compileMapAccess(IndexExpression* target, Expression* value); // Emits MAP_GET, or MAP_SET when value is given
+    void collectDeclarations(ASTNode* node); // Records every FunctionDeclaration outside function bodies
+    bool isRecursive(const std::string& name); // True if the function can reach itself through the call graph
+    bool shouldInline(const FunctionInfo& info, CallExpression* callExpr); // The inliner's cost model
+    void compileInlinedCall(const FunctionInfo& info, CallExpression* callExpr); // Substitutes the body at the call site
+
+    // Parallel loops
+    void compileParallelFor(ParallelForStatement* parallelFor); // Emits the loop unit, PARALLEL_FOR and PARALLEL_REDUCEs
+    bool noteSharedEffect(const std::string& effect, const Token& where); // Rejects effect in a parallel body; records it on the current function
+    bool checkVariableWrite(const Symbol* symbol, const Token& where); // Host input and parallel for rules for assigning a variable
+    bool literalValue(const Token& literal, int& value); // An integer literal's value; false (after reporting) if it does not fit
+    bool literalValue(const Token& literal, float& value); // A float literal's value; false (after reporting) if it does not fit
+    bool isHostInput(const Symbol* symbol) const; // True if the symbol is one of the globals bound to host memory
+    bool isLoopVariable(Expression* expr); // True if expr is the loop variable of the parallel for being compiled
+    bool checkParallelCalls(); // Rejects parallel bodies calling functions with shared effects; false on error
 
 public:
+    // Identifies the bytecode this compiler generates: change it whenever the same source would compile
+    // differently, so that programs cached by an older compiler (see CompilationCache.h) are not reused
+    static constexpr const char* kVersion = "1";
+
     Compiler();
     ASTNode::Type getLiteralType(Literal* literal);
     std::vector<Bytecode> compile(ASTNode* ast);
+    /**
+     * @brief Compiles one more piece of a program that grows by appending, such as a REPL line.
+     * Globals, functions and string literals of earlier pieces stay visible, and the piece's
+     * globals are declared in the same scope. The piece's addresses start at base (the size of
+     * the program so far), so only the piece is compiled, not the program.
+     * @param statements The piece's top-level statements (see Parser::parseStatements); they
+     * must stay alive while later pieces may inline the functions they declare.
+     * @param base Address of the piece's first instruction.
+     * @return The piece's instructions, ending with HALT; empty on a compile error, after which
+     * the compiler is as it was before the piece.
+     */
+    std::vector<Bytecode> compileIncremental(const std::vector<ASTNode*>& statements, int base);
     const std::string& getStringLiteral(int index) const; // New: Get a string literal by index
     const std::vector<std::string>& getStringLiterals() const; // New: Get all string literals
+    int getGlobalCount() const; // Global variable slots the compiled program uses
+    ASTNode::Type resolveExpressionType(Expression* expr); // An expression's type against the symbols declared so far
+    void setErrorStream(std::ostream& stream); // Compile errors go to std::cerr unless set
+    void setNatives(const NativeTable* table) { natives = table; } // Calls to names bound in table compile to CALL_NATIVE
+    void setInputs(const HostBindings* bindings) { inputs = bindings; } // Declares bindings' names as read-only globals 0..n-1
 };
 
 #endif // COMPILER_H
@@ -0,0 +1,435 @@
+#include "Daemon.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using daemon_protocol::Reply;
+using daemon_protocol::Request;
+using daemon_protocol::Status;
+
+static const size_t kMaxPrograms = 4096; // Cached programs; beyond this, the oldest is dropped for each new one
+
+// Reads exactly size bytes; false on end of stream or error
+static bool readFully(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t count = read(fd, bytes, size);
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        bytes += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+#ifdef MSG_NOSIGNAL
+        ssize_t count = send(fd, bytes, size, MSG_NOSIGNAL); // A vanished peer is an error, not SIGPIPE
+#else
+        ssize_t count = write(fd, bytes, size);
+#endif
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) return false;
+        bytes += count;
+        size -= static_cast<size_t>(count);
+    }
+    return true;
+}
+
+// Reads one frame's body into buffer
+static bool readFrame(int fd, std::string& buffer) {
+    uint32_t length;
+    if (!readFully(fd, &length, sizeof(length)) || length > daemon_protocol::kMaxFrame) return false;
+    buffer.resize(length);
+    return readFully(fd, &buffer[0], length);
+}
+
+static bool fillAddress(const std::string& path, sockaddr_un& address) {
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) return false;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+Daemon::Daemon(size_t threads, const cocompiler::Inputs& inputs)
+    : thread_count(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads), inputs(inputs),
+      listener(-1), wake{-1, -1}, connections(new std::atomic<int>[thread_count]), contexts(thread_count), stopping(false),
+      next_id(1), requests(0), compiles(0) {
+    this->inputs.output = nullptr;
+    for (size_t i = 0; i < thread_count; ++i) connections[i].store(-1);
+}
+
+Daemon::~Daemon() {
+    stop();
+    wait();
+}
+
+bool Daemon::start(const std::string& path) {
+    sockaddr_un address;
+    if (!fillAddress(path, address)) {
+        std::cerr << "Daemon Error: Socket path '" << path << "' is empty or too long." << std::endl;
+        return false;
+    }
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path.c_str()); // Left behind by a daemon that did not stop cleanly
+    }
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 128) != 0 || fcntl(listener, F_SETFL, O_NONBLOCK) != 0 || pipe(wake) != 0 ||
+        fcntl(wake[0], F_SETFL, O_NONBLOCK) != 0) {
+        std::cerr << "Daemon Error: Could not listen on '" << path << "': " << std::strerror(errno) << std::endl;
+        if (listener >= 0) close(listener);
+        listener = -1;
+        for (int& end : wake) {
+            if (end >= 0) close(end);
+            end = -1;
+        }
+        return false;
+    }
+    socket_path = path;
+    poller = std::thread(&Daemon::pollLoop, this);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(&Daemon::workerLoop, this, i);
+    }
+    return true;
+}
+
+void Daemon::stop() {
+    // Only async-signal-safe calls: stop() may run in a signal handler
+    stopping.store(true);
+    if (wake[1] >= 0) {
+        char byte = 0;
+        ssize_t written = write(wake[1], &byte, 1);
+        (void)written; // A full pipe wakes the poll thread just as well
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        int connection = connections[i].load();
+        if (connection >= 0) shutdown(connection, SHUT_RDWR);
+    }
+}
+
+void Daemon::wait() {
+    if (poller.joinable()) poller.join();
+    for (std::thread& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+    if (listener >= 0) {
+        close(listener);
+        listener = -1;
+        unlink(socket_path.c_str());
+    }
+    for (int& end : wake) {
+        if (end >= 0) close(end);
+        end = -1;
+    }
+}
+
+// Reads whatever a connection has received without blocking; false once the client has closed it or failed
+static bool receiveAvailable(int fd, std::string& input) {
+    char bytes[4096];
+    for (;;) {
+        ssize_t count = recv(fd, bytes, sizeof(bytes), MSG_DONTWAIT);
+        if (count > 0) {
+            input.append(bytes, static_cast<size_t>(count));
+            if (input.size() > sizeof(uint32_t) + daemon_protocol::kMaxFrame) return false;
+            continue;
+        }
+        if (count < 0 && errno == EINTR) continue;
+        return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+enum class Framing { INCOMPLETE, COMPLETE, MALFORMED };
+
+// Moves the first whole frame's body out of a connection's buffered input
+static Framing takeFrame(std::string& input, std::string& frame) {
+    uint32_t length;
+    if (input.size() < sizeof(length)) return Framing::INCOMPLETE;
+    std::memcpy(&length, input.data(), sizeof(length));
+    if (length == 0 || length > daemon_protocol::kMaxFrame) return Framing::MALFORMED;
+    if (input.size() - sizeof(length) < length) return Framing::INCOMPLETE;
+    frame.assign(input, sizeof(length), length);
+    input.erase(0, sizeof(length) + length);
+    return Framing::COMPLETE;
+}
+
+// Accepts connections, reads requests from the idle ones and hands each whole request to the workers
+void Daemon::pollLoop() {
+    std::vector<int> idle;
+    std::unordered_map<int, std::string> input; // What each idle connection has sent of its next request
+    std::vector<int> waiting;
+    std::vector<Handoff> handed, answered;
+    std::vector<pollfd> watched;
+    timeval timeout = {kReplyTimeoutSeconds, 0};
+
+    // Hands a connection to the workers if its input holds a whole request, and otherwise watches it again
+    auto dispatch = [&](int connection, std::string& pending) {
+        Handoff handoff;
+        switch (takeFrame(pending, handoff.request)) {
+            case Framing::COMPLETE:
+                handoff.connection = connection;
+                handoff.input = std::move(pending);
+                handed.push_back(std::move(handoff));
+                input.erase(connection);
+                break;
+            case Framing::MALFORMED:
+                close(connection);
+                input.erase(connection);
+                break;
+            case Framing::INCOMPLETE:
+                idle.push_back(connection);
+                break;
+        }
+    };
+
+    while (!stopping.load()) {
+        watched.clear();
+        watched.push_back({wake[0], POLLIN, 0});
+        watched.push_back({listener, POLLIN, 0});
+        for (int connection : idle) watched.push_back({connection, POLLIN, 0});
+        if (poll(watched.data(), watched.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (stopping.load()) break;
+        if (watched[0].revents != 0) {
+            char drained[64];
+            while (read(wake[0], drained, sizeof(drained)) > 0) {}
+        }
+
+        handed.clear();
+        waiting.clear();
+        waiting.swap(idle);
+        for (size_t i = 0; i < waiting.size(); ++i) {
+            int connection = waiting[i];
+            if (watched[i + 2].revents == 0) {
+                idle.push_back(connection);
+            } else if (!receiveAvailable(connection, input[connection])) {
+                close(connection); // Closed by the client, or it sent more than a frame may hold
+                input.erase(connection);
+            } else {
+                dispatch(connection, input[connection]);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            answered.swap(returned);
+        }
+        for (Handoff& handoff : answered) {
+            input[handoff.connection] = std::move(handoff.input);
+            dispatch(handoff.connection, input[handoff.connection]);
+        }
+        answered.clear();
+        if (!handed.empty()) {
+            {
+                std::lock_guard<std::mutex> lock(queue_mutex);
+                for (Handoff& handoff : handed) ready.push_back(std::move(handoff));
+            }
+            queue_ready.notify_all();
+        }
+
+        if (watched[1].revents & (POLLERR | POLLHUP | POLLNVAL)) break;
+        if (watched[1].revents & POLLIN) {
+            for (;;) {
+                int connection = accept(listener, nullptr, nullptr);
+                if (connection < 0) break; // EAGAIN once the backlog is empty
+                fcntl(connection, F_SETFL, 0); // Blocking for replies, whatever it inherited from the listener
+                setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                idle.push_back(connection);
+            }
+        }
+    }
+
+    // Stopping (or the listener failed): release the workers and close every connection no worker holds
+    stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (const Handoff& handoff : ready) close(handoff.connection);
+        for (const Handoff& handoff : returned) close(handoff.connection);
+        ready.clear();
+        returned.clear();
+    }
+    queue_ready.notify_all();
+    for (int connection : idle) close(connection);
+}
+
+// Answers one request at a time from whichever connection has one read
+void Daemon::workerLoop(size_t self) {
+    Scratch scratch;
+    for (;;) {
+        Handoff handoff;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_ready.wait(lock, [this]() { return !ready.empty() || stopping.load(); });
+            if (ready.empty()) return; // Stopping
+            handoff = std::move(ready.front());
+            ready.pop_front();
+            connections[self].store(handoff.connection);
+        }
+        bool keep = !stopping.load() && serveRequest(handoff.connection, handoff.request, scratch);
+        connections[self].store(-1);
+        if (keep) {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            if (!stopping.load()) { // Otherwise the poll thread has already closed what it watches
+                returned.push_back(std::move(handoff));
+                handoff.connection = -1;
+            }
+        }
+        if (handoff.connection >= 0) {
+            close(handoff.connection);
+        } else {
+            char byte = 0;
+            ssize_t written = write(wake[1], &byte, 1);
+            (void)written;
+        }
+    }
+}
+
+cocompiler::Program Daemon::lookup(const std::string& source, uint64_t& id) {
+    {
+        std::shared_lock<std::shared_mutex> lock(programs_mutex);
+        auto found = ids.find(source);
+        if (found != ids.end()) {
+            id = found->second;
+            return programs.find(id)->second.program;
+        }
+    }
+    compiles++;
+    cocompiler::Program program = cocompiler::compile(source); // Outside the lock
+    std::unique_lock<std::shared_mutex> lock(programs_mutex);
+    auto found = ids.find(source);
+    if (found != ids.end()) { // Another request compiled the same source meanwhile
+        id = found->second;
+        return programs.find(id)->second.program;
+    }
+    if (programs.size() >= kMaxPrograms) {
+        ids.erase(programs.begin()->second.source);
+        programs.erase(programs.begin());
+    }
+    id = next_id++;
+    Entry& entry = programs[id];
+    entry.source = source;
+    entry.program = program;
+    ids.emplace(entry.source, id); // Map nodes do not move, so the view stays valid until the entry is erased
+    return program;
+}
+
+bool Daemon::find(uint64_t id, cocompiler::Program& program) {
+    std::shared_lock<std::shared_mutex> lock(programs_mutex);
+    auto found = programs.find(id);
+    if (found == programs.end()) return false;
+    program = found->second.program;
+    return true;
+}
+
+// Answers one request (a frame's body) on a connection; false if the reply could not be written
+// (the client has gone, or did not read for kReplyTimeoutSeconds)
+bool Daemon::serveRequest(int connection, const std::string& frame, Scratch& scratch) {
+    cocompiler::Result& result = scratch.result;
+    requests++;
+    Reply reply;
+    std::memset(&reply, 0, sizeof(reply));
+    reply.status = Status::OK;
+    result.output.clear();
+    result.errors.clear();
+
+    Request type = static_cast<Request>(frame[0]);
+    cocompiler::Program program;
+    bool haveProgram = false;
+    if (type == Request::RUN_SOURCE || type == Request::COMPILE) {
+        scratch.source.assign(frame, 1, std::string::npos);
+        try {
+            program = lookup(scratch.source, reply.program);
+            haveProgram = true;
+        } catch (const std::exception& e) { // One bad request must not take the daemon down
+            reply.status = Status::COMPILE_ERROR;
+            result.errors = std::string("Compiler Error: ") + e.what() + "\n";
+        }
+    } else if (type == Request::RUN_PROGRAM && frame.size() == 1 + sizeof(uint64_t)) {
+        std::memcpy(&reply.program, &frame[1], sizeof(uint64_t));
+        haveProgram = find(reply.program, program);
+        if (!haveProgram) reply.status = Status::UNKNOWN_PROGRAM;
+    } else {
+        reply.status = Status::BAD_REQUEST;
+    }
+
+    if (haveProgram) {
+        reply.expression = program.isExpression();
+        if (!program.ok()) {
+            reply.status = Status::COMPILE_ERROR;
+            result.errors = program.errors();
+        } else if (type != Request::COMPILE) {
+            try {
+                if (!contexts.run(program, inputs, result)) reply.status = Status::RUNTIME_ERROR;
+                reply.value = result.value;
+            } catch (const std::exception& e) {
+                reply.status = Status::RUNTIME_ERROR;
+                reply.value = -1;
+                result.errors += std::string("VM Error: ") + e.what() + "\n";
+            }
+        }
+    }
+    reply.output_length = static_cast<uint32_t>(result.output.size());
+
+    std::string& response = scratch.response;
+    uint32_t length = static_cast<uint32_t>(sizeof(reply) + result.output.size() + result.errors.size());
+    response.clear();
+    response.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    response.append(reinterpret_cast<const char*>(&reply), sizeof(reply));
+    response += result.output;
+    response += result.errors;
+    return writeFully(connection, response.data(), response.size());
+}
+
+DaemonClient::DaemonClient() : socket_fd(-1) {}
+
+DaemonClient::~DaemonClient() {
+    if (socket_fd >= 0) close(socket_fd);
+}
+
+bool DaemonClient::connect(const std::string& path) {
+    sockaddr_un address;
+    if (!fillAddress(path, address)) {
+        std::cerr << "Daemon Error: Socket path '" << path << "' is empty or too long." << std::endl;
+        return false;
+    }
+    if (socket_fd >= 0) close(socket_fd);
+    socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd < 0 || ::connect(socket_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::cerr << "Daemon Error: Could not connect to '" << path << "': " << std::strerror(errno) << std::endl;
+        if (socket_fd >= 0) close(socket_fd);
+        socket_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool DaemonClient::request(Request type, const std::string& payload, Reply& reply, std::string& output, std::string& errors) {
+    if (socket_fd < 0 || payload.size() >= daemon_protocol::kMaxFrame) return false;
+    uint32_t length = static_cast<uint32_t>(1 + payload.size());
+    buffer.clear();
+    buffer.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    buffer += static_cast<char>(type);
+    buffer += payload;
+    if (!writeFully(socket_fd, buffer.data(), buffer.size()) || !readFrame(socket_fd, buffer) || buffer.size() < sizeof(reply)) {
+        return false;
+    }
+    std::memcpy(&reply, buffer.data(), sizeof(reply));
+    if (reply.output_length > buffer.size() - sizeof(reply)) return false;
+    output.assign(buffer, sizeof(reply), reply.output_length);
+    errors.assign(buffer, sizeof(reply) + reply.output_length, std::string::npos);
+    return true;
+}
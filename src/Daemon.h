@@ -0,0 +1,177 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../include/CoCompiler.h"
+
+/**
+ * @brief The framed protocol spoken over the daemon's Unix domain socket.
+ *
+ * Every message is a frame: a 32-bit length (of what follows, in host byte order, since
+ * both ends are on one machine), then the body. A request body is one type byte and its
+ * payload; a response body is a fixed Reply header followed by the output and error text.
+ * A connection carries any number of requests, each answered in order.
+ */
+namespace daemon_protocol {
+
+enum class Request : uint8_t {
+    RUN_SOURCE = 1,  /**< Payload: source. Compiles it (unless cached) and runs it. */
+    COMPILE = 2,     /**< Payload: source. Compiles it (unless cached); the reply carries its id. */
+    RUN_PROGRAM = 3, /**< Payload: a 64-bit program id from an earlier reply. Runs that program. */
+};
+
+enum class Status : uint8_t {
+    OK = 0,
+    COMPILE_ERROR = 1,   /**< The errors text holds the compiler's errors. */
+    RUNTIME_ERROR = 2,   /**< The errors text holds the runtime errors. */
+    UNKNOWN_PROGRAM = 3, /**< RUN_PROGRAM named an id the daemon does not have (any more); send the source. */
+    BAD_REQUEST = 4,
+};
+
+/**
+ * @brief The fixed part of a response body.
+ */
+struct Reply {
+    Status status;
+    uint8_t expression;     // The program is a single expression, whose value is value
+    uint64_t program;       // Id of the program compiled or run; the daemon numbers programs and never reuses an id
+    double value;
+    uint32_t output_length; // Bytes of output text following the header; the errors text fills the rest
+};
+
+const uint32_t kMaxFrame = 64u << 20; // Longer frames are refused
+
+} // namespace daemon_protocol
+
+/**
+ * @brief A long-lived compile-and-run server on a Unix domain socket (POSIX only), so that
+ * callers pay neither process startup nor a cold compile per script.
+ *
+ * Compiled programs stay cached by their source, along with the string literals they
+ * pre-hashed, under ids the daemon hands out in order; when the cache is full the oldest
+ * program is dropped. Runs borrow warmed execution contexts from a ContextPool.
+ *
+ * One thread accepts connections, polls them and reads requests without blocking. Once a
+ * whole request has arrived on a connection, the connection is handed to one of a fixed set
+ * of worker threads, which answers that request and hands it back. Idle clients, and clients
+ * that stall in the middle of a request, hold no thread; clients that keep a connection open
+ * pay one round trip per request. A client that does not read its reply is disconnected
+ * after kReplyTimeoutSeconds.
+ */
+class Daemon {
+public:
+    /**
+     * @param threads Requests served at the same time; 0 uses the number of hardware threads.
+     * @param inputs How every program runs (Inputs::output is ignored: output goes in the reply).
+     */
+    Daemon(size_t threads, const cocompiler::Inputs& inputs = cocompiler::Inputs());
+    ~Daemon(); // Stops serving
+
+    /**
+     * @brief Binds the socket (replacing a stale socket file) and starts the serving threads.
+     * @return False, after reporting on std::cerr, if the socket could not be set up.
+     */
+    bool start(const std::string& path);
+
+    void wait(); // Blocks until stop() (from any thread, or a signal handler)
+    void stop();
+
+    size_t getThreads() const { return thread_count; } // Worker threads
+    uint64_t getRequests() const { return requests.load(); }
+    uint64_t getCompiles() const { return compiles.load(); } // Requests that missed the program cache
+
+    static const int kReplyTimeoutSeconds = 10;
+
+private:
+    struct Entry {
+        std::string source;
+        cocompiler::Program program;
+    };
+
+    // A connection passed between the poll thread and the workers, with what was read from it
+    struct Handoff {
+        int connection;
+        std::string request; // The body of the request to answer
+        std::string input;   // Bytes that arrived after it: the start of the next request
+    };
+
+    // A worker's buffers, reused from request to request
+    struct Scratch {
+        std::string source;
+        std::string response;
+        cocompiler::Result result;
+    };
+
+    size_t thread_count;
+    cocompiler::Inputs inputs;
+    std::string socket_path;
+    int listener;
+    int wake[2]; // A pipe that wakes the poll thread: a connection was handed back, or stop() was called
+    std::thread poller;
+    std::vector<std::thread> threads;
+    std::unique_ptr<std::atomic<int>[]> connections; // The connection each worker is serving, or -1
+    std::mutex queue_mutex;
+    std::condition_variable queue_ready;
+    std::deque<Handoff> ready;     // Connections with a whole request read, for the workers
+    std::vector<Handoff> returned; // Connections the workers answered, for the poll thread to watch again
+    cocompiler::ContextPool contexts;
+    std::atomic<bool> stopping;
+    std::shared_mutex programs_mutex;
+    std::map<uint64_t, Entry> programs; // By id; ids count up, so the first entry is the oldest
+    std::unordered_map<std::string_view, uint64_t> ids; // Each program's source (viewing its entry's copy) to its id
+    uint64_t next_id;
+    std::atomic<uint64_t> requests;
+    std::atomic<uint64_t> compiles;
+
+    void pollLoop();
+    void workerLoop(size_t self);
+    bool serveRequest(int connection, const std::string& frame, Scratch& scratch);
+    cocompiler::Program lookup(const std::string& source, uint64_t& id);
+    bool find(uint64_t id, cocompiler::Program& program);
+};
+
+/**
+ * @brief A connection to a Daemon.
+ */
+class DaemonClient {
+public:
+    DaemonClient();
+    ~DaemonClient();
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    /**
+     * @return False, after reporting on std::cerr, if nothing is listening at path.
+     */
+    bool connect(const std::string& path);
+
+    /**
+     * @brief Sends one request and waits for its reply.
+     * @return False if the connection failed; the reply's status says how the request went.
+     */
+    bool request(daemon_protocol::Request type, const std::string& payload, daemon_protocol::Reply& reply,
+                 std::string& output, std::string& errors);
+
+    bool runSource(const std::string& source, daemon_protocol::Reply& reply, std::string& output, std::string& errors) {
+        return request(daemon_protocol::Request::RUN_SOURCE, source, reply, output, errors);
+    }
+
+private:
+    int socket_fd;
+    std::string buffer; // Reused for frames in both directions
+};
+
+#endif // DAEMON_H
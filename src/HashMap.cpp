@@ -0,0 +1,230 @@
+#include "HashMap.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Control byte values. Full slots hold a 7-bit hash tag (0..127), so both special
+// values have the sign bit set and a single movemask finds every free slot.
+static const int8_t kEmpty = -128;
+static const int8_t kDeleted = -2;
+static const size_t kNotFound = static_cast<size_t>(-1);
+
+// --- Hashing ---
+
+// The splitmix64 finalizer: spreads every input bit over the whole 64-bit result,
+// so both the 7-bit tag (low bits) and the probe start (high bits) are well mixed.
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t HashMap::hashInteger(int64_t key) {
+    return mix(static_cast<uint64_t>(key));
+}
+
+uint64_t HashMap::hashString(const std::string& key) {
+    uint64_t hash = 0xcbf29ce484222325ULL; // FNV-1a
+    for (unsigned char c : key) {
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return mix(hash);
+}
+
+uint64_t StringObject::getHash() const {
+    if (!hashed) {
+        hash = HashMap::hashString(value);
+        hashed = true;
+    }
+    return hash;
+}
+
+// --- Group matching ---
+
+static uint32_t matchByte(const int8_t* group, int8_t byte) {
+#if defined(__SSE2__)
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(byte))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < HashMap::kGroupWidth; ++i) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static uint32_t matchEmptyOrDeleted(const int8_t* group) {
+#if defined(__SSE2__)
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < HashMap::kGroupWidth; ++i) {
+        if (group[i] < 0) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
+
+static int lowestBit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1u)) { mask >>= 1; ++bit; }
+    return bit;
+#endif
+}
+
+static int8_t hashTag(uint64_t hash) {
+    return static_cast<int8_t>(hash & 0x7f);
+}
+
+// --- HashMap ---
+
+HashMap::HashMap() : capacity(0), count(0), growth_left(0) {
+    resize(kGroupWidth);
+}
+
+void HashMap::setCtrl(size_t index, int8_t value) {
+    ctrl[index] = value;
+    if (index < kGroupWidth) {
+        ctrl[capacity + index] = value; // Mirror, so a group starting near the end can be loaded unbroken
+    }
+}
+
+/**
+ * Probes group by group (triangular steps of whole groups, which visit every group of a
+ * power-of-two table) until the key is found or a group with an empty slot ends the chain.
+ */
+size_t HashMap::findIndex(uint64_t hash, bool isString, int64_t integer, const std::string* text) const {
+    size_t mask = capacity - 1;
+    size_t pos = (hash >> 7) & mask;
+    int8_t tag = hashTag(hash);
+    for (size_t step = kGroupWidth;; step += kGroupWidth) {
+        const int8_t* group = &ctrl[pos];
+        for (uint32_t candidates = matchByte(group, tag); candidates; candidates &= candidates - 1) {
+            size_t index = (pos + lowestBit(candidates)) & mask;
+            const Slot& slot = slots[index];
+            if (slot.hash == hash && slot.isString == isString &&
+                (isString ? string_keys[slot.key] == *text : slot.key == integer)) {
+                return index;
+            }
+        }
+        if (matchByte(group, kEmpty)) return kNotFound;
+        pos = (pos + step) & mask;
+    }
+}
+
+/**
+ * Returns a free slot on the key's probe chain, growing the table first if no empty
+ * slot may be consumed. The slot's control byte is set to the key's tag.
+ */
+size_t HashMap::prepareInsert(uint64_t hash) {
+    for (;;) {
+        size_t mask = capacity - 1;
+        size_t pos = (hash >> 7) & mask;
+        for (size_t step = kGroupWidth;; step += kGroupWidth) {
+            uint32_t free = matchEmptyOrDeleted(&ctrl[pos]);
+            if (free) {
+                size_t index = (pos + lowestBit(free)) & mask;
+                if (ctrl[index] == kEmpty) {
+                    if (growth_left == 0) break; // Grow, then probe again in the new table
+                    growth_left--;
+                }
+                setCtrl(index, hashTag(hash));
+                count++;
+                return index;
+            }
+            pos = (pos + step) & mask;
+        }
+        // Reclaim tombstones in place when the table is mostly deleted slots, otherwise double
+        resize(count < capacity * 7 / 16 ? capacity : capacity * 2);
+    }
+}
+
+void HashMap::resize(size_t newCapacity) {
+    std::vector<int8_t> oldCtrl = std::move(ctrl);
+    std::vector<Slot> oldSlots = std::move(slots);
+    size_t oldCapacity = capacity;
+
+    capacity = newCapacity;
+    ctrl.assign(capacity + kGroupWidth, kEmpty);
+    slots.clear();
+    slots.resize(capacity);
+    growth_left = capacity - capacity / 8;
+    count = 0;
+
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldCtrl[i] >= 0) {
+            // Every key is distinct, so slots go straight to the first free position
+            size_t index = prepareInsert(oldSlots[i].hash);
+            slots[index] = oldSlots[i];
+        }
+    }
+}
+
+double* HashMap::find(int64_t key) {
+    size_t index = findIndex(hashInteger(key), false, key, nullptr);
+    return index == kNotFound ? nullptr : &slots[index].value;
+}
+
+double* HashMap::find(const StringObject& key) {
+    size_t index = findIndex(key.getHash(), true, 0, &key.getValue());
+    return index == kNotFound ? nullptr : &slots[index].value;
+}
+
+void HashMap::set(int64_t key, double value) {
+    uint64_t hash = hashInteger(key);
+    size_t index = findIndex(hash, false, key, nullptr);
+    if (index == kNotFound) {
+        index = prepareInsert(hash);
+        Slot& slot = slots[index];
+        slot.hash = hash;
+        slot.isString = false;
+        slot.key = key;
+    }
+    slots[index].value = value;
+}
+
+void HashMap::set(const StringObject& key, double value) {
+    uint64_t hash = key.getHash();
+    size_t index = findIndex(hash, true, 0, &key.getValue());
+    if (index == kNotFound) {
+        index = prepareInsert(hash);
+        Slot& slot = slots[index];
+        slot.hash = hash;
+        slot.isString = true;
+        if (free_string_keys.empty()) {
+            slot.key = static_cast<int64_t>(string_keys.size());
+            string_keys.push_back(key.getValue());
+        } else {
+            slot.key = free_string_keys.back();
+            free_string_keys.pop_back();
+            string_keys[slot.key] = key.getValue();
+        }
+    }
+    slots[index].value = value;
+}
+
+bool HashMap::erase(int64_t key) {
+    size_t index = findIndex(hashInteger(key), false, key, nullptr);
+    if (index == kNotFound) return false;
+    setCtrl(index, kDeleted); // A tombstone keeps later keys on this probe chain reachable
+    count--;
+    return true;
+}
+
+bool HashMap::erase(const StringObject& key) {
+    size_t index = findIndex(key.getHash(), true, 0, &key.getValue());
+    if (index == kNotFound) return false;
+    setCtrl(index, kDeleted);
+    string_keys[slots[index].key].clear();
+    free_string_keys.push_back(slots[index].key);
+    count--;
+    return true;
+}
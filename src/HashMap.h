@@ -0,0 +1,103 @@
+#ifndef HASH_MAP_H
+#define HASH_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief A VM string that computes its hash on first use and caches it, so a string used
+ * as a map key repeatedly is only hashed once.
+ *
+ * Scripts cannot change a string once it is made; only the VM rewrites one in place, with
+ * assign(), when it reuses the object of a string from an earlier run (see StringArena in
+ * VM.h). assign() drops the cached hash, which is recomputed on the next getHash().
+ */
+class StringObject {
+private:
+    std::string value;
+    mutable uint64_t hash;
+    mutable bool hashed;
+
+public:
+    StringObject(std::string value) : value(std::move(value)), hash(0), hashed(false) {}
+
+    const std::string& getValue() const { return value; }
+    uint64_t getHash() const;
+
+    // Makes this object first + second, keeping its buffer, so a reused object need not allocate (see StringArena)
+    void assign(std::string_view first, std::string_view second) {
+        value.assign(first.data(), first.size());
+        value.append(second.data(), second.size());
+        hashed = false;
+    }
+};
+
+/**
+ * @brief An open-addressing hash map from integer or string keys to numbers.
+ *
+ * The layout follows the Swiss-table design: a dense array of one-byte control words
+ * (empty, deleted, or the low 7 bits of a full slot's hash) sits beside the slot array.
+ * Lookups probe the control bytes a group of 16 at a time (one SSE2 compare where
+ * available), so most misses and hits touch a single cache line of metadata and only
+ * compare keys whose 7-bit hash tag already matches. String keys are stored out of line
+ * so slots stay small and two fit in a cache line. The table keeps at most 7/8 of its
+ * slots in use and grows by doubling. Each slot caches its key's full hash, so growing
+ * never rehashes keys.
+ */
+class HashMap {
+public:
+    static constexpr size_t kGroupWidth = 16;
+
+    HashMap();
+
+    /**
+     * @brief Looks up a key.
+     * @return A pointer to the key's value, or nullptr if the key is absent.
+     */
+    double* find(int64_t key);
+    double* find(const StringObject& key);
+
+    /**
+     * @brief Inserts a key or overwrites its value.
+     */
+    void set(int64_t key, double value);
+    void set(const StringObject& key, double value);
+
+    /**
+     * @brief Removes a key.
+     * @return True if the key was present.
+     */
+    bool erase(int64_t key);
+    bool erase(const StringObject& key);
+
+    size_t size() const { return count; }
+
+    static uint64_t hashInteger(int64_t key);
+    static uint64_t hashString(const std::string& key);
+
+private:
+    struct Slot {
+        uint64_t hash; // Full hash of the key, cached for growth
+        int64_t key;   // The integer key, or an index into string_keys
+        double value;
+        bool isString;
+    };
+
+    std::vector<int8_t> ctrl; // capacity control bytes, then the first kGroupWidth mirrored
+    std::vector<Slot> slots;
+    size_t capacity;          // Always a power of two, at least kGroupWidth
+    size_t count;             // Full slots
+    size_t growth_left;       // Empty slots that may still be filled before the table grows
+    std::vector<std::string> string_keys; // Out-of-line string keys, keeping slots small (32 bytes)
+    std::vector<int64_t> free_string_keys; // Reusable entries of string_keys
+
+    size_t findIndex(uint64_t hash, bool isString, int64_t integer, const std::string* text) const;
+    size_t prepareInsert(uint64_t hash);
+    void setCtrl(size_t index, int8_t value);
+    void resize(size_t newCapacity);
+};
+
+#endif // HASH_MAP_H
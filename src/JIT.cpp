@@ -0,0 +1,730 @@
+#include "JIT.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include "Verifier.h"
+#include "VM.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define COCOMPILER_JIT_X86_64 1
+#include <sys/mman.h>
+#endif
+
+/**
+ * @brief The state generated code reads and writes through rbx.
+ * Standard layout, so the templates address its fields with offsetof.
+ */
+struct JIT::Context {
+    double* top;                // Top of the operand stack (the ValueStack guard slot when empty); cached in r13
+    double* frame;              // Slot 0 of the current frame; cached in r12
+    double* values;             // The ValueStack's element 0
+    double* limit;              // One past the ValueStack's capacity
+    Frame* frames;              // The VM's call frames
+    int64_t frame_count;        // Authoritative while compiled code runs, like back_edges_taken
+    uint64_t max_frames;        // The VM's maximum call depth
+    double* memory;             // Global variables; cached in r15
+    uint64_t memory_size;       // Number of globals
+    uint32_t* back_edge_counts; // The VM's hotness counters
+    uint64_t back_edges_taken;  // Authoritative while compiled code runs; copied to and from the VM around each step
+    uint64_t limit_check_after; // The VM's limit_check_at - 1: the back-edge after this many calls the limit helper
+    uint64_t calls_taken;       // Authoritative while compiled code runs, like back_edges_taken
+    uint64_t call_check_after;  // The VM's call_check_at - 1: the call after this many calls the limit helper
+    const uint8_t* const* entries; // JIT::entries
+    int64_t pc;                 // Instruction to start at
+    int64_t end;                // Program size
+    uint64_t max_height;        // JIT::max_height
+    VM* vm;
+    bool halted;                // Set when HALT ran
+    double result;              // The value HALT returned
+};
+
+JIT::JIT() : code(nullptr), code_size(0), max_height(0) {}
+
+JIT::~JIT() {
+#ifdef COCOMPILER_JIT_X86_64
+    if (code) munmap(code, code_size);
+#endif
+}
+
+bool JIT::isSupported() {
+#ifdef COCOMPILER_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef COCOMPILER_JIT_X86_64
+
+// --- x86-64 encoding ---
+
+namespace {
+
+enum Reg { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSP = 4, RBP = 5, RSI = 6, RDI = 7,
+           R12 = 12, R13 = 13, R14 = 14, R15 = 15 };
+
+// Condition codes (the low nibble of Jcc and SETcc)
+enum Cond { CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+            CC_S = 0x8, CC_P = 0xA, CC_NP = 0xB };
+
+/**
+ * @brief Appends x86-64 instructions to a byte buffer.
+ * Only the forms the templates need; memory operands always use a 32-bit displacement.
+ */
+class Assembler {
+public:
+    std::vector<uint8_t> bytes;
+
+    size_t offset() const { return bytes.size(); }
+    void byte(uint8_t value) { bytes.push_back(value); }
+    void u32(uint32_t value) { for (int i = 0; i < 4; ++i) byte(static_cast<uint8_t>(value >> (8 * i))); }
+    void u64(uint64_t value) { for (int i = 0; i < 8; ++i) byte(static_cast<uint8_t>(value >> (8 * i))); }
+
+    void rex(bool wide, int reg, int index, int base) {
+        uint8_t value = 0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+        if (value != 0x40) byte(value);
+    }
+    // ModRM (and SIB) for [base + disp32]
+    void memory(int reg, int base, int32_t disp) {
+        byte(static_cast<uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == RSP) byte(0x24);
+        u32(static_cast<uint32_t>(disp));
+    }
+
+    // General-purpose instructions (64-bit)
+    void movLoad(int reg, int base, int32_t disp) { rex(true, reg, 0, base); byte(0x8B); memory(reg, base, disp); }
+    void movStore(int base, int32_t disp, int reg) { rex(true, reg, 0, base); byte(0x89); memory(reg, base, disp); }
+    void movRegReg(int dst, int src) { rex(true, src, 0, dst); byte(0x89); byte(static_cast<uint8_t>(0xC0 | ((src & 7) << 3) | (dst & 7))); }
+    void movImm64(int reg, uint64_t value) { rex(true, 0, 0, reg); byte(static_cast<uint8_t>(0xB8 | (reg & 7))); u64(value); }
+    void movEsiImm(uint32_t value) { byte(0xBE); u32(value); }
+    void lea(int reg, int base, int32_t disp) { rex(true, reg, 0, base); byte(0x8D); memory(reg, base, disp); }
+    void addImm8(int reg, int8_t value) { rex(true, 0, 0, reg); byte(0x83); byte(static_cast<uint8_t>(0xC0 | (reg & 7))); byte(static_cast<uint8_t>(value)); }
+    void cmpRegMem(int reg, int base, int32_t disp) { rex(true, reg, 0, base); byte(0x3B); memory(reg, base, disp); }
+    void cmpMemImm32(int base, int32_t disp, int32_t value) { rex(true, 0, 0, base); byte(0x81); memory(7, base, disp); u32(static_cast<uint32_t>(value)); }
+    void addMem32Imm8(int base, int32_t disp, int8_t value) { rex(false, 0, 0, base); byte(0x83); memory(0, base, disp); byte(static_cast<uint8_t>(value)); }
+    void testRaxRax() { byte(0x48); byte(0x85); byte(0xC0); }
+    void incRax() { byte(0x48); byte(0xFF); byte(0xC0); }
+    void decRax() { byte(0x48); byte(0xFF); byte(0xC8); }
+    void shrImm8(int reg, uint8_t count) { rex(true, 0, 0, reg); byte(0xC1); byte(static_cast<uint8_t>(0xE8 | (reg & 7))); byte(count); }
+    void subRegMem(int reg, int base, int32_t disp) { rex(true, reg, 0, base); byte(0x2B); memory(reg, base, disp); }
+    // Frame fields: [rcx + rax*8 + disp]
+    void frameStoreImm(int32_t disp, uint32_t value) { byte(0xC7); byte(0x84); byte(0xC1); u32(static_cast<uint32_t>(disp)); u32(value); }
+    void frameStoreEdx(int32_t disp) { byte(0x89); byte(0x94); byte(0xC1); u32(static_cast<uint32_t>(disp)); }
+    void frameLoad(int reg, int32_t disp) { rex(true, reg, 0, 0); byte(0x63); byte(static_cast<uint8_t>(0x84 | ((reg & 7) << 3))); byte(0xC1); u32(static_cast<uint32_t>(disp)); }
+    // lea reg, [rsi + rdx*8]
+    void leaStackSlot(int reg) { rex(true, reg, 0, 0); byte(0x8D); byte(static_cast<uint8_t>(((reg & 7) << 3) | 4)); byte(0xD6); }
+    void movsxdRaxEax() { byte(0x48); byte(0x63); byte(0xC0); }
+    void push(int reg) { rex(false, 0, 0, reg); byte(static_cast<uint8_t>(0x50 | (reg & 7))); }
+    void pop(int reg) { rex(false, 0, 0, reg); byte(static_cast<uint8_t>(0x58 | (reg & 7))); }
+    void callRax() { byte(0xFF); byte(0xD0); }
+    void ret() { byte(0xC3); }
+    void jmpTable() { byte(0xFF); byte(0x24); byte(0xC1); } // jmp [rcx + rax*8]
+    void setcc(Cond cond, int reg) { byte(0x0F); byte(static_cast<uint8_t>(0x90 | cond)); byte(static_cast<uint8_t>(0xC0 | reg)); }
+    void andAlCl() { byte(0x20); byte(0xC8); }
+    void orAlCl() { byte(0x08); byte(0xC8); }
+    void movzxEaxAl() { byte(0x0F); byte(0xB6); byte(0xC0); }
+
+    // Jumps with a 32-bit displacement; the returned position is patched by bind() or link()
+    size_t jmp() { byte(0xE9); u32(0); return offset() - 4; }
+    size_t jcc(Cond cond) { byte(0x0F); byte(static_cast<uint8_t>(0x80 | cond)); u32(0); return offset() - 4; }
+    void link(size_t at, size_t target) {
+        uint32_t rel = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        std::memcpy(&bytes[at], &rel, 4);
+    }
+    void bind(size_t at) { link(at, offset()); }
+
+    // Scalar double instructions: prefix 0F op /r
+    void sseRegReg(uint8_t prefix, uint8_t op, int dst, int src) {
+        byte(prefix); byte(0x0F); byte(op); byte(static_cast<uint8_t>(0xC0 | (dst << 3) | src));
+    }
+    void sseRegMem(uint8_t prefix, uint8_t op, int xmm, int base, int32_t disp) {
+        byte(prefix); rex(false, xmm, 0, base); byte(0x0F); byte(op); memory(xmm, base, disp);
+    }
+    // [base + index*8] without displacement (base must not be rbp or r13)
+    void sseRegIndexed(uint8_t prefix, uint8_t op, int xmm, int base, int index) {
+        byte(prefix); rex(false, xmm, index, base); byte(0x0F); byte(op);
+        byte(static_cast<uint8_t>(((xmm & 7) << 3) | 4));
+        byte(static_cast<uint8_t>(0xC0 | ((index & 7) << 3) | (base & 7)));
+    }
+    void movsdLoad(int xmm, int base, int32_t disp) { sseRegMem(0xF2, 0x10, xmm, base, disp); }
+    void movsdStore(int base, int32_t disp, int xmm) { sseRegMem(0xF2, 0x11, xmm, base, disp); }
+    void arith(uint8_t op, int dst, int src) { sseRegReg(0xF2, op, dst, src); } // 58 add, 5C sub, 59 mul, 5E div
+    void movapd(int dst, int src) { sseRegReg(0x66, 0x28, dst, src); }
+    void xorpd(int dst, int src) { sseRegReg(0x66, 0x57, dst, src); }
+    void ucomisd(int left, int right) { sseRegReg(0x66, 0x2E, left, right); }
+    void movqXmmRax(int xmm) { byte(0x66); byte(0x48); byte(0x0F); byte(0x6E); byte(static_cast<uint8_t>(0xC0 | (xmm << 3))); }
+    void cvtsi2sdEax(int xmm) { sseRegReg(0xF2, 0x2A, xmm, RAX); }
+    void cvttsd2siEax(int xmm) { sseRegReg(0xF2, 0x2C, RAX, xmm); }
+};
+
+// Register assignment of generated code
+const int CONTEXT = RBX; // JIT::Context*
+const int FRAME = R12;   // Slot 0 of the current frame
+const int TOP = R13;     // The top stack slot; its value is in xmm0, and memory may be stale
+const int GLOBALS = R15; // Global variables
+
+#define CONTEXT_FIELD(field) static_cast<int32_t>(offsetof(JIT::Context, field))
+
+uint64_t doubleBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof bits);
+    return bits;
+}
+
+} // namespace
+
+/**
+ * @brief Translates a verified program instruction by instruction.
+ */
+class TemplateCompiler {
+public:
+    TemplateCompiler(BytecodeView program, const std::vector<int>& heights, size_t maxHeight,
+                     void* step, void* limits)
+        : program(program), heights(heights), max_height(maxHeight), step_helper(step), limits_helper(limits), exit_label(0) {}
+
+    Assembler a;
+    std::vector<size_t> starts; // Code offset of each instruction, plus the end block
+
+    void compile() {
+        emitPrologue();
+        for (size_t pc = 0; pc < program.size(); ++pc) {
+            starts.push_back(a.offset());
+            if (heights[pc] < 0) {
+                emitStep(static_cast<int>(pc), false); // Unreachable as far as the verifier knows
+            } else {
+                emitInstruction(static_cast<int>(pc), program[pc]);
+            }
+        }
+        starts.push_back(a.offset());
+        emitStep(static_cast<int>(program.size()), false); // Running off the end is an interpreter error
+        for (const auto& jump : jumps) {
+            a.link(jump.first, starts[jump.second]);
+        }
+    }
+
+private:
+    BytecodeView program;
+    const std::vector<int>& heights;
+    size_t max_height;
+    void* step_helper;
+    void* limits_helper;
+    size_t exit_label;
+    std::vector<std::pair<size_t, int>> jumps; // Displacements to patch with an instruction's start
+
+    int clampTarget(int target) const {
+        return target < 0 || target > static_cast<int>(program.size()) ? static_cast<int>(program.size()) : target;
+    }
+    void jumpTo(int target) { jumps.push_back({a.jmp(), clampTarget(target)}); }
+    void jumpTo(Cond cond, int target) { jumps.push_back({a.jcc(cond), clampTarget(target)}); }
+
+    void reload() {
+        a.movLoad(FRAME, CONTEXT, CONTEXT_FIELD(frame));
+        a.movLoad(TOP, CONTEXT, CONTEXT_FIELD(top));
+        a.movLoad(GLOBALS, CONTEXT, CONTEXT_FIELD(memory));
+        a.movsdLoad(0, TOP, 0);
+    }
+    void dispatchRax() {
+        a.movLoad(RCX, CONTEXT, CONTEXT_FIELD(entries));
+        a.jmpTable();
+    }
+
+    // Saves callee-saved registers, loads the cached state and jumps to the start instruction
+    void emitPrologue() {
+        a.push(RBX); a.push(RBP); a.push(R12); a.push(R13); a.push(R14); a.push(R15);
+        a.addImm8(RSP, -8); // Six pushes and the return address: realign to 16 for helper calls
+        a.movRegReg(CONTEXT, RDI);
+        reload();
+        a.movLoad(RAX, CONTEXT, CONTEXT_FIELD(pc));
+        dispatchRax();
+        exit_label = a.offset();
+        a.addImm8(RSP, 8);
+        a.pop(R15); a.pop(R14); a.pop(R13); a.pop(R12); a.pop(RBP); a.pop(RBX);
+        a.ret();
+    }
+
+    /**
+     * Writes back the cached top and runs instruction pc in the interpreter. The helper
+     * returns the next instruction, or -1 after HALT or an error. Sequential instructions
+     * fall through to the next template; others dispatch through the entry table.
+     */
+    void emitStep(int pc, bool sequential) {
+        a.movsdStore(TOP, 0, 0);
+        a.movRegReg(RDI, CONTEXT);
+        a.movEsiImm(static_cast<uint32_t>(pc));
+        a.movRegReg(RDX, TOP);
+        a.movImm64(RAX, reinterpret_cast<uint64_t>(step_helper));
+        a.callRax();
+        a.testRaxRax();
+        a.link(a.jcc(CC_S), exit_label);
+        reload();
+        if (!sequential) dispatchRax();
+    }
+
+    // Counts a taken back-edge as VM::onBackEdge does, calling the limit helper when the VM's next check is due
+    // and leaving if it reports a limit exceeded
+    void emitBackEdge(int target) {
+        a.movLoad(RAX, CONTEXT, CONTEXT_FIELD(back_edge_counts));
+        a.addMem32Imm8(RAX, target * 4, 1);
+        emitLimitCount(CONTEXT_FIELD(back_edges_taken), CONTEXT_FIELD(limit_check_after), target);
+    }
+
+    // Adds one to the counter at taken and, once it passes the threshold at after, calls the limit helper
+    // (reporting target), leaving if it reports a limit exceeded
+    void emitLimitCount(int32_t taken, int32_t after, int target) {
+        a.movLoad(RAX, CONTEXT, taken);
+        a.addImm8(RAX, 1);
+        a.movStore(CONTEXT, taken, RAX);
+        a.cmpRegMem(RAX, CONTEXT, after);
+        size_t within = a.jcc(CC_BE);
+        a.movsdStore(TOP, 0, 0); // xmm0 does not survive the call
+        a.movRegReg(RDI, CONTEXT);
+        a.movEsiImm(static_cast<uint32_t>(target));
+        a.movImm64(RAX, reinterpret_cast<uint64_t>(limits_helper));
+        a.callRax();
+        a.testRaxRax();
+        size_t resume = a.jcc(CC_NE);
+        a.link(a.jmp(), exit_label);
+        a.bind(resume);
+        a.movsdLoad(0, TOP, 0);
+        a.bind(within);
+    }
+
+    // Jumps to target, counting a back-edge when the interpreter would (target at or before pc)
+    void emitJump(int pc, int target) {
+        if (target >= 0 && target <= pc) emitBackEdge(target);
+        jumpTo(target);
+    }
+
+    void emitPush() {
+        a.movsdStore(TOP, 0, 0);
+        a.lea(TOP, TOP, 8);
+    }
+    void emitPop() {
+        a.lea(TOP, TOP, -8);
+        a.movsdLoad(0, TOP, 0);
+    }
+    void emitConstant(double value) {
+        emitPush();
+        if (doubleBits(value) == 0) {
+            a.xorpd(0, 0);
+        } else {
+            a.movImm64(RAX, doubleBits(value));
+            a.movqXmmRax(0);
+        }
+    }
+    // xmm0 = second-from-top OP top, popping one
+    void emitArithmetic(uint8_t op) {
+        a.movsdLoad(1, TOP, -8);
+        a.arith(op, 1, 0);
+        a.movapd(0, 1);
+        a.lea(TOP, TOP, -8);
+    }
+    // xmm0 = 1.0 or 0.0 from the flags just set by ucomisd
+    void emitFlagsToBool(Instruction comparison) {
+        switch (comparison) {
+            case Instruction::GREATER:
+            case Instruction::LESS: a.setcc(CC_A, RAX); break;
+            case Instruction::GREATER_EQUAL:
+            case Instruction::LESS_EQUAL: a.setcc(CC_AE, RAX); break;
+            case Instruction::EQUAL_EQUAL: a.setcc(CC_E, RAX); a.setcc(CC_NP, RCX); a.andAlCl(); break;
+            default: a.setcc(CC_NE, RAX); a.setcc(CC_P, RCX); a.orAlCl(); break; // BANG_EQUAL, true when unordered
+        }
+        a.movzxEaxAl();
+        a.cvtsi2sdEax(0);
+    }
+    void emitComparison(Instruction comparison) {
+        a.movsdLoad(1, TOP, -8);
+        a.lea(TOP, TOP, -8);
+        // ucomisd sets "above" for left > right, so < and <= compare the other way round
+        if (comparison == Instruction::LESS || comparison == Instruction::LESS_EQUAL) {
+            a.ucomisd(0, 1);
+        } else {
+            a.ucomisd(1, 0);
+        }
+        emitFlagsToBool(comparison);
+    }
+    // Converts the address on top of the stack to an index, going to the returned jumps when it is not a valid global
+    void emitGlobalIndex(size_t& negative, size_t& beyond) {
+        a.cvttsd2siEax(0);
+        a.movsxdRaxEax();
+        a.testRaxRax();
+        negative = a.jcc(CC_S);
+        a.cmpRegMem(RAX, CONTEXT, CONTEXT_FIELD(memory_size));
+        beyond = a.jcc(CC_AE);
+    }
+
+    /**
+     * Pushes a frame as VM CALL does and jumps to the callee. Exceeding the call depth, or
+     * the stack capacity the callee's templates rely on, goes to the interpreter instead
+     * (which reports the overflow, or grows the stack).
+     */
+    void emitCall(int pc, const Bytecode& instruction) {
+        int argc = instruction.operand2;
+        int frameSize = instruction.operand3;
+        if (frameSize - argc > 32) { // Zeroing large frames inline is not worth the code
+            emitStep(pc, false);
+            return;
+        }
+        a.movLoad(RAX, CONTEXT, CONTEXT_FIELD(frame_count));
+        a.cmpRegMem(RAX, CONTEXT, CONTEXT_FIELD(max_frames));
+        size_t tooDeep = a.jcc(CC_AE);
+        a.lea(RDX, TOP, (static_cast<int32_t>(max_height) + 2 - argc) * 8);
+        a.cmpRegMem(RDX, CONTEXT, CONTEXT_FIELD(limit));
+        size_t tooSmall = a.jcc(CC_A);
+
+        a.movsdStore(TOP, 0, 0); // The last argument
+        a.movLoad(RCX, CONTEXT, CONTEXT_FIELD(frames));
+        a.frameStoreImm(static_cast<int32_t>(offsetof(Frame, return_pc)), static_cast<uint32_t>(pc + 1));
+        a.lea(FRAME, TOP, 8 - argc * 8); // The arguments become the callee's first slots
+        a.movRegReg(RDX, FRAME);
+        a.subRegMem(RDX, CONTEXT, CONTEXT_FIELD(values));
+        a.shrImm8(RDX, 3);
+        a.frameStoreEdx(static_cast<int32_t>(offsetof(Frame, base)));
+        a.incRax();
+        a.movStore(CONTEXT, CONTEXT_FIELD(frame_count), RAX);
+        a.movStore(CONTEXT, CONTEXT_FIELD(frame), FRAME);
+        a.xorpd(1, 1);
+        for (int slot = argc; slot < frameSize; ++slot) {
+            a.movsdStore(FRAME, slot * 8, 1);
+        }
+        a.lea(TOP, FRAME, (frameSize - 1) * 8);
+        a.movsdLoad(0, TOP, 0);
+        emitLimitCount(CONTEXT_FIELD(calls_taken), CONTEXT_FIELD(call_check_after), static_cast<int>(instruction.operand));
+        jumpTo(static_cast<int>(instruction.operand));
+
+        a.bind(tooDeep);
+        a.bind(tooSmall);
+        emitStep(pc, false);
+    }
+
+    // Pops a frame as VM RET does, leaving the return value (xmm0) in the callee's slot 0
+    void emitReturn(int pc) {
+        a.movLoad(RAX, CONTEXT, CONTEXT_FIELD(frame_count));
+        a.testRaxRax();
+        size_t topLevel = a.jcc(CC_E);
+        a.decRax();
+        a.movStore(CONTEXT, CONTEXT_FIELD(frame_count), RAX);
+        a.movLoad(RCX, CONTEXT, CONTEXT_FIELD(frames));
+        a.movLoad(RSI, CONTEXT, CONTEXT_FIELD(values));
+        a.frameLoad(RDX, static_cast<int32_t>(offsetof(Frame, base)));
+        a.leaStackSlot(TOP);
+        a.movRegReg(FRAME, RSI);
+        a.testRaxRax();
+        size_t outermost = a.jcc(CC_E);
+        a.frameLoad(RDX, static_cast<int32_t>(offsetof(Frame, base)) - static_cast<int32_t>(sizeof(Frame)));
+        a.leaStackSlot(FRAME);
+        a.bind(outermost);
+        a.movStore(CONTEXT, CONTEXT_FIELD(frame), FRAME);
+        a.frameLoad(RAX, static_cast<int32_t>(offsetof(Frame, return_pc)));
+        dispatchRax();
+
+        a.bind(topLevel);
+        emitStep(pc, false); // Reports RET outside of a function
+    }
+
+    void emitInstruction(int pc, const Bytecode& instruction) {
+        int target = static_cast<int>(instruction.operand);
+        switch (instruction.instruction) {
+            case Instruction::PUSH_INT:
+            case Instruction::PUSH_FLOAT:
+            case Instruction::PUSH_STRING:
+                emitConstant(instruction.operand);
+                break;
+            case Instruction::ADD: emitArithmetic(0x58); break;
+            case Instruction::SUB: emitArithmetic(0x5C); break;
+            case Instruction::MUL: emitArithmetic(0x59); break;
+            case Instruction::DIV: {
+                // A zero divisor (but not NaN) goes to the interpreter, which reports it
+                a.xorpd(1, 1);
+                a.ucomisd(0, 1);
+                size_t unordered = a.jcc(CC_P);
+                size_t nonZero = a.jcc(CC_NE);
+                emitStep(pc, true);
+                a.bind(unordered);
+                a.bind(nonZero);
+                emitArithmetic(0x5E);
+                break;
+            }
+            case Instruction::NEGATE:
+                a.movImm64(RAX, 0x8000000000000000ULL);
+                a.movqXmmRax(1);
+                a.xorpd(0, 1);
+                break;
+            case Instruction::NOT:
+                a.xorpd(1, 1);
+                a.ucomisd(0, 1);
+                emitFlagsToBool(Instruction::EQUAL_EQUAL);
+                break;
+            case Instruction::POP:
+                emitPop();
+                break;
+            case Instruction::GREATER: case Instruction::LESS: case Instruction::GREATER_EQUAL:
+            case Instruction::LESS_EQUAL: case Instruction::EQUAL_EQUAL: case Instruction::BANG_EQUAL:
+                emitComparison(instruction.instruction);
+                break;
+            case Instruction::LOAD: {
+                size_t negative, beyond;
+                emitGlobalIndex(negative, beyond);
+                a.sseRegIndexed(0xF2, 0x10, 0, GLOBALS, RAX);
+                size_t done = a.jmp();
+                a.bind(negative);
+                a.bind(beyond);
+                emitStep(pc, true); // Reports the invalid address
+                a.bind(done);
+                break;
+            }
+            case Instruction::STORE: {
+                size_t negative, beyond;
+                emitGlobalIndex(negative, beyond);
+                a.movsdLoad(0, TOP, -8);
+                a.lea(TOP, TOP, -8);
+                a.sseRegIndexed(0xF2, 0x11, 0, GLOBALS, RAX);
+                size_t done = a.jmp();
+                a.bind(negative);
+                a.bind(beyond);
+                emitStep(pc, true); // Grows memory for a new global, or reports a negative address
+                a.bind(done);
+                break;
+            }
+            case Instruction::JUMP:
+                emitJump(pc, target);
+                break;
+            case Instruction::JUMP_IF_FALSE:
+            case Instruction::JUMP_IF_TRUE: {
+                // The condition is false exactly when it compares equal (and ordered) to zero
+                a.xorpd(1, 1);
+                a.ucomisd(0, 1);
+                a.lea(TOP, TOP, -8); // lea and movsd leave the flags alone
+                a.movsdLoad(0, TOP, 0);
+                bool backward = target >= 0 && target <= pc;
+                if (instruction.instruction == Instruction::JUMP_IF_FALSE) {
+                    size_t unordered = a.jcc(CC_P);
+                    if (backward) {
+                        size_t nonZero = a.jcc(CC_NE);
+                        emitJump(pc, target);
+                        a.bind(nonZero);
+                    } else {
+                        jumpTo(CC_E, target);
+                    }
+                    a.bind(unordered);
+                } else if (backward) {
+                    size_t taken = a.jcc(CC_P);
+                    size_t zero = a.jcc(CC_E);
+                    a.bind(taken);
+                    emitJump(pc, target);
+                    a.bind(zero);
+                } else {
+                    jumpTo(CC_P, target);
+                    jumpTo(CC_NE, target);
+                }
+                break;
+            }
+            case Instruction::LOOP_INC_CMP_JUMP:
+            case Instruction::LOOP_INC_CMP_JUMP_LOCAL: {
+                Instruction comparison = static_cast<Instruction>(instruction.operand3);
+                bool local = instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL;
+                bool validComparison = comparison == Instruction::LESS || comparison == Instruction::LESS_EQUAL ||
+                                       comparison == Instruction::GREATER || comparison == Instruction::GREATER_EQUAL;
+                if (!validComparison || (!local && (instruction.operand2 < 0 || instruction.operand2 >= (1 << 27)))) {
+                    emitStep(pc, false); // Reports the error
+                    break;
+                }
+                size_t missing = 0;
+                if (!local) {
+                    a.cmpMemImm32(CONTEXT, CONTEXT_FIELD(memory_size), instruction.operand2);
+                    missing = a.jcc(CC_BE);
+                }
+                int base = local ? FRAME : GLOBALS;
+                int32_t disp = instruction.operand2 * 8;
+                a.movapd(2, 0); // The limit
+                a.lea(TOP, TOP, -8);
+                a.movsdLoad(1, base, disp);
+                a.movImm64(RAX, doubleBits(static_cast<double>(instruction.operand4)));
+                a.movqXmmRax(3);
+                a.arith(0x58, 1, 3);
+                a.movsdStore(base, disp, 1);
+                a.movsdLoad(0, TOP, 0); // After the store, in case the counter is the new top
+                bool upward = comparison == Instruction::LESS || comparison == Instruction::LESS_EQUAL;
+                if (upward) {
+                    a.ucomisd(2, 1); // limit above counter
+                } else {
+                    a.ucomisd(1, 2); // counter above limit
+                }
+                bool inclusive = comparison == Instruction::LESS_EQUAL || comparison == Instruction::GREATER_EQUAL;
+                size_t exit = a.jcc(inclusive ? CC_B : CC_BE);
+                emitBackEdge(target);
+                jumpTo(target);
+                if (!local) {
+                    a.bind(missing);
+                    emitStep(pc, false); // Reports the invalid address
+                }
+                a.bind(exit);
+                break;
+            }
+            case Instruction::LOAD_LOCAL:
+                emitPush();
+                a.movsdLoad(0, FRAME, target * 8);
+                break;
+            case Instruction::STORE_LOCAL:
+                a.movsdStore(FRAME, target * 8, 0);
+                if (instruction.operand2) emitPop();
+                break;
+            case Instruction::LOAD_GLOBAL:
+            case Instruction::STORE_GLOBAL: {
+                if (target >= (1 << 27)) {
+                    emitStep(pc, true);
+                    break;
+                }
+                a.cmpMemImm32(CONTEXT, CONTEXT_FIELD(memory_size), target);
+                size_t missing = a.jcc(CC_BE);
+                if (instruction.instruction == Instruction::LOAD_GLOBAL) {
+                    emitPush();
+                    a.movsdLoad(0, GLOBALS, target * 8);
+                } else {
+                    a.movsdStore(GLOBALS, target * 8, 0);
+                    if (instruction.operand2) emitPop();
+                }
+                size_t done = a.jmp();
+                a.bind(missing);
+                emitStep(pc, true); // Reports an invalid LOAD, or grows memory for a new global
+                a.bind(done);
+                break;
+            }
+            case Instruction::CALL:
+                emitCall(pc, instruction);
+                break;
+            case Instruction::RET:
+                emitReturn(pc);
+                break;
+            case Instruction::TAIL_CALL:
+            case Instruction::HALT:
+                emitStep(pc, false);
+                break;
+            default:
+                emitStep(pc, true);
+                break;
+        }
+    }
+};
+
+#endif // COCOMPILER_JIT_X86_64
+
+bool JIT::compile(BytecodeView program) {
+#ifdef COCOMPILER_JIT_X86_64
+    std::vector<int> heights;
+    int maxHeight = 0;
+    if (!computeStackHeights(program, heights, maxHeight)) return false;
+
+    TemplateCompiler compiler(program, heights, static_cast<size_t>(maxHeight), reinterpret_cast<void*>(&JIT::step),
+                              reinterpret_cast<void*>(&JIT::checkLimits));
+    compiler.compile();
+
+    size_t page = 4096;
+    size_t size = (compiler.a.bytes.size() + page - 1) / page * page;
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) return false;
+    std::memcpy(mapping, compiler.a.bytes.data(), compiler.a.bytes.size());
+    if (mprotect(mapping, size, PROT_READ | PROT_EXEC) != 0) { // Never writable and executable at once
+        munmap(mapping, size);
+        return false;
+    }
+    code = static_cast<uint8_t*>(mapping);
+    code_size = size;
+    max_height = static_cast<size_t>(maxHeight);
+    entries.clear();
+    for (size_t start : compiler.starts) {
+        entries.push_back(code + start);
+    }
+    return true;
+#else
+    (void)program;
+    return false;
+#endif
+}
+
+/**
+ * @brief Points the context's cached pointers at the VM's current stack, frame and globals.
+ */
+void JIT::refresh(Context& context) {
+    VM& vm = *context.vm;
+    context.top = vm.stack.values + vm.stack.count - 1;
+    context.frame = vm.stack.values + vm.fp;
+    context.values = vm.stack.values;
+    context.limit = vm.stack.values + vm.stack.capacity;
+    context.frames = vm.frames.data();
+    context.frame_count = vm.frame_count;
+    context.memory = vm.heap->memory.data();
+    context.memory_size = vm.heap->memory.size();
+}
+
+/**
+ * @brief Called by generated code to run instruction pc in the interpreter.
+ * @param top The generated code's top of stack (already written back).
+ * @return The instruction to continue at (the program size if execution ran off the end),
+ * or -1 after HALT or a reported error.
+ */
+int64_t JIT::step(Context* context, int64_t pc, double* top) {
+    VM& vm = *context->vm;
+    vm.stack.count = static_cast<size_t>(top + 1 - vm.stack.values);
+    vm.fp = static_cast<int>(context->frame - vm.stack.values);
+    vm.frame_count = static_cast<int>(context->frame_count);
+    vm.back_edges_taken = context->back_edges_taken;
+    vm.calls_taken = context->calls_taken;
+    vm.pc = static_cast<int>(pc);
+    double result = vm.execute(1);
+    context->back_edges_taken = vm.back_edges_taken;
+    context->calls_taken = vm.calls_taken;
+    if (vm.halted) {
+        context->halted = true;
+        context->result = result;
+        return -1;
+    }
+    if (result == -1) return -1;
+    // Templates never check capacity: within a frame the stack grows by at most max_height
+    vm.stack.reserve(vm.stack.count + context->max_height + 1);
+    refresh(*context);
+    return vm.pc >= 0 && vm.pc < context->end ? vm.pc : context->end;
+}
+
+/**
+ * @brief Called by generated code when a back-edge or call reaches the VM's next limit check;
+ * checks the limits as the interpreter would.
+ * @return 1 to continue, or 0 (after reporting) if a limit is exceeded.
+ */
+int64_t JIT::checkLimits(Context* context, int64_t target) {
+    VM& vm = *context->vm;
+    vm.back_edges_taken = context->back_edges_taken;
+    vm.calls_taken = context->calls_taken;
+    vm.frame_count = static_cast<int>(context->frame_count);
+    if (!vm.checkLimits(static_cast<int>(target))) return 0;
+    context->limit_check_after = vm.limit_check_at - 1;
+    context->call_check_after = vm.call_check_at - 1;
+    return 1;
+}
+
+double JIT::run(VM& vm) {
+    if (!code) return -1;
+    Context context;
+    context.vm = &vm;
+    context.back_edge_counts = vm.back_edge_counts.data();
+    context.back_edges_taken = vm.back_edges_taken;
+    context.limit_check_after = vm.limit_check_at - 1;
+    context.calls_taken = vm.calls_taken;
+    context.call_check_after = vm.call_check_at - 1;
+    context.entries = entries.data();
+    context.pc = vm.pc;
+    context.end = static_cast<int64_t>(entries.size()) - 1;
+    context.max_height = max_height;
+    context.max_frames = vm.max_frames;
+    context.halted = false;
+    context.result = -1;
+    vm.halted = false;
+    vm.stack.reserve(vm.stack.count + max_height + 1);
+    refresh(context);
+#ifdef COCOMPILER_JIT_X86_64
+    reinterpret_cast<void (*)(Context*)>(code)(&context);
+#endif
+    vm.back_edges_taken = context.back_edges_taken;
+    vm.calls_taken = context.calls_taken;
+    return context.halted ? context.result : -1;
+}
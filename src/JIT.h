@@ -0,0 +1,69 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../include/Bytecode.h"
+
+class VM;
+
+/**
+ * @brief A baseline template JIT that translates bytecode to x86-64 machine code (Linux only).
+ *
+ * compile() emits one fixed machine-code template per instruction into mmap'd executable
+ * memory, so the interpreter's fetch and dispatch disappear but nothing is optimized across
+ * instructions. The operand stack stays in the VM's ValueStack, with its top element cached
+ * in xmm0 (and the current frame, stack top and globals in callee-saved registers).
+ *
+ * Arithmetic, comparisons, jumps, loops, global and local variable access, calls and
+ * returns have templates. Every other instruction (tail calls, strings, printing, arrays,
+ * maps, builtins, parallel loops and HALT), and every rare case a template does not handle
+ * (division by zero, a store that grows memory, call stack overflow), writes the cached
+ * state back and runs as one step of VM::execute; the compiled code then resumes wherever
+ * the interpreter left off. Programs therefore behave exactly as when interpreted, down to
+ * error messages and back-edge counts.
+ */
+class JIT {
+public:
+    JIT();
+    ~JIT();
+
+    JIT(const JIT&) = delete;
+    JIT& operator=(const JIT&) = delete;
+
+    /**
+     * @brief Returns true if this build can generate and run machine code (Linux x86-64).
+     */
+    static bool isSupported();
+
+    /**
+     * @brief Compiles a program to machine code.
+     * Programs whose stack use cannot be verified (the height at each instruction must be
+     * the same on every path and never drop below what an instruction pops) are rejected.
+     * @param program The bytecode, which must outlive the compiled code.
+     * @return True on success; false if the program or platform is unsupported or executable memory could not be mapped.
+     */
+    bool compile(BytecodeView program);
+
+    /**
+     * @brief Runs the compiled program on a VM that VM::run has set up, starting at its pc.
+     * @return As VM::execute: the value on top of the stack at HALT, or -1 after an error was reported.
+     */
+    double run(VM& vm);
+
+private:
+    struct Context; // The state shared with the generated code (see JIT.cpp)
+    friend class TemplateCompiler;
+
+    uint8_t* code;     // Executable mapping, or null before a successful compile()
+    size_t code_size;  // Bytes mapped at code
+    std::vector<const uint8_t*> entries; // Machine code of each instruction, plus the end of the program
+    size_t max_height; // Largest stack height of any instruction, relative to its frame
+
+    static int64_t step(Context* context, int64_t pc, double* top);
+    static int64_t checkLimits(Context* context, int64_t target);
+    static void refresh(Context& context);
+};
+
+#endif // JIT_H
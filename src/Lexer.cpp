@@ -3,7 +3,7 @@
 #include <iostream> // For error output
 
 Lexer::Lexer(const std::string& source_code)
-    : source(source_code), current_pos(0), current_line(1), current_column(1), errors({}) {}
+    : source(source_code), current_pos(0), current_line(1), current_column(1), errors({}), error_stream(&std::cerr) {}
 
 // --- Helper Methods ---
 
@@ -130,7 +130,7 @@ std::vector<Token> Lexer::tokenize() {
             continue; // Go to next iteration after consuming the number
         }
 
-        // Handle identifiers and keywords (like 'var', 'true', 'false', 'if', 'else', 'print')
+        // Handle identifiers and keywords (like 'var', 'true', 'false', 'if', 'else', 'while', 'for', 'fn', 'return', 'print')
         if (isAlpha(c)) {
             int identifier_start_pos = current_pos;
             int identifier_start_col = current_column;
@@ -146,6 +146,16 @@ std::vector<Token> Lexer::tokenize() {
                 tokens.push_back(Token(TokenType::IF, value, current_line, identifier_start_col));
             } else if (value == "else") {
                 tokens.push_back(Token(TokenType::ELSE, value, current_line, identifier_start_col));
+            } else if (value == "while") {
+                tokens.push_back(Token(TokenType::WHILE, value, current_line, identifier_start_col));
+            } else if (value == "for") {
+                tokens.push_back(Token(TokenType::FOR, value, current_line, identifier_start_col));
+            } else if (value == "parallel") {
+                tokens.push_back(Token(TokenType::PARALLEL, value, current_line, identifier_start_col));
+            } else if (value == "fn") {
+                tokens.push_back(Token(TokenType::FN, value, current_line, identifier_start_col));
+            } else if (value == "return") {
+                tokens.push_back(Token(TokenType::RETURN, value, current_line, identifier_start_col));
             } else if (value == "print") {
                 tokens.push_back(Token(TokenType::PRINT, value, current_line, identifier_start_col));
             } else if (value == "true") { // New: true keyword
@@ -178,9 +188,13 @@ std::vector<Token> Lexer::tokenize() {
                 break;
             case '(': tokens.push_back(Token(TokenType::LPAREN, "(", current_line, token_start_col)); advance(); break;
             case ')': tokens.push_back(Token(TokenType::RPAREN, ")", current_line, token_start_col)); advance(); break;
+            case '[': tokens.push_back(Token(TokenType::LBRACKET, "[", current_line, token_start_col)); advance(); break;
+            case ']': tokens.push_back(Token(TokenType::RBRACKET, "]", current_line, token_start_col)); advance(); break;
             case '{': tokens.push_back(Token(TokenType::LBRACE, "{", current_line, token_start_col)); advance(); break;
             case '}': tokens.push_back(Token(TokenType::RBRACE, "}", current_line, token_start_col)); advance(); break;
             case ';': tokens.push_back(Token(TokenType::SEMICOLON, ";", current_line, token_start_col)); advance(); break;
+            case ',': tokens.push_back(Token(TokenType::COMMA, ",", current_line, token_start_col)); advance(); break;
+            case ':': tokens.push_back(Token(TokenType::COLON, ":", current_line, token_start_col)); advance(); break;
             case '"': tokens.push_back(string_literal()); break; // New: String literal
             case '=':
                 advance(); // Consume '='
@@ -247,11 +261,11 @@ std::vector<Token> Lexer::tokenize() {
     tokens.push_back(Token(TokenType::EOF_TOKEN, "", current_line, current_column));
 
     if (!errors.empty()) {
-        std::cerr << "\n--- Lexer Errors ---" << std::endl;
+        *error_stream << "\n--- Lexer Errors ---" << std::endl;
         for (const auto& error : errors) {
-            std::cerr << error << std::endl;
+            *error_stream << error << std::endl;
         }
-        std::cerr << "--------------------" << std::endl;
+        *error_stream << "--------------------" << std::endl;
     }
 
     return tokens;
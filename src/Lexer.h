@@ -1,6 +1,7 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <ostream>
 #include <string>
 #include <vector>
 #include "Tokens.h" // Includes TokenType and Token struct
@@ -26,11 +27,13 @@ private:
     Token string_literal(); // New: Reads a string literal
 
     std::vector<std::string> errors; // Collect lexer errors
+    std::ostream* error_stream; // Where the collected errors are reported: std::cerr unless set
 
 public:
     Lexer(const std::string& source_code);
 
     std::vector<Token> tokenize(); // Main function to produce all tokens
+    void setErrorStream(std::ostream& stream) { error_stream = &stream; }
 };
 
 #endif // LEXER_H
@@ -0,0 +1,212 @@
+#include "Optimizer.h"
+#include <climits>
+#include <cmath>
+
+// Instructions whose operand is an instruction address
+static bool hasAddressOperand(Instruction instruction) {
+    switch (instruction) {
+        case Instruction::JUMP:
+        case Instruction::JUMP_IF_FALSE:
+        case Instruction::JUMP_IF_TRUE:
+        case Instruction::LOOP_INC_CMP_JUMP:
+        case Instruction::LOOP_INC_CMP_JUMP_LOCAL:
+        case Instruction::CALL:
+        case Instruction::TAIL_CALL:
+        case Instruction::PARALLEL_FOR:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// True if the instruction pushes a numeric constant (string indices are not folded)
+static bool constantOf(const Bytecode& instruction, double& value) {
+    if (instruction.instruction != Instruction::PUSH_INT && instruction.instruction != Instruction::PUSH_FLOAT) return false;
+    value = instruction.operand;
+    return true;
+}
+
+static Bytecode constant(double value) {
+    Bytecode push(Instruction::PUSH_FLOAT);
+    push.operand = value; // Set directly: the float constructor would round it
+    return push;
+}
+
+// A constant LOAD or STORE address that the specialized instructions can hold
+static bool globalAddress(double value, int& address) {
+    if (value < 0 || value > INT_MAX || value != std::floor(value)) return false; // Invalid addresses keep their error path
+    address = static_cast<int>(value);
+    return true;
+}
+
+/**
+ * Evaluates a binary instruction on constants exactly as the VM would. Division by zero is
+ * left to run (and report its error) at run time.
+ */
+static bool foldBinary(Instruction op, double left, double right, double& value) {
+    switch (op) {
+        case Instruction::ADD: value = left + right; return true;
+        case Instruction::SUB: value = left - right; return true;
+        case Instruction::MUL: value = left * right; return true;
+        case Instruction::DIV:
+            if (right == 0.0) return false;
+            value = left / right;
+            return true;
+        case Instruction::GREATER: value = left > right ? 1.0 : 0.0; return true;
+        case Instruction::LESS: value = left < right ? 1.0 : 0.0; return true;
+        case Instruction::GREATER_EQUAL: value = left >= right ? 1.0 : 0.0; return true;
+        case Instruction::LESS_EQUAL: value = left <= right ? 1.0 : 0.0; return true;
+        case Instruction::EQUAL_EQUAL: value = left == right ? 1.0 : 0.0; return true;
+        case Instruction::BANG_EQUAL: value = left != right ? 1.0 : 0.0; return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Optimizes a program one basic block at a time.
+ * Instructions are appended to the result one by one, and after each append the rules are
+ * applied to the end of the result until none matches. An entry point starts a new block,
+ * below which the rules do not look.
+ */
+bool Optimizer::optimize(BytecodeView program, OptimizedProgram& result) {
+    std::vector<bool> entries;
+    if (!findEntryPoints(program, entries)) return false;
+
+    result.bytecode.clear();
+    result.source_pcs.clear();
+    result.entry_pcs.assign(program.size() + 1, -1);
+    size_t blockStart = 0;
+    for (size_t pc = 0; pc < program.size(); ++pc) {
+        if (entries[pc]) {
+            blockStart = result.bytecode.size();
+            result.entry_pcs[pc] = static_cast<int>(blockStart);
+        }
+        result.bytecode.push_back(program[pc]);
+        result.source_pcs.push_back(static_cast<int>(pc));
+        while (simplifyTail(result, blockStart)) {}
+    }
+    result.entry_pcs[program.size()] = static_cast<int>(result.bytecode.size());
+
+    // Every jump target is an entry point, so each has an optimized address
+    for (Bytecode& instruction : result.bytecode) {
+        if (hasAddressOperand(instruction.instruction)) {
+            instruction.operand = result.entry_pcs[static_cast<int>(instruction.operand)];
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Marks the instructions execution can arrive at other than from the instruction
+ * before: the start, jump and loop targets, function and parallel for entries, and the
+ * instruction after each CALL (where RET resumes).
+ */
+bool Optimizer::findEntryPoints(BytecodeView program, std::vector<bool>& entries) {
+    entries.assign(program.size() + 1, false);
+    entries[0] = true;
+    for (size_t pc = 0; pc < program.size(); ++pc) {
+        const Bytecode& instruction = program[pc];
+        if (!hasAddressOperand(instruction.instruction)) continue;
+        double target = instruction.operand;
+        if (target < 0 || target > program.size() || target != std::floor(target)) return false;
+        entries[static_cast<size_t>(target)] = true;
+        if (instruction.instruction == Instruction::CALL) entries[pc + 1] = true;
+    }
+    return true;
+}
+
+bool Optimizer::simplifyTail(OptimizedProgram& result, size_t blockStart) {
+    std::vector<Bytecode>& code = result.bytecode;
+    size_t available = code.size() - blockStart;
+    if (available < 2) return false;
+    Bytecode last = code[code.size() - 1];
+    Bytecode previous = code[code.size() - 2];
+    double value;
+    bool previousConstant = constantOf(previous, value);
+    int address;
+
+    switch (last.instruction) {
+        case Instruction::ADD: case Instruction::SUB: case Instruction::MUL: case Instruction::DIV:
+        case Instruction::GREATER: case Instruction::LESS: case Instruction::GREATER_EQUAL:
+        case Instruction::LESS_EQUAL: case Instruction::EQUAL_EQUAL: case Instruction::BANG_EQUAL: {
+            double left, folded;
+            if (available >= 3 && previousConstant && constantOf(code[code.size() - 3], left) &&
+                foldBinary(last.instruction, left, value, folded)) {
+                replaceTail(result, 3, constant(folded));
+                return true;
+            }
+            return false;
+        }
+        case Instruction::NEGATE:
+            if (!previousConstant) return false;
+            replaceTail(result, 2, constant(-value));
+            return true;
+        case Instruction::NOT:
+            if (!previousConstant) return false;
+            replaceTail(result, 2, constant(value == 0.0 ? 1.0 : 0.0));
+            return true;
+        case Instruction::POP:
+            if (previousConstant) { // A constant statement
+                dropTail(result, 2);
+                return true;
+            }
+            if ((previous.instruction == Instruction::STORE_GLOBAL || previous.instruction == Instruction::STORE_LOCAL) &&
+                previous.operand2 == 0) { // An assignment statement
+                previous.operand2 = 1;
+                replaceTail(result, 2, previous);
+                return true;
+            }
+            return false;
+        case Instruction::LOAD:
+            if (!previousConstant || !globalAddress(value, address)) return false;
+            replaceTail(result, 2, Bytecode(Instruction::LOAD_GLOBAL, address));
+            return true;
+        case Instruction::STORE:
+            if (!previousConstant || !globalAddress(value, address)) return false;
+            replaceTail(result, 2, Bytecode(Instruction::STORE_GLOBAL, address));
+            return true;
+        case Instruction::LOAD_GLOBAL:
+        case Instruction::LOAD_LOCAL: {
+            // Reading back the variable just stored: keep the stored value instead
+            Instruction store = last.instruction == Instruction::LOAD_GLOBAL ? Instruction::STORE_GLOBAL : Instruction::STORE_LOCAL;
+            if (previous.instruction != store || previous.operand2 != 1 || previous.operand != last.operand) return false;
+            previous.operand2 = 0;
+            replaceTail(result, 2, previous);
+            return true;
+        }
+        case Instruction::JUMP_IF_FALSE:
+        case Instruction::JUMP_IF_TRUE: {
+            bool jumpsIfFalse = last.instruction == Instruction::JUMP_IF_FALSE;
+            if (previousConstant) {
+                if ((value == 0.0) == jumpsIfFalse) {
+                    last.instruction = Instruction::JUMP;
+                    replaceTail(result, 2, last);
+                } else {
+                    dropTail(result, 2);
+                }
+                return true;
+            }
+            if (previous.instruction == Instruction::NOT) {
+                last.instruction = jumpsIfFalse ? Instruction::JUMP_IF_TRUE : Instruction::JUMP_IF_FALSE;
+                replaceTail(result, 2, last);
+                return true;
+            }
+            return false;
+        }
+        default:
+            return false;
+    }
+}
+
+// Replaces the last count instructions with one, which starts where they started
+void Optimizer::replaceTail(OptimizedProgram& result, size_t count, const Bytecode& replacement) {
+    int source = result.source_pcs[result.source_pcs.size() - count];
+    dropTail(result, count);
+    result.bytecode.push_back(replacement);
+    result.source_pcs.push_back(source);
+}
+
+void Optimizer::dropTail(OptimizedProgram& result, size_t count) {
+    result.bytecode.resize(result.bytecode.size() - count, Bytecode(Instruction::HALT));
+    result.source_pcs.resize(result.source_pcs.size() - count);
+}
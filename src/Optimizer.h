@@ -0,0 +1,45 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <vector>
+#include "../include/Bytecode.h"
+
+/**
+ * @brief A program rewritten by the Optimizer, with the address maps the VM needs to switch
+ * to it while the original is running.
+ */
+struct OptimizedProgram {
+    std::vector<Bytecode> bytecode;
+    std::vector<int> entry_pcs;  // Per original instruction (plus the end): its optimized address if it is an entry point, else -1
+    std::vector<int> source_pcs; // Per optimized instruction: the original instruction its sequence started at
+};
+
+/**
+ * @brief The bytecode optimizer behind the VM's optimized tier.
+ *
+ * Rewrites straight-line sequences with peephole rules: constant folding, conditional jumps
+ * on constants, NOT before a conditional jump, and the specialized LOAD_GLOBAL and
+ * STORE_GLOBAL forms of constant-address LOAD and STORE (with a following POP folded in).
+ * No rule reaches across an entry point (a jump or loop target, function or parallel for
+ * entry, or return address), so the stack and globals at every entry point are exactly as in
+ * the original program and the VM can switch from one to the other there. Jumps keep their
+ * direction, so back-edge counts and budgets are unchanged.
+ */
+class Optimizer {
+public:
+    /**
+     * @brief Optimizes a program.
+     * @param program The bytecode as compiled.
+     * @param result Receives the optimized bytecode and its address maps.
+     * @return False (leaving result unspecified) if a jump target lies outside the program.
+     */
+    bool optimize(BytecodeView program, OptimizedProgram& result);
+
+private:
+    bool findEntryPoints(BytecodeView program, std::vector<bool>& entries);
+    bool simplifyTail(OptimizedProgram& result, size_t blockStart); // Applies one rule to the end of result; true if it did
+    void replaceTail(OptimizedProgram& result, size_t count, const Bytecode& replacement);
+    void dropTail(OptimizedProgram& result, size_t count);
+};
+
+#endif // OPTIMIZER_H
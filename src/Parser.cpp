@@ -1,7 +1,7 @@
 #include "Parser.h"
 #include <iostream>
 
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), current_pos(0) {}
+Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens), current_pos(0), errors(&std::cerr) {}
 
 Token Parser::peek() {
     if (current_pos >= tokens.size()) {
@@ -34,7 +34,7 @@ Token Parser::consume(TokenType type, const std::string& message) {
     if (peek().type == type) {
         return advance();
     }
-    std::cerr << "Parser Error: " << message << " at L" << peek().line << ":C" << peek().column << std::endl;
+    *errors << "Parser Error: " << message << " at L" << peek().line << ":C" << peek().column << std::endl;
     // In a real compiler, you'd implement error recovery here.
     // For now, return a dummy EOF token to prevent further errors.
     return Token(TokenType::EOF_TOKEN, "", peek().line, peek().column);
@@ -67,20 +67,78 @@ Expression* Parser::primary() {
     } else if (match(TokenType::FALSE)) { // New: Handle boolean false
         return new BooleanLiteral(tokens[current_pos - 1]);
     } else if (match(TokenType::IDENTIFIER)) { // Handle identifiers
-        return new IdentifierExpression(tokens[current_pos - 1]);
+        Token identifier = tokens[current_pos - 1];
+        if (match(TokenType::LPAREN)) { // An identifier followed by '(' is a call
+            return finishCall(identifier);
+        }
+        return new IdentifierExpression(identifier);
+    } else if (match(TokenType::LBRACKET)) { // Array literal
+        return finishArrayLiteral(tokens[current_pos - 1]);
     } else if (match(TokenType::LPAREN)) {
         Expression* expr = expression();
         if (match(TokenType::RPAREN)) {
             return expr;
         } else {
-            std::cerr << "Parser Error: Expected ')' after expression at L" << peek().line << ":C" << peek().column << std::endl;
+            *errors << "Parser Error: Expected ')' after expression at L" << peek().line << ":C" << peek().column << std::endl;
             return nullptr;
         }
     }
-    std::cerr << "Parser Error: Expected expression at L" << peek().line << ":C" << peek().column << std::endl;
+    *errors << "Parser Error: Expected expression at L" << peek().line << ":C" << peek().column << std::endl;
     return nullptr;
 }
 
+/**
+ * @brief Parses the arguments of a call after the opening parenthesis.
+ * Syntax: callee(argument, argument, ...)
+ * @param callee The identifier token naming the called function.
+ * @return A pointer to a CallExpression node, or nullptr if an error occurs.
+ */
+Expression* Parser::finishCall(Token callee) {
+    std::vector<Expression*> arguments;
+    if (peek().type != TokenType::RPAREN) {
+        do {
+            Expression* arg = expression();
+            if (!arg) {
+                for (Expression* parsed : arguments) delete parsed;
+                return nullptr; // Propagate error
+            }
+            arguments.push_back(arg);
+        } while (match(TokenType::COMMA));
+    }
+    Token paren = consume(TokenType::RPAREN, "Expected ')' after call arguments");
+    if (paren.type == TokenType::EOF_TOKEN) {
+        for (Expression* parsed : arguments) delete parsed;
+        return nullptr;
+    }
+    return new CallExpression(callee, arguments);
+}
+
+/**
+ * @brief Parses the elements of an array literal after the opening bracket.
+ * Syntax: [element, element, ...]
+ * @param bracket The '[' token.
+ * @return A pointer to an ArrayLiteral node, or nullptr if an error occurs.
+ */
+Expression* Parser::finishArrayLiteral(Token bracket) {
+    std::vector<Expression*> elements;
+    if (peek().type != TokenType::RBRACKET) {
+        do {
+            Expression* element = expression();
+            if (!element) {
+                for (Expression* parsed : elements) delete parsed;
+                return nullptr; // Propagate error
+            }
+            elements.push_back(element);
+        } while (match(TokenType::COMMA));
+    }
+    Token closing = consume(TokenType::RBRACKET, "Expected ']' after array elements");
+    if (closing.type == TokenType::EOF_TOKEN) {
+        for (Expression* parsed : elements) delete parsed;
+        return nullptr;
+    }
+    return new ArrayLiteral(bracket, elements);
+}
+
 /**
  * @brief Parses a unary expression (e.g., -expression).
  * For now, it just calls primary().
@@ -97,7 +155,30 @@ Expression* Parser::unary() {
         if (!right) return nullptr; // Propagate error
         return new UnaryExpression(op, right);
     }
-    return primary();
+    return postfix();
+}
+
+/**
+ * @brief Parses indexing, which binds tighter than any unary or binary operator (e.g. a[i][j]).
+ * @return A pointer to an Expression node, or nullptr if an error occurs.
+ */
+Expression* Parser::postfix() {
+    Expression* expr = primary();
+    while (expr && match(TokenType::LBRACKET)) {
+        Token bracket = tokens[current_pos - 1];
+        Expression* index = expression();
+        if (!index) {
+            delete expr;
+            return nullptr; // Propagate error
+        }
+        if (consume(TokenType::RBRACKET, "Expected ']' after index").type == TokenType::EOF_TOKEN) {
+            delete expr;
+            delete index;
+            return nullptr;
+        }
+        expr = new IndexExpression(expr, bracket, index);
+    }
+    return expr;
 }
 
 /**
@@ -196,14 +277,18 @@ Expression* Parser::assignment() {
 
     if (match(TokenType::ASSIGN)) {
         Token equals = tokens[current_pos - 1];
-        // The left-hand side must be an IdentifierExpression
+        // The left-hand side must be an IdentifierExpression or an array element
         IdentifierExpression* identifier_expr = dynamic_cast<IdentifierExpression*>(expr);
-        if (!identifier_expr) {
-            std::cerr << "Parser Error: Invalid assignment target. Expected identifier at L" << equals.line << ":C" << equals.column << std::endl;
+        IndexExpression* index_expr = dynamic_cast<IndexExpression*>(expr);
+        if (!identifier_expr && !index_expr) {
+            *errors << "Parser Error: Invalid assignment target. Expected identifier or array element at L" << equals.line << ":C" << equals.column << std::endl;
             return nullptr;
         }
         Expression* value = assignment(); // Assignment is right-associative
         if (!value) return nullptr; // Propagate error
+        if (index_expr) {
+            return new IndexAssignmentExpression(index_expr, value);
+        }
         return new AssignmentExpression(identifier_expr->getIdentifier(), value);
     }
 
@@ -290,6 +375,177 @@ ASTNode* Parser::parseIfStatement() {
     return new IfStatement(condition, thenBranch, elseBranch);
 }
 
+/**
+ * @brief Parses a while statement.
+ * Syntax: while (condition) { body }
+ * @return A pointer to a WhileStatement node, or nullptr if an error occurs.
+ */
+ASTNode* Parser::parseWhileStatement() {
+    consume(TokenType::WHILE, "Expected 'while' keyword");
+    consume(TokenType::LPAREN, "Expected '(' after 'while'");
+    Expression* condition = expression();
+    if (!condition) return nullptr; // Propagate error
+    consume(TokenType::RPAREN, "Expected ')' after while condition");
+
+    ASTNode* body = block(); // The loop body is a block
+    if (!body) {
+        delete condition;
+        return nullptr;
+    }
+    return new WhileStatement(condition, body);
+}
+
+/**
+ * @brief Parses a C-style for statement.
+ * Syntax: for (initializer; condition; increment) { body }
+ * Each of the three clauses is optional; the initializer may be a variable declaration.
+ * @param reductions For a parallel for, receives the optional reduce(...) clause between the header and the body.
+ * @return A pointer to a ForStatement node, or nullptr if an error occurs.
+ */
+ASTNode* Parser::parseForStatement(std::vector<ReductionClause>* reductions) {
+    consume(TokenType::FOR, "Expected 'for' keyword");
+    consume(TokenType::LPAREN, "Expected '(' after 'for'");
+
+    ASTNode* initializer = nullptr;
+    if (match(TokenType::SEMICOLON)) {
+        // No initializer
+    } else if (peek().type == TokenType::VAR) {
+        initializer = parseVariableDeclaration(); // Consumes the trailing ';'
+        if (!initializer) return nullptr;
+    } else {
+        initializer = expression();
+        if (!initializer) return nullptr;
+        consume(TokenType::SEMICOLON, "Expected ';' after for initializer");
+    }
+
+    Expression* condition = nullptr;
+    if (peek().type != TokenType::SEMICOLON) {
+        condition = expression();
+        if (!condition) {
+            delete initializer;
+            return nullptr;
+        }
+    }
+    consume(TokenType::SEMICOLON, "Expected ';' after for condition");
+
+    Expression* increment = nullptr;
+    if (peek().type != TokenType::RPAREN) {
+        increment = expression();
+        if (!increment) {
+            delete initializer;
+            delete condition;
+            return nullptr;
+        }
+    }
+    consume(TokenType::RPAREN, "Expected ')' after for clauses");
+
+    if (reductions && !parseReductionClause(*reductions)) {
+        delete initializer;
+        delete condition;
+        delete increment;
+        return nullptr;
+    }
+
+    ASTNode* body = block(); // The loop body is a block
+    if (!body) {
+        delete initializer;
+        delete condition;
+        delete increment;
+        return nullptr;
+    }
+    return new ForStatement(initializer, condition, increment, body);
+}
+
+/**
+ * @brief Parses a parallel for statement.
+ * Syntax: parallel for (var i = start; i < limit; i = i + step) reduce(op: variable, ...) { body }
+ * The reduce clause is optional; op is +, *, min or max. The loop's shape is checked by the compiler.
+ * @return A pointer to a ParallelForStatement node, or nullptr if an error occurs.
+ */
+ASTNode* Parser::parseParallelForStatement() {
+    Token keyword = consume(TokenType::PARALLEL, "Expected 'parallel' keyword");
+    if (peek().type != TokenType::FOR) {
+        consume(TokenType::FOR, "Expected 'for' after 'parallel'");
+        return nullptr;
+    }
+    std::vector<ReductionClause> reductions;
+    ASTNode* loop = parseForStatement(&reductions);
+    if (!loop) return nullptr; // Propagate error
+    return new ParallelForStatement(keyword, static_cast<ForStatement*>(loop), reductions);
+}
+
+/**
+ * @brief Parses the optional reduction clause of a parallel for.
+ * Syntax: reduce(op: variable, op: variable, ...) where op is +, *, min or max.
+ * 'reduce' is only special in this position, so it remains usable as a name elsewhere.
+ * @param reductions Receives the clause's entries.
+ * @return False if the clause is malformed.
+ */
+bool Parser::parseReductionClause(std::vector<ReductionClause>& reductions) {
+    if (peek().type != TokenType::IDENTIFIER || peek().value != "reduce") {
+        return true; // No clause
+    }
+    advance(); // Consume 'reduce'
+    consume(TokenType::LPAREN, "Expected '(' after 'reduce'");
+    do {
+        Token op = advance();
+        bool validOp = op.type == TokenType::PLUS || op.type == TokenType::STAR ||
+                       (op.type == TokenType::IDENTIFIER && (op.value == "min" || op.value == "max"));
+        if (!validOp) {
+            *errors << "Parser Error: Expected a reduction operator (+, *, min or max) at L" << op.line << ":C" << op.column << std::endl;
+            return false;
+        }
+        consume(TokenType::COLON, "Expected ':' after reduction operator");
+        Token variable = consume(TokenType::IDENTIFIER, "Expected variable name in reduce clause");
+        if (variable.type == TokenType::EOF_TOKEN) return false; // Error occurred
+        reductions.push_back(ReductionClause{op, variable});
+    } while (match(TokenType::COMMA));
+    consume(TokenType::RPAREN, "Expected ')' after reduce clause");
+    return true;
+}
+
+/**
+ * @brief Parses a function declaration.
+ * Syntax: fn name(param, param, ...) { body }
+ * @return A pointer to a FunctionDeclaration node, or nullptr if an error occurs.
+ */
+ASTNode* Parser::parseFunctionDeclaration() {
+    consume(TokenType::FN, "Expected 'fn' keyword");
+    Token name = consume(TokenType::IDENTIFIER, "Expected function name after 'fn'");
+    if (name.type == TokenType::EOF_TOKEN) return nullptr; // Error occurred
+    consume(TokenType::LPAREN, "Expected '(' after function name");
+
+    std::vector<Token> parameters;
+    if (peek().type != TokenType::RPAREN) {
+        do {
+            Token parameter = consume(TokenType::IDENTIFIER, "Expected parameter name");
+            if (parameter.type == TokenType::EOF_TOKEN) return nullptr; // Error occurred
+            parameters.push_back(parameter);
+        } while (match(TokenType::COMMA));
+    }
+    consume(TokenType::RPAREN, "Expected ')' after parameters");
+
+    ASTNode* body = block(); // The function body is a block
+    if (!body) return nullptr; // Propagate error
+    return new FunctionDeclaration(name, parameters, body);
+}
+
+/**
+ * @brief Parses a return statement.
+ * Syntax: return expression; or return;
+ * @return A pointer to a ReturnStatement node, or nullptr if an error occurs.
+ */
+ASTNode* Parser::parseReturnStatement() {
+    Token keyword = consume(TokenType::RETURN, "Expected 'return' keyword");
+    Expression* value = nullptr;
+    if (peek().type != TokenType::SEMICOLON) {
+        value = expression();
+        if (!value) return nullptr; // Propagate error
+    }
+    consume(TokenType::SEMICOLON, "Expected ';' after return statement");
+    return new ReturnStatement(keyword, value);
+}
+
 /**
  * @brief Parses a print statement.
  * Syntax: print expression;
@@ -314,6 +570,16 @@ ASTNode* Parser::parseStatement() {
         return parseVariableDeclaration();
     } else if (peek().type == TokenType::IF) { // New: Handle if statements
         return parseIfStatement();
+    } else if (peek().type == TokenType::WHILE) {
+        return parseWhileStatement();
+    } else if (peek().type == TokenType::FOR) {
+        return parseForStatement();
+    } else if (peek().type == TokenType::PARALLEL) {
+        return parseParallelForStatement();
+    } else if (peek().type == TokenType::FN) {
+        return parseFunctionDeclaration();
+    } else if (peek().type == TokenType::RETURN) {
+        return parseReturnStatement();
     } else if (peek().type == TokenType::PRINT) { // New: Handle print statements
         return parsePrintStatement();
     }
@@ -332,8 +598,8 @@ ASTNode* Parser::parseStatement() {
  * @brief Parses the entire token stream into an AST, handling multiple statements.
  * @return A pointer to the root ASTNode (a BlockStatement if multiple, or a single statement), or nullptr if an error occurs.
  */
-ASTNode* Parser::parse() {
-    std::vector<ASTNode*> statements;
+bool Parser::parseStatements(std::vector<ASTNode*>& statements) {
+    statements.clear();
     while (peek().type != TokenType::EOF_TOKEN) {
         ASTNode* statement = parseStatement();
         if (statement) {
@@ -341,9 +607,19 @@ ASTNode* Parser::parse() {
         } else {
             // Error occurred in parsing a statement, attempt to recover or stop
             // For now, we'll stop parsing on the first error in the top-level.
-            return nullptr;
+            for (ASTNode* parsed : statements) delete parsed;
+            statements.clear();
+            return false;
         }
     }
+    return true;
+}
+
+ASTNode* Parser::parse() {
+    std::vector<ASTNode*> statements;
+    if (!parseStatements(statements)) {
+        return nullptr;
+    }
 
     if (statements.empty()) {
         return nullptr; // Empty input
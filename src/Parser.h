@@ -1,6 +1,7 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <ostream>
 #include <vector>
 #include "../include/Tokens.h"
 #include "../include/AST.h"
@@ -9,6 +10,7 @@ class Parser {
 private:
     const std::vector<Token>& tokens;
     int current_pos;
+    std::ostream* errors; // Where syntax errors are reported: std::cerr unless set
 
     Token peek();
     Token advance();
@@ -17,6 +19,7 @@ private:
 
     // Parsing functions for expressions
     Expression* primary();
+    Expression* postfix(); // For indexing like a[i]
     Expression* unary(); // New: For future unary operators like -x
     Expression* factor();
     Expression* term();
@@ -33,14 +36,28 @@ private:
 
     // Parsing functions for control flow
     ASTNode* parseIfStatement(); // New: Parses 'if (condition) { ... } else { ... }'
+    ASTNode* parseWhileStatement(); // Parses 'while (condition) { ... }'
+    ASTNode* parseForStatement(std::vector<ReductionClause>* reductions = nullptr); // Parses 'for (init; condition; increment) { ... }'
+    ASTNode* parseParallelForStatement(); // Parses 'parallel for (...) reduce(op: var, ...) { ... }'
+    bool parseReductionClause(std::vector<ReductionClause>& reductions); // Parses 'reduce(op: var, ...)'
     ASTNode* block(); // New: Parses a block of statements enclosed in {}
 
+    // Parsing functions for functions
+    ASTNode* parseFunctionDeclaration(); // Parses 'fn name(params) { ... }'
+    ASTNode* parseReturnStatement(); // Parses 'return expression;'
+    Expression* finishCall(Token callee); // Parses the argument list of a call
+    Expression* finishArrayLiteral(Token bracket); // Parses the elements of '[a, b, ...]'
+
     // Parsing functions for other statements
     ASTNode* parsePrintStatement(); // New: Parses 'print expression;'
 
 public:
     Parser(const std::vector<Token>& tokens);
     ASTNode* parse(); // Changed return type to ASTNode* to accommodate statements
+    // Parses the input as top-level statements without wrapping several in a block (for REPL sessions,
+    // whose globals must outlive the line). False on a syntax error, leaving statements empty.
+    bool parseStatements(std::vector<ASTNode*>& statements);
+    void setErrorStream(std::ostream& stream) { errors = &stream; }
 };
 
 #endif // PARSER_H
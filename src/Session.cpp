@@ -0,0 +1,80 @@
+#include "Session.h"
+#include "Lexer.h"
+#include "Parser.h"
+
+Session::Session(const cocompiler::Inputs& inputs) : inputs(inputs) {
+    compiler.setErrorStream(errors);
+    vm.setTrace(false);
+    vm.setJit(false);
+    vm.setClosures(false);
+    vm.setTierUpThreshold(0);
+    vm.setMaxFrames(inputs.max_frames);
+    vm.setBackEdgeBudget(inputs.back_edge_budget);
+    vm.setInstructionBudget(inputs.instruction_budget);
+    vm.setDeadline(inputs.deadline_ms);
+    vm.setMaxStringBytes(inputs.max_string_bytes);
+    vm.setOutputStream(inputs.output ? *inputs.output : output);
+    vm.setErrorStream(errors);
+}
+
+SessionOutcome Session::evaluate(const std::string& line) {
+    SessionOutcome outcome;
+    outcome.result.value = -1;
+    errors.str("");
+    output.str("");
+
+    Lexer lexer(line);
+    lexer.setErrorStream(errors);
+    std::vector<Token> tokens = lexer.tokenize();
+    Parser parser(tokens);
+    parser.setErrorStream(errors);
+    std::vector<ASTNode*> statements;
+    bool parsed = parser.parseStatements(statements) && errors.str().empty();
+
+    std::vector<Bytecode> piece;
+    if (parsed && !statements.empty()) {
+        piece = compiler.compileIncremental(statements, static_cast<int>(program.size()));
+    }
+    if (piece.empty()) {
+        for (ASTNode* statement : statements) delete statement;
+        outcome.result.errors = errors.str();
+        if (parsed && statements.empty()) outcome.result.ok = true; // Nothing to run (a blank or comment-only line)
+        else if (outcome.result.errors.empty()) outcome.result.errors = "Compiler Error: No instructions were generated.\n";
+        if (!outcome.result.ok) outcome.result.error = RunError::RUNTIME;
+        return outcome;
+    }
+    for (ASTNode* statement : statements) lines.emplace_back(statement);
+    outcome.expression = statements.size() == 1 && (dynamic_cast<Expression*>(statements[0]) ||
+                                                     dynamic_cast<AssignmentExpression*>(statements[0]));
+    ASTNode::Type type = ASTNode::Type::UNKNOWN; // Of the value the line leaves: an assignment's is the assigned value's
+    if (outcome.expression) {
+        Expression* value = static_cast<Expression*>(statements[0]);
+        if (AssignmentExpression* assignment = dynamic_cast<AssignmentExpression*>(value)) value = assignment->getValue();
+        type = compiler.resolveExpressionType(value);
+    }
+
+    // Only the line's literals are new; earlier ones keep their handles (and cached hashes)
+    const std::vector<std::string>& strings = compiler.getStringLiterals();
+    for (size_t i = literals.size(); i < strings.size(); ++i) literals.emplace_back(strings[i]);
+
+    int entry = static_cast<int>(program.size());
+    bool fresh = entry == 0;
+    program.insert(program.end(), piece.begin(), piece.end());
+    outcome.result.value = vm.runAppended(program, literals, static_cast<size_t>(compiler.getGlobalCount()), entry, fresh);
+    outcome.result.output = output.str();
+    outcome.result.errors = errors.str();
+    outcome.result.ok = outcome.result.errors.empty();
+    if (!outcome.result.ok) outcome.result.error = vm.getRunError() != RunError::NONE ? vm.getRunError() : RunError::RUNTIME;
+    if (outcome.result.ok && outcome.expression && type != ASTNode::Type::ARRAY && type != ASTNode::Type::MAP) {
+        const StringObject* text = type == ASTNode::Type::STRING_LITERAL ? vm.getString(outcome.result.value) : nullptr;
+        if (text) {
+            outcome.echo = text->getValue();
+        } else {
+            std::ostringstream value;
+            value << outcome.result.value;
+            outcome.echo = value.str();
+        }
+        outcome.echoed = true;
+    }
+    return outcome;
+}
@@ -0,0 +1,62 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../include/AST.h"
+#include "../include/CoCompiler.h"
+#include "Compiler.h"
+#include "VM.h"
+
+/**
+ * @brief What evaluating one line of a Session did.
+ */
+struct SessionOutcome {
+    cocompiler::Result result; // Lexer, parser and compile errors end up in result.errors, with result.ok false
+    bool expression = false;   // The line is a single expression, whose value is result.value
+    std::string echo;          // For an expression that ran: its value as a REPL shows it (a string's text, not its handle)
+    bool echoed = false;       // Whether echo applies; arrays and maps, whose values are only handles, are not echoed
+};
+
+/**
+ * @brief An interactive session (a REPL): lines are evaluated one after another against one
+ * growing program, so a line sees the variables, functions and strings of the lines before it.
+ *
+ * The session keeps one Compiler, whose symbol table and string literals grow line by line,
+ * and one VM, whose globals, arrays, maps and strings persist between lines. Each line is
+ * compiled on its own (Compiler::compileIncremental) and appended to the program, and only
+ * its instructions run (VM::runAppended), so the cost of a line depends on the line, not on
+ * the length of the session. A line that does not compile leaves the session as it was; one
+ * that fails at run time keeps whatever it stored before the error.
+ *
+ * Sessions run in the interpreter only: Inputs::jit, Inputs::closures,
+ * Inputs::tier_up_threshold and Inputs::bindings are ignored.
+ */
+class Session {
+public:
+    explicit Session(const cocompiler::Inputs& inputs = cocompiler::Inputs());
+
+    /**
+     * @brief Compiles one line against the session and runs it.
+     * @param line Any number of statements; a single expression's value is returned.
+     */
+    SessionOutcome evaluate(const std::string& line);
+
+    size_t getLines() const { return lines.size(); } // Lines that compiled
+    size_t getInstructions() const { return program.size(); } // Of the whole program so far
+
+private:
+    cocompiler::Inputs inputs;
+    Compiler compiler;
+    VM vm;
+    std::vector<Bytecode> program; // Every compiled line, each ending with HALT
+    std::vector<StringObject> literals; // The compiler's string literals, as the VM uses them
+    std::vector<std::unique_ptr<ASTNode>> lines; // Statements of every compiled line, which later lines may inline
+    std::ostringstream errors; // Collects each line's errors
+    std::ostringstream output; // Collects each line's output, unless Inputs::output is set
+};
+
+#endif // SESSION_H
@@ -0,0 +1,462 @@
+#include "Supervisor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <signal.h>
+#include <sstream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include "BytecodeImage.h"
+#include "VM.h"
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the shared rings need lock-free 64-bit atomics");
+
+namespace {
+
+const size_t kRingCapacity = 8;              // Jobs (or results) queued per worker; a power of two
+const uint64_t kTextCapacity = 256ull << 20; // Bytes of output and errors per run() (reserved lazily)
+const int kMaxAttempts = 2;                  // Runs of a script whose workers crashed before it fails
+
+/**
+ * A bounded single-producer, single-consumer queue of 32-bit values that works between
+ * processes. The producer writes a value and then publishes it by moving head; the consumer
+ * reads it and then frees its cell by moving tail. Either store happened or it did not, so a
+ * process that dies inside push() or pop() leaves the ring consistent, and once a worker is
+ * dead the supervisor can take back the jobs it never started.
+ */
+struct Ring {
+    alignas(64) std::atomic<uint64_t> head; // Next position to push
+    alignas(64) std::atomic<uint64_t> tail; // Next position to pop
+    uint32_t values[kRingCapacity];
+
+    Ring() : head(0), tail(0) {}
+
+    bool push(uint32_t value) {
+        uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) == kRingCapacity) return false; // Full
+        values[position & (kRingCapacity - 1)] = value;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Reads the oldest value without taking it, so the consumer can record it before dropping it
+    bool peek(uint32_t& value) const {
+        uint64_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire)) return false; // Empty
+        value = values[position & (kRingCapacity - 1)];
+        return true;
+    }
+
+    void drop() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool pop(uint32_t& value) {
+        if (!peek(value)) return false;
+        drop();
+        return true;
+    }
+
+    size_t size() const { return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire); }
+
+    // Copies the values still queued, oldest first; only stable once one side has stopped
+    void contents(std::vector<uint32_t>& out) const {
+        uint64_t last = head.load(std::memory_order_acquire);
+        for (uint64_t position = tail.load(std::memory_order_acquire); position < last; ++position) {
+            out.push_back(values[position & (kRingCapacity - 1)]);
+        }
+    }
+};
+
+struct Header {
+    alignas(64) std::atomic<uint32_t> stopping;
+    std::atomic<uint64_t> text_used; // Bytes of the text area handed out
+};
+
+// One worker's queues, and what it is doing, for the supervisor to recover from its death
+struct alignas(64) WorkerSlot {
+    Ring jobs;    // Script indices the supervisor handed this worker
+    Ring results; // Script indices whose record this worker completed
+    alignas(64) std::atomic<uint32_t> job; // Index + 1 of the script it is running, or 0
+    std::atomic<int64_t> started;          // steady_clock nanoseconds when that script started
+
+    WorkerSlot() : job(0), started(0) {}
+};
+
+// A script's result, written by the worker that ran it
+struct ResultRecord {
+    std::atomic<uint32_t> done; // Set once the fields below are complete
+    uint32_t ok;
+    uint32_t truncated; // Output or errors did not fit in the text area
+    double value;
+    double seconds;
+    uint64_t output_offset, output_length;
+    uint64_t errors_offset, errors_length;
+};
+
+// The shared mapping, carved into the header, the worker slots, the records and the text area
+struct Region {
+    void* memory = nullptr;
+    size_t bytes = 0;
+    Header* header = nullptr;
+    WorkerSlot* slots = nullptr;
+    ResultRecord* records = nullptr;
+    char* text = nullptr;
+
+    bool map(size_t workers, size_t scripts) {
+        auto align = [](size_t size) { return (size + 63) / 64 * 64; };
+        size_t slotsAt = align(sizeof(Header));
+        size_t recordsAt = slotsAt + align(workers * sizeof(WorkerSlot));
+        size_t textAt = recordsAt + align(scripts * sizeof(ResultRecord));
+        bytes = textAt + kTextCapacity;
+        int flags = MAP_SHARED | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+        flags |= MAP_NORESERVE; // Pages of the text area cost nothing until written
+#endif
+        memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (memory == MAP_FAILED) {
+            memory = nullptr;
+            return false;
+        }
+        char* base = static_cast<char*>(memory);
+        header = new (base) Header();
+        header->stopping.store(0);
+        header->text_used.store(0);
+        slots = reinterpret_cast<WorkerSlot*>(base + slotsAt);
+        for (size_t i = 0; i < workers; ++i) new (&slots[i]) WorkerSlot();
+        records = reinterpret_cast<ResultRecord*>(base + recordsAt);
+        for (size_t i = 0; i < scripts; ++i) new (&records[i]) ResultRecord{{0}, 0, 0, 0, 0, 0, 0, 0, 0};
+        text = base + textAt;
+        return true;
+    }
+
+    ~Region() {
+        if (memory) munmap(memory, bytes);
+    }
+};
+
+int64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Waits a little longer each time nothing was there to do: yields first, then sleeps
+void backOff(int& idle) {
+    if (++idle < 64) {
+        std::this_thread::yield();
+    } else {
+        usleep(idle < 256 ? 50 : 200);
+    }
+}
+
+// A program as a worker runs it: the image mapped read-only, run in place through an Executable over the mapping
+struct MappedProgram {
+    BytecodeImage image;
+    std::unique_ptr<Executable> executable;
+};
+
+// Copies text into the shared text area; false if it did not fit
+bool storeText(Region& region, const std::string& text, uint64_t& offset, uint64_t& length) {
+    offset = region.header->text_used.fetch_add(text.size(), std::memory_order_relaxed);
+    length = 0;
+    if (offset + text.size() > kTextCapacity) return false;
+    std::memcpy(region.text + offset, text.data(), text.size());
+    length = text.size();
+    return true;
+}
+
+// A worker process: takes scripts from the job ring until the supervisor stops (or dies); never returns
+[[noreturn]] void workerMain(Region& region, size_t self, const std::vector<size_t>& programOf,
+                             const std::vector<std::string>& images, const cocompiler::Inputs& inputs) {
+    pid_t supervisor = getppid();
+    VM vm;
+    vm.setTrace(false);
+    vm.setJit(inputs.jit);
+    vm.setClosures(inputs.closures);
+    vm.setTierUpThreshold(inputs.tier_up_threshold);
+    vm.setMaxFrames(inputs.max_frames);
+    vm.setBackEdgeBudget(inputs.back_edge_budget);
+    vm.setInstructionBudget(inputs.instruction_budget);
+    vm.setDeadline(inputs.deadline_ms);
+    vm.setMaxStringBytes(inputs.max_string_bytes);
+    std::ostringstream output, errors;
+    vm.setOutputStream(output);
+    vm.setErrorStream(errors);
+    std::vector<std::unique_ptr<MappedProgram>> mapped(images.size()); // Mapped on first use
+
+    WorkerSlot& slot = region.slots[self];
+    int idle = 0;
+    while (!region.header->stopping.load(std::memory_order_acquire)) {
+        uint32_t job;
+        if (!slot.jobs.peek(job)) {
+            if (getppid() != supervisor) _exit(1); // Orphaned
+            backOff(idle);
+            continue;
+        }
+        idle = 0;
+        int64_t start = nowNanoseconds();
+        slot.started.store(start, std::memory_order_relaxed);
+        slot.job.store(job + 1, std::memory_order_release);
+        slot.jobs.drop(); // Only now, so the job is always in the ring or the slot
+
+        ResultRecord& record = region.records[job];
+        size_t program = programOf[job];
+        output.str("");
+        errors.str("");
+        record.value = -1;
+        if (!mapped[program]) {
+            std::unique_ptr<MappedProgram> loaded(new MappedProgram());
+            if (loaded->image.load(images[program])) {
+                const BytecodeImage& image = loaded->image;
+                loaded->executable.reset(new Executable(BytecodeView(image.code(), image.size()), image.strings(), image.globalCount()));
+                mapped[program] = std::move(loaded);
+            }
+        }
+        if (mapped[program]) {
+            record.value = vm.run(*mapped[program]->executable); // Reads the mapped instructions in place
+        } else {
+            errors << "Worker Error: Could not map the program's image." << std::endl;
+        }
+        record.seconds = (nowNanoseconds() - start) / 1e9;
+        std::string errorText = errors.str();
+        record.ok = errorText.empty();
+        record.truncated = !storeText(region, output.str(), record.output_offset, record.output_length) ||
+                           !storeText(region, errorText, record.errors_offset, record.errors_length);
+        record.done.store(1, std::memory_order_release);
+
+        while (!slot.results.push(job)) backOff(idle);
+        idle = 0;
+        slot.job.store(0, std::memory_order_release);
+    }
+    _exit(0);
+}
+
+} // namespace
+
+Supervisor::Supervisor(size_t workers, const cocompiler::Inputs& inputs, uint32_t timeout_ms)
+    : workers(workers == 0 ? std::max(1u, std::thread::hardware_concurrency()) : workers),
+      inputs(inputs), timeout_ms(timeout_ms), respawns(0) {}
+
+std::vector<BatchOutcome> Supervisor::run(const std::vector<BatchScript>& scripts) {
+    auto batchStart = std::chrono::steady_clock::now();
+    respawns = 0;
+    std::vector<BatchOutcome> outcomes(scripts.size());
+    std::vector<bool> finished(scripts.size(), false);
+    size_t remaining = scripts.size();
+    auto fail = [&](size_t script, const std::string& message) {
+        if (finished[script]) return;
+        outcomes[script].result.ok = false;
+        outcomes[script].result.value = -1;
+        outcomes[script].result.errors += message;
+        finished[script] = true;
+        remaining--;
+    };
+
+    // Compile each distinct source once, into an image the workers map
+    std::unordered_map<std::string_view, size_t> slots;
+    std::vector<size_t> programOf(scripts.size());
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        programOf[i] = slots.emplace(scripts[i].source, slots.size()).first->second;
+    }
+    std::vector<cocompiler::Program> programs(slots.size());
+    std::vector<std::string> images(slots.size());
+    std::vector<bool> written(slots.size(), false);
+    const char* temporary = std::getenv("TMPDIR");
+    std::string directory = std::string(temporary && *temporary ? temporary : "/tmp") + "/cocompiler-XXXXXX";
+    bool haveDirectory = mkdtemp(&directory[0]) != nullptr;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        size_t program = programOf[i];
+        if (images[program].empty()) { // First script with this source
+            programs[program] = cocompiler::compile(scripts[i].source);
+            images[program] = directory + "/" + std::to_string(program) + ".cocb";
+            written[program] = haveDirectory && programs[program].ok() &&
+                               BytecodeImage::write(images[program], programs[program].bytecode(), programs[program].strings(),
+                                                    programs[program].globalCount(),
+                                                    programs[program].isExpression() ? BytecodeImage::kExpressionResult : 0);
+        }
+        outcomes[i].expression = programs[program].isExpression();
+        if (!programs[program].ok()) {
+            fail(i, programs[program].errors());
+        } else if (!written[program]) {
+            fail(i, "Worker Error: Could not write the program's image.\n");
+        }
+    }
+
+    Region region;
+    if (remaining > 0 && !region.map(workers, scripts.size())) {
+        for (size_t i = 0; i < scripts.size(); ++i) fail(i, "Worker Error: Could not map the shared job queue.\n");
+    }
+
+    std::vector<pid_t> pids(workers, -1);
+    auto spawn = [&](size_t self) {
+        std::cout.flush(); // Buffered output would otherwise be written again by the child
+        pid_t pid = fork();
+        if (pid == 0) workerMain(region, self, programOf, images, inputs);
+        pids[self] = pid;
+        return pid > 0;
+    };
+    if (remaining > 0) {
+        for (size_t self = 0; self < workers; ++self) spawn(self);
+    }
+
+    // Collects a script whose record a worker completed
+    auto collect = [&](uint32_t script) {
+        const ResultRecord& record = region.records[script];
+        if (finished[script] || !record.done.load(std::memory_order_acquire)) return;
+        cocompiler::Result& result = outcomes[script].result;
+        result.ok = record.ok && !record.truncated;
+        result.value = record.value;
+        result.output.assign(region.text + record.output_offset, record.output_length);
+        result.errors.assign(region.text + record.errors_offset, record.errors_length);
+        if (record.truncated) result.errors += "Worker Error: The script's output did not fit in shared memory.\n";
+        outcomes[script].seconds = record.seconds;
+        finished[script] = true;
+        remaining--;
+    };
+
+    std::vector<int> attempts(scripts.size(), 0);
+    std::vector<uint32_t> killedFor(workers, 0); // Job + 1 a worker was killed for running too long
+    std::deque<uint32_t> queue;
+    for (size_t i = 0; i < scripts.size(); ++i) {
+        if (!finished[i]) queue.push_back(static_cast<uint32_t>(i));
+    }
+
+    // Puts every unfinished script that is neither queued nor held by a live worker back in the queue.
+    // Each worker ring is read before its slot, and the slots before the records: a worker records a
+    // job in its slot before dropping it from its ring, and completes its record before clearing its slot.
+    std::vector<bool> held(scripts.size());
+    std::vector<uint32_t> pending;
+    auto requeueLost = [&]() {
+        std::fill(held.begin(), held.end(), false);
+        for (uint32_t script : queue) held[script] = true;
+        for (size_t self = 0; self < workers; ++self) {
+            if (pids[self] <= 0) continue;
+            pending.clear();
+            region.slots[self].jobs.contents(pending);
+            for (uint32_t script : pending) held[script] = true;
+            uint32_t job = region.slots[self].job.load(std::memory_order_acquire);
+            if (job != 0) held[job - 1] = true;
+        }
+        for (size_t script = 0; script < scripts.size(); ++script) {
+            if (finished[script] || held[script]) continue;
+            collect(static_cast<uint32_t>(script)); // Completed, but its result was never read
+            if (!finished[script]) queue.push_back(static_cast<uint32_t>(script));
+        }
+    };
+
+    int idle = 0;
+    while (remaining > 0) {
+        bool progress = false;
+        // Each job goes to the live worker with the fewest queued, so a slow script holds up few others
+        while (!queue.empty()) {
+            size_t best = workers;
+            for (size_t self = 0; self < workers; ++self) {
+                if (pids[self] > 0 && (best == workers || region.slots[self].jobs.size() < region.slots[best].jobs.size())) {
+                    best = self;
+                }
+            }
+            if (best == workers || !region.slots[best].jobs.push(queue.front())) break;
+            queue.pop_front();
+            progress = true;
+        }
+        for (size_t self = 0; self < workers; ++self) {
+            uint32_t script;
+            while (region.slots[self].results.pop(script)) {
+                collect(script);
+                progress = true;
+            }
+        }
+
+        // A dead worker's jobs go back in the queue (the one it was running at most once more), and a new worker takes its place
+        for (size_t self = 0; self < workers; ++self) {
+            int status;
+            if (pids[self] <= 0 || waitpid(pids[self], &status, WNOHANG) != pids[self]) continue;
+            progress = true;
+            pids[self] = -1;
+            WorkerSlot& slot = region.slots[self];
+            uint32_t script;
+            while (slot.results.pop(script)) collect(script);
+            uint32_t job = slot.job.exchange(0);
+            pending.clear();
+            slot.jobs.contents(pending); // Never started: requeued as they were, without an attempt
+            for (auto it = pending.rbegin(); it != pending.rend(); ++it) {
+                if (*it + 1 != job) queue.push_front(*it);
+            }
+            slot.jobs.head.store(0);
+            slot.jobs.tail.store(0);
+            slot.results.head.store(0);
+            slot.results.tail.store(0);
+            if (job != 0) {
+                uint32_t crashed = job - 1;
+                collect(crashed); // Finished, but died before clearing its slot
+                if (!finished[crashed]) {
+                    outcomes[crashed].seconds = (nowNanoseconds() - slot.started.load()) / 1e9;
+                }
+                if (killedFor[self] == job) {
+                    fail(crashed, "Worker Error: The script ran longer than " + std::to_string(timeout_ms) +
+                                      " ms and its worker was stopped.\n");
+                } else if (!finished[crashed]) {
+                    std::string cause = WIFSIGNALED(status) ? "signal " + std::to_string(WTERMSIG(status))
+                                                            : "exit status " + std::to_string(WEXITSTATUS(status));
+                    if (++attempts[crashed] < kMaxAttempts) {
+                        queue.push_front(crashed);
+                    } else {
+                        fail(crashed, "Worker Error: The script crashed its worker (" + cause + ").\n");
+                    }
+                }
+            }
+            killedFor[self] = 0;
+            requeueLost();
+            if (remaining > 0) {
+                respawns++;
+                spawn(self);
+            }
+        }
+        if (std::all_of(pids.begin(), pids.end(), [](pid_t worker) { return worker <= 0; }) && remaining > 0) {
+            for (size_t i = 0; i < scripts.size(); ++i) fail(i, "Worker Error: Could not start a worker process.\n");
+        }
+
+        // Workers stuck in one script for too long are killed (and reaped above), unless it just completed
+        if (timeout_ms > 0) {
+            int64_t now = nowNanoseconds();
+            for (size_t self = 0; self < workers; ++self) {
+                uint32_t job = region.slots[self].job.load(std::memory_order_acquire);
+                int64_t started = region.slots[self].started.load(std::memory_order_relaxed);
+                if (job != 0 && killedFor[self] == 0 && pids[self] > 0 && now - started > int64_t(timeout_ms) * 1000000 &&
+                    region.slots[self].job.load(std::memory_order_acquire) == job &&
+                    !region.records[job - 1].done.load(std::memory_order_acquire)) {
+                    killedFor[self] = job;
+                    kill(pids[self], SIGKILL);
+                }
+            }
+        }
+
+        if (progress) {
+            idle = 0;
+        } else {
+            backOff(idle);
+        }
+    }
+
+    if (region.header) region.header->stopping.store(1, std::memory_order_release);
+    for (pid_t pid : pids) {
+        if (pid > 0) waitpid(pid, nullptr, 0);
+    }
+    if (haveDirectory) {
+        for (size_t program = 0; program < images.size(); ++program) {
+            if (written[program]) unlink(images[program].c_str());
+        }
+        rmdir(directory.c_str());
+    }
+
+    totals = BatchSummary::of(outcomes, programs.size(),
+                              std::chrono::duration<double>(std::chrono::steady_clock::now() - batchStart).count());
+    return outcomes;
+}
@@ -0,0 +1,57 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../include/CoCompiler.h"
+#include "BatchRunner.h"
+
+/**
+ * @brief Runs a batch of scripts in forked worker processes, so that a script which crashes
+ * or runs away takes down only its worker (POSIX only).
+ *
+ * The supervisor compiles every distinct source once and writes it as a bytecode image
+ * (see BytecodeImage.h) into a temporary directory; workers map the images read-only and
+ * run the instructions in place (see Executable), so all workers share their pages. Jobs
+ * (script indices) and results flow through a pair of lock-free single-producer,
+ * single-consumer rings per worker in an anonymous shared mapping, next to one record per
+ * script and a text area its output and errors are copied into. The supervisor hands each
+ * job to the worker with the fewest queued. A worker publishes the job it is running before
+ * taking it off its ring, so every unfinished job is always queued, in a ring or in a slot.
+ * When a worker dies, the supervisor collects what it completed, takes back the jobs it never
+ * started, puts the one it was running back in the queue (once; a script that crashes a
+ * second worker fails), requeues anything else unaccounted for, and forks a replacement.
+ * Workers that run a script for longer than the timeout are killed, and the script fails
+ * without a retry.
+ */
+class Supervisor {
+public:
+    /**
+     * @param workers Worker processes; 0 uses the number of hardware threads.
+     * @param inputs How every script runs (Inputs::output, Inputs::bindings are ignored).
+     * @param timeout_ms Longest a script may run before its worker is killed (0 = no limit).
+     */
+    Supervisor(size_t workers, const cocompiler::Inputs& inputs = cocompiler::Inputs(), uint32_t timeout_ms = 0);
+
+    /**
+     * @brief Runs every script on the workers and waits for all of them.
+     * @return One outcome per script, in the order of scripts. If the workers could not be
+     * set up, every script fails with the reason in its errors.
+     */
+    std::vector<BatchOutcome> run(const std::vector<BatchScript>& scripts);
+
+    const BatchSummary& summary() const { return totals; } // Of the last run()
+    size_t getWorkers() const { return workers; }
+    size_t getRespawns() const { return respawns; } // Workers replaced during the last run()
+
+private:
+    size_t workers;
+    cocompiler::Inputs inputs;
+    uint32_t timeout_ms;
+    BatchSummary totals;
+    size_t respawns;
+};
+
+#endif // SUPERVISOR_H
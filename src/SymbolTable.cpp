@@ -1,11 +1,12 @@
 #include "SymbolTable.h"
+#include <algorithm> // For std::min
 #include <iostream> // For debugging purposes, can be removed later
 
 /**
  * @brief Constructs a new SymbolTable object.
  * Initializes with a global scope and resets the next available address.
  */
-SymbolTable::SymbolTable() : next_address(0) {
+SymbolTable::SymbolTable() : next_address(0), function_scope_depth(-1), next_local(0), errors(&std::cerr) {
     enterScope(); // Start with a global scope
 }
 
@@ -25,44 +26,158 @@ void SymbolTable::exitScope() {
         scopes.pop_back();
     } else {
         // Optionally, handle error or log a warning if trying to exit global scope
-        std::cerr << "Warning: Attempted to exit global scope." << std::endl;
+        *errors << "Warning: Attempted to exit global scope." << std::endl;
     }
 }
 
+/**
+ * @brief Enters the outermost scope of a function body and restarts local slot numbering.
+ * Functions cannot be nested, so there is at most one active function scope.
+ */
+void SymbolTable::enterFunctionScope() {
+    enterScope();
+    function_scope_depth = static_cast<int>(scopes.size()) - 1;
+    next_local = 0;
+}
+
+/**
+ * @brief Exits the outermost scope of a function body.
+ */
+void SymbolTable::exitFunctionScope() {
+    exitScope();
+    function_scope_depth = -1;
+}
+
+/**
+ * @brief Enters the outermost scope of a function body inlined at a call site.
+ * @param visibleAddressLimit The next global address at the point the function was declared.
+ */
+void SymbolTable::enterInlineScope(int visibleAddressLimit) {
+    enterScope();
+    inline_barriers.emplace_back(static_cast<int>(scopes.size()) - 1, visibleAddressLimit);
+}
+
+/**
+ * @brief Exits the outermost scope of an inlined function body.
+ */
+void SymbolTable::exitInlineScope() {
+    exitScope();
+    inline_barriers.pop_back();
+}
+
+/**
+ * @brief Returns the next global address that will be assigned.
+ * @return The next available memory address.
+ */
+int SymbolTable::getNextAddress() const {
+    return next_address;
+}
+
+/**
+ * @brief Checks whether a function body is currently being compiled.
+ * @return True if inside a function scope.
+ */
+bool SymbolTable::inFunction() const {
+    return function_scope_depth >= 0;
+}
+
+/**
+ * @brief Returns the number of frame slots used by the current function so far.
+ * Slots are never reused, so this is also the function's frame size.
+ * @return The number of locals (including parameters).
+ */
+int SymbolTable::getLocalCount() const {
+    return next_local;
+}
+
 /**
  * @brief Adds a symbol to the current scope.
- * Assigns a unique address to the new symbol.
+ * Assigns a unique address (or frame slot, inside a function) to the new symbol.
  * @param name The name of the symbol.
  * @param type The type of the symbol.
  * @return True if the symbol was added successfully, false if it already exists in the current scope.
  */
 bool SymbolTable::addSymbol(const std::string& name, ASTNode::Type type) {
     if (scopes.empty()) {
-        std::cerr << "Error: No active scope to add symbol to." << std::endl;
+        *errors << "Error: No active scope to add symbol to." << std::endl;
         return false;
     }
     // Check if the symbol already exists in the current scope
     if (scopes.back().count(name)) {
-        std::cerr << "Error: Symbol '" << name << "' already exists in the current scope." << std::endl;
+        *errors << "Error: Symbol '" << name << "' already exists in the current scope." << std::endl;
         return false;
     }
-    // Assign the next available address and increment it
-    scopes.back().emplace(name, Symbol(name, type, next_address++));
+    // Function locals get the next frame slot; everything else the next global address
+    if (inFunction()) {
+        scopes.back().emplace(name, Symbol(name, type, next_local++, true));
+    } else {
+        scopes.back().emplace(name, Symbol(name, type, next_address++));
+    }
     return true;
 }
 
+/**
+ * @brief Reserves an unnamed frame slot in the current function.
+ * @return The slot number.
+ */
+int SymbolTable::reserveLocal() {
+    return next_local++;
+}
+
 /**
  * @brief Looks up a symbol in the current and enclosing scopes.
- * Searches from the innermost scope outwards to the global scope.
+ * Searches from the innermost scope outwards to the global scope. Once the search
+ * leaves an inlined function body, only globals declared before that function are
+ * visible (addresses grow monotonically, so this is an address comparison).
  * @param name The name of the symbol to look up.
  * @return A pointer to the Symbol if found, nullptr otherwise.
  */
 Symbol* SymbolTable::lookupSymbol(const std::string& name) {
-    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        auto& scope = *it;
-        if (scope.count(name)) {
-            return &scope.at(name);
+    int visibleAddressLimit = -1; // -1: not behind an inline barrier
+    auto barrier = inline_barriers.rbegin();
+    for (int index = static_cast<int>(scopes.size()) - 1; index >= 0; --index) {
+        auto found = scopes[index].find(name);
+        if (found != scopes[index].end()) {
+            Symbol& symbol = found->second;
+            if (visibleAddressLimit < 0 || (!symbol.isLocal && symbol.address < visibleAddressLimit)) {
+                return &symbol;
+            }
+        }
+        if (barrier != inline_barriers.rend() && barrier->first == index) {
+            visibleAddressLimit = visibleAddressLimit < 0 ? barrier->second : std::min(visibleAddressLimit, barrier->second);
+            ++barrier;
         }
     }
     return nullptr; // Symbol not found in any scope
 }
+
+/**
+ * @brief Records the current scope depth and next global address.
+ * @return The checkpoint.
+ */
+SymbolTable::Checkpoint SymbolTable::checkpoint() const {
+    return Checkpoint{scopes.size(), next_address};
+}
+
+/**
+ * @brief Returns to a checkpoint: pops the scopes entered since and removes the globals declared since.
+ * Globals are only found by a scan of the remaining scopes, which is fine on this error path.
+ * @param checkpoint A checkpoint taken at this scope depth or deeper.
+ */
+void SymbolTable::restore(const Checkpoint& checkpoint) {
+    while (scopes.size() > checkpoint.scopes && scopes.size() > 1) {
+        scopes.pop_back();
+    }
+    function_scope_depth = -1;
+    inline_barriers.clear();
+    for (auto& scope : scopes) {
+        for (auto it = scope.begin(); it != scope.end();) {
+            if (!it->second.isLocal && it->second.address >= checkpoint.next_address) {
+                it = scope.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+    next_address = checkpoint.next_address;
+}
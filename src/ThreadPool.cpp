@@ -0,0 +1,141 @@
+#include "ThreadPool.h"
+#include <cstdlib>
+
+// Set while a thread is executing pool tasks; nested parallelFor calls then run inline
+static thread_local bool insidePool = false;
+
+ThreadPool::ThreadPool(size_t threadCount) : generation(0), stopping(false) {
+    size_t participants = threadCount == 0 ? 1 : threadCount;
+    for (size_t i = 0; i < participants; ++i) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (size_t i = 1; i < participants; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop(size_t self) {
+    size_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+        }
+        runTasks(self);
+    }
+}
+
+/**
+ * Takes the next task from this participant's own deque (front), or steals the last task
+ * of another participant's deque.
+ */
+bool ThreadPool::takeTask(size_t self, Task& task) {
+    {
+        Queue& own = *queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        Queue& victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::runTasks(size_t self) {
+    insidePool = true;
+    Task task;
+    while (takeTask(self, task)) {
+        // A task's job outlives it: parallelFor waits for every task before returning
+        (*task.job->body)(task.index, self);
+        if (task.job->remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(done_mutex);
+            done.notify_all();
+        }
+    }
+    insidePool = false;
+}
+
+void ThreadPool::parallelFor(size_t taskCount, const std::function<void(size_t)>& body) {
+    parallelForEach(taskCount, [&body](size_t task, size_t) { body(task); });
+}
+
+void ThreadPool::parallelForEach(size_t taskCount, const std::function<void(size_t, size_t)>& body) {
+    if (taskCount == 0) return;
+    if (taskCount == 1 || queues.size() == 1 || insidePool) {
+        // Inline on this thread; participant 0 is private to this call
+        for (size_t i = 0; i < taskCount; ++i) body(i, 0);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(run_mutex);
+    Job job;
+    job.body = &body;
+    job.remaining = taskCount;
+
+    // Contiguous blocks keep neighbouring tasks (and their memory) on the same thread
+    size_t participants = queues.size();
+    for (size_t p = 0; p < participants; ++p) {
+        size_t begin = taskCount * p / participants;
+        size_t end = taskCount * (p + 1) / participants;
+        std::lock_guard<std::mutex> lock(queues[p]->mutex);
+        for (size_t i = begin; i < end; ++i) {
+            queues[p]->tasks.push_back(Task{&job, i});
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0);
+
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done.wait(lock, [&] { return job.remaining.load() == 0; });
+}
+
+static std::unique_ptr<ThreadPool>& sharedPool() {
+    static std::unique_ptr<ThreadPool> pool;
+    return pool;
+}
+
+ThreadPool& ThreadPool::shared() {
+    static std::mutex creation; // VMs on different threads may reach their first parallel loop together
+    std::lock_guard<std::mutex> lock(creation);
+    std::unique_ptr<ThreadPool>& pool = sharedPool();
+    if (!pool) {
+        size_t threads = std::thread::hardware_concurrency();
+        if (const char* configured = std::getenv("COCOMPILER_THREADS")) {
+            threads = static_cast<size_t>(std::strtoul(configured, nullptr, 10));
+        }
+        pool.reset(new ThreadPool(threads));
+    }
+    return *pool;
+}
+
+void ThreadPool::setSharedThreadCount(size_t threadCount) {
+    sharedPool().reset(new ThreadPool(threadCount));
+}
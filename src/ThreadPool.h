@@ -0,0 +1,98 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief A fixed-size work-stealing thread pool for data-parallel loops.
+ *
+ * parallelFor() splits its tasks into one contiguous block per participant (the calling
+ * thread plus the pool's workers). Each participant takes tasks from the front of its own
+ * deque and, once that is empty, steals from the back of the others', so uneven tasks
+ * (e.g. merge steps of different sizes) still balance. Calls made from inside a task run
+ * inline, so nested parallel algorithms cannot deadlock.
+ *
+ * Task boundaries are chosen by the caller, never by the pool, so results that depend on
+ * the order of floating-point operations are the same for any thread count.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts a pool in which threadCount threads (including the caller) take part.
+     * @param threadCount Total participants; 0 or 1 runs every loop on the calling thread.
+     */
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * @brief Runs body(0) ... body(taskCount - 1) across the pool and waits for all of them.
+     * @param taskCount The number of tasks.
+     * @param body The task function; tasks may run concurrently and in any order.
+     */
+    void parallelFor(size_t taskCount, const std::function<void(size_t)>& body);
+
+    /**
+     * @brief Like parallelFor, but also passes each task the index of the participant running
+     * it (below getThreadCount(); 0 is the calling thread). No two tasks with the same
+     * participant index run at the same time, so callers can keep per-participant state.
+     * @param taskCount The number of tasks.
+     * @param body The task function, called as body(task, participant).
+     */
+    void parallelForEach(size_t taskCount, const std::function<void(size_t, size_t)>& body);
+
+    size_t getThreadCount() const { return queues.size(); }
+
+    /**
+     * @brief Returns the pool used by the VM's array builtins.
+     * Its size is set by setSharedThreadCount(), or else the COCOMPILER_THREADS environment
+     * variable, or else the number of hardware threads.
+     */
+    static ThreadPool& shared();
+
+    /**
+     * @brief Replaces the shared pool with one of the given size.
+     * Must not be called while the shared pool is running a loop.
+     */
+    static void setSharedThreadCount(size_t threadCount);
+
+private:
+    struct Job {
+        const std::function<void(size_t, size_t)>* body;
+        std::atomic<size_t> remaining;
+    };
+    struct Task {
+        Job* job;
+        size_t index;
+    };
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues; // One per participant; queues[0] belongs to the caller
+    std::vector<std::thread> workers;
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+    size_t generation; // Bumped for every parallelFor, so sleeping workers know there is work
+    bool stopping;
+    std::mutex done_mutex;
+    std::condition_variable done;
+    std::mutex run_mutex; // Serializes parallelFor calls from different threads
+
+    void workerLoop(size_t self);
+    void runTasks(size_t self);
+    bool takeTask(size_t self, Task& task);
+};
+
+#endif // THREAD_POOL_H
@@ -1,11 +1,576 @@
 #include "VM.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <new>
+#include <sstream>
+#include "ClosureCompiler.h"
+#include "JIT.h"
+#include "Optimizer.h"
+#include "ThreadPool.h"
+#include <time.h>
 
 /**
  * @brief Constructs a new VM object.
  * Initializes the program counter.
  */
-VM::VM() : pc(0) {}
+VM::VM() : original(bytecode), program(bytecode), heap(&own_heap), parallel_worker(false), halted(false), pc(0), frame_count(0), fp(0), max_frames(1024), trace(true), errors(&std::cerr), output(&std::cout), natives(&own_natives), inputs(nullptr), back_edges_taken(0), back_edge_budget(0), limit_check_at(UINT64_MAX), calls_taken(0), call_check_at(UINT64_MAX), instruction_budget(0), instructions_counted(0), deadline_ms(0), deadline(0), max_string_bytes(0), string_bytes(0), run_error(RunError::NONE), jit(false), closures(false), tier_up_threshold(1000), tiering(false), optimized_for(0), source_pcs(nullptr), compiled_handover(false), stepping(false) {}
+
+/**
+ * @brief Prepares a program for sharing: converts the string literals and hashes each one now,
+ * so that VMs running the program never write to it.
+ */
+Executable::Executable(std::vector<Bytecode> bytecode, std::vector<std::string> string_literals, size_t global_count)
+    : Executable(BytecodeView(), std::move(string_literals), global_count) {
+    this->bytecode = std::move(bytecode);
+    code = this->bytecode;
+}
+
+/**
+ * @brief Prepares a program whose instructions are held elsewhere: they are read in place,
+ * so processes that map one bytecode image share its pages. They must outlive the Executable.
+ */
+Executable::Executable(BytecodeView code, std::vector<std::string> string_literals, size_t global_count)
+    : code(code), string_literals(std::move(string_literals)), global_count(global_count) {
+    static std::atomic<uint64_t> next_id(1);
+    id = next_id++;
+    strings.assign(this->string_literals.begin(), this->string_literals.end());
+    for (const StringObject& string : strings) {
+        string.getHash();
+    }
+}
+
+/**
+ * @brief Records a backward jump to the given target.
+ * Back-edges are the only place the VM checks its loop budget and updates hotness
+ * counters, so straight-line code pays nothing for either. A loop header whose counter
+ * reaches the tier-up threshold switches the program to its optimized version.
+ * @param target The instruction index the jump lands on (a loop header); translated into
+ * the optimized program if the program tiered up.
+ * @return True if execution may continue, false if the back-edge budget is exhausted or
+ * execution continues in compiled code (see tierUp).
+ */
+bool VM::onBackEdge(int& target) {
+    back_edge_counts[target]++;
+    instructions_counted += static_cast<uint64_t>(pc - target); // pc is past the jump: the iteration's length
+    if (++back_edges_taken >= limit_check_at && !checkLimits(target)) return false;
+    if (tiering && back_edge_counts[target] >= tier_up_threshold) {
+        pc = target;
+        if (!tierUp()) return false;
+        target = pc;
+    }
+    return true;
+}
+
+void VM::reportBackEdgeBudget(int target) {
+    if (source_pcs) target = (*source_pcs)[target]; // Report the loop as compiled
+    *errors << "VM Error: Back-edge budget of " << back_edge_budget << " exhausted at PC " << target << "." << std::endl;
+}
+
+// Back-edges between two looks at the clock when a deadline is set: well under a millisecond of looping
+static const uint64_t kDeadlinePollInterval = 4096;
+
+// Milliseconds on a monotonic clock that is read without a system call, to within a few milliseconds
+static uint64_t coarseMilliseconds() {
+#ifdef CLOCK_MONOTONIC_COARSE
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000 + static_cast<uint64_t>(now.tv_nsec) / 1000000;
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/**
+ * @brief Resets the limit counters for a new run and starts its deadline.
+ * Called once the program to run is set, since the checks are spaced by its length.
+ */
+void VM::startLimits() {
+    back_edges_taken = 0;
+    calls_taken = 0;
+    instructions_counted = 0;
+    string_bytes = 0;
+    run_error = RunError::NONE;
+    if (deadline_ms != 0) deadline = coarseMilliseconds() + deadline_ms;
+    scheduleLimitCheck();
+}
+
+/**
+ * @brief Checks the run's limits. Every tier calls this when back_edges_taken reaches
+ * limit_check_at or calls_taken reaches call_check_at, so between checks a loop or a
+ * recursive call pays one compare for all limits together.
+ * @param target The loop header the back-edge jumps to, or the function a call enters, for the error message.
+ * @return False (after reporting, with run_error set) if a limit is exceeded.
+ */
+bool VM::checkLimits(int target) {
+    int reported = source_pcs ? (*source_pcs)[target] : target; // Report the loop as compiled
+    if (back_edge_budget != 0 && back_edges_taken > back_edge_budget) {
+        run_error = RunError::BACK_EDGE_BUDGET;
+        reportBackEdgeBudget(target);
+        return false;
+    }
+    if (instruction_budget != 0 && instructionsUsed() > instruction_budget) {
+        run_error = RunError::INSTRUCTION_BUDGET;
+        *errors << "VM Error: Instruction budget of " << instruction_budget << " exhausted at PC " << reported << "." << std::endl;
+        return false;
+    }
+    if (deadline_ms != 0 && coarseMilliseconds() >= deadline) {
+        run_error = RunError::DEADLINE;
+        *errors << "VM Error: Deadline of " << deadline_ms << " ms passed at PC " << reported << "." << std::endl;
+        return false;
+    }
+    scheduleLimitCheck();
+    return true;
+}
+
+/**
+ * @brief Sets limit_check_at and call_check_at to the first back-edge and call at which a
+ * limit could be exceeded. One back-edge adds at most the program's length to the
+ * instruction count and one call adds one, so the instruction budget needs looking at only
+ * once enough of them could have used up what is left of it (half each, as both may run
+ * between checks); checks come closer together as it runs low, and it is never overshot.
+ */
+void VM::scheduleLimitCheck() {
+    uint64_t next = UINT64_MAX;
+    uint64_t nextCall = UINT64_MAX;
+    if (back_edge_budget != 0) next = back_edge_budget + 1;
+    if (instruction_budget != 0) {
+        uint64_t used = instructionsUsed();
+        uint64_t left = used < instruction_budget ? instruction_budget - used : 0;
+        uint64_t longest = std::max<uint64_t>(program.size(), 1);
+        next = std::min(next, back_edges_taken + left / 2 / longest + 1);
+        nextCall = std::min(nextCall, calls_taken + left / 2 + 1);
+    }
+    if (deadline_ms != 0) {
+        next = std::min(next, back_edges_taken + kDeadlinePollInterval);
+        nextCall = std::min(nextCall, calls_taken + kDeadlinePollInterval);
+    }
+    limit_check_at = next;
+    call_check_at = nextCall;
+}
+
+// Moves per-instruction counters to the optimized instructions their entry points became
+static void translateCounts(std::vector<uint32_t>& counts, const OptimizedProgram& optimized) {
+    std::vector<uint32_t> translated(optimized.bytecode.size(), 0);
+    for (size_t pc = 0; pc < counts.size(); ++pc) {
+        int entry = optimized.entry_pcs[pc];
+        if (counts[pc] != 0 && entry >= 0 && entry < static_cast<int>(translated.size())) translated[entry] += counts[pc];
+    }
+    counts.swap(translated);
+}
+
+/**
+ * @brief Switches the running program to its optimized version (on-stack replacement).
+ * Called with pc at a loop header or function entry, where the optimized program keeps the
+ * same stack and globals, so only pc, the frames' return addresses and the hotness counters
+ * need translating. The whole program is optimized at once, which is cheap next to the time
+ * it has already run.
+ * @return False if execute() should stop so that run() continues in compiled code (JIT or closures).
+ */
+bool VM::tierUp() {
+    tiering = false;
+    OptimizedProgram result;
+    if (!Optimizer().optimize(original, result)) return true; // Keep interpreting the original
+    pc = result.entry_pcs[pc];
+    for (int i = 0; i < frame_count; ++i) {
+        frames[i].return_pc = result.entry_pcs[frames[i].return_pc];
+    }
+    translateCounts(back_edge_counts, result);
+    translateCounts(call_counts, result);
+    optimized.swap(result.bytecode);
+    optimized_source_pcs.swap(result.source_pcs);
+    program = optimized;
+    source_pcs = &optimized_source_pcs;
+    scheduleLimitCheck(); // Spaced by the new program's length
+    if (!stepping && instruction_budget == 0 && ((jit && JIT::isSupported()) || closures)) {
+        compiled_handover = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Runs the program from pc in the fastest compiled form enabled: machine code if the
+ * JIT is on and supported, else pre-bound handlers if closures are on.
+ * @return False if neither applies or the program could not be compiled (it then has not started).
+ */
+bool VM::runCompiled(double& result) {
+    if (jit) {
+        JIT compiled;
+        if (compiled.compile(program)) {
+            result = compiled.run(*this);
+            return true;
+        }
+    }
+    if (closures) {
+        ClosureCompiler compiled;
+        if (compiled.compile(program)) {
+            result = compiled.run(*this);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Resolves an array handle.
+ * @param handle The value on the stack that should refer to an array.
+ * @param operation The instruction or builtin name, for the error message.
+ * @return The array, or nullptr (after reporting an error) if the value is not a valid handle.
+ */
+Array* VM::getArray(double handle, const char* operation) {
+    if (handle < 0 || handle >= heap->arrays.size() || handle != std::floor(handle)) {
+        *errors << "VM Error: " << operation << " expects an array, got " << handle << "." << std::endl;
+        return nullptr;
+    }
+    return &heap->arrays[static_cast<size_t>(handle)];
+}
+
+/**
+ * @brief Resolves a map handle.
+ * @param handle The value on the stack that should refer to a map.
+ * @param operation The instruction name, for the error message.
+ * @return The map, or nullptr (after reporting an error) if the value is not a valid handle.
+ */
+HashMap* VM::getMap(double handle, const char* operation) {
+    if (handle < 0 || handle >= heap->maps.size() || handle != std::floor(handle)) {
+        *errors << "VM Error: " << operation << " expects a map, got " << handle << "." << std::endl;
+        return nullptr;
+    }
+    return &heap->maps[static_cast<size_t>(handle)];
+}
+
+/**
+ * @brief Resolves a string index: the program's literals come first, then, from string_base, the strings made by this run.
+ * @param index The value on the stack that should refer to a string.
+ * @return The string, or nullptr if the value is not a valid index.
+ */
+const StringObject* VM::getString(double index) const {
+    if (index < 0 || index >= heap->string_base + heap->strings.size() || index != std::floor(index)) return nullptr;
+    size_t position = static_cast<size_t>(index);
+    if (position < heap->literals->size()) return &(*heap->literals)[position];
+    return position >= heap->string_base ? &heap->strings[position - heap->string_base] : nullptr;
+}
+
+/**
+ * @brief Executes MAP_GET, MAP_SET, MAP_HAS or MAP_DELETE.
+ * String keys are string indices whose StringObject supplies a cached hash; other keys must be integers.
+ * @param instruction The map instruction (operand is 1 for a string key).
+ * @return True on success, false (after reporting) on a runtime error.
+ */
+bool VM::executeMapInstruction(const Bytecode& instruction) {
+    std::string name = instruction_to_string(instruction.instruction);
+    bool isSet = instruction.instruction == Instruction::MAP_SET;
+    size_t operands = isSet ? 3 : 2;
+    if (stack.size() < operands) { *errors << "VM Error: Stack underflow for " << name << "." << std::endl; return false; }
+    size_t base = stack.size() - operands;
+    HashMap* map = getMap(stack[base], name.c_str());
+    if (!map) return false;
+    double key = stack[base + 1];
+    double value = isSet ? stack[base + 2] : 0.0;
+    stack.resize(base);
+
+    bool stringKey = instruction.operand != 0;
+    const StringObject* text = nullptr;
+    int64_t integer = 0;
+    if (stringKey) {
+        text = getString(key);
+        if (!text) { *errors << "VM Error: Invalid string literal index for " << name << "." << std::endl; return false; }
+    } else {
+        if (key != std::floor(key) || std::fabs(key) > 9.2e18) { *errors << "VM Error: Map key " << key << " is not an integer." << std::endl; return false; }
+        integer = static_cast<int64_t>(key);
+    }
+
+    switch (instruction.instruction) {
+        case Instruction::MAP_GET: {
+            double* found = text ? map->find(*text) : map->find(integer);
+            if (!found) {
+                *errors << "VM Error: Key ";
+                if (text) *errors << "\"" << text->getValue() << "\""; else *errors << integer;
+                *errors << " not found in map." << std::endl;
+                return false;
+            }
+            stack.push_back(*found);
+            break;
+        }
+        case Instruction::MAP_SET:
+            if (text) map->set(*text, value); else map->set(integer, value);
+            stack.push_back(value); // Like STORE, the stored value stays on the stack
+            break;
+        case Instruction::MAP_HAS:
+            stack.push_back((text ? map->find(*text) : map->find(integer)) ? 1.0 : 0.0);
+            break;
+        default: // MAP_DELETE
+            stack.push_back((text ? map->erase(*text) : map->erase(integer)) ? 1.0 : 0.0);
+            break;
+    }
+    return true;
+}
+
+// array() and range() refuse longer arrays (1 GiB of 64-bit elements), so that a bad length is
+// a runtime error rather than an allocation failure that ends the host process
+static const size_t kMaxArrayLength = size_t(1) << 27;
+
+/**
+ * @brief Executes CALL_BUILTIN: pops the arguments and pushes the builtin's result.
+ * Whole-array work is done by ArrayKernels, so each builtin is one dispatch regardless of length.
+ * @param instruction The CALL_BUILTIN instruction.
+ * @return True on success, false (after reporting) on a runtime error.
+ */
+bool VM::callBuiltin(const Bytecode& instruction) {
+    Builtin builtin = static_cast<Builtin>(static_cast<int>(instruction.operand));
+    int argc = instruction.operand2;
+    if (stack.size() < static_cast<size_t>(argc)) { *errors << "VM Error: Stack underflow for CALL_BUILTIN." << std::endl; return false; }
+    double first = argc > 0 ? stack[stack.size() - argc] : 0.0;
+    double second = argc > 1 ? stack.back() : 0.0;
+    stack.resize(stack.size() - argc);
+
+    if (builtin == Builtin::MAP) {
+        heap->maps.emplace_back();
+        stack.push_back(static_cast<double>(heap->maps.size() - 1));
+        return true;
+    }
+    if (builtin == Builtin::MAP_LEN) {
+        HashMap* map = getMap(first, "len");
+        if (!map) return false;
+        stack.push_back(static_cast<double>(map->size()));
+        return true;
+    }
+
+    if (builtin == Builtin::ARRAY || builtin == Builtin::RANGE) {
+        if (first < 0 || first != std::floor(first)) {
+            *errors << "VM Error: Array length must be a non-negative integer, got " << first << "." << std::endl;
+            return false;
+        }
+        if (first > static_cast<double>(kMaxArrayLength)) {
+            *errors << "VM Error: Array length " << first << " exceeds the maximum of " << kMaxArrayLength << "." << std::endl;
+            return false;
+        }
+        try {
+            Array result(ElementType::INT64, static_cast<size_t>(first));
+            if (builtin == Builtin::RANGE) {
+                int64_t* data = result.int64Data();
+                for (size_t i = 0; i < result.size(); ++i) data[i] = static_cast<int64_t>(i);
+            }
+            heap->arrays.push_back(std::move(result));
+        } catch (const std::bad_alloc&) {
+            *errors << "VM Error: Out of memory allocating an array of length " << first << "." << std::endl;
+            return false;
+        }
+        stack.push_back(static_cast<double>(heap->arrays.size() - 1));
+        return true;
+    }
+
+    Array* left = getArray(first, "Builtin");
+    if (!left) return false;
+    Array* right = nullptr;
+    bool scalarSecond = instruction.operand3 != 0;
+    if (argc > 1 && !scalarSecond) {
+        right = getArray(second, "Builtin");
+        if (!right) return false;
+        if (right->size() != left->size()) {
+            *errors << "VM Error: Array length mismatch (" << left->size() << " vs " << right->size() << ")." << std::endl;
+            return false;
+        }
+    }
+
+    switch (builtin) {
+        case Builtin::LEN: stack.push_back(static_cast<double>(left->size())); return true;
+        case Builtin::SUM: stack.push_back(ArrayKernels::sum(*left)); return true;
+        case Builtin::DOT: stack.push_back(ArrayKernels::dot(*left, *right)); return true;
+        case Builtin::MIN:
+        case Builtin::MAX:
+            if (left->size() == 0) { *errors << "VM Error: min/max of an empty array." << std::endl; return false; }
+            stack.push_back(builtin == Builtin::MIN ? ArrayKernels::min(*left) : ArrayKernels::max(*left));
+            return true;
+        default: break;
+    }
+
+    // Element-wise builtins produce a new array
+    Array result(ElementType::INT64, 0);
+    switch (builtin) {
+        case Builtin::SORT: result = ArrayKernels::sort(*left); break;
+        case Builtin::SCAN: result = ArrayKernels::scan(*left); break;
+        case Builtin::FILTER: result = ArrayKernels::filter(*left, *right); break;
+        case Builtin::ADD: result = right ? ArrayKernels::add(*left, *right) : ArrayKernels::add(*left, second); break;
+        case Builtin::MUL: result = right ? ArrayKernels::mul(*left, *right) : ArrayKernels::mul(*left, second); break;
+        case Builtin::LT:
+        case Builtin::GT:
+        case Builtin::EQ: {
+            CompareOp op = builtin == Builtin::LT ? CompareOp::LESS : (builtin == Builtin::GT ? CompareOp::GREATER : CompareOp::EQUAL);
+            result = right ? ArrayKernels::compare(*left, *right, op) : ArrayKernels::compare(*left, second, op);
+            break;
+        }
+        default:
+            *errors << "VM Error: Unknown builtin: " << static_cast<int>(builtin) << std::endl;
+            return false;
+    }
+    heap->arrays.push_back(std::move(result)); // Invalidates left and right, which are no longer used
+    stack.push_back(static_cast<double>(heap->arrays.size() - 1));
+    return true;
+}
+
+// A parallel for is split into at most this many chunks (one per iteration when there are
+// fewer). The split depends only on the iteration count, so reductions combine in the same
+// order, and give the same result, for any number of threads.
+static const size_t kMaxParallelChunks = 256;
+
+static double reductionIdentity(Reduction op) {
+    switch (op) {
+        case Reduction::PRODUCT: return 1.0;
+        case Reduction::MIN: return std::numeric_limits<double>::infinity();
+        case Reduction::MAX: return -std::numeric_limits<double>::infinity();
+        default: return 0.0;
+    }
+}
+
+static double combineReduction(Reduction op, double accumulated, double value) {
+    switch (op) {
+        case Reduction::PRODUCT: return accumulated * value;
+        case Reduction::MIN: return value < accumulated ? value : accumulated;
+        case Reduction::MAX: return value > accumulated ? value : accumulated;
+        default: return accumulated + value;
+    }
+}
+
+/**
+ * @brief Executes PARALLEL_FOR: pops the limit and start, runs the loop unit over the
+ * iteration space on worker VMs, and pushes each reduction's combined partial result.
+ *
+ * Each participant thread of ThreadPool::shared() gets one worker VM, which shares this
+ * VM's program and heap but has its own stack, frames and back-edge counters. A worker runs
+ * a chunk by setting up the unit's frame (loop variable, chunk limit, reduction identities)
+ * and executing from the unit's entry until its HALT. The compiler has already rejected
+ * bodies that write shared state, so workers only read the heap, apart from array elements
+ * indexed by the loop variable.
+ * @param instruction The PARALLEL_FOR instruction; the PARALLEL_REDUCEs that follow it name the reductions.
+ * @return True on success, false (after reporting) on a runtime error in any iteration.
+ */
+bool VM::executeParallelFor(const Bytecode& instruction) {
+    if (stack.size() < 2) { *errors << "VM Error: Stack underflow for PARALLEL_FOR." << std::endl; return false; }
+    double limit = stack.back(); stack.pop_back();
+    double start = stack.back(); stack.pop_back();
+    int step = instruction.operand4;
+    if (start != std::floor(start) || std::fabs(start) > 9.0e15) {
+        *errors << "VM Error: parallel for start must be an integer, got " << start << "." << std::endl;
+        return false;
+    }
+
+    // Iterations run while start + k * step still compares true against the limit
+    Instruction comparison = static_cast<Instruction>(instruction.operand3);
+    bool inclusive = comparison == Instruction::LESS_EQUAL || comparison == Instruction::GREATER_EQUAL;
+    double distance = (limit - start) / step; // In steps; positive when the first test passes
+    if (distance > 9.0e15) {
+        *errors << "VM Error: parallel for has too many iterations (limit " << limit << ")." << std::endl;
+        return false;
+    }
+    size_t count = 0;
+    if (distance > 0 || (inclusive && distance == 0)) {
+        count = static_cast<size_t>(inclusive ? std::floor(distance) + 1 : std::ceil(distance));
+    }
+
+    std::vector<std::pair<Reduction, int>> reductions; // Operator and unit frame slot
+    for (size_t next = pc; next < program.size() && program[next].instruction == Instruction::PARALLEL_REDUCE; ++next) {
+        reductions.push_back({static_cast<Reduction>(static_cast<int>(program[next].operand)), program[next].operand3});
+    }
+    size_t chunks = std::min(count, kMaxParallelChunks);
+    std::vector<double> partials(chunks * reductions.size());
+
+    // Workers look strings up concurrently, so every cached hash is filled in first
+    for (const StringObject& string : *heap->literals) {
+        string.getHash();
+    }
+    for (size_t i = 0; i < heap->strings.size(); ++i) {
+        heap->strings[i].getHash();
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    std::vector<std::unique_ptr<VM>> workers(pool.getThreadCount());
+    std::vector<std::ostringstream> workerErrors(pool.getThreadCount());
+    // The lowest failing chunk is reported, so the error does not depend on the thread count
+    std::atomic<size_t> firstFailed(chunks);
+    std::vector<std::string> failures(chunks);
+    std::vector<RunError> failureCodes(chunks, RunError::NONE);
+    int entry = static_cast<int>(instruction.operand);
+    int frameSize = instruction.operand2;
+    pool.parallelForEach(chunks, [&](size_t chunk, size_t participant) {
+        if (chunk > firstFailed.load()) return; // An earlier chunk already failed
+        std::unique_ptr<VM>& worker = workers[participant];
+        if (!worker) {
+            worker.reset(new VM());
+            worker->program = program;
+            worker->source_pcs = source_pcs;
+            worker->heap = heap;
+            worker->parallel_worker = true;
+            worker->trace = false; // Interleaved per-thread traces would be unreadable
+            worker->errors = &workerErrors[participant];
+            worker->output = output;
+            worker->natives = natives;
+            worker->max_frames = max_frames;
+            worker->frames.resize(max_frames);
+            worker->back_edge_counts.assign(program.size(), 0);
+            worker->back_edge_budget = back_edge_budget == 0 ? 0 : back_edge_budget - back_edges_taken;
+            worker->instruction_budget = instruction_budget == 0 ? 0 : std::max<uint64_t>(instruction_budget - instructionsUsed(), 1);
+            worker->deadline_ms = deadline_ms;
+            worker->deadline = deadline;
+            worker->scheduleLimitCheck();
+        }
+        size_t first = count * chunk / chunks;
+        size_t last = count * (chunk + 1) / chunks;
+        VM& vm = *worker;
+        vm.stack.assign(frameSize, 0.0);
+        vm.stack[0] = start + static_cast<double>(first) * step;
+        vm.stack[1] = start + static_cast<double>(last) * step;
+        for (const auto& reduction : reductions) {
+            vm.stack[reduction.second] = reductionIdentity(reduction.first);
+        }
+        vm.frame_count = 0;
+        vm.fp = 0;
+        vm.pc = entry;
+        workerErrors[participant].str("");
+        vm.execute();
+        if (!vm.halted) {
+            failures[chunk] = workerErrors[participant].str();
+            failureCodes[chunk] = vm.run_error;
+            size_t lowest = firstFailed.load();
+            while (chunk < lowest && !firstFailed.compare_exchange_weak(lowest, chunk)) {}
+            return;
+        }
+        for (size_t r = 0; r < reductions.size(); ++r) {
+            partials[chunk * reductions.size() + r] = vm.stack[reductions[r].second];
+        }
+    });
+
+    for (const std::unique_ptr<VM>& worker : workers) {
+        if (!worker) continue;
+        back_edges_taken += worker->back_edges_taken;
+        calls_taken += worker->calls_taken;
+        instructions_counted += worker->instructions_counted;
+        for (size_t i = 0; i < back_edge_counts.size(); ++i) {
+            back_edge_counts[i] += worker->back_edge_counts[i];
+        }
+    }
+    if (firstFailed.load() < chunks) {
+        *errors << failures[firstFailed.load()];
+        run_error = failureCodes[firstFailed.load()];
+        return false;
+    }
+
+    // Combine per-chunk results in chunk order; the first reduction ends up on top
+    for (size_t r = reductions.size(); r-- > 0;) {
+        double combined = reductionIdentity(reductions[r].first);
+        for (size_t chunk = 0; chunk < chunks; ++chunk) {
+            combined = combineReduction(reductions[r].first, combined, partials[chunk * reductions.size() + r]);
+        }
+        stack.push_back(combined);
+    }
+    return true;
+}
 
 /**
  * @brief Runs the provided bytecode instructions.
@@ -14,29 +579,253 @@ VM::VM() : pc(0) {}
  * @return The final value on the stack if the program halts, or -1 in case of an error.
  */
 double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals) {
-    this->bytecode = bytecode;
-    this->string_literals = string_literals; // Store the string literals
+    return run(bytecode.data(), bytecode.size(), string_literals);
+}
+
+/**
+ * @brief Runs instructions held elsewhere, such as in a mapped bytecode image (see BytecodeImage.h).
+ * @param code The first instruction; the instructions are copied in one block, without decoding.
+ * @param count The number of instructions.
+ * @param string_literals A vector of string literals from the compiler.
+ * @param global_count The number of global variable slots the program uses, reserved up front (0 if unknown).
+ * @return The final value on the stack if the program halts, or -1 in case of an error.
+ */
+double VM::run(const Bytecode* code, size_t count, const std::vector<std::string>& string_literals, size_t global_count) {
+    // A program that got hot in an earlier run starts out optimized
+    bool optimizedBefore = !optimized.empty() && optimized_for == 0 && count == bytecode.size() &&
+                           std::equal(code, code + count, bytecode.begin());
+    if (!optimizedBefore) {
+        bytecode.assign(code, code + count);
+        optimized.clear();
+        optimized_source_pcs.clear();
+        optimized_for = 0;
+    }
+    own_literals.assign(string_literals.begin(), string_literals.end());
+    return start(bytecode, &own_literals, global_count, optimizedBefore);
+}
+
+/**
+ * @brief Runs a program shared with other VMs, in place: neither its instructions nor its
+ * string literals are copied, and it is only read.
+ * @param executable The program; it must stay alive until the run returns.
+ * @return The final value on the stack if the program halts, or -1 in case of an error.
+ */
+double VM::run(const Executable& executable) {
+    bool optimizedBefore = !optimized.empty() && optimized_for == executable.getId();
+    if (!optimizedBefore) {
+        optimized.clear();
+        optimized_source_pcs.clear();
+        optimized_for = executable.getId();
+    }
+    return start(executable.getCode(), &executable.getStrings(), executable.getGlobalCount(), optimizedBefore);
+}
+
+/**
+ * @brief Resets the run-time state and runs a program from its first instruction.
+ * @param code The program as compiled.
+ * @param literals Its string literals.
+ * @param global_count The number of global variable slots it uses (0 if unknown).
+ * @param optimizedBefore True if optimized holds the program's optimized version from an earlier run.
+ * @return The final value on the stack if the program halts, or -1 in case of an error.
+ */
+double VM::start(BytecodeView code, const std::vector<StringObject>* literals, size_t global_count, bool optimizedBefore) {
+    stepping = false;
+    prepare(code, literals, global_count, optimizedBefore);
+    double result;
+    // Compiled code cannot print a trace line per instruction, nor count instructions for a budget
+    if (!trace && !tiering && instruction_budget == 0 && runCompiled(result)) return result;
+    result = execute();
+    if (!compiled_handover) return result;
+    // The program got hot: continue its optimized version as compiled code from where it stopped
+    compiled_handover = false;
+    if (runCompiled(result)) return result;
+    return execute();
+}
+
+/**
+ * @brief Resets the run-time state for a run of a program from its first instruction (see start()).
+ */
+void VM::prepare(BytecodeView code, const std::vector<StringObject>* literals, size_t global_count, bool optimizedBefore) {
+    original = code;
+    program = optimizedBefore ? BytecodeView(optimized) : code;
+    source_pcs = optimizedBefore ? &optimized_source_pcs : nullptr;
+    tiering = !optimizedBefore && !trace && tier_up_threshold != 0; // Trace lines refer to the instructions as compiled
+    compiled_handover = false;
+    heap = &own_heap;
+    parallel_worker = false;
+    heap->literals = literals;
+    heap->strings.reset();
+    heap->string_base = literals->size();
     stack.clear();
-    memory.clear(); // Clear memory for a new run
+    heap->memory.clear(); // Clear memory for a new run
+    heap->memory.reserve(global_count);
+    heap->arrays.clear();
+    heap->maps.clear();
+    bindInputs();
+    back_edge_counts.assign(program.size(), 0);
+    call_counts.assign(program.size(), 0);
+    startLimits();
+    frames.resize(max_frames);
+    frame_count = 0;
+    fp = 0;
     pc = 0;
+}
 
-    while (pc < this->bytecode.size()) {
-        Bytecode instruction = this->bytecode[pc]; // Peek at instruction
-        std::cout << "DEBUG: PC: " << pc << ", Instruction: " << static_cast<int>(instruction.instruction)
-                  << " (" << instruction_to_string(instruction.instruction) << ")";
-        if (instruction.instruction == Instruction::PUSH_INT ||
-            instruction.instruction == Instruction::PUSH_FLOAT ||
-            instruction.instruction == Instruction::PUSH_STRING ||
-            instruction.instruction == Instruction::JUMP ||
-            instruction.instruction == Instruction::JUMP_IF_FALSE ||
-            instruction.instruction == Instruction::JUMP_IF_TRUE) {
-            std::cout << " Operand: " << instruction.operand;
+/**
+ * @brief Starts a run of a shared program, to be executed in slices by step().
+ * @param executable The program; it must stay alive until the run is over.
+ */
+void VM::begin(const Executable& executable) {
+    bool optimizedBefore = !optimized.empty() && optimized_for == executable.getId();
+    if (!optimizedBefore) {
+        optimized.clear();
+        optimized_source_pcs.clear();
+        optimized_for = executable.getId();
+    }
+    stepping = true;
+    prepare(executable.getCode(), &executable.getStrings(), executable.getGlobalCount(), optimizedBefore);
+}
+
+/**
+ * @brief Runs the next slice of the run started by begin().
+ * The fuel is counted by the same per-instruction check that single-steps the compiled
+ * tiers, so a paused run resumes exactly where it stopped, mid-loop or mid-call.
+ * @param fuel Instructions to run before pausing (0 = until the run is over).
+ * @param value Set to the final value on the stack if the run halts, or -1 if it fails.
+ * @return Whether the run paused, halted or failed.
+ */
+StepStatus VM::step(uint64_t fuel, double& value) {
+    double result = execute(fuel);
+    if (halted) {
+        value = result;
+        return StepStatus::HALTED;
+    }
+    if (result == -1) { // execute() returns -1 after an error and 0 when the fuel runs out
+        value = -1;
+        return StepStatus::FAILED;
+    }
+    return StepStatus::PAUSED;
+}
+
+/**
+ * @brief Runs the newest piece of a program that grows by appending, such as a REPL session.
+ * Only the stack and call frames are reset, so globals and everything they refer to carry
+ * over from the pieces before; the hotness counters just grow to cover the new instructions.
+ * @param code The whole program so far.
+ * @param literals Its string literals.
+ * @param global_count The number of global variable slots it uses.
+ * @param entry The first instruction of the piece to run.
+ * @param fresh Start from an empty heap.
+ * @return The final value on the stack if the piece halts, or -1 in case of an error.
+ */
+double VM::runAppended(const std::vector<Bytecode>& code, const std::vector<StringObject>& literals, size_t global_count,
+                       int entry, bool fresh) {
+    original = code;
+    program = code;
+    source_pcs = nullptr;
+    tiering = false;
+    compiled_handover = false;
+    optimized.clear();
+    optimized_source_pcs.clear();
+    optimized_for = 0;
+    heap = &own_heap;
+    parallel_worker = false;
+    heap->literals = &literals;
+    heap->string_base = kSessionStringBase;
+    if (fresh) {
+        heap->strings.reset();
+        heap->memory.clear();
+        heap->arrays.clear();
+        heap->maps.clear();
+        bindInputs();
+    }
+    heap->memory.reserve(global_count);
+    stack.clear();
+    back_edge_counts.resize(code.size(), 0);
+    call_counts.resize(code.size(), 0);
+    startLimits();
+    frames.resize(max_frames);
+    frame_count = 0;
+    fp = 0;
+    pc = entry;
+    return execute();
+}
+
+/**
+ * @brief Fills the globals of the host inputs (see HostBindings.h) for a new run.
+ * Arrays wrap the host's elements in place; a number is read through its pointer, and a
+ * string is added to the run's string table.
+ */
+void VM::bindInputs() {
+    if (!inputs || inputs->size() == 0) return;
+    heap->memory.resize(inputs->size());
+    for (size_t i = 0; i < inputs->size(); ++i) {
+        const HostValue& input = (*inputs)[i];
+        switch (input.kind) {
+            case HostValue::Kind::NUMBER:
+                heap->memory[i] = *static_cast<const double*>(input.data);
+                break;
+            case HostValue::Kind::FLOAT64_ARRAY:
+            case HostValue::Kind::INT64_ARRAY: {
+                ElementType type = input.kind == HostValue::Kind::INT64_ARRAY ? ElementType::INT64 : ElementType::FLOAT64;
+                heap->arrays.push_back(Array::borrow(type, input.data, input.length));
+                heap->memory[i] = static_cast<double>(heap->arrays.size() - 1);
+                break;
+            }
+            case HostValue::Kind::STRING:
+                size_t position = heap->strings.add(std::string_view(static_cast<const char*>(input.data), input.length));
+                heap->memory[i] = static_cast<double>(heap->string_base + position);
+                break;
         }
-        std::cout << " Stack: [";
-        for (size_t i = 0; i < stack.size(); ++i) {
-            std::cout << stack[i] << (i == stack.size() - 1 ? "" : ", ");
+    }
+}
+
+/**
+ * @brief Executes instructions from the current pc.
+ * @param fuel Stop after this many instructions (0 = no limit). The JIT and closures run the
+ * instructions they do not handle one at a time this way, and step() runs slices.
+ * @return The final value on the stack if the program halts (halted is then set), -1 in case of an error,
+ * or 0 once the fuel has run out without halting or failing.
+ */
+double VM::execute(uint64_t fuel) {
+    halted = false;
+    uint64_t remaining = fuel != 0 ? fuel : UINT64_MAX; // One decrement per instruction, whether or not fuel is set
+    while (static_cast<size_t>(pc) < program.size()) {
+        Bytecode instruction = program[pc]; // Peek at instruction
+        if (trace) {
+            *output << "DEBUG: PC: " << pc << ", Instruction: " << static_cast<int>(instruction.instruction)
+                    << " (" << instruction_to_string(instruction.instruction) << ")";
+            if (instruction.instruction == Instruction::PUSH_INT ||
+                instruction.instruction == Instruction::PUSH_FLOAT ||
+                instruction.instruction == Instruction::PUSH_STRING ||
+                instruction.instruction == Instruction::JUMP ||
+                instruction.instruction == Instruction::JUMP_IF_FALSE ||
+                instruction.instruction == Instruction::JUMP_IF_TRUE ||
+                instruction.instruction == Instruction::LOOP_INC_CMP_JUMP ||
+                instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL ||
+                instruction.instruction == Instruction::LOAD_LOCAL ||
+                instruction.instruction == Instruction::STORE_LOCAL ||
+                instruction.instruction == Instruction::CALL ||
+                instruction.instruction == Instruction::TAIL_CALL ||
+                instruction.instruction == Instruction::NEW_ARRAY ||
+                instruction.instruction == Instruction::CALL_BUILTIN ||
+                instruction.instruction == Instruction::CALL_NATIVE ||
+                instruction.instruction == Instruction::MAP_GET ||
+                instruction.instruction == Instruction::MAP_SET ||
+                instruction.instruction == Instruction::MAP_HAS ||
+                instruction.instruction == Instruction::MAP_DELETE ||
+                instruction.instruction == Instruction::PARALLEL_FOR ||
+                instruction.instruction == Instruction::PARALLEL_REDUCE ||
+                instruction.instruction == Instruction::LOAD_GLOBAL ||
+                instruction.instruction == Instruction::STORE_GLOBAL) {
+                *output << " Operand: " << instruction.operand;
+            }
+            *output << " Stack: [";
+            for (size_t i = 0; i < stack.size(); ++i) {
+                *output << stack[i] << (i == stack.size() - 1 ? "" : ", ");
+            }
+            *output << "]" << std::endl;
         }
-        std::cout << "]" << std::endl;
 
         pc++; // Then increment pc
 
@@ -48,100 +837,107 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 stack.push_back(static_cast<double>(instruction.operand));
                 break;
             case Instruction::ADD: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for ADD." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for ADD." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 stack.push_back(val1 + val2);
                 break;
             }
             case Instruction::SUB: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for SUB." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for SUB." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 stack.push_back(val1 - val2);
                 break;
             }
             case Instruction::MUL: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for MUL." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for MUL." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 stack.push_back(val1 * val2);
                 break;
             }
             case Instruction::DIV: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for DIV." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for DIV." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
-                if (val2 == 0.0) { std::cerr << "VM Error: Division by zero." << std::endl; return -1; }
+                if (val2 == 0.0) { *errors << "VM Error: Division by zero." << std::endl; return -1; }
                 double val1 = stack.back(); stack.pop_back();
                 stack.push_back(val1 / val2);
                 break;
             }
             case Instruction::NEGATE: {
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for NEGATE." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for NEGATE." << std::endl; return -1; }
                 double val = stack.back(); stack.pop_back();
                 stack.push_back(-val);
                 break;
             }
             case Instruction::POP: {
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for POP." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for POP." << std::endl; return -1; }
                 stack.pop_back();
                 break;
             }
             case Instruction::STORE: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for STORE." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for STORE." << std::endl; return -1; }
                 int address = static_cast<int>(stack.back()); stack.pop_back();
                 double value = stack.back(); stack.pop_back();
 
                 if (address < 0) {
-                    std::cerr << "VM Error: Invalid memory address for STORE: " << address << std::endl;
+                    *errors << "VM Error: Invalid memory address for STORE: " << address << std::endl;
                     return -1;
                 }
-                if (address >= memory.size()) {
-                    memory.resize(address + 1);
+                if (static_cast<size_t>(address) >= heap->memory.size()) {
+                    heap->memory.resize(address + 1);
                 }
-                memory[address] = value;
+                heap->memory[address] = value;
                 // Push the stored value back onto the stack for assignment expressions
                 stack.push_back(value);
                 break;
             }
             case Instruction::LOAD: {
-                if (stack.size() < 1) { std::cerr << "VM Error: Stack underflow for LOAD." << std::endl; return -1; }
+                if (stack.size() < 1) { *errors << "VM Error: Stack underflow for LOAD." << std::endl; return -1; }
                 int address = static_cast<int>(stack.back()); stack.pop_back();
 
-                if (address < 0 || address >= memory.size()) {
-                    std::cerr << "VM Error: Invalid memory address for LOAD: " << address << std::endl;
+                if (address < 0 || static_cast<size_t>(address) >= heap->memory.size()) {
+                    *errors << "VM Error: Invalid memory address for LOAD: " << address << std::endl;
                     return -1;
                 }
-                stack.push_back(memory[address]);
+                stack.push_back(heap->memory[address]);
                 break;
             }
             case Instruction::HALT:
+                halted = true;
                 if (stack.empty()) {
                     return 0;
                 }
                 return stack.back();
             case Instruction::JUMP_IF_FALSE: {
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for JUMP_IF_FALSE." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for JUMP_IF_FALSE." << std::endl; return -1; }
                 double condition = stack.back(); stack.pop_back();
                 if (condition == 0.0) {
-                    pc = static_cast<int>(instruction.operand);
+                    int target = static_cast<int>(instruction.operand);
+                    if (target < pc && !onBackEdge(target)) return -1;
+                    pc = target;
                 }
                 break;
             }
             case Instruction::JUMP: {
-                pc = static_cast<int>(instruction.operand);
+                int target = static_cast<int>(instruction.operand);
+                if (target < pc && !onBackEdge(target)) return -1;
+                pc = target;
                 break;
             }
             case Instruction::JUMP_IF_TRUE: {
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for JUMP_IF_TRUE." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for JUMP_IF_TRUE." << std::endl; return -1; }
                 double condition = stack.back(); stack.pop_back();
                 if (condition != 0.0) {
-                    pc = static_cast<int>(instruction.operand);
+                    int target = static_cast<int>(instruction.operand);
+                    if (target < pc && !onBackEdge(target)) return -1;
+                    pc = target;
                 }
                 break;
             }
             case Instruction::GREATER: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for GREATER." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for GREATER." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 > val2);
@@ -149,7 +945,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::LESS: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for LESS." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for LESS." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 < val2);
@@ -157,7 +953,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::GREATER_EQUAL: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for GREATER_EQUAL." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for GREATER_EQUAL." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 >= val2);
@@ -165,7 +961,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::LESS_EQUAL: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for LESS_EQUAL." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for LESS_EQUAL." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 <= val2);
@@ -173,7 +969,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::EQUAL_EQUAL: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for EQUAL_EQUAL." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for EQUAL_EQUAL." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 == val2);
@@ -181,7 +977,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::BANG_EQUAL: {
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for BANG_EQUAL." << std::endl; return -1; }
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for BANG_EQUAL." << std::endl; return -1; }
                 double val2 = stack.back(); stack.pop_back();
                 double val1 = stack.back(); stack.pop_back();
                 bool result = (val1 != val2);
@@ -189,7 +985,7 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
                 break;
             }
             case Instruction::NOT: {
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for NOT." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for NOT." << std::endl; return -1; }
                 double val = stack.back(); stack.pop_back();
                 bool result = (val == 0.0);
                 stack.push_back(result ? 1.0 : 0.0);
@@ -197,58 +993,279 @@ double VM::run(const std::vector<Bytecode>& bytecode, const std::vector<std::str
             }
             case Instruction::AND:
             case Instruction::OR:
-                std::cerr << "VM Error: Encountered logical operator instruction (AND/OR) directly. This should be handled by jumps." << std::endl;
+                *errors << "VM Error: Encountered logical operator instruction (AND/OR) directly. This should be handled by jumps." << std::endl;
                 return -1;
             case Instruction::PUSH_STRING: { // PUSH_STRING is now 23
                 stack.push_back(static_cast<double>(instruction.operand));
                 break;
             }
             case Instruction::CONCAT_STRING: { // CONCAT_STRING is now 24
-                if (stack.size() < 2) { std::cerr << "VM Error: Stack underflow for CONCAT_STRING." << std::endl; return -1; }
-                int string_idx2 = static_cast<int>(stack.back()); stack.pop_back();
-                int string_idx1 = static_cast<int>(stack.back()); stack.pop_back();
+                if (stack.size() < 2) { *errors << "VM Error: Stack underflow for CONCAT_STRING." << std::endl; return -1; }
+                const StringObject* string2 = getString(stack.back()); stack.pop_back();
+                const StringObject* string1 = getString(stack.back()); stack.pop_back();
 
-                if (string_idx1 < 0 || string_idx1 >= this->string_literals.size() ||
-                    string_idx2 < 0 || string_idx2 >= this->string_literals.size()) {
-                    std::cerr << "VM Error: Invalid string literal index for CONCAT_STRING." << std::endl;
+                if (!string1 || !string2) {
+                    *errors << "VM Error: Invalid string literal index for CONCAT_STRING." << std::endl;
                     return -1;
                 }
 
-                std::string concatenated_string = this->string_literals[string_idx1] + this->string_literals[string_idx2];
+                string_bytes += string1->getValue().size() + string2->getValue().size();
+                if (string_bytes > max_string_bytes && max_string_bytes != 0) {
+                    run_error = RunError::STRING_BYTES;
+                    *errors << "VM Error: Strings made by the run exceed the cap of " << max_string_bytes << " bytes." << std::endl;
+                    return -1;
+                }
 
-                int new_string_index = static_cast<int>(this->string_literals.size());
-                this->string_literals.push_back(concatenated_string);
+                // New strings are numbered after the program's literals
+                size_t new_string_index = heap->string_base + heap->strings.add(string1->getValue(), string2->getValue());
                 stack.push_back(static_cast<double>(new_string_index));
                 break;
             }
             case Instruction::PRINT_VALUE: { // New PRINT_VALUE instruction (25)
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for PRINT_VALUE." << std::endl; return -1; }
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for PRINT_VALUE." << std::endl; return -1; }
                 double val = stack.back(); stack.pop_back();
                 if (val == 0.0) {
-                    std::cout << "false" << std::endl;
+                    *output << "false" << std::endl;
                 } else if (val == 1.0) {
-                    std::cout << "true" << std::endl;
+                    *output << "true" << std::endl;
                 } else {
-                    std::cout << val << std::endl;
+                    *output << val << std::endl;
                 }
                 break;
             }
             case Instruction::PRINT_STRING: { // New PRINT_STRING instruction (26)
-                if (stack.empty()) { std::cerr << "VM Error: Stack underflow for PRINT_STRING." << std::endl; return -1; }
-                int string_idx = static_cast<int>(stack.back()); stack.pop_back();
-                if (string_idx < 0 || string_idx >= this->string_literals.size()) {
-                    std::cerr << "VM Error: Invalid string literal index for PRINT_STRING." << std::endl;
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for PRINT_STRING." << std::endl; return -1; }
+                const StringObject* string = getString(stack.back()); stack.pop_back();
+                if (!string) {
+                    *errors << "VM Error: Invalid string literal index for PRINT_STRING." << std::endl;
                     return -1;
                 }
-                std::cout << this->string_literals[string_idx] << std::endl;
+                *output << string->getValue() << std::endl;
+                break;
+            }
+            case Instruction::LOOP_INC_CMP_JUMP:
+            case Instruction::LOOP_INC_CMP_JUMP_LOCAL: {
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for " << instruction_to_string(instruction.instruction) << "." << std::endl; return -1; }
+                double limit = stack.back(); stack.pop_back();
+                double* slot;
+                if (instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL) {
+                    slot = &stack[fp + instruction.operand2];
+                } else {
+                    int address = instruction.operand2;
+                    if (address < 0 || static_cast<size_t>(address) >= heap->memory.size()) {
+                        *errors << "VM Error: Invalid memory address for LOOP_INC_CMP_JUMP: " << address << std::endl;
+                        return -1;
+                    }
+                    slot = &heap->memory[address];
+                }
+                double counter = *slot + instruction.operand4;
+                *slot = counter;
+
+                bool keepLooping;
+                switch (static_cast<Instruction>(instruction.operand3)) {
+                    case Instruction::LESS: keepLooping = counter < limit; break;
+                    case Instruction::LESS_EQUAL: keepLooping = counter <= limit; break;
+                    case Instruction::GREATER: keepLooping = counter > limit; break;
+                    case Instruction::GREATER_EQUAL: keepLooping = counter >= limit; break;
+                    default:
+                        *errors << "VM Error: Invalid comparison for " << instruction_to_string(instruction.instruction) << "." << std::endl;
+                        return -1;
+                }
+                if (keepLooping) {
+                    int target = static_cast<int>(instruction.operand);
+                    if (!onBackEdge(target)) return -1;
+                    pc = target;
+                }
+                break;
+            }
+            case Instruction::LOAD_LOCAL: {
+                stack.push_back(stack[fp + static_cast<int>(instruction.operand)]);
+                break;
+            }
+            case Instruction::STORE_LOCAL: {
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for STORE_LOCAL." << std::endl; return -1; }
+                // The stored value stays on the stack, matching STORE, unless the optimizer folded a POP in
+                stack[fp + static_cast<int>(instruction.operand)] = stack.back();
+                if (instruction.operand2) stack.pop_back();
+                break;
+            }
+            case Instruction::CALL: {
+                int argc = instruction.operand2;
+                if (stack.size() < static_cast<size_t>(argc)) { *errors << "VM Error: Stack underflow for CALL." << std::endl; return -1; }
+                if (frame_count == static_cast<int>(max_frames)) {
+                    *errors << "VM Error: Call stack overflow (maximum depth " << max_frames << ")." << std::endl;
+                    return -1;
+                }
+                // The arguments already on the stack become slots 0..argc-1 of the new frame
+                Frame& frame = frames[frame_count++];
+                frame.return_pc = pc;
+                frame.base = static_cast<int>(stack.size()) - argc;
+                fp = frame.base;
+                stack.resize(fp + instruction.operand3); // Reserve (zeroed) slots for the callee's locals
+                pc = static_cast<int>(instruction.operand);
+                if (++calls_taken >= call_check_at && !checkLimits(pc)) return -1; // Recursion needs no loop to run away
+                if (tiering && pc >= 0 && pc < static_cast<int>(call_counts.size()) &&
+                    ++call_counts[pc] >= tier_up_threshold && !tierUp()) {
+                    return -1; // Continues in compiled code
+                }
+                break;
+            }
+            case Instruction::TAIL_CALL: {
+                int argc = instruction.operand2;
+                if (frame_count == 0) { *errors << "VM Error: TAIL_CALL outside of a function." << std::endl; return -1; }
+                if (stack.size() < static_cast<size_t>(fp + argc)) { *errors << "VM Error: Stack underflow for TAIL_CALL." << std::endl; return -1; }
+                // Slide the arguments down over the current frame's slots; the frame (and its return address) is reused
+                std::copy(stack.end() - argc, stack.end(), stack.begin() + fp);
+                stack.resize(fp + argc);
+                stack.resize(fp + instruction.operand3); // Fresh (zeroed) slots for the callee's locals
+                int target = static_cast<int>(instruction.operand);
+                if (target < pc && !onBackEdge(target)) return -1; // Self tail recursion is a loop
+                pc = target;
+                break;
+            }
+            case Instruction::RET: {
+                if (frame_count == 0) { *errors << "VM Error: RET outside of a function." << std::endl; return -1; }
+                if (stack.size() <= static_cast<size_t>(fp)) { *errors << "VM Error: Stack underflow for RET." << std::endl; return -1; }
+                double value = stack.back();
+                const Frame& frame = frames[--frame_count];
+                stack.resize(frame.base); // Drop the callee's slots and temporaries
+                stack.push_back(value);
+                pc = frame.return_pc;
+                fp = frame_count > 0 ? frames[frame_count - 1].base : 0;
+                break;
+            }
+            case Instruction::NEW_ARRAY: {
+                size_t count = static_cast<size_t>(instruction.operand);
+                if (stack.size() < count) { *errors << "VM Error: Stack underflow for NEW_ARRAY." << std::endl; return -1; }
+                Array array(ElementType::INT64, count);
+                size_t first = stack.size() - count;
+                for (size_t i = 0; i < count; ++i) {
+                    array.set(i, stack[first + i]); // Promotes to FLOAT64 at the first non-integral element
+                }
+                stack.resize(first);
+                heap->arrays.push_back(std::move(array));
+                stack.push_back(static_cast<double>(heap->arrays.size() - 1));
+                break;
+            }
+            case Instruction::ARRAY_GET:
+            case Instruction::ARRAY_SET: {
+                bool isSet = instruction.instruction == Instruction::ARRAY_SET;
+                size_t operands = isSet ? 3 : 2;
+                if (stack.size() < operands) {
+                    *errors << "VM Error: Stack underflow for " << instruction_to_string(instruction.instruction) << "." << std::endl;
+                    return -1;
+                }
+                size_t base = stack.size() - operands;
+                Array* array = getArray(stack[base], instruction_to_string(instruction.instruction).c_str());
+                if (!array) return -1;
+                double index = stack[base + 1];
+                if (index < 0 || index >= array->size() || index != std::floor(index)) {
+                    *errors << "VM Error: Array index " << index << " out of bounds (length " << array->size() << ")." << std::endl;
+                    return -1;
+                }
+                double value = isSet ? stack[base + 2] : array->get(static_cast<size_t>(index));
+                if (isSet && array->isBorrowed()) {
+                    *errors << "VM Error: Cannot store into an array bound to host memory." << std::endl;
+                    return -1;
+                }
+                if (isSet && parallel_worker && !array->fits(value)) {
+                    // Promotion rewrites the whole array, which other iterations are using
+                    *errors << "VM Error: parallel for cannot store " << value << " into an integer array;"
+                              << " store a non-integer into it before the loop." << std::endl;
+                    return -1;
+                }
+                if (isSet) {
+                    array->set(static_cast<size_t>(index), value);
+                }
+                stack.resize(base);
+                stack.push_back(value); // Like STORE, a set leaves the stored value on the stack
+                break;
+            }
+            case Instruction::CALL_BUILTIN: {
+                if (!callBuiltin(instruction)) return -1;
+                break;
+            }
+            case Instruction::CALL_NATIVE: {
+                size_t index = static_cast<size_t>(instruction.operand);
+                size_t argc = static_cast<size_t>(instruction.operand2);
+                if (index >= natives->size()) {
+                    *errors << "VM Error: No host function is bound at index " << index << "." << std::endl;
+                    return -1;
+                }
+                const NativeFunction& native = (*natives)[index];
+                if (static_cast<int>(argc) != native.arity) {
+                    *errors << "VM Error: Host function '" << native.name << "' takes " << native.arity
+                            << " argument(s) but was called with " << argc << "." << std::endl;
+                    return -1;
+                }
+                if (stack.size() < argc) {
+                    *errors << "VM Error: Stack underflow for CALL_NATIVE." << std::endl;
+                    return -1;
+                }
+                // The arguments are passed where they lie on the stack, and the result replaces them
+                double* args = &stack[stack.size() - argc];
+                double result = native.thunk(native.function, args);
+                stack.resize(stack.size() - argc);
+                stack.push_back(result);
+                break;
+            }
+            case Instruction::MAP_GET:
+            case Instruction::MAP_SET:
+            case Instruction::MAP_HAS:
+            case Instruction::MAP_DELETE: {
+                if (!executeMapInstruction(instruction)) return -1;
+                break;
+            }
+            case Instruction::PARALLEL_FOR: {
+                if (!executeParallelFor(instruction)) return -1;
+                break;
+            }
+            case Instruction::PARALLEL_REDUCE: {
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for PARALLEL_REDUCE." << std::endl; return -1; }
+                double partial = stack.back(); stack.pop_back();
+                int address = instruction.operand2;
+                if (address < 0 || static_cast<size_t>(address) >= heap->memory.size()) {
+                    *errors << "VM Error: Invalid memory address for PARALLEL_REDUCE: " << address << std::endl;
+                    return -1;
+                }
+                Reduction op = static_cast<Reduction>(static_cast<int>(instruction.operand));
+                heap->memory[address] = combineReduction(op, heap->memory[address], partial);
+                break;
+            }
+            case Instruction::LOAD_GLOBAL: {
+                size_t address = static_cast<size_t>(instruction.operand);
+                if (address >= heap->memory.size()) {
+                    *errors << "VM Error: Invalid memory address for LOAD: " << address << std::endl;
+                    return -1;
+                }
+                stack.push_back(heap->memory[address]);
+                break;
+            }
+            case Instruction::STORE_GLOBAL: {
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for STORE_GLOBAL." << std::endl; return -1; }
+                size_t address = static_cast<size_t>(instruction.operand);
+                if (address >= heap->memory.size()) {
+                    heap->memory.resize(address + 1);
+                }
+                heap->memory[address] = stack.back();
+                if (instruction.operand2) stack.pop_back();
+                break;
+            }
+            case Instruction::PRINT_ARRAY: {
+                if (stack.empty()) { *errors << "VM Error: Stack underflow for PRINT_ARRAY." << std::endl; return -1; }
+                Array* array = getArray(stack.back(), "PRINT_ARRAY");
+                if (!array) return -1;
+                stack.pop_back();
+                *output << array->toString() << std::endl;
                 break;
             }
             default:
-                std::cerr << "VM Error: Unknown instruction: " << static_cast<int>(instruction.instruction) << std::endl;
+                *errors << "VM Error: Unknown instruction: " << static_cast<int>(instruction.instruction) << std::endl;
                 return -1;
         }
+        if (--remaining == 0) return 0;
     }
 
-    std::cerr << "VM Error: Program did not halt. Missing HALT instruction or infinite loop." << std::endl;
+    *errors << "VM Error: Program did not halt. Missing HALT instruction or infinite loop." << std::endl;
     return -1;
 }
@@ -1,20 +1,326 @@
 #ifndef VM_H
 #define VM_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
 #include <vector>
 #include "../include/Bytecode.h"
+#include "../include/HostBindings.h"
+#include "../include/NativeTable.h"
+#include "../include/RunError.h"
+#include "Array.h"
+#include "HashMap.h"
+
+/**
+ * @brief A function activation record.
+ * Frames live in one contiguous preallocated array; the frame's slots (arguments first,
+ * then locals) live on the operand stack starting at base, so calls copy nothing.
+ */
+struct Frame {
+    int return_pc; // Instruction to resume at after RET
+    int base;      // Operand stack index of the frame's slot 0
+};
+
+/**
+ * @brief The VM's operand stack: a growable array of values with the std::vector operations
+ * the interpreter uses.
+ * The layout is public so that JIT-compiled code can push and pop in place. One writable
+ * guard slot sits below values[0], so the JIT can always write back the top of stack it
+ * keeps in a register, even when the stack is empty.
+ */
+class ValueStack {
+public:
+    double* values;  // Element 0; values[-1] is the guard slot
+    size_t count;    // Number of elements
+    size_t capacity; // Elements that fit before the storage must grow
+
+    ValueStack() : values(nullptr), count(0), capacity(0) { reserve(64); }
+    ~ValueStack() { delete[] (values - 1); }
+    ValueStack(const ValueStack&) = delete;
+    ValueStack& operator=(const ValueStack&) = delete;
+
+    void reserve(size_t minimum) {
+        if (minimum <= capacity) return;
+        size_t grown = std::max(minimum, capacity * 2);
+        double* storage = new double[grown + 1];
+        if (values) {
+            std::copy(values - 1, values + count, storage);
+            delete[] (values - 1);
+        } else {
+            storage[0] = 0.0;
+        }
+        values = storage + 1;
+        capacity = grown;
+    }
+    void push_back(double value) {
+        if (count == capacity) reserve(count + 1);
+        values[count++] = value;
+    }
+    void pop_back() { count--; }
+    double& back() { return values[count - 1]; }
+    double& operator[](size_t index) { return values[index]; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    void clear() { count = 0; }
+    void resize(size_t newCount) { // New elements are zeroed
+        reserve(newCount);
+        if (newCount > count) std::fill(values + count, values + newCount, 0.0);
+        count = newCount;
+    }
+    void assign(size_t newCount, double value) {
+        reserve(newCount);
+        std::fill(values, values + newCount, value);
+        count = newCount;
+    }
+    double* begin() { return values; }
+    double* end() { return values + count; }
+};
+
+/**
+ * @brief The strings a run makes, kept from one run to the next.
+ * reset() rewinds the arena in O(1); later strings reuse the objects (and the buffers they
+ * grew) of earlier runs, so a warmed VM makes strings without allocating.
+ */
+class StringArena {
+public:
+    void reset() { count = 0; }
+    size_t size() const { return count; }
+    StringObject& operator[](size_t index) { return strings[index]; }
+    const StringObject& operator[](size_t index) const { return strings[index]; }
+
+    // Adds first + second as the newest string and returns its position. Growing the arena
+    // moves the strings, so the text is built before the new object is added.
+    size_t add(std::string_view first, std::string_view second = std::string_view()) {
+        if (count == strings.size()) {
+            std::string text;
+            text.reserve(first.size() + second.size());
+            text.append(first.data(), first.size()).append(second.data(), second.size());
+            strings.emplace_back(std::move(text));
+        } else {
+            strings[count].assign(first, second);
+        }
+        return count++;
+    }
+
+private:
+    std::vector<StringObject> strings; // The first count are this run's; the rest wait for reuse
+    size_t count = 0;
+};
+
+// Run-time strings of a session are numbered from here, past any literal count, so that the
+// handles globals hold stay valid as later pieces add literals (see VM::runAppended)
+const size_t kSessionStringBase = size_t(1) << 32;
+
+/**
+ * @brief Run-time data a VM shares with the parallel for workers it starts.
+ * Workers only read it, except for array elements: each iteration writes its own.
+ */
+struct Heap {
+    std::vector<double> memory; // Global variables
+    const std::vector<StringObject>* literals = nullptr; // The program's string literals (each caches its hash); never written
+    StringArena strings; // Strings made while running (concatenations, host inputs), numbered from string_base
+    size_t string_base = 0; // Handle of the first run-time string: the literal count, or kSessionStringBase in a session
+    // Arrays live for the whole run; values on the stack and in memory refer to them by index
+    std::vector<Array> arrays;
+    std::vector<HashMap> maps; // Same scheme as arrays, with handles indexing this vector
+};
+
+/**
+ * @brief A compiled program prepared to run on any number of VMs at once (see VM::run(const Executable&)).
+ * Nothing in it changes after construction: the string literals' hashes are computed up front,
+ * and everything a run writes (stack, globals, new strings, hotness counters, the optimized
+ * version) belongs to the VM running it. So VMs on different threads can run one Executable
+ * without locks, and without copying it.
+ */
+class Executable {
+public:
+    Executable(std::vector<Bytecode> bytecode, std::vector<std::string> string_literals, size_t global_count);
+    // Runs instructions held elsewhere, such as in a mapped bytecode image, without copying them
+    Executable(BytecodeView code, std::vector<std::string> string_literals, size_t global_count);
+    Executable(const Executable&) = delete; // code may point into bytecode
+    Executable& operator=(const Executable&) = delete;
+
+    const std::vector<Bytecode>& getBytecode() const { return bytecode; } // The instructions it owns (none if made over a view)
+    BytecodeView getCode() const { return code; } // The instructions it runs
+    const std::vector<std::string>& getStringLiterals() const { return string_literals; }
+    const std::vector<StringObject>& getStrings() const { return strings; }
+    size_t getGlobalCount() const { return global_count; }
+    uint64_t getId() const { return id; } // Unique in the process, so a VM can tell a program it ran before
 
-class VM {
 private:
     std::vector<Bytecode> bytecode;
-    std::vector<double> stack; // Use double to store both ints and floats
-    std::vector<double> memory; // New: For variable storage
-    std::vector<std::string> string_literals; // New: To store string literals
+    BytecodeView code; // bytecode, or the instructions given to the second constructor
+    std::vector<std::string> string_literals;
+    std::vector<StringObject> strings; // string_literals as the VM uses them, already hashed
+    size_t global_count;
+    uint64_t id;
+};
+
+/**
+ * @brief Where a run driven by VM::step() stands after a slice.
+ */
+enum class StepStatus {
+    PAUSED, // The fuel ran out; step() again to continue
+    HALTED, // The program reached HALT
+    FAILED  // A runtime error was reported (including an exceeded limit; see getRunError())
+};
+
+/**
+ * @brief The interpreter. A VM is one thread's execution state; to run a program on several
+ * threads at once, give each its own VM and share the program as an Executable.
+ * Aligned to a cache line, so VMs allocated side by side for different threads never share
+ * a line of mutable state.
+ */
+class alignas(64) VM {
+private:
+    std::vector<Bytecode> bytecode; // Copy of the instructions passed to run(code, count, ...)
+    std::vector<StringObject> own_literals; // Copy of the string literals passed to run(code, count, ...)
+    BytecodeView original; // The program as compiled: bytecode, or an Executable's
+    BytecodeView program; // The executing program: original or optimized, or the starting VM's for a worker
+    ValueStack stack; // Use double to store both ints and floats
+    Heap own_heap;
+    Heap* heap; // own_heap, or the starting VM's for a parallel for worker
+    bool parallel_worker; // Runs chunks of a parallel for (shared arrays must not change representation)
+    bool halted; // Set when execute() stops at HALT rather than on an error
     int pc; // Program counter
+    std::vector<Frame> frames; // Call-frame stack, sized to max_frames at the start of a run
+    int frame_count; // Number of active frames
+    int fp; // Operand stack index of the current frame's slot 0 (0 at the top level)
+    size_t max_frames; // Maximum call depth
+    bool trace; // Print the DEBUG line for every executed instruction
+    std::ostream* errors; // Where runtime errors are reported: std::cerr, or a worker's buffer
+    std::ostream* output; // Where print statements and trace lines go: std::cout unless set
+    NativeTable own_natives; // Host functions bound with bind()
+    const NativeTable* natives; // Host functions CALL_NATIVE indexes: own_natives, or the table given to setNatives()
+    const HostBindings* inputs; // Host memory filling globals 0..n-1 at the start of each run, or null
+
+    // Back-edge instrumentation: every backward jump goes through onBackEdge()
+    std::vector<uint32_t> back_edge_counts; // Hotness counter per back-edge target
+    uint64_t back_edges_taken;              // Total backward jumps taken in this run
+    uint64_t back_edge_budget;              // Maximum backward jumps per run (0 = unlimited)
+
+    // Execution limits, all checked at one back-edge count and one call count (see checkLimits()), so loops and
+    // recursion pay a single compare
+    uint64_t limit_check_at;       // back_edges_taken at which checkLimits() runs next (UINT64_MAX without limits)
+    uint64_t calls_taken;          // Function calls made in this run (tail calls reuse a frame and are not counted)
+    uint64_t call_check_at;        // calls_taken at which checkLimits() runs next (UINT64_MAX without limits)
+    uint64_t instruction_budget;   // Maximum instructions per run, counted per loop iteration and call (0 = unlimited)
+    uint64_t instructions_counted; // Instructions of the loop iterations this run took: each back-edge adds its loop's length
+    uint32_t deadline_ms;          // Longest a run may take, in milliseconds (0 = no deadline)
+    uint64_t deadline;             // When this run's deadline passes, on the coarse clock (in milliseconds)
+    size_t max_string_bytes;       // Maximum bytes of strings CONCAT_STRING makes per run (0 = unlimited)
+    size_t string_bytes;           // Bytes of strings CONCAT_STRING made in this run
+    RunError run_error;            // The limit that stopped this run, or NONE
+
+    bool jit; // Run programs as x86-64 machine code when possible (see JIT.h)
+    bool closures; // Run programs as pre-bound handlers (see ClosureCompiler.h) where the JIT does not
+
+    // Tiered execution: a program that gets hot switches to its optimized version (see Optimizer.h)
+    uint32_t tier_up_threshold;        // Back-edges to one loop header, or calls to one function, that make a program hot (0 = never)
+    bool tiering;                      // Counting toward tier-up in this run (off once optimized, while tracing, and in workers)
+    std::vector<uint32_t> call_counts; // Hotness counter per function entry
+    std::vector<Bytecode> optimized;   // The optimized program, kept for the next run of the same bytecode
+    uint64_t optimized_for;            // Id of the Executable optimized belongs to, or 0 for bytecode
+    std::vector<int> optimized_source_pcs; // Instruction of bytecode each optimized instruction starts at
+    const std::vector<int>* source_pcs; // optimized_source_pcs (the starting VM's for a worker) while running the optimized program, else null
+    bool compiled_handover; // execute() stopped after tier-up so that run() continues in compiled code
+    bool stepping; // The run was started by begin(): it stays in the interpreter, where step() can pause it anywhere
+
+    // Runs from pc until HALT (setting halted) or an error (returning -1); with fuel, returns 0 after that many instructions
+    double execute(uint64_t fuel = 0);
+    double start(BytecodeView code, const std::vector<StringObject>* literals, size_t global_count, bool optimizedBefore);
+    void prepare(BytecodeView code, const std::vector<StringObject>* literals, size_t global_count, bool optimizedBefore);
+    bool onBackEdge(int& target);
+    void reportBackEdgeBudget(int target);
+    void startLimits(); // Resets the limit counters for a new run
+    bool checkLimits(int target); // At limit_check_at or call_check_at: false (after reporting) if a limit is exceeded
+    void scheduleLimitCheck();
+    uint64_t instructionsUsed() const { return instructions_counted + calls_taken; } // Each call counts as one
+    bool tierUp();
+    bool runCompiled(double& result);
+    void bindInputs();
+    Array* getArray(double handle, const char* operation); // Null (after reporting) if handle is not an array
+    HashMap* getMap(double handle, const char* operation); // Null (after reporting) if handle is not a map
+    bool callBuiltin(const Bytecode& instruction);
+    bool executeMapInstruction(const Bytecode& instruction);
+    bool executeParallelFor(const Bytecode& instruction);
+
+    friend class JIT;
+    friend class ClosureCompiler;
+    friend class HandlerBuilder;
 
 public:
     VM();
     double run(const std::vector<Bytecode>& bytecode, const std::vector<std::string>& string_literals);
+    double run(const Bytecode* code, size_t count, const std::vector<std::string>& string_literals, size_t global_count = 0);
+    double run(const Executable& executable);
+    /**
+     * @brief Runs the newest piece of a program that grows by appending (see Session.h), keeping
+     * the globals, arrays, maps and strings earlier pieces left, in the interpreter only: the
+     * program is read in place, and neither tiered up nor compiled, whose cost would grow with it.
+     * @param code The whole program so far; it may have moved or grown since the last call.
+     * @param literals Its string literals, which later pieces only append to.
+     * @param global_count The number of global variable slots it uses.
+     * @param entry The first instruction of the piece to run.
+     * @param fresh Start from an empty heap, as for a new session.
+     * @return The final value on the stack if the piece halts, or -1 in case of an error.
+     */
+    double runAppended(const std::vector<Bytecode>& code, const std::vector<StringObject>& literals, size_t global_count,
+                       int entry, bool fresh);
+
+    /**
+     * @brief Starts a run of a shared program without executing anything; step() then runs it
+     * in slices. Between slices the VM holds the whole paused run (pc, stack, frames, heap),
+     * so one thread can interleave many VMs, and no script holds its thread for longer than
+     * a slice. Stepped runs may tier up, but stay in the interpreter (setJit and setClosures
+     * do not apply), since compiled code runs to the end.
+     * @param executable The program; it must stay alive until the run is over.
+     */
+    void begin(const Executable& executable);
+
+    /**
+     * @brief Continues the run started by begin() for at most fuel instructions. Parallel for
+     * loops, builtins and host functions count as one instruction each. The back-edge budget
+     * (setBackEdgeBudget) still limits the whole run, not a slice.
+     * @param fuel Instructions to run before pausing (0 = until the run is over).
+     * @param value Set to the value on top of the stack when the run halts, or -1 when it fails.
+     */
+    StepStatus step(uint64_t fuel, double& value);
+
+    void setTrace(bool enabled) { trace = enabled; }
+    void setErrorStream(std::ostream& stream) { errors = &stream; } // Runtime errors go to std::cerr unless set
+    void setOutputStream(std::ostream& stream) { output = &stream; }
+    // Binds a host function in this VM's own table (which it then uses); compile with setNatives(&getNatives())
+    template <typename R, typename... Args>
+    int bind(const std::string& name, R (*function)(Args...)) {
+        natives = &own_natives;
+        return own_natives.bind(name, function);
+    }
+    void setNatives(const NativeTable& table) { natives = &table; } // Uses a table shared with other VMs instead
+    const NativeTable& getNatives() const { return *natives; }
+    // Host memory for the inputs the program was compiled with (Compiler::setInputs); read at the start of each run
+    void setInputs(const HostBindings* bindings) { inputs = bindings; }
+    void setJit(bool enabled) { jit = enabled; } // Ignored while tracing or where the JIT is unsupported
+    void setClosures(bool enabled) { closures = enabled; } // Ignored while tracing
+    void setBackEdgeBudget(uint64_t budget) { back_edge_budget = budget; }
+    // Counted at back-edges: each loop iteration adds the instructions from its header to its backward jump,
+    // and calls in it count as one. Runs with a budget stay in the interpreter, which knows the lengths.
+    void setInstructionBudget(uint64_t budget) { instruction_budget = budget; }
+    void setDeadline(uint32_t milliseconds) { deadline_ms = milliseconds; } // Polled from a coarse clock every few thousand back-edges
+    void setMaxStringBytes(size_t bytes) { max_string_bytes = bytes; }
+    RunError getRunError() const { return run_error; } // The limit that stopped the last run, or NONE (other errors are only reported)
+    void setMaxFrames(size_t count) { max_frames = count; }
+    void setTierUpThreshold(uint32_t count) { tier_up_threshold = count; } // 0 disables tier-up
+    // Hotness counters are indexed by instruction of the program running (the optimized one once getTier() is 1)
+    const std::vector<uint32_t>& getBackEdgeCounts() const { return back_edge_counts; }
+    const std::vector<uint32_t>& getCallCounts() const { return call_counts; }
+    uint64_t getBackEdgesTaken() const { return back_edges_taken; }
+    const StringObject* getString(double index) const; // The string a value names, or null if it names no literal or run-time string
+    int getTier() const { return source_pcs ? 1 : 0; } // 0 while running the bytecode as compiled, 1 once running its optimized version
 };
 
 #endif // VM_H
@@ -0,0 +1,124 @@
+#include "Verifier.h"
+#include <algorithm>
+
+bool computeStackHeights(const Bytecode* program, size_t size, std::vector<int>& heights, int& maxHeight) {
+    int end = static_cast<int>(size);
+    heights.assign(size, -1);
+    maxHeight = 0;
+    std::vector<std::pair<int, int>> work = {{0, 0}};
+    auto reach = [&](int target, int height) {
+        if (target < 0) return false;
+        if (target >= end) return true; // Runs off the end: an interpreter error, not a stack problem
+        if (heights[target] == -1) {
+            heights[target] = height;
+            work.push_back({target, height});
+            return true;
+        }
+        return heights[target] == height;
+    };
+    if (end == 0) return true;
+    heights[0] = 0;
+
+    while (!work.empty()) {
+        int pc = work.back().first;
+        int height = work.back().second;
+        work.pop_back();
+        const Bytecode& instruction = program[pc];
+        int target = static_cast<int>(instruction.operand);
+        int pops = 0;
+        int pushes = 0;
+        bool fallsThrough = true;
+        switch (instruction.instruction) {
+            case Instruction::PUSH_INT:
+            case Instruction::PUSH_FLOAT:
+            case Instruction::PUSH_STRING:
+                pushes = 1;
+                break;
+            case Instruction::ADD: case Instruction::SUB: case Instruction::MUL: case Instruction::DIV:
+            case Instruction::GREATER: case Instruction::LESS: case Instruction::GREATER_EQUAL:
+            case Instruction::LESS_EQUAL: case Instruction::EQUAL_EQUAL: case Instruction::BANG_EQUAL:
+            case Instruction::CONCAT_STRING: case Instruction::STORE: case Instruction::ARRAY_GET:
+            case Instruction::MAP_GET: case Instruction::MAP_HAS: case Instruction::MAP_DELETE:
+                pops = 2; pushes = 1;
+                break;
+            case Instruction::NEGATE: case Instruction::NOT: case Instruction::LOAD:
+                pops = 1; pushes = 1;
+                break;
+            case Instruction::POP: case Instruction::PRINT_VALUE: case Instruction::PRINT_STRING:
+            case Instruction::PRINT_ARRAY: case Instruction::PARALLEL_REDUCE:
+                pops = 1;
+                break;
+            case Instruction::ARRAY_SET: case Instruction::MAP_SET:
+                pops = 3; pushes = 1;
+                break;
+            case Instruction::HALT:
+                fallsThrough = false;
+                break;
+            case Instruction::JUMP:
+                if (!reach(target, height)) return false;
+                fallsThrough = false;
+                break;
+            case Instruction::JUMP_IF_FALSE:
+            case Instruction::JUMP_IF_TRUE:
+                if (height < 1 || !reach(target, height - 1)) return false;
+                pops = 1;
+                break;
+            case Instruction::LOOP_INC_CMP_JUMP:
+            case Instruction::LOOP_INC_CMP_JUMP_LOCAL:
+                if (height < 1 || !reach(target, height - 1)) return false;
+                if (instruction.instruction == Instruction::LOOP_INC_CMP_JUMP_LOCAL &&
+                    (instruction.operand2 < 0 || instruction.operand2 >= height - 1)) return false;
+                pops = 1;
+                break;
+            case Instruction::LOAD_LOCAL:
+            case Instruction::STORE_LOCAL:
+                if (target < 0 || target >= height) return false;
+                pops = instruction.instruction == Instruction::STORE_LOCAL ? 1 : 0;
+                pushes = pops;
+                if (instruction.instruction == Instruction::LOAD_LOCAL) pushes = 1;
+                if (instruction.instruction == Instruction::STORE_LOCAL && instruction.operand2) pushes = 0;
+                break;
+            case Instruction::LOAD_GLOBAL:
+                pushes = 1;
+                break;
+            case Instruction::STORE_GLOBAL:
+                pops = 1;
+                pushes = instruction.operand2 ? 0 : 1;
+                break;
+            case Instruction::CALL:
+            case Instruction::TAIL_CALL:
+                if (instruction.operand2 < 0 || instruction.operand3 < instruction.operand2) return false;
+                if (!reach(target, instruction.operand3)) return false;
+                pops = instruction.operand2;
+                pushes = 1; // The return value, once the callee returns to the next instruction
+                fallsThrough = instruction.instruction == Instruction::CALL;
+                break;
+            case Instruction::RET:
+                pops = 1;
+                fallsThrough = false;
+                break;
+            case Instruction::NEW_ARRAY:
+                pops = target; pushes = 1;
+                break;
+            case Instruction::CALL_BUILTIN:
+            case Instruction::CALL_NATIVE:
+                pops = instruction.operand2; pushes = 1;
+                break;
+            case Instruction::PARALLEL_FOR: {
+                if (!reach(target, instruction.operand2)) return false;
+                pops = 2;
+                for (size_t next = pc + 1; next < size && program[next].instruction == Instruction::PARALLEL_REDUCE; ++next) {
+                    pushes++;
+                }
+                break;
+            }
+            default:
+                return false; // AND, OR and unknown instructions are interpreter errors; leave them to it
+        }
+        if (pops < 0 || height < pops) return false;
+        int after = height - pops + pushes;
+        maxHeight = std::max(maxHeight, std::max(height, after));
+        if (fallsThrough && !reach(pc + 1, after)) return false;
+    }
+    return true;
+}
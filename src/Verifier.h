@@ -0,0 +1,24 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include <cstddef>
+#include <vector>
+#include "../include/Bytecode.h"
+
+/**
+ * @brief Computes the operand stack height (relative to the frame) before every reachable
+ * instruction, starting from instruction 0 and from every call and parallel for entry.
+ * Backends that give each stack slot a fixed place (the JIT and the C backend) rely on it.
+ * @param program The bytecode to check.
+ * @param heights Receives the height before each instruction; unreachable instructions keep -1.
+ * @param maxHeight Receives the largest height of any instruction.
+ * @return False if an instruction could pop below its frame, heights disagree where paths
+ * meet, a local slot lies outside its frame, or an instruction is unknown to the VM.
+ */
+bool computeStackHeights(const Bytecode* program, size_t size, std::vector<int>& heights, int& maxHeight);
+
+inline bool computeStackHeights(BytecodeView program, std::vector<int>& heights, int& maxHeight) {
+    return computeStackHeights(program.data(), program.size(), heights, maxHeight);
+}
+
+#endif // VERIFIER_H